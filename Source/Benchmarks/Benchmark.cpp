@@ -0,0 +1,39 @@
+#include "Benchmark.h"
+
+namespace esperanza::benchmarks
+{
+	BenchmarkRegistrar::BenchmarkRegistrar(const char* pszName, PFN_BENCHMARK pfnRun) noexcept
+	{
+		GetBenchmarks().push_back({ .pszName = pszName, .pfnRun = pfnRun });
+	}
+
+	std::vector<BenchmarkCase>& GetBenchmarks() noexcept
+	{
+		// Function local so registration from other translation units never sees it uninitialized
+		static std::vector<BenchmarkCase> s_Benchmarks;
+
+		return s_Benchmarks;
+	}
+
+	void SummarizeLatencies(LatencySummary& outSummary, std::vector<UINT64>& samples) noexcept
+	{
+		outSummary = {};
+		if (samples.empty())
+		{
+			return;
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		const auto percentile = [&samples](double fraction) noexcept
+		{
+			const size_t uIndex = std::min(samples.size() - 1, static_cast<size_t>(fraction * static_cast<double>(samples.size())));
+			return samples[uIndex];
+		};
+
+		outSummary.uP50Nanoseconds = percentile(0.5);
+		outSummary.uP99Nanoseconds = percentile(0.99);
+		outSummary.uP999Nanoseconds = percentile(0.999);
+		outSummary.uMaxNanoseconds = samples.back();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Pch.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace esperanza::benchmarks
+{
+	typedef void (*PFN_BENCHMARK)();
+
+	struct BenchmarkCase
+	{
+		const char* pszName;
+		PFN_BENCHMARK pfnRun;
+	};
+
+	struct LatencySummary
+	{
+		UINT64 uP50Nanoseconds;
+		UINT64 uP99Nanoseconds;
+		UINT64 uP999Nanoseconds;
+		UINT64 uMaxNanoseconds;
+	};
+
+	class BenchmarkRegistrar final
+	{
+	public:
+		explicit BenchmarkRegistrar(_In_ const char* pszName, _In_ PFN_BENCHMARK pfnRun) noexcept;
+	};
+
+	std::vector<BenchmarkCase>& GetBenchmarks() noexcept;
+
+	// Sorts the samples in place
+	void SummarizeLatencies(_Out_ LatencySummary& outSummary, _Inout_ std::vector<UINT64>& samples) noexcept;
+
+	inline UINT64 GetTimeNanoseconds() noexcept
+	{
+		return static_cast<UINT64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+}
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static const esperanza::benchmarks::BenchmarkRegistrar s_##name##Registrar(#name, name); \
+	static void name()
@@ -0,0 +1,32 @@
+#include "Benchmark.h"
+
+// Runs every registered benchmark, or only those named on the command line
+INT wmain(_In_ INT argc, _In_reads_(argc) WCHAR** argv)
+{
+	esperanza::g_Log.Initialize(esperanza::Log::eVerbosity::Error);
+
+	INT nNumRun = 0;
+	for (const esperanza::benchmarks::BenchmarkCase& benchmark : esperanza::benchmarks::GetBenchmarks())
+	{
+		BOOL bIsSelected = argc <= 1;
+		for (INT i = 1; i < argc && !bIsSelected; ++i)
+		{
+			WCHAR szName[128];
+			swprintf_s(szName, L"%hs", benchmark.pszName);
+			bIsSelected = wcscmp(szName, argv[i]) == 0;
+		}
+
+		if (!bIsSelected)
+		{
+			continue;
+		}
+
+		printf("== %s\n", benchmark.pszName);
+		benchmark.pfnRun();
+		++nNumRun;
+	}
+
+	esperanza::g_Log.Destroy();
+
+	return nNumRun > 0 ? 0 : 1;
+}
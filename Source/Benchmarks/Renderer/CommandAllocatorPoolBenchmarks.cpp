@@ -0,0 +1,104 @@
+#include "Benchmark.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/CommandAllocatorPool.h"
+
+#include <thread>
+
+namespace esperanza::benchmarks
+{
+	namespace
+	{
+		constexpr const uint32_t MAX_NUM_THREADS = 16u;
+		constexpr const uint32_t NUM_REQUESTS_PER_THREAD = 32768u;
+
+		// The simulated GPU completes fences this many submissions behind the newest one, and falls further
+		// behind for one burst of BURST_LENGTH requests out of every BURST_PERIOD
+		constexpr const UINT64 FENCE_LAG = 16u;
+		constexpr const UINT64 BURST_FENCE_LAG = 256u;
+		constexpr const uint32_t BURST_PERIOD = 8192u;
+		constexpr const uint32_t BURST_LENGTH = 1024u;
+	}
+
+	// Requests per second and request latency from 1 to 16 threads sharing one pool, and how far the pool grows
+	// when completion falls behind in bursts and is trimmed back afterwards.  Each thread discards the allocator
+	// it got with the next fence value right away, as a context does when it is finished.  WARP stands in for
+	// the GPU, its allocators are only created and reset.
+	BENCHMARK(CommandAllocatorPoolContentionAndGrowth)
+	{
+		ID3D12Device* pDevice = tests::GetHeadlessDevice();
+		if (pDevice == nullptr)
+		{
+			printf("skipped, no WARP device\n");
+
+			return;
+		}
+
+		printf("%3s %12s %8s %8s %10s %10s %8s %8s %8s\n", "thr", "requests/s", "p50 ns", "p99 ns", "allocators", "high water", "created", "reused", "trimmed");
+
+		for (uint32_t uNumThreads = 1; uNumThreads <= MAX_NUM_THREADS; uNumThreads *= 2)
+		{
+			std::unique_ptr<CommandAllocatorPool> pPool = std::make_unique<CommandAllocatorPool>(D3D12_COMMAND_LIST_TYPE_DIRECT);
+			pPool->Initialize(pDevice);
+
+			std::atomic<UINT64> uNextFenceValue = 1;
+			std::atomic<BOOL> bStart = FALSE;
+			std::vector<std::vector<UINT64>> latencies(uNumThreads, std::vector<UINT64>(NUM_REQUESTS_PER_THREAD));
+
+			std::vector<std::thread> threads;
+			for (uint32_t uThread = 0; uThread < uNumThreads; ++uThread)
+			{
+				threads.emplace_back(
+					[&, uThread]()
+					{
+						while (!bStart.load(std::memory_order_acquire))
+						{
+							std::this_thread::yield();
+						}
+
+						for (uint32_t i = 0; i < NUM_REQUESTS_PER_THREAD; ++i)
+						{
+							const UINT64 uFenceLag = i % BURST_PERIOD < BURST_LENGTH ? BURST_FENCE_LAG : FENCE_LAG;
+							const UINT64 uLastSubmittedFenceValue = uNextFenceValue.load(std::memory_order_relaxed) - 1;
+							const UINT64 uCompletedFenceValue = uLastSubmittedFenceValue > uFenceLag ? uLastSubmittedFenceValue - uFenceLag : 0;
+
+							ID3D12CommandAllocator* pAllocator = nullptr;
+							const UINT64 uStartTime = GetTimeNanoseconds();
+							const HRESULT hr = pPool->RequestAllocator(&pAllocator, uCompletedFenceValue);
+							latencies[uThread][i] = GetTimeNanoseconds() - uStartTime;
+
+							if (SUCCEEDED(hr))
+							{
+								pPool->DiscardAllocator(uNextFenceValue.fetch_add(1, std::memory_order_relaxed), pAllocator);
+							}
+						}
+					}
+				);
+			}
+
+			const UINT64 uStartTime = GetTimeNanoseconds();
+			bStart.store(TRUE, std::memory_order_release);
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+			const UINT64 uElapsedNanoseconds = std::max<UINT64>(GetTimeNanoseconds() - uStartTime, 1);
+
+			CommandAllocatorPoolStatistics statistics;
+			pPool->GetStatistics(statistics);
+			pPool->Destroy();
+
+			std::vector<UINT64> allLatencies;
+			for (const std::vector<UINT64>& samples : latencies)
+			{
+				allLatencies.insert(allLatencies.end(), samples.begin(), samples.end());
+			}
+
+			LatencySummary summary;
+			SummarizeLatencies(summary, allLatencies);
+
+			printf("%3u %12.0f %8llu %8llu %10zu %10zu %8zu %8zu %8zu\n", uNumThreads, static_cast<double>(allLatencies.size()) * 1e9 / static_cast<double>(uElapsedNanoseconds),
+				summary.uP50Nanoseconds, summary.uP99Nanoseconds, statistics.uNumAllocators, statistics.uHighWaterMark, statistics.uNumCreated, statistics.uNumReused, statistics.uNumTrimmed);
+		}
+	}
+}
@@ -0,0 +1,142 @@
+#include "Benchmark.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/CommandContext.h"
+#include "Renderer/CommandListManager.h"
+
+#include <thread>
+
+namespace esperanza::benchmarks
+{
+	namespace
+	{
+		constexpr const uint32_t MAX_NUM_THREADS = 8u;
+		constexpr const uint32_t NUM_CONTEXTS_PER_THREAD = 2048u;
+		constexpr const uint32_t NUM_COMMANDS_PER_CONTEXT = 64u;
+
+		// Every thread ends a frame after this many contexts, which flushes the batches as Display::Present does
+		constexpr const uint32_t NUM_CONTEXTS_PER_FRAME = 64u;
+
+		enum class eSubmitMode : uint8_t
+		{
+			Batched,
+			FlushEveryList,
+		};
+	}
+
+	// Contexts begun, recorded and finished per second from 1 to 8 threads, with lists batched until the end
+	// of a frame against lists flushed one by one as every Finish used to.  WARP stands in for the GPU and the
+	// lists only set viewport, scissor and topology, so the cost measured is the context and submission path.
+	BENCHMARK(CommandContextRecordingAndSubmission)
+	{
+		ID3D12Device* pDevice = tests::GetHeadlessDevice();
+		if (pDevice == nullptr)
+		{
+			printf("skipped, no WARP device\n");
+
+			return;
+		}
+
+		const D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+		const D3D12_RECT scissorRect = { 0, 0, 1920, 1080 };
+
+		printf("%-16s %3s %12s %8s %8s\n", "mode", "thr", "lists/s", "p50 ns", "p99 ns");
+
+		for (eSubmitMode mode : { eSubmitMode::Batched, eSubmitMode::FlushEveryList })
+		{
+			for (uint32_t uNumThreads = 1; uNumThreads <= MAX_NUM_THREADS; uNumThreads *= 2)
+			{
+				std::shared_ptr<CommandListManager> pCommandListManager = std::make_shared<CommandListManager>();
+				if (FAILED(pCommandListManager->Initialize(pDevice)))
+				{
+					printf("skipped, creating the command list manager failed\n");
+
+					return;
+				}
+
+				std::unique_ptr<ContextManager> pContextManager = std::make_unique<ContextManager>();
+				pContextManager->Initialize(pCommandListManager);
+
+				std::atomic<BOOL> bStart = FALSE;
+				std::atomic<uint32_t> uNumFailures = 0;
+				std::vector<std::vector<UINT64>> latencies(uNumThreads, std::vector<UINT64>(NUM_CONTEXTS_PER_THREAD));
+
+				std::vector<std::thread> threads;
+				for (uint32_t uThread = 0; uThread < uNumThreads; ++uThread)
+				{
+					threads.emplace_back(
+						[&, uThread]()
+						{
+							while (!bStart.load(std::memory_order_acquire))
+							{
+								std::this_thread::yield();
+							}
+
+							for (uint32_t i = 0; i < NUM_CONTEXTS_PER_THREAD; ++i)
+							{
+								const UINT64 uStartTime = GetTimeNanoseconds();
+
+								GraphicsContext* pContext = nullptr;
+								if (FAILED(pContextManager->BeginGraphicsContext(&pContext, L"Benchmark")))
+								{
+									uNumFailures.fetch_add(1, std::memory_order_relaxed);
+
+									continue;
+								}
+
+								for (uint32_t uCommand = 0; uCommand < NUM_COMMANDS_PER_CONTEXT; ++uCommand)
+								{
+									pContext->SetViewportAndScissor(viewport, scissorRect);
+									pContext->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+								}
+
+								UINT64 uFenceValue = 0;
+								HRESULT hr = pContext->Finish(uFenceValue);
+								if (SUCCEEDED(hr) && (mode == eSubmitMode::FlushEveryList || (i + 1) % NUM_CONTEXTS_PER_FRAME == 0))
+								{
+									hr = pCommandListManager->GetGraphicsQueue().FlushCommandLists();
+								}
+
+								latencies[uThread][i] = GetTimeNanoseconds() - uStartTime;
+
+								if (FAILED(hr))
+								{
+									uNumFailures.fetch_add(1, std::memory_order_relaxed);
+								}
+							}
+						}
+					);
+				}
+
+				const UINT64 uStartTime = GetTimeNanoseconds();
+				bStart.store(TRUE, std::memory_order_release);
+				for (std::thread& thread : threads)
+				{
+					thread.join();
+				}
+				const UINT64 uElapsedNanoseconds = std::max<UINT64>(GetTimeNanoseconds() - uStartTime, 1);
+
+				pCommandListManager->IdleGpu();
+				pContextManager->Destroy();
+				pCommandListManager->Destroy();
+
+				std::vector<UINT64> allLatencies;
+				for (const std::vector<UINT64>& samples : latencies)
+				{
+					allLatencies.insert(allLatencies.end(), samples.begin(), samples.end());
+				}
+
+				LatencySummary summary;
+				SummarizeLatencies(summary, allLatencies);
+
+				printf("%-16s %3u %12.0f %8llu %8llu\n", mode == eSubmitMode::Batched ? "batched" : "flush every list", uNumThreads,
+					static_cast<double>(allLatencies.size()) * 1e9 / static_cast<double>(uElapsedNanoseconds), summary.uP50Nanoseconds, summary.uP99Nanoseconds);
+
+				if (uNumFailures.load(std::memory_order_relaxed) > 0)
+				{
+					printf("%u contexts failed\n", uNumFailures.load(std::memory_order_relaxed));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/DescriptorHeap.h"
+
+#include <barrier>
+#include <thread>
+
+namespace esperanza::benchmarks
+{
+	namespace
+	{
+		constexpr const uint32_t MAX_NUM_THREADS = 32u;
+		constexpr const uint32_t NUM_ROUNDS = 256u;
+		constexpr const uint32_t NUM_ALLOCATIONS_PER_ROUND = 256u;
+
+		// Every thread allocates a batch of views each round and then frees either its own batch or the one its
+		// neighbour allocated, which sends every range through the shared pool.  Returns the elapsed time.
+		UINT64 runAllocationRounds(_In_ ID3D12Device* pDevice, _In_ DescriptorAllocator& allocator, _In_ uint32_t uNumThreads, _In_ BOOL bIsFreedByNeighbour)
+		{
+			std::vector<std::vector<DescriptorAllocation>> batches(uNumThreads, std::vector<DescriptorAllocation>(NUM_ALLOCATIONS_PER_ROUND));
+			std::barrier<> roundBarrier(static_cast<ptrdiff_t>(uNumThreads));
+			std::atomic<BOOL> bStart = FALSE;
+
+			std::vector<std::thread> threads;
+			for (uint32_t uThread = 0; uThread < uNumThreads; ++uThread)
+			{
+				threads.emplace_back(
+					[&, uThread]()
+					{
+						const uint32_t uFreedBatch = bIsFreedByNeighbour ? (uThread + 1) % uNumThreads : uThread;
+
+						while (!bStart.load(std::memory_order_acquire))
+						{
+							std::this_thread::yield();
+						}
+
+						for (uint32_t uRound = 0; uRound < NUM_ROUNDS; ++uRound)
+						{
+							for (uint32_t i = 0; i < NUM_ALLOCATIONS_PER_ROUND; ++i)
+							{
+								allocator.Allocate(batches[uThread][i], pDevice, 1u + (i & 3u));
+							}
+
+							roundBarrier.arrive_and_wait();
+
+							for (const DescriptorAllocation& allocation : batches[uFreedBatch])
+							{
+								allocator.Free(allocation);
+							}
+
+							roundBarrier.arrive_and_wait();
+						}
+					}
+				);
+			}
+
+			const UINT64 uStartTime = GetTimeNanoseconds();
+			bStart.store(TRUE, std::memory_order_release);
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+
+			return std::max<UINT64>(GetTimeNanoseconds() - uStartTime, 1);
+		}
+	}
+
+	// Allocations and frees per second from 1 to 32 threads, with ranges freed by the allocating thread or by
+	// another one, and the number of heaps each run ends up with.  WARP stands in for the GPU, heaps are only
+	// created while the first rounds warm the allocator up.
+	BENCHMARK(DescriptorAllocatorThreadScaling)
+	{
+		ID3D12Device* pDevice = tests::GetHeadlessDevice();
+		if (pDevice == nullptr)
+		{
+			printf("skipped, no WARP device\n");
+
+			return;
+		}
+
+		printf("%-9s %3s %14s %6s\n", "free", "thr", "ops/s", "heaps");
+
+		for (BOOL bIsFreedByNeighbour : { FALSE, TRUE })
+		{
+			for (uint32_t uNumThreads = 1; uNumThreads <= MAX_NUM_THREADS; uNumThreads *= 2)
+			{
+				std::unique_ptr<DescriptorAllocator> pAllocator = std::make_unique<DescriptorAllocator>(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+				const UINT64 uElapsedNanoseconds = runAllocationRounds(pDevice, *pAllocator, uNumThreads, bIsFreedByNeighbour);
+
+				const double numOperations = 2.0 * NUM_ROUNDS * NUM_ALLOCATIONS_PER_ROUND * uNumThreads;
+				printf("%-9s %3u %14.0f %6u\n", bIsFreedByNeighbour ? "neighbour" : "own", uNumThreads, numOperations * 1e9 / static_cast<double>(uElapsedNanoseconds), pAllocator->GetNumHeaps());
+			}
+		}
+	}
+}
@@ -0,0 +1,142 @@
+#include "Benchmark.h"
+
+#include "Renderer/GpuResource.h"
+#include "Renderer/RenderGraph.h"
+
+namespace esperanza::benchmarks
+{
+	namespace
+	{
+		constexpr const uint32_t NUM_ITERATIONS = 200u;
+		constexpr const UINT64 PLACEMENT_ALIGNMENT = 64u * 1024u;
+
+		// Every tenth pass is a compute pass writing its target as an unordered access view
+		constexpr const uint32_t UAV_PASS_INTERVAL = 10u;
+
+		// Each pass reads the target of the pass before it and of the one four passes back, so lifetimes
+		// overlap by a few passes and most of the heap is aliased
+		constexpr const uint32_t LONG_READ_DISTANCE = 4u;
+
+		RenderGraphTextureDesc makeTextureDesc(_In_ uint32_t uPassIndex) noexcept
+		{
+			// A few sizes so placement does not only ever see identical blocks
+			const UINT uWidth = 1920u >> (uPassIndex % 3u);
+			const UINT uHeight = 1080u >> (uPassIndex % 3u);
+
+			RenderGraphTextureDesc desc = {};
+			desc.Desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, uWidth, uHeight, 1, 1, 1, 0,
+				D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+			desc.AllocationInfo.SizeInBytes = (static_cast<UINT64>(uWidth) * uHeight * 4u + PLACEMENT_ALIGNMENT - 1) & ~(PLACEMENT_ALIGNMENT - 1);
+			desc.AllocationInfo.Alignment = PLACEMENT_ALIGNMENT;
+
+			return desc;
+		}
+
+		HRESULT buildGraph(_In_ RenderGraph& graph, _In_ GpuResource& backBuffer, _In_ uint32_t uNumPasses) noexcept
+		{
+			graph.Reset();
+
+			RenderGraphResourceHandle backBufferHandle = RenderGraph::INVALID_HANDLE;
+			HRESULT hr = graph.ImportResource(backBufferHandle, backBuffer, D3D12_RESOURCE_STATE_PRESENT, L"Back Buffer");
+			if (FAILED(hr))
+			{
+				return hr;
+			}
+
+			std::vector<RenderGraphResourceHandle> handles(uNumPasses, RenderGraph::INVALID_HANDLE);
+			for (uint32_t i = 0; i < uNumPasses; ++i)
+			{
+				hr = graph.CreateTransientResource(handles[i], makeTextureDesc(i), L"Target");
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				uint32_t uPassIndex = 0;
+				hr = graph.AddPass(uPassIndex, L"Pass", nullptr, nullptr);
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				const D3D12_RESOURCE_STATES readState = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+				if (i >= 1)
+				{
+					hr = graph.ReadResource(uPassIndex, handles[i - 1], readState);
+				}
+				if (SUCCEEDED(hr) && i >= LONG_READ_DISTANCE)
+				{
+					hr = graph.ReadResource(uPassIndex, handles[i - LONG_READ_DISTANCE], readState);
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = graph.WriteResource(uPassIndex, handles[i],
+						i % UAV_PASS_INTERVAL == 0 ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_RENDER_TARGET);
+				}
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+			}
+
+			uint32_t uCompositePass = 0;
+			hr = graph.AddPass(uCompositePass, L"Composite", nullptr, nullptr);
+			if (SUCCEEDED(hr))
+			{
+				hr = graph.ReadResource(uCompositePass, handles[uNumPasses - 1], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			}
+			if (SUCCEEDED(hr))
+			{
+				hr = graph.WriteResource(uCompositePass, backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			}
+			if (FAILED(hr))
+			{
+				return hr;
+			}
+
+			return graph.Compile();
+		}
+	}
+
+	// Time to reset, declare and compile a chain of 100 to 1000 passes, along with the transient heap the
+	// placement ends up with against the sum of every transient, and the transitions and aliasing barriers
+	// planned.  Compile never touches the device, so this runs without one.
+	BENCHMARK(RenderGraphCompileScaling)
+	{
+		GpuResource backBuffer;
+
+		printf("%6s %10s %10s %10s %10s %8s %8s\n", "passes", "p50 us", "p99 us", "heap MB", "sum MB", "trans", "alias");
+
+		for (uint32_t uNumPasses : { 100u, 250u, 500u, 1000u })
+		{
+			RenderGraph graph;
+			std::vector<UINT64> latencies;
+			latencies.reserve(NUM_ITERATIONS);
+
+			for (uint32_t i = 0; i < NUM_ITERATIONS; ++i)
+			{
+				const UINT64 uStartTime = GetTimeNanoseconds();
+				if (FAILED(buildGraph(graph, backBuffer, uNumPasses)))
+				{
+					printf("building a graph of %u passes failed\n", uNumPasses);
+
+					return;
+				}
+
+				latencies.push_back(GetTimeNanoseconds() - uStartTime);
+			}
+
+			RenderGraphStatistics statistics;
+			graph.GetStatistics(statistics);
+			graph.Destroy();
+
+			LatencySummary summary;
+			SummarizeLatencies(summary, latencies);
+
+			printf("%6u %10.1f %10.1f %10.1f %10.1f %8u %8u\n", uNumPasses,
+				static_cast<double>(summary.uP50Nanoseconds) / 1e3, static_cast<double>(summary.uP99Nanoseconds) / 1e3,
+				static_cast<double>(statistics.uTransientHeapSize) / (1024.0 * 1024.0), static_cast<double>(statistics.uTransientBytesRequested) / (1024.0 * 1024.0),
+				statistics.uNumTransitionBarriers, statistics.uNumAliasBarriers);
+		}
+	}
+}
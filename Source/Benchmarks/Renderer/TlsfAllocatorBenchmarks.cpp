@@ -0,0 +1,174 @@
+#include "Benchmark.h"
+
+#include "Renderer/TlsfAllocator.h"
+
+#include <random>
+
+namespace esperanza::benchmarks
+{
+	namespace
+	{
+		constexpr const UINT64 HEAP_SIZE = 0x40000000;	// 1GB
+		constexpr const UINT64 GRANULARITY = 0x10000;	// 64KB, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+		constexpr const UINT64 MSAA_ALIGNMENT = 0x400000;	// 4MB, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT
+		constexpr const uint32_t NUM_CHURN_OPERATIONS = 200000u;
+
+		// Texture-like requests from 64KB to 16MB, small ones the most common and one in sixteen MSAA aligned
+		struct Request
+		{
+			UINT64 uSize;
+			UINT64 uAlignment;
+		};
+
+		Request makeRequest(_Inout_ std::mt19937_64& random) noexcept
+		{
+			std::geometric_distribution<uint32_t> sizeClass(0.35);
+			const uint32_t uLog2Units = std::min(sizeClass(random), 7u);
+
+			// Not a power of two most of the time, like mip chains and odd resolutions
+			std::uniform_int_distribution<UINT64> units((1ull << uLog2Units), (2ull << uLog2Units) - 1);
+
+			Request request;
+			request.uSize = units(random) * GRANULARITY - (random() % GRANULARITY);
+			request.uAlignment = random() % 16 == 0 ? MSAA_ALIGNMENT : GRANULARITY;
+
+			return request;
+		}
+
+		// Fills the range up to uTargetSize, then keeps replacing random live allocations by new requests for
+		// NUM_CHURN_OPERATIONS requests.  Requests that do not fit are counted and dropped, the allocations still
+		// live at the end are left to the caller.
+		void churn(_In_ TlsfAllocator& allocator, _In_ UINT64 uTargetSize, _Inout_ std::mt19937_64& random, _Out_ std::vector<TlsfAllocation>& outLiveAllocations,
+			_Out_ uint32_t& uOutNumFailures, _Out_ std::vector<UINT64>& outAllocateLatencies, _Out_ std::vector<UINT64>& outFreeLatencies) noexcept
+		{
+			outLiveAllocations.clear();
+			uOutNumFailures = 0;
+			outAllocateLatencies.clear();
+			outFreeLatencies.clear();
+			outAllocateLatencies.reserve(NUM_CHURN_OPERATIONS);
+			outFreeLatencies.reserve(NUM_CHURN_OPERATIONS);
+
+			UINT64 uLiveSize = 0;
+			for (uint32_t i = 0; i < NUM_CHURN_OPERATIONS; ++i)
+			{
+				const Request request = makeRequest(random);
+
+				// Random victims make room, so the live size stays at the target instead of drifting
+				while (!outLiveAllocations.empty() && uLiveSize + request.uSize > uTargetSize)
+				{
+					const size_t uVictim = static_cast<size_t>(random() % outLiveAllocations.size());
+					const TlsfAllocation allocation = outLiveAllocations[uVictim];
+					outLiveAllocations[uVictim] = outLiveAllocations.back();
+					outLiveAllocations.pop_back();
+
+					const UINT64 uStartTime = GetTimeNanoseconds();
+					allocator.Free(allocation);
+					outFreeLatencies.push_back(GetTimeNanoseconds() - uStartTime);
+
+					uLiveSize -= allocation.uSize;
+				}
+
+				TlsfAllocation allocation = {};
+				const UINT64 uStartTime = GetTimeNanoseconds();
+				const HRESULT hr = allocator.Allocate(allocation, request.uSize, request.uAlignment);
+				outAllocateLatencies.push_back(GetTimeNanoseconds() - uStartTime);
+
+				if (FAILED(hr))
+				{
+					++uOutNumFailures;
+
+					continue;
+				}
+
+				outLiveAllocations.push_back(allocation);
+				uLiveSize += allocation.uSize;
+			}
+		}
+	}
+
+	// Allocate and Free latencies over a 1GB range churned at 50 to 95% occupancy.  TLSF should stay flat
+	// however full or fragmented the range gets, since neither call ever walks a list.
+	BENCHMARK(TlsfAllocatorThroughput)
+	{
+		printf("%9s %10s %10s %10s %10s %12s\n", "occupancy", "alloc p50", "alloc p99", "free p50", "free p99", "ops/s");
+
+		for (uint32_t uOccupancyPercent : { 50u, 75u, 90u, 95u })
+		{
+			TlsfAllocator allocator;
+			if (FAILED(allocator.Initialize(HEAP_SIZE, GRANULARITY)))
+			{
+				printf("skipped, initializing the allocator failed\n");
+
+				return;
+			}
+
+			std::mt19937_64 random(uOccupancyPercent);
+			std::vector<TlsfAllocation> liveAllocations;
+			std::vector<UINT64> allocateLatencies;
+			std::vector<UINT64> freeLatencies;
+			uint32_t uNumFailures = 0;
+
+			const UINT64 uStartTime = GetTimeNanoseconds();
+			churn(allocator, HEAP_SIZE / 100 * uOccupancyPercent, random, liveAllocations, uNumFailures, allocateLatencies, freeLatencies);
+			const UINT64 uElapsedNanoseconds = std::max<UINT64>(GetTimeNanoseconds() - uStartTime, 1);
+
+			const size_t uNumOperations = allocateLatencies.size() + freeLatencies.size();
+
+			LatencySummary allocateSummary;
+			LatencySummary freeSummary;
+			SummarizeLatencies(allocateSummary, allocateLatencies);
+			SummarizeLatencies(freeSummary, freeLatencies);
+
+			// The clock is read around every call, so ops/s is a lower bound
+			printf("%8u%% %10llu %10llu %10llu %10llu %12.0f\n", uOccupancyPercent,
+				allocateSummary.uP50Nanoseconds, allocateSummary.uP99Nanoseconds, freeSummary.uP50Nanoseconds, freeSummary.uP99Nanoseconds,
+				static_cast<double>(uNumOperations) * 1e9 / static_cast<double>(uElapsedNanoseconds));
+
+			for (const TlsfAllocation& allocation : liveAllocations)
+			{
+				allocator.Free(allocation);
+			}
+
+			allocator.Destroy();
+		}
+	}
+
+	// Fragmentation left in a 1GB range after churning it at 50 to 95% occupancy: how many requests did not
+	// fit during the churn, and the largest free block against all the free space at the end.
+	BENCHMARK(TlsfAllocatorFragmentation)
+	{
+		printf("%9s %10s %10s %12s %10s %10s\n", "occupancy", "failed", "frag", "largest MB", "free MB", "blocks");
+
+		for (uint32_t uOccupancyPercent : { 50u, 75u, 90u, 95u })
+		{
+			TlsfAllocator allocator;
+			if (FAILED(allocator.Initialize(HEAP_SIZE, GRANULARITY)))
+			{
+				printf("skipped, initializing the allocator failed\n");
+
+				return;
+			}
+
+			std::mt19937_64 random(uOccupancyPercent);
+			std::vector<TlsfAllocation> liveAllocations;
+			std::vector<UINT64> allocateLatencies;
+			std::vector<UINT64> freeLatencies;
+			uint32_t uNumFailures = 0;
+			churn(allocator, HEAP_SIZE / 100 * uOccupancyPercent, random, liveAllocations, uNumFailures, allocateLatencies, freeLatencies);
+
+			TlsfAllocatorStatistics statistics;
+			allocator.GetStatistics(statistics);
+
+			printf("%8u%% %10u %10.3f %12.1f %10.1f %10u\n", uOccupancyPercent, uNumFailures, statistics.Fragmentation,
+				static_cast<double>(statistics.uLargestFreeBlockSize) / (1024.0 * 1024.0),
+				static_cast<double>(statistics.uTotalSize - statistics.uAllocatedSize) / (1024.0 * 1024.0), statistics.uNumFreeBlocks);
+
+			for (const TlsfAllocation& allocation : liveAllocations)
+			{
+				allocator.Free(allocation);
+			}
+
+			allocator.Destroy();
+		}
+	}
+}
@@ -0,0 +1,202 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace esperanza::benchmarks
+{
+	namespace
+	{
+		constexpr const size_t NUM_LOG_RECORDS = 1u << 16;
+
+		// Stays below the ring size so that producers never wait for the log thread while they are timed
+		constexpr const size_t NUM_CALLS_PER_BATCH = NUM_LOG_RECORDS / 2;
+		constexpr const size_t NUM_BATCHES = 16;
+
+		// Small enough that a burst from several producers overflows it
+		constexpr const size_t NUM_THROUGHPUT_LOG_RECORDS = 4096u;
+		constexpr const uint32_t NUM_THROUGHPUT_CALLS = 60000u;
+		constexpr const uint32_t MAX_NUM_PRODUCERS = 32u;
+
+		constexpr const wchar_t FRAME_FORMAT[] = L"Frame %u took %.3f ms in %s";
+
+		// Stands in for OutputDebugString, which would dominate every measurement
+		void countLine(_In_ const WCHAR* pszLine, _In_opt_ void* pContext) noexcept
+		{
+			UNREFERENCED_PARAMETER(pszLine);
+
+			static_cast<std::atomic<size_t>*>(pContext)->fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Dropped records never took a ring position, so every submitted record is printed in the end
+		void waitForDrain(_In_ const Log& log) noexcept
+		{
+			LogStatistics statistics;
+			log.GetStatistics(statistics);
+			while (statistics.uNumPrintedRecords < statistics.uNumSubmittedRecords)
+			{
+				std::this_thread::yield();
+				log.GetStatistics(statistics);
+			}
+		}
+
+		// Gives a callsite enough tokens to get a whole batch past the rate limiter, or none at all
+		void primeCallsite(_Inout_ LogCallsite& callsite, _In_ BOOL bIsSuppressed) noexcept
+		{
+			callsite.uRateLimitState.store((GetTickCount64() << 16) | (bIsSuppressed ? 0u : 0xFFFFu), std::memory_order_relaxed);
+		}
+	}
+
+	// Per call cost on the producer thread of formatting in place against capturing the raw arguments
+	BENCHMARK(LogFormattedVersusDeferred)
+	{
+		enum class eMode
+		{
+			Formatted,
+			Deferred,
+			DeferredSuppressed,
+			COUNT,
+		};
+
+		constexpr const char* MODE_NAMES[] = { "formatted", "deferred", "deferred suppressed" };
+
+		for (size_t uMode = 0; uMode < static_cast<size_t>(eMode::COUNT); ++uMode)
+		{
+			const eMode mode = static_cast<eMode>(uMode);
+			std::atomic<size_t> uNumLines = 0;
+
+			std::unique_ptr<Log> pLog = std::make_unique<Log>(NUM_LOG_RECORDS);
+			pLog->SetSink(countLine, &uNumLines);
+			pLog->Initialize(Log::eVerbosity::All, Log::eOverflowPolicy::Block);
+
+			static LogCallsite s_Callsite = { __FILE__, __func__, __LINE__, FRAME_FORMAT };
+			const WCHAR* pszPassName = L"Render";
+			UINT64 uTotalNanoseconds = 0;
+
+			for (size_t uBatch = 0; uBatch < NUM_BATCHES; ++uBatch)
+			{
+				primeCallsite(s_Callsite, mode == eMode::DeferredSuppressed);
+
+				const UINT64 uStartTime = GetTimeNanoseconds();
+				for (uint32_t i = 0; i < NUM_CALLS_PER_BATCH; ++i)
+				{
+					const double frameTime = 16.0 + static_cast<double>(i & 7) * 0.125;
+					if (mode == eMode::Formatted)
+					{
+						pLog->PrintLogFormat(Log::eVerbosity::Info, __FILE__, __func__, __LINE__, FRAME_FORMAT, i, frameTime, pszPassName);
+					}
+					else
+					{
+						pLog->PrintLogDeferred(Log::eVerbosity::Info, s_Callsite, i, frameTime, pszPassName);
+					}
+				}
+				uTotalNanoseconds += GetTimeNanoseconds() - uStartTime;
+
+				waitForDrain(*pLog);
+			}
+
+			pLog->Destroy();
+
+			const double numCalls = static_cast<double>(NUM_CALLS_PER_BATCH * NUM_BATCHES);
+			printf("%-20s %8.1f ns/call, %zu lines printed\n", MODE_NAMES[uMode], static_cast<double>(uTotalNanoseconds) / numCalls, uNumLines.load());
+		}
+	}
+
+	// Calls per second, producer latency percentiles, consumer lag and dropped records from 1 to N producer
+	// threads, for each backend, overflow policy and runtime verbosity.  Every sample includes the clock overhead.
+	BENCHMARK(LogThroughputAndLatency)
+	{
+		constexpr const Log::eOverflowPolicy OVERFLOW_POLICIES[] = { Log::eOverflowPolicy::Block, Log::eOverflowPolicy::CountDropped };
+		constexpr const char* OVERFLOW_POLICY_NAMES[] = { "block", "count" };
+		constexpr const char* BACKEND_NAMES[] = { "formatted", "deferred" };
+
+		const uint32_t uMaxNumProducers = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_NUM_PRODUCERS);
+
+		printf("%-10s %-6s %-8s %3s %12s %8s %8s %8s %8s %8s\n", "backend", "policy", "level", "thr", "calls/s", "p50 ns", "p99 ns", "p999 ns", "max lag", "dropped");
+
+		for (size_t uBackend = 0; uBackend < ARRAYSIZE(BACKEND_NAMES); ++uBackend)
+		{
+			for (size_t uPolicy = 0; uPolicy < ARRAYSIZE(OVERFLOW_POLICIES); ++uPolicy)
+			{
+				for (BOOL bIsFiltered : { FALSE, TRUE })
+				{
+					for (uint32_t uNumProducers = 1; uNumProducers <= uMaxNumProducers; uNumProducers *= 2)
+					{
+						std::atomic<size_t> uNumLines = 0;
+
+						std::unique_ptr<Log> pLog = std::make_unique<Log>(NUM_THROUGHPUT_LOG_RECORDS);
+						pLog->SetSink(countLine, &uNumLines);
+						pLog->Initialize(bIsFiltered ? Log::eVerbosity::Error : Log::eVerbosity::All, OVERFLOW_POLICIES[uPolicy]);
+
+						static LogCallsite s_Callsite = { __FILE__, __func__, __LINE__, FRAME_FORMAT };
+						primeCallsite(s_Callsite, FALSE);
+
+						const uint32_t uNumCallsPerProducer = NUM_THROUGHPUT_CALLS / uNumProducers;
+						std::vector<std::vector<UINT64>> latencies(uNumProducers, std::vector<UINT64>(uNumCallsPerProducer));
+						std::atomic<BOOL> bStart = FALSE;
+
+						std::vector<std::thread> producers;
+						for (uint32_t uProducer = 0; uProducer < uNumProducers; ++uProducer)
+						{
+							producers.emplace_back(
+								[&, uProducer]()
+								{
+									const WCHAR* pszPassName = L"Render";
+									std::vector<UINT64>& samples = latencies[uProducer];
+
+									while (!bStart.load(std::memory_order_acquire))
+									{
+										std::this_thread::yield();
+									}
+
+									for (uint32_t i = 0; i < uNumCallsPerProducer; ++i)
+									{
+										const double frameTime = 16.0 + static_cast<double>(i & 7) * 0.125;
+										const UINT64 uStartTime = GetTimeNanoseconds();
+										if (uBackend == 0)
+										{
+											pLog->PrintLogFormat(Log::eVerbosity::Info, __FILE__, __func__, __LINE__, FRAME_FORMAT, i, frameTime, pszPassName);
+										}
+										else
+										{
+											pLog->PrintLogDeferred(Log::eVerbosity::Info, s_Callsite, i, frameTime, pszPassName);
+										}
+										samples[i] = GetTimeNanoseconds() - uStartTime;
+									}
+								}
+							);
+						}
+
+						const UINT64 uStartTime = GetTimeNanoseconds();
+						bStart.store(TRUE, std::memory_order_release);
+						for (std::thread& producer : producers)
+						{
+							producer.join();
+						}
+						const UINT64 uElapsedNanoseconds = std::max<UINT64>(GetTimeNanoseconds() - uStartTime, 1);
+
+						waitForDrain(*pLog);
+
+						LogStatistics statistics;
+						pLog->GetStatistics(statistics);
+						pLog->Destroy();
+
+						std::vector<UINT64> allLatencies;
+						allLatencies.reserve(static_cast<size_t>(uNumCallsPerProducer) * uNumProducers);
+						for (const std::vector<UINT64>& samples : latencies)
+						{
+							allLatencies.insert(allLatencies.end(), samples.begin(), samples.end());
+						}
+
+						LatencySummary summary;
+						SummarizeLatencies(summary, allLatencies);
+
+						const double callsPerSecond = static_cast<double>(allLatencies.size()) * 1e9 / static_cast<double>(uElapsedNanoseconds);
+						printf("%-10s %-6s %-8s %3u %12.0f %8llu %8llu %8llu %8zu %8zu\n", BACKEND_NAMES[uBackend], OVERFLOW_POLICY_NAMES[uPolicy], bIsFiltered ? "filtered" : "enabled",
+							uNumProducers, callsPerSecond, summary.uP50Nanoseconds, summary.uP99Nanoseconds, summary.uP999Nanoseconds, statistics.uMaxConsumerLag, statistics.uNumDroppedRecords);
+					}
+				}
+			}
+		}
+	}
+}
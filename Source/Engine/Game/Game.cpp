@@ -43,6 +43,14 @@ namespace esperanza
 		verbosity = Log::eVerbosity::Error;
 #endif
 
+		// A failure here only costs the post-mortem log, the debugger output still works
+		HRESULT hrRingFile = g_Log.OpenRingFile(LOG_RING_FILE_PATH, _4MB);
+		if (FAILED(hrRingFile))
+		{
+			_com_error err(hrRingFile);
+			LOGEF(m_Logger, L"Opening log ring file failed with HRESULT code %u, %s", hrRingFile, err.ErrorMessage());
+		}
+
 		g_Log.Initialize(verbosity);
 		m_Logger.Initialize(verbosity);
 
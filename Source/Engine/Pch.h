@@ -49,8 +49,11 @@
 #include <crtdbg.h>
 
 // STL Headers
+#include <array>
 #include <cassert>
+#include <deque>
 #include <filesystem>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <queue>
@@ -79,6 +82,7 @@ namespace esperanza
 
 	const std::filesystem::path CONTENTS_PATH(L"Contents");
 	const std::filesystem::path SHADERS_PATH(CONTENTS_PATH / L"Shaders");
+	const std::filesystem::path LOG_RING_FILE_PATH(L"Esperanza.log");
 
 	constexpr const WCHAR ENGINE_NAME[] = L"Esperanza";
 	constexpr const size_t DEFAULT_WIDTH = 1920;
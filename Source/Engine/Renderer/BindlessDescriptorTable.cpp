@@ -0,0 +1,237 @@
+#include "Pch.h"
+
+#include "Renderer/BindlessDescriptorTable.h"
+#include "Renderer/CommandListManager.h"
+#include "Renderer/GpuResource.h"
+
+namespace esperanza
+{
+	static constexpr const D3D12_COMMAND_LIST_TYPE QUEUE_TYPES[] =
+	{
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		D3D12_COMMAND_LIST_TYPE_COMPUTE,
+		D3D12_COMMAND_LIST_TYPE_COPY,
+	};
+
+	BindlessDescriptorTable::BindlessDescriptorTable() noexcept
+		: m_pDevice()
+		, m_pCommandListManager(nullptr)
+		, m_Heap()
+		, m_uMaxCount(0)
+		, m_Mutex()
+		, m_Bindings()
+		, m_FreeIndices()
+		, m_FreedIndices()
+		, m_aTableCopies()
+		, m_uCurrentTableCopy(0)
+		, m_uNumRefreshes(0)
+	{
+	}
+
+	HRESULT BindlessDescriptorTable::Initialize(ID3D12Device* pDevice, CommandListManager& commandListManager, const std::wstring& strDebugHeapName, uint32_t uMaxCount) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		if (!pDevice)
+		{
+			GLOGE(L"Device is null!");
+
+			return E_FAIL;
+		}
+
+		if (uMaxCount == 0 || uMaxCount > UINT32_MAX / NUM_TABLE_COPIES)
+		{
+			GLOGEF(L"Invalid bindless descriptor count %u", uMaxCount);
+
+			return E_INVALIDARG;
+		}
+
+		hr = m_Heap.Initialize(pDevice, strDebugHeapName, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, uMaxCount * NUM_TABLE_COPIES);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing Descriptor Heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		m_pDevice = pDevice;
+		m_pCommandListManager = &commandListManager;
+		m_uMaxCount = uMaxCount;
+
+		for (TableCopy& tableCopy : m_aTableCopies)
+		{
+			std::fill(std::begin(tableCopy.auFenceValues), std::end(tableCopy.auFenceValues), 0);
+			tableCopy.Generations.assign(uMaxCount, 0);
+		}
+
+		m_uCurrentTableCopy.store(0, std::memory_order_relaxed);
+		m_uNumRefreshes = 0;
+
+		return hr;
+	}
+
+	void BindlessDescriptorTable::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		m_Bindings.clear();
+		m_FreeIndices.clear();
+		m_FreedIndices = std::queue<FreedIndex>();
+		for (TableCopy& tableCopy : m_aTableCopies)
+		{
+			std::fill(std::begin(tableCopy.auFenceValues), std::end(tableCopy.auFenceValues), 0);
+			tableCopy.Generations.clear();
+		}
+
+		m_Heap.Destroy();
+		m_uMaxCount = 0;
+		m_pCommandListManager = nullptr;
+		m_pDevice.Reset();
+	}
+
+	HRESULT BindlessDescriptorTable::Register(uint32_t& uOutIndex, const GpuResource& resource, const D3D12_CPU_DESCRIPTOR_HANDLE& liveDescriptor) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		uOutIndex = INVALID_INDEX;
+
+		uint32_t uIndex = INVALID_INDEX;
+		if (!m_FreeIndices.empty())
+		{
+			uIndex = m_FreeIndices.back();
+			m_FreeIndices.pop_back();
+		}
+		else if (m_Bindings.size() < m_uMaxCount)
+		{
+			uIndex = static_cast<uint32_t>(m_Bindings.size());
+			m_Bindings.push_back(Binding{ nullptr, nullptr, 0, 0 });
+		}
+		else
+		{
+			GLOGEF(L"Bindless descriptor table is full, %u unregistered indices wait for the next refresh", static_cast<uint32_t>(m_FreedIndices.size()));
+
+			return E_OUTOFMEMORY;
+		}
+
+		// The generation goes on from the last binding at this index, so no copy of the table still matches
+		Binding& binding = m_Bindings[uIndex];
+		binding = Binding{ &resource, &liveDescriptor, resource.GetVersionId(), binding.uGeneration + 1 };
+		copyDescriptor(uIndex);
+		uOutIndex = uIndex;
+
+		return S_OK;
+	}
+
+	HRESULT BindlessDescriptorTable::Unregister(uint32_t uIndex) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		if (uIndex >= m_Bindings.size() || !m_Bindings[uIndex].pResource)
+		{
+			GLOGEF(L"Unregistering bindless index %u that is not registered", uIndex);
+
+			return E_INVALIDARG;
+		}
+
+		Binding& binding = m_Bindings[uIndex];
+		binding.pResource = nullptr;
+		binding.pLiveDescriptor = nullptr;
+		m_FreedIndices.push(FreedIndex{ m_uNumRefreshes, uIndex });
+
+		return S_OK;
+	}
+
+	uint32_t BindlessDescriptorTable::RefreshDescriptors() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		// Anything already submitted to any queue, including a batch still waiting to be flushed, may read the
+		// copy that was current until now
+		const uint32_t uLastTableCopy = m_uCurrentTableCopy.load(std::memory_order_relaxed);
+		TableCopy& lastTableCopy = m_aTableCopies[uLastTableCopy];
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			lastTableCopy.auFenceValues[i] = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).GetLastSubmittedFenceValue();
+		}
+
+		// With one copy more than frames in flight the GPU is normally done with the next copy already
+		const uint32_t uTableCopy = (uLastTableCopy + 1) % NUM_TABLE_COPIES;
+		if (FAILED(waitForTableCopy(m_aTableCopies[uTableCopy])))
+		{
+			// Writing a copy the GPU may still read is not an option, the last one stays current
+			return 0;
+		}
+
+		m_uCurrentTableCopy.store(uTableCopy, std::memory_order_release);
+		++m_uNumRefreshes;
+
+		while (!m_FreedIndices.empty() && m_FreedIndices.front().uRefreshNumber < m_uNumRefreshes)
+		{
+			m_FreeIndices.push_back(m_FreedIndices.front().uIndex);
+			m_FreedIndices.pop();
+		}
+
+		uint32_t uNumRefreshed = 0;
+		for (uint32_t uIndex = 0; uIndex < m_Bindings.size(); ++uIndex)
+		{
+			Binding& binding = m_Bindings[uIndex];
+			if (!binding.pResource)
+			{
+				continue;
+			}
+
+			if (binding.pResource->GetVersionId() != binding.uVersionId)
+			{
+				binding.uVersionId = binding.pResource->GetVersionId();
+				++binding.uGeneration;
+				++uNumRefreshed;
+			}
+
+			if (m_aTableCopies[uTableCopy].Generations[uIndex] != binding.uGeneration)
+			{
+				copyDescriptor(uIndex);
+			}
+		}
+
+		return uNumRefreshed;
+	}
+
+	DescriptorHandle BindlessDescriptorTable::GetTableStart() const noexcept
+	{
+		return m_Heap[m_uCurrentTableCopy.load(std::memory_order_acquire) * m_uMaxCount];
+	}
+
+	ID3D12DescriptorHeap* BindlessDescriptorTable::GetHeapPointer() const noexcept
+	{
+		return m_Heap.GetHeapPointer();
+	}
+
+	HRESULT BindlessDescriptorTable::waitForTableCopy(const TableCopy& tableCopy) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			hr = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).WaitForFence(tableCopy.auFenceValues[i]);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Waiting for fence failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		return hr;
+	}
+
+	void BindlessDescriptorTable::copyDescriptor(uint32_t uIndex) noexcept
+	{
+		const uint32_t uTableCopy = m_uCurrentTableCopy.load(std::memory_order_relaxed);
+		const Binding& binding = m_Bindings[uIndex];
+
+		m_pDevice->CopyDescriptorsSimple(1, m_Heap[uTableCopy * m_uMaxCount + uIndex], *binding.pLiveDescriptor, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		m_aTableCopies[uTableCopy].Generations[uIndex] = binding.uGeneration;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Pch.h"
+#include "Renderer/DescriptorHeap.h"
+#include "Renderer/FrameController.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+	class GpuResource;
+
+	// One large shader-visible CBV/SRV/UAV heap that shaders index directly instead of having descriptor tables
+	// copied for every draw.  A registered view keeps the index Register returns until it is unregistered.  The
+	// heap holds one copy of the table per frame that can be in flight plus one, and every RefreshDescriptors
+	// moves on to the next copy once the GPU is done with it and brings it up to date with the live views.  A
+	// view recreated since, or a new binding, is only ever written into the current copy, so frames in flight
+	// keep reading the descriptors they were recorded with.  Shaders index from GetTableStart, which moves with
+	// the current copy and is bound as the start of a descriptor table every frame.
+	class BindlessDescriptorTable final
+	{
+	public:
+		static constexpr const uint32_t INVALID_INDEX = UINT32_MAX;
+
+	public:
+		explicit BindlessDescriptorTable() noexcept;
+		BindlessDescriptorTable(const BindlessDescriptorTable& other) = delete;
+		BindlessDescriptorTable(BindlessDescriptorTable&& other) = delete;
+		BindlessDescriptorTable& operator=(const BindlessDescriptorTable& other) = delete;
+		BindlessDescriptorTable& operator=(BindlessDescriptorTable&& other) = delete;
+		~BindlessDescriptorTable() noexcept = default;
+
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ CommandListManager& commandListManager, _In_ const std::wstring& strDebugHeapName, _In_ uint32_t uMaxCount) noexcept;
+		void Destroy() noexcept;
+
+		// The live descriptor is the CPU-visible view handle kept by the owner of the resource, it must outlive the
+		// binding and is read again whenever the resource is recreated
+		HRESULT Register(_Out_ uint32_t& uOutIndex, _In_ const GpuResource& resource, _In_ const D3D12_CPU_DESCRIPTOR_HANDLE& liveDescriptor) noexcept;
+		HRESULT Unregister(_In_ uint32_t uIndex) noexcept;
+
+		// Moves on to the next copy of the table, waiting for the GPU if a frame still reads it, and copies in
+		// every view registered or recreated since the copy was last current.  Call once per frame before
+		// recording.  Returns the number of bindings whose resource changed its version id.
+		uint32_t RefreshDescriptors() noexcept;
+
+		// Start of the current copy of the table, indices returned by Register are relative to it
+		DescriptorHandle GetTableStart() const noexcept;
+		ID3D12DescriptorHeap* GetHeapPointer() const noexcept;
+
+	private:
+		static constexpr const size_t NUM_QUEUES = 3u;
+		static constexpr const uint32_t NUM_TABLE_COPIES = FrameController::MAX_FRAMES_IN_FLIGHT + 1u;
+
+		struct Binding
+		{
+			const GpuResource* pResource;
+			const D3D12_CPU_DESCRIPTOR_HANDLE* pLiveDescriptor;
+			UINT uVersionId;
+
+			// Bumped whenever the view changes, a copy of the table is up to date when it holds the same
+			uint32_t uGeneration;
+		};
+
+		struct TableCopy
+		{
+			// Last submitted fence value of every queue when the copy stopped being the current one
+			UINT64 auFenceValues[NUM_QUEUES];
+			std::vector<uint32_t> Generations;
+		};
+
+		// Reused only once the table has moved on, frames already recorded with the current copy may read it
+		struct FreedIndex
+		{
+			uint64_t uRefreshNumber;
+			uint32_t uIndex;
+		};
+
+	private:
+		HRESULT waitForTableCopy(_In_ const TableCopy& tableCopy) noexcept;
+		void copyDescriptor(_In_ uint32_t uIndex) noexcept;
+
+	private:
+		ComPtr<ID3D12Device> m_pDevice;
+		CommandListManager* m_pCommandListManager;
+		DescriptorHeap m_Heap;
+		uint32_t m_uMaxCount;
+		std::mutex m_Mutex;
+		std::vector<Binding> m_Bindings;
+		std::vector<uint32_t> m_FreeIndices;
+		std::queue<FreedIndex> m_FreedIndices;
+		TableCopy m_aTableCopies[NUM_TABLE_COPIES];
+		std::atomic<uint32_t> m_uCurrentTableCopy;
+		uint64_t m_uNumRefreshes;
+	};
+}
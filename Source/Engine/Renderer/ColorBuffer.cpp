@@ -2,6 +2,7 @@
 
 #include "Renderer/ColorBuffer.h"
 #include "Renderer/DescriptorHeap.h"
+#include "Renderer/DescriptorViewCache.h"
 
 namespace esperanza
 {
@@ -15,6 +16,9 @@ namespace esperanza
 		, m_SrvHandle()
 		, m_RtvHandle()
 		, m_UavHandle{}
+		, m_pRtvAllocator(nullptr)
+		, m_RtvAllocation()
+		, m_pViewCache(nullptr)
 		, m_uNumMipMaps(0)	// number of texture sublevels
 		, m_uFragmentCount(1)
 		, m_uSampleCount(1)
@@ -40,7 +44,14 @@ namespace esperanza
 			return hr;
 		}
 
-		hr = rtvAllocator.Allocate(m_RtvHandle, pDevice, 1);
+		// The swap chain buffers are re-associated on every resize, recycle the view of the previous buffer
+		if (m_pRtvAllocator)
+		{
+			m_pRtvAllocator->Free(m_RtvAllocation);
+			m_pRtvAllocator = nullptr;
+		}
+
+		hr = rtvAllocator.Allocate(m_RtvAllocation, pDevice, 1);
 		if (FAILED(hr))
 		{
 			_com_error err(hr);
@@ -49,7 +60,35 @@ namespace esperanza
 			return hr;
 		}
 
+		m_pRtvAllocator = &rtvAllocator;
+		m_RtvHandle = m_RtvAllocation.Handle;
 		pDevice->CreateRenderTargetView(m_pResource.Get(), nullptr, m_RtvHandle);
+
+		return hr;
+	}
+
+	void ColorBuffer::Destroy() noexcept
+	{
+		if (m_pRtvAllocator)
+		{
+			m_pRtvAllocator->Free(m_RtvAllocation);
+			m_pRtvAllocator = nullptr;
+			m_RtvAllocation = DescriptorAllocation();
+			m_RtvHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+		}
+
+		if (m_pViewCache)
+		{
+			m_pViewCache->Evict(*this);
+			m_RtvHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+			m_SrvHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+			for (UINT i = 0; i < ARRAYSIZE(m_UavHandle); ++i)
+			{
+				m_UavHandle[i].ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+			}
+		}
+
+		PixelBuffer::Destroy();
 	}
 
 	HRESULT ColorBuffer::Initialize(ID3D12Device* pDevice, const std::wstring& strName, uint32_t uWidth, uint32_t uHeight, uint32_t uNumMips, DXGI_FORMAT format) noexcept
@@ -60,7 +99,7 @@ namespace esperanza
 	HRESULT ColorBuffer::Initialize(ID3D12Device* pDevice, const std::wstring& strName, uint32_t uWidth, uint32_t uHeight, uint32_t uNumMips, DXGI_FORMAT format, D3D12_GPU_VIRTUAL_ADDRESS vidMemPtr) noexcept
 	{
 		HRESULT hr = S_OK;
-		uNumMips = (uNumMips == 0 ? computeNumMips(uWidth, uHeight) : uNumMips);
+		uNumMips = (uNumMips == 0 ? ComputeNumMips(uWidth, uHeight) : uNumMips);
 		D3D12_RESOURCE_FLAGS flags = combineResourceFlags();
 		D3D12_RESOURCE_DESC resourceDesc = describeTex2d(uWidth, uHeight, 1, uNumMips, format, flags);
 
@@ -93,10 +132,40 @@ namespace esperanza
 		return hr;
 	}
 
-	void ColorBuffer::Initialize(ID3D12Device* pDevice, const std::wstring& strName, uint32_t uWidth, uint32_t uHeight, uint32_t uNumMips, DXGI_FORMAT format, EsramAllocator& allocator) noexcept
+	HRESULT ColorBuffer::Initialize(ID3D12Device* pDevice, const std::wstring& strName, uint32_t uWidth, uint32_t uHeight, uint32_t uNumMips, DXGI_FORMAT format, EsramAllocator& allocator) noexcept
 	{
-		UNREFERENCED_PARAMETER(allocator);
-		Initialize(pDevice, strName, uWidth, uHeight, uNumMips, format);
+		HRESULT hr = S_OK;
+		uNumMips = (uNumMips == 0 ? ComputeNumMips(uWidth, uHeight) : uNumMips);
+		D3D12_RESOURCE_FLAGS flags = combineResourceFlags();
+		D3D12_RESOURCE_DESC resourceDesc = describeTex2d(uWidth, uHeight, 1, uNumMips, format, flags);
+
+		resourceDesc.SampleDesc.Count = m_uFragmentCount;
+		resourceDesc.SampleDesc.Quality = 0;
+
+		D3D12_CLEAR_VALUE clearValue = 
+		{
+			.Format = format,
+			.Color =
+			{
+				m_ClearColor.GetR(),
+				m_ClearColor.GetG(),
+				m_ClearColor.GetB(),
+				m_ClearColor.GetA(),
+			},
+		};
+
+		hr = initializeTextureResource(pDevice, strName, resourceDesc, clearValue, allocator);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing Placed Texture Resources failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		initializeDerivedViews(pDevice, format, 1, uNumMips);
+
+		return hr;
 	}
 
 	void ColorBuffer::InitializeArray(ID3D12Device* pDevice, const std::wstring& strName, uint32_t uWidth, uint32_t uHeight, uint32_t uArrayCount, DXGI_FORMAT format) noexcept
@@ -130,6 +199,38 @@ namespace esperanza
 		return InitializeArray(strName, uWidth, uHeight, uArrayCount, format, D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN);
 	}
 
+	HRESULT ColorBuffer::InitializeArray(ID3D12Device* pDevice, const std::wstring& strName, uint32_t uWidth, uint32_t uHeight, uint32_t uArrayCount, DXGI_FORMAT format, EsramAllocator& allocator) noexcept
+	{
+		HRESULT hr = S_OK;
+		D3D12_RESOURCE_FLAGS flags = combineResourceFlags();
+		D3D12_RESOURCE_DESC resourceDesc = describeTex2d(uWidth, uHeight, uArrayCount, 1, format, flags);
+
+		D3D12_CLEAR_VALUE clearValue = 
+		{
+			.Format = format,
+			.Color = 
+			{
+				m_ClearColor.GetR(),
+				m_ClearColor.GetG(),
+				m_ClearColor.GetB(),
+				m_ClearColor.GetA(),
+			}
+		};
+
+		hr = initializeTextureResource(pDevice, strName, resourceDesc, clearValue, allocator);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing Placed Texture Resources failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		initializeDerivedViews(pDevice, format, uArrayCount, 1);
+
+		return hr;
+	}
+
 	HRESULT ColorBuffer::initializeDerivedViews(ID3D12Device* pDevice, DXGI_FORMAT format, uint32_t uArraySize) noexcept
 	{
 		return initializeDerivedViews(pDevice, format, uArraySize, 1);
@@ -191,6 +292,45 @@ namespace esperanza
 			SrvDesc.Texture2D.MostDetailedMip = 0;
 		}
 
+		// Asking again for a view of the same version of the resource hands back the existing descriptor
+		if (m_pViewCache)
+		{
+			hr = m_pViewCache->GetRenderTargetView(m_RtvHandle, *this, &RtvDesc);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Getting Render Target View failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			hr = m_pViewCache->GetShaderResourceView(m_SrvHandle, *this, &SrvDesc);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Getting Shader Resource View failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			// Multisampled buffers have no unordered access views
+			for (uint32_t i = 0; i < uNumMips && m_uFragmentCount == 1; ++i)
+			{
+				hr = m_pViewCache->GetUnorderedAccessView(m_UavHandle[i], *this, &UavDesc);
+				if (FAILED(hr))
+				{
+					_com_error err(hr);
+					GLOGEF(L"Getting Unordered Access View failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+					return hr;
+				}
+
+				UavDesc.Texture2D.MipSlice++;
+			}
+
+			return hr;
+		}
+
 		if (m_SrvHandle.ptr == D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN)
 		{
 			//m_RtvHandle = Graphics::AllocateDescriptor(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "Renderer/Color.h"
+#include "Renderer/DescriptorHeap.h"
 #include "Renderer/PixelBuffer.h"
 
+#include <bit>
+
 namespace esperanza
 {
-    class DescriptorAllocator;
+	class DescriptorViewCache;
 	class EsramAllocator;
 
 	class ColorBuffer final : public PixelBuffer
@@ -19,6 +22,9 @@ namespace esperanza
 		ColorBuffer& operator=(ColorBuffer&& other) = delete;
 		~ColorBuffer() noexcept = default;
 
+        // Also returns the render target view to the allocator it came from
+        void Destroy() noexcept override;
+
         // Initialize a color buffer from a swap chain buffer.  Unordered access is restricted.
         HRESULT InitializeFromSwapChain(_In_ ID3D12Device* pDevice, _In_ DescriptorAllocator& rtvAllocator, _In_ const std::wstring& strName, _In_ ID3D12Resource* pBaseResource) noexcept;
 
@@ -31,8 +37,8 @@ namespace esperanza
         HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ const std::wstring& strName, _In_ uint32_t uWidth, _In_  uint32_t uHeight, _In_ uint32_t uNumMips,
             _In_ DXGI_FORMAT format, _In_ D3D12_GPU_VIRTUAL_ADDRESS vidMemPtr) noexcept;
 
-        // Initialize a color buffer.  Memory will be allocated in ESRAM (on Xbox One).  On Windows,
-        // this functions the same as Initialize() without a video address.
+        // Initialize a color buffer placed in a heap block of the allocator instead of a committed
+        // resource of its own.  The memory goes back to the allocator on Destroy.
         HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ const std::wstring& strName, _In_ uint32_t uWidth, _In_ uint32_t uHeight, _In_ uint32_t uNumMips,
             _In_ DXGI_FORMAT format, _In_ EsramAllocator& allocator) noexcept;
 
@@ -45,8 +51,7 @@ namespace esperanza
         HRESULT InitializeArray(_In_ ID3D12Device* pDevice, _In_ const std::wstring& strName, _In_ uint32_t uWidth, _In_ uint32_t uHeight, _In_ uint32_t uArrayCount,
             _In_ DXGI_FORMAT format, _In_ D3D12_GPU_VIRTUAL_ADDRESS VidMemPtr) noexcept;
 
-        // Initialize a color buffer.  Memory will be allocated in ESRAM (on Xbox One).  On Windows,
-        // this functions the same as Initialize() without a video address.
+        // Initialize a color buffer array placed in a heap block of the allocator
         HRESULT InitializeArray(_In_ ID3D12Device* pDevice, _In_ const std::wstring& strName, _In_ uint32_t uWidth, _In_ uint32_t uHeight, _In_ uint32_t uArrayCount,
             _In_ DXGI_FORMAT format, _In_ EsramAllocator& allocator) noexcept;
 
@@ -57,6 +62,9 @@ namespace esperanza
 
         constexpr void SetClearColor(Color ClearColor) noexcept;
 
+        // Views are taken from the cache instead of being created on every initialize when one is set
+        constexpr void SetViewCache(_In_opt_ DescriptorViewCache* pViewCache) noexcept;
+
         constexpr void SetMsaaMode(uint32_t NumColorSamples, uint32_t NumCoverageSamples) noexcept;
 
         constexpr const Color& GetClearColor(void) const noexcept;
@@ -66,12 +74,11 @@ namespace esperanza
         // 0 for ArrayCount to reserve space for mips at creation time.
         //void GenerateMipMaps(CommandContext& Context);
 
-    protected:
-        // Compute the number of texture levels needed to reduce to 1x1.  This uses
-        // _BitScanReverse to find the highest set bit.  Each dimension reduces by
-        // half and truncates bits.  The dimension 256 (0x100) has 9 mip levels, same
-        // as the dimension 511 (0x1FF).
-        static constexpr uint32_t computeNumMips(uint32_t uWidth, uint32_t uHeight) noexcept;
+        // Compute the number of texture levels needed to reduce to 1x1.  This finds the
+        // highest set bit of either dimension.  Each dimension reduces by half and
+        // truncates bits.  The dimension 256 (0x100) has 9 mip levels, same as the
+        // dimension 511 (0x1FF).
+        static constexpr uint32_t ComputeNumMips(_In_ uint32_t uWidth, _In_ uint32_t uHeight) noexcept;
 
     protected:
         constexpr D3D12_RESOURCE_FLAGS combineResourceFlags(void) const noexcept;
@@ -84,8 +91,34 @@ namespace esperanza
         D3D12_CPU_DESCRIPTOR_HANDLE m_SrvHandle;
         D3D12_CPU_DESCRIPTOR_HANDLE m_RtvHandle;
         D3D12_CPU_DESCRIPTOR_HANDLE m_UavHandle[12];
+        DescriptorAllocator* m_pRtvAllocator;
+        DescriptorAllocation m_RtvAllocation;
+        DescriptorViewCache* m_pViewCache;
         uint32_t m_uNumMipMaps; // number of texture sublevels
         uint32_t m_uFragmentCount;
         uint32_t m_uSampleCount;
 	};
+
+	inline constexpr uint32_t ColorBuffer::ComputeNumMips(uint32_t uWidth, uint32_t uHeight) noexcept
+	{
+		return static_cast<uint32_t>(std::bit_width(uWidth | uHeight));
+	}
+
+	inline constexpr void ColorBuffer::SetClearColor(Color clearColor) noexcept
+	{
+		m_ClearColor = clearColor;
+	}
+
+	inline constexpr void ColorBuffer::SetViewCache(DescriptorViewCache* pViewCache) noexcept
+	{
+		m_pViewCache = pViewCache;
+	}
+
+	inline constexpr void ColorBuffer::SetMsaaMode(uint32_t uNumColorSamples, uint32_t uNumCoverageSamples) noexcept
+	{
+		assert(uNumCoverageSamples >= uNumColorSamples);
+
+		m_uFragmentCount = uNumColorSamples;
+		m_uSampleCount = uNumCoverageSamples;
+	}
 }
\ No newline at end of file
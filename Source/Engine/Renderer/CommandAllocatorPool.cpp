@@ -7,8 +7,17 @@ namespace esperanza
 		: m_Type(type)
 		, m_pDevice()
 		, m_AllocatorPool()
-		, m_ReadyAllocators()
 		, m_AllocatorMutex()
+		, m_RetiredAllocators()
+		, m_RetiredMutex()
+		, m_aFreeListStripes()
+		, m_uNumAllocators(0)
+		, m_uNumInFlight(0)
+		, m_uHighWaterMark(0)
+		, m_uNumCreated(0)
+		, m_uNumReused(0)
+		, m_uNumTrimmed(0)
+		, m_uNumRequests(0)
 	{
 	}
 
@@ -20,40 +29,71 @@ namespace esperanza
 
 	void CommandAllocatorPool::Destroy()
 	{
+		{
+			std::lock_guard<std::mutex> lockGuard(m_RetiredMutex);
+			m_RetiredAllocators.clear();
+		}
+
+		for (FreeListStripe& stripe : m_aFreeListStripes)
+		{
+			std::lock_guard<std::mutex> lockGuard(stripe.Mutex);
+			stripe.Allocators.clear();
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_AllocatorMutex);
 		m_AllocatorPool.clear();
+		m_uNumAllocators.store(0, std::memory_order_relaxed);
+		m_uNumInFlight.store(0, std::memory_order_relaxed);
 		m_pDevice.Reset();
 	}
 
 	HRESULT CommandAllocatorPool::RequestAllocator(_Out_ ID3D12CommandAllocator** ppAllocator, _In_ UINT64 uCompletedFenceValue) noexcept
 	{
-		std::lock_guard<std::mutex> lockGuard(m_AllocatorMutex);
-
 		HRESULT hr = S_OK;
-		ID3D12CommandAllocator* pAllocator = nullptr;
+		*ppAllocator = nullptr;
+
+		if (m_uNumRequests.fetch_add(1, std::memory_order_relaxed) % TRIM_INTERVAL == TRIM_INTERVAL - 1)
+		{
+			Trim();
+		}
 
-		if (!m_ReadyAllocators.empty())
+		FreeListStripe& stripe = getStripe();
+		ID3D12CommandAllocator* pAllocator = popFreeAllocator(stripe);
+
+		if (!pAllocator)
 		{
-			std::pair<UINT64, ID3D12CommandAllocator*>& allocatorPair = m_ReadyAllocators.front();
+			pAllocator = collectCompletedAllocators(stripe, uCompletedFenceValue);
+		}
 
-			if (allocatorPair.first <= uCompletedFenceValue)
+		// Take one from another thread before growing the pool
+		for (size_t i = 0; !pAllocator && i < NUM_FREE_LIST_STRIPES; ++i)
+		{
+			if (&m_aFreeListStripes[i] != &stripe)
 			{
-				pAllocator = allocatorPair.second;
-				hr = pAllocator->Reset();
-				if (FAILED(hr))
-				{
-					_com_error err(hr);
-					GLOGEF(L"Resetting Command Allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
-
-					return hr;
-				}
-				m_ReadyAllocators.pop();
+				pAllocator = popFreeAllocator(m_aFreeListStripes[i]);
 			}
 		}
 
-		// If no allocators were ready to be reused, create a new one
-		if (!pAllocator)
+		if (pAllocator)
+		{
+			hr = pAllocator->Reset();
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Resetting Command Allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				std::lock_guard<std::mutex> lockGuard(stripe.Mutex);
+				stripe.Allocators.push_back(pAllocator);
+
+				return hr;
+			}
+
+			m_uNumReused.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
 		{
-			hr = m_pDevice->CreateCommandAllocator(m_Type, IID_PPV_ARGS(&pAllocator));
+			// If no allocators were ready to be reused, create a new one
+			hr = createAllocator(&pAllocator);
 			if (FAILED(hr))
 			{
 				_com_error err(hr);
@@ -61,12 +101,9 @@ namespace esperanza
 
 				return hr;
 			}
-			WCHAR szAllocatorName[32];
-			swprintf_s(szAllocatorName, L"CommandAllocator %zu", m_AllocatorPool.size());
-			pAllocator->SetName(szAllocatorName);
-			m_AllocatorPool.push_back(pAllocator);
 		}
 
+		updateHighWaterMark(m_uNumInFlight.fetch_add(1, std::memory_order_relaxed) + 1);
 		*ppAllocator = pAllocator;
 
 		return hr;
@@ -74,9 +111,149 @@ namespace esperanza
 
 	void CommandAllocatorPool::DiscardAllocator(_In_ UINT64 uFenceValue, _In_ ID3D12CommandAllocator* pAllocator) noexcept
 	{
-		std::lock_guard<std::mutex> lockGuard(m_AllocatorMutex);
+		std::lock_guard<std::mutex> lockGuard(m_RetiredMutex);
 
 		// That fence value indicates we are free to reset the allocator
-		m_ReadyAllocators.push(std::make_pair(uFenceValue, pAllocator));
+		m_RetiredAllocators[uFenceValue].push_back(pAllocator);
+	}
+
+	void CommandAllocatorPool::Trim() noexcept
+	{
+		const size_t uNumInFlight = m_uNumInFlight.load(std::memory_order_relaxed);
+		const size_t uHighWaterMark = m_uHighWaterMark.exchange(uNumInFlight, std::memory_order_relaxed);
+		const size_t uNumAllocators = m_uNumAllocators.load(std::memory_order_relaxed);
+		if (uNumAllocators <= uHighWaterMark)
+		{
+			return;
+		}
+
+		size_t uNumToTrim = uNumAllocators - uHighWaterMark;
+		std::vector<ID3D12CommandAllocator*> trimmedAllocators;
+		for (FreeListStripe& stripe : m_aFreeListStripes)
+		{
+			std::lock_guard<std::mutex> lockGuard(stripe.Mutex);
+
+			while (uNumToTrim > 0 && !stripe.Allocators.empty())
+			{
+				trimmedAllocators.push_back(stripe.Allocators.back());
+				stripe.Allocators.pop_back();
+				--uNumToTrim;
+			}
+		}
+
+		if (trimmedAllocators.empty())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_AllocatorMutex);
+
+		std::erase_if(m_AllocatorPool,
+			[&trimmedAllocators](const ComPtr<ID3D12CommandAllocator>& pAllocator)
+			{
+				return std::find(trimmedAllocators.begin(), trimmedAllocators.end(), pAllocator.Get()) != trimmedAllocators.end();
+			});
+
+		m_uNumAllocators.store(m_AllocatorPool.size(), std::memory_order_relaxed);
+		m_uNumTrimmed.fetch_add(trimmedAllocators.size(), std::memory_order_relaxed);
+	}
+
+	void CommandAllocatorPool::GetStatistics(CommandAllocatorPoolStatistics& outStatistics) const noexcept
+	{
+		outStatistics.uNumAllocators = m_uNumAllocators.load(std::memory_order_relaxed);
+		outStatistics.uNumInFlight = m_uNumInFlight.load(std::memory_order_relaxed);
+		outStatistics.uHighWaterMark = m_uHighWaterMark.load(std::memory_order_relaxed);
+		outStatistics.uNumCreated = m_uNumCreated.load(std::memory_order_relaxed);
+		outStatistics.uNumReused = m_uNumReused.load(std::memory_order_relaxed);
+		outStatistics.uNumTrimmed = m_uNumTrimmed.load(std::memory_order_relaxed);
+	}
+
+	CommandAllocatorPool::FreeListStripe& CommandAllocatorPool::getStripe() noexcept
+	{
+		const size_t uHash = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+		return m_aFreeListStripes[uHash % NUM_FREE_LIST_STRIPES];
+	}
+
+	ID3D12CommandAllocator* CommandAllocatorPool::popFreeAllocator(FreeListStripe& stripe) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(stripe.Mutex);
+
+		if (stripe.Allocators.empty())
+		{
+			return nullptr;
+		}
+
+		ID3D12CommandAllocator* pAllocator = stripe.Allocators.back();
+		stripe.Allocators.pop_back();
+
+		return pAllocator;
+	}
+
+	ID3D12CommandAllocator* CommandAllocatorPool::collectCompletedAllocators(FreeListStripe& stripe, UINT64 uCompletedFenceValue) noexcept
+	{
+		std::vector<ID3D12CommandAllocator*> completedAllocators;
+		{
+			std::lock_guard<std::mutex> lockGuard(m_RetiredMutex);
+
+			// Every bucket up to the completed fence value is reusable, not just the oldest one
+			auto firstPending = m_RetiredAllocators.upper_bound(uCompletedFenceValue);
+			for (auto bucket = m_RetiredAllocators.begin(); bucket != firstPending; ++bucket)
+			{
+				completedAllocators.insert(completedAllocators.end(), bucket->second.begin(), bucket->second.end());
+			}
+			m_RetiredAllocators.erase(m_RetiredAllocators.begin(), firstPending);
+		}
+
+		if (completedAllocators.empty())
+		{
+			return nullptr;
+		}
+
+		m_uNumInFlight.fetch_sub(completedAllocators.size(), std::memory_order_relaxed);
+
+		ID3D12CommandAllocator* pAllocator = completedAllocators.back();
+		completedAllocators.pop_back();
+
+		std::lock_guard<std::mutex> lockGuard(stripe.Mutex);
+		stripe.Allocators.insert(stripe.Allocators.end(), completedAllocators.begin(), completedAllocators.end());
+
+		return pAllocator;
+	}
+
+	HRESULT CommandAllocatorPool::createAllocator(ID3D12CommandAllocator** ppAllocator) noexcept
+	{
+		HRESULT hr = S_OK;
+		*ppAllocator = nullptr;
+
+		ComPtr<ID3D12CommandAllocator> pAllocator;
+		hr = m_pDevice->CreateCommandAllocator(m_Type, IID_PPV_ARGS(&pAllocator));
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Creating Command Allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_AllocatorMutex);
+
+		WCHAR szAllocatorName[32];
+		swprintf_s(szAllocatorName, L"CommandAllocator %zu", m_uNumCreated.fetch_add(1, std::memory_order_relaxed));
+		pAllocator->SetName(szAllocatorName);
+		m_AllocatorPool.push_back(pAllocator);
+		m_uNumAllocators.store(m_AllocatorPool.size(), std::memory_order_relaxed);
+		*ppAllocator = pAllocator.Get();
+
+		return hr;
+	}
+
+	void CommandAllocatorPool::updateHighWaterMark(size_t uNumInFlight) noexcept
+	{
+		size_t uHighWaterMark = m_uHighWaterMark.load(std::memory_order_relaxed);
+		while (uNumInFlight > uHighWaterMark &&
+			!m_uHighWaterMark.compare_exchange_weak(uHighWaterMark, uNumInFlight, std::memory_order_relaxed))
+		{
+		}
 	}
-}
\ No newline at end of file
+}
@@ -4,6 +4,26 @@
 
 namespace esperanza
 {
+	struct CommandAllocatorPoolStatistics
+	{
+		size_t uNumAllocators;
+		size_t uNumInFlight;
+		size_t uHighWaterMark;
+		size_t uNumCreated;
+		size_t uNumReused;
+		size_t uNumTrimmed;
+	};
+
+	// Every free list stripe fills a cache line of its own so that threads on different stripes do not false
+	// share, which is padding MSVC warns about.
+#pragma warning(push)
+#pragma warning(disable : 4324)
+
+	// Discarded allocators wait in buckets ordered by the fence value that frees them.  Once that fence has
+	// completed the whole bucket moves to the free list of the requesting thread, so a single slow fence no
+	// longer hides allocators that are already reusable.  Free lists are striped by thread and each stripe has
+	// its own lock, a thread only touches another stripe when its own is empty.  Every TRIM_INTERVAL requests
+	// the idle allocators above the peak number in flight since the previous trim are released.
 	class CommandAllocatorPool final
 	{
 	public:
@@ -21,18 +41,54 @@ namespace esperanza
 		HRESULT RequestAllocator(_Out_ ID3D12CommandAllocator** ppAllocator, _In_ UINT64 uCompletedFenceValue) noexcept;
 		void DiscardAllocator(_In_ UINT64 uFenceValue, _In_ ID3D12CommandAllocator* pAllocator) noexcept;
 
-		constexpr size_t GetSize() const noexcept;
+		// Releases idle allocators above the high-water mark of allocators in flight
+		void Trim() noexcept;
+
+		size_t GetSize() const noexcept;
+		void GetStatistics(_Out_ CommandAllocatorPoolStatistics& outStatistics) const noexcept;
+
+	private:
+		static constexpr const size_t NUM_FREE_LIST_STRIPES = 8u;
+		static constexpr const size_t TRIM_INTERVAL = 1024u;
+
+		struct alignas(64) FreeListStripe
+		{
+			std::mutex Mutex;
+			std::vector<ID3D12CommandAllocator*> Allocators;
+		};
+
+	private:
+		FreeListStripe& getStripe() noexcept;
+		ID3D12CommandAllocator* popFreeAllocator(_In_ FreeListStripe& stripe) noexcept;
+		ID3D12CommandAllocator* collectCompletedAllocators(_In_ FreeListStripe& stripe, _In_ UINT64 uCompletedFenceValue) noexcept;
+		HRESULT createAllocator(_Out_ ID3D12CommandAllocator** ppAllocator) noexcept;
+		void updateHighWaterMark(_In_ size_t uNumInFlight) noexcept;
 
 	private:
 		const D3D12_COMMAND_LIST_TYPE m_Type;
 		ComPtr<ID3D12Device> m_pDevice;
-		std::vector<ID3D12CommandAllocator*> m_AllocatorPool;
-		std::queue<std::pair<UINT64, ID3D12CommandAllocator*>> m_ReadyAllocators;
+
+		// Owns every allocator, only locked to create or release one
+		std::vector<ComPtr<ID3D12CommandAllocator>> m_AllocatorPool;
 		std::mutex m_AllocatorMutex;
+
+		std::map<UINT64, std::vector<ID3D12CommandAllocator*>> m_RetiredAllocators;
+		std::mutex m_RetiredMutex;
+
+		FreeListStripe m_aFreeListStripes[NUM_FREE_LIST_STRIPES];
+
+		std::atomic<size_t> m_uNumAllocators;
+		std::atomic<size_t> m_uNumInFlight;
+		std::atomic<size_t> m_uHighWaterMark;
+		std::atomic<size_t> m_uNumCreated;
+		std::atomic<size_t> m_uNumReused;
+		std::atomic<size_t> m_uNumTrimmed;
+		std::atomic<size_t> m_uNumRequests;
 	};
+#pragma warning(pop)
 
-	constexpr size_t CommandAllocatorPool::GetSize() const noexcept
+	inline size_t CommandAllocatorPool::GetSize() const noexcept
 	{
-		return m_AllocatorPool.size();
+		return m_uNumAllocators.load(std::memory_order_relaxed);
 	}
-}
\ No newline at end of file
+}
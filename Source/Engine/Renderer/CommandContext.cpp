@@ -0,0 +1,750 @@
+#include "Pch.h"
+#include "Renderer/CommandContext.h"
+
+#include "Renderer/CommandListManager.h"
+#include "Renderer/GpuResource.h"
+
+namespace esperanza
+{
+	CommandContext::CommandContext(D3D12_COMMAND_LIST_TYPE type) noexcept
+		: m_Type(type)
+		, m_uPoolIndex(0)
+		, m_pOwner(nullptr)
+		, m_pCommandListManager(nullptr)
+		, m_pCommandList()
+		, m_pCurrentAllocator(nullptr)
+		, m_strName()
+		, m_uSubmittedFenceValue(0)
+		, m_TrackedResources()
+		, m_aPendingBarriers()
+		, m_uNumPendingBarriers(0)
+		, m_BarrierStatistics()
+	{
+	}
+
+	HRESULT CommandContext::Finish(UINT64& uOutFenceValue) noexcept
+	{
+		return Finish(uOutFenceValue, FALSE);
+	}
+
+	HRESULT CommandContext::Finish(UINT64& uOutFenceValue, BOOL bWaitForCompletion) noexcept
+	{
+		HRESULT hr = S_OK;
+		uOutFenceValue = 0;
+
+		CommandQueue& queue = m_pCommandListManager->GetQueue(m_Type);
+
+		// Split barriers never stay open across lists, so every resource leaves this list in a known state
+		for (auto& [pResource, state] : m_TrackedResources)
+		{
+			if (state.SplitState != INVALID_RESOURCE_STATE)
+			{
+				endSplitTransition(*pResource, state);
+			}
+		}
+
+		FlushResourceBarriers();
+
+		{
+			std::lock_guard<std::mutex> lockGuard(m_pOwner->m_ResourceStateMutex);
+
+			CommandContext* pFixupContext = nullptr;
+			hr = resolveInitialStates(queue, &pFixupContext);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Resolving initial resource states failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				// Never submitted, but the list has to be closed before the pool can reset it
+				m_pCommandList->Close();
+				retire(queue, queue.GetLastSubmittedFenceValue());
+
+				return hr;
+			}
+
+			hr = queue.SubmitCommandList(uOutFenceValue, m_pCommandList.Get());
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Submitting Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				// The fix-up list is queued already and leaves every resource in the state this list expected
+				if (pFixupContext)
+				{
+					for (auto& [pResource, state] : m_TrackedResources)
+					{
+						if (!state.bIsDiscarded)
+						{
+							pResource->m_UsageState = state.InitialState;
+						}
+					}
+
+					CommandQueue& fixupQueue = m_pCommandListManager->GetQueue(pFixupContext->m_Type);
+					pFixupContext->retire(fixupQueue, fixupQueue.GetLastSubmittedFenceValue());
+				}
+
+				// Nothing or only part of the list may have reached the GPU, the next signal covers either
+				retire(queue, queue.GetLastSubmittedFenceValue() + 1);
+				uOutFenceValue = 0;
+
+				return hr;
+			}
+
+			// Only a submitted list changes the global state of its resources
+			for (auto& [pResource, state] : m_TrackedResources)
+			{
+				pResource->m_UsageState = state.CurrentState;
+			}
+
+			// A fix-up list on this queue is queued right in front of this one, so its list is not reset before
+			// this batch has gone to the GPU either.  One on the graphics queue was flushed by the wait.
+			if (pFixupContext)
+			{
+				CommandQueue& fixupQueue = m_pCommandListManager->GetQueue(pFixupContext->m_Type);
+				pFixupContext->retire(fixupQueue, &fixupQueue == &queue ? uOutFenceValue : fixupQueue.GetLastSubmittedFenceValue());
+			}
+
+			ResourceBarrierStatistics& ownerStatistics = m_pOwner->m_BarrierStatistics;
+			ownerStatistics.uNumTransitionBarriers += m_BarrierStatistics.uNumTransitionBarriers;
+			ownerStatistics.uNumSplitBarriers += m_BarrierStatistics.uNumSplitBarriers;
+			ownerStatistics.uNumUavBarriers += m_BarrierStatistics.uNumUavBarriers;
+			ownerStatistics.uNumAliasBarriers += m_BarrierStatistics.uNumAliasBarriers;
+			ownerStatistics.uNumFixupBarriers += m_BarrierStatistics.uNumFixupBarriers;
+			ownerStatistics.uNumSkippedTransitions += m_BarrierStatistics.uNumSkippedTransitions;
+			ownerStatistics.uNumBarrierFlushes += m_BarrierStatistics.uNumBarrierFlushes;
+		}
+
+		// Waiting flushes the batch the list is queued in
+		if (bWaitForCompletion)
+		{
+			hr = queue.WaitForFence(uOutFenceValue);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Wait For Fence failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+			}
+		}
+
+		// The allocator can be reset once the GPU is done with this submission
+		retire(queue, uOutFenceValue);
+
+		return hr;
+	}
+
+	GraphicsContext& CommandContext::GetGraphicsContext() noexcept
+	{
+		assert(m_Type == D3D12_COMMAND_LIST_TYPE_DIRECT && dynamic_cast<GraphicsContext*>(this));
+
+		return static_cast<GraphicsContext&>(*this);
+	}
+
+	ComputeContext& CommandContext::GetComputeContext() noexcept
+	{
+		assert(dynamic_cast<ComputeContext*>(this));
+
+		return static_cast<ComputeContext&>(*this);
+	}
+
+	void CommandContext::TransitionResource(GpuResource& resource, D3D12_RESOURCE_STATES newState) noexcept
+	{
+		TransitionResource(resource, newState, FALSE);
+	}
+
+	void CommandContext::TransitionResource(GpuResource& resource, D3D12_RESOURCE_STATES newState, BOOL bFlushImmediate) noexcept
+	{
+		auto it = m_TrackedResources.find(&resource);
+		if (it == m_TrackedResources.end())
+		{
+			// Whatever state the resource is in when the list runs is only known at submission
+			m_TrackedResources.emplace(&resource, TrackedResourceState{ newState, newState, INVALID_RESOURCE_STATE, FALSE });
+		}
+		else
+		{
+			TrackedResourceState& state = it->second;
+			if (state.SplitState != INVALID_RESOURCE_STATE)
+			{
+				endSplitTransition(resource, state);
+			}
+
+			if (IsRedundantTransition(state.CurrentState, newState))
+			{
+				++m_BarrierStatistics.uNumSkippedTransitions;
+			}
+			else
+			{
+				addTransitionBarrier(resource, state.CurrentState, newState, D3D12_RESOURCE_BARRIER_FLAG_NONE);
+				++m_BarrierStatistics.uNumTransitionBarriers;
+				state.CurrentState = newState;
+			}
+		}
+
+		if (bFlushImmediate || m_uNumPendingBarriers == MAX_NUM_PENDING_BARRIERS)
+		{
+			FlushResourceBarriers();
+		}
+	}
+
+	void CommandContext::BeginResourceTransition(GpuResource& resource, D3D12_RESOURCE_STATES newState) noexcept
+	{
+		auto it = m_TrackedResources.find(&resource);
+		if (it == m_TrackedResources.end())
+		{
+			// Nothing in this list touches the resource before, so the submission fix-up already does the work
+			m_TrackedResources.emplace(&resource, TrackedResourceState{ newState, newState, INVALID_RESOURCE_STATE, FALSE });
+
+			return;
+		}
+
+		TrackedResourceState& state = it->second;
+		if (state.SplitState != INVALID_RESOURCE_STATE)
+		{
+			if (state.SplitState == newState)
+			{
+				return;
+			}
+
+			endSplitTransition(resource, state);
+		}
+
+		if (IsRedundantTransition(state.CurrentState, newState))
+		{
+			++m_BarrierStatistics.uNumSkippedTransitions;
+
+			return;
+		}
+
+		addTransitionBarrier(resource, state.CurrentState, newState, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+		++m_BarrierStatistics.uNumSplitBarriers;
+		state.SplitState = newState;
+
+		if (m_uNumPendingBarriers == MAX_NUM_PENDING_BARRIERS)
+		{
+			FlushResourceBarriers();
+		}
+	}
+
+	void CommandContext::InsertUAVBarrier(GpuResource& resource) noexcept
+	{
+		InsertUAVBarrier(resource, FALSE);
+	}
+
+	void CommandContext::InsertUAVBarrier(GpuResource& resource, BOOL bFlushImmediate) noexcept
+	{
+		assert(m_uNumPendingBarriers < MAX_NUM_PENDING_BARRIERS);
+
+		D3D12_RESOURCE_BARRIER& barrier = m_aPendingBarriers[m_uNumPendingBarriers++];
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.UAV.pResource = resource.GetResource();
+		++m_BarrierStatistics.uNumUavBarriers;
+
+		if (bFlushImmediate || m_uNumPendingBarriers == MAX_NUM_PENDING_BARRIERS)
+		{
+			FlushResourceBarriers();
+		}
+	}
+
+	void CommandContext::InsertAliasBarrier(GpuResource* pBefore, GpuResource& after) noexcept
+	{
+		assert(m_uNumPendingBarriers < MAX_NUM_PENDING_BARRIERS);
+
+		D3D12_RESOURCE_BARRIER& barrier = m_aPendingBarriers[m_uNumPendingBarriers++];
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.Aliasing.pResourceBefore = pBefore ? pBefore->GetResource() : nullptr;
+		barrier.Aliasing.pResourceAfter = after.GetResource();
+		++m_BarrierStatistics.uNumAliasBarriers;
+
+		if (m_uNumPendingBarriers == MAX_NUM_PENDING_BARRIERS)
+		{
+			FlushResourceBarriers();
+		}
+	}
+
+	void CommandContext::ActivateAliasedResource(GpuResource& resource, D3D12_RESOURCE_STATES activeState) noexcept
+	{
+		assert(activeState == D3D12_RESOURCE_STATE_RENDER_TARGET || activeState == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+		auto it = m_TrackedResources.find(&resource);
+		if (it == m_TrackedResources.end())
+		{
+			m_TrackedResources.emplace(&resource, TrackedResourceState{ activeState, activeState, INVALID_RESOURCE_STATE, TRUE });
+		}
+		else
+		{
+			// Used earlier in this list, so its state is known and only has to reach activeState
+			TransitionResource(resource, activeState);
+		}
+
+		InsertAliasBarrier(nullptr, resource);
+		FlushResourceBarriers();
+
+		m_pCommandList->DiscardResource(resource.GetResource(), nullptr);
+	}
+
+	void CommandContext::FlushResourceBarriers() noexcept
+	{
+		if (m_uNumPendingBarriers == 0)
+		{
+			return;
+		}
+
+		m_pCommandList->ResourceBarrier(m_uNumPendingBarriers, m_aPendingBarriers);
+		m_uNumPendingBarriers = 0;
+		++m_BarrierStatistics.uNumBarrierFlushes;
+	}
+
+	ID3D12GraphicsCommandList* CommandContext::GetCommandList() noexcept
+	{
+		return m_pCommandList.Get();
+	}
+
+	void CommandContext::addTransitionBarrier(GpuResource& resource, D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter, D3D12_RESOURCE_BARRIER_FLAGS flags) noexcept
+	{
+		if (m_uNumPendingBarriers == MAX_NUM_PENDING_BARRIERS)
+		{
+			FlushResourceBarriers();
+		}
+
+		D3D12_RESOURCE_BARRIER& barrier = m_aPendingBarriers[m_uNumPendingBarriers++];
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = flags;
+		barrier.Transition.pResource = resource.GetResource();
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		barrier.Transition.StateBefore = stateBefore;
+		barrier.Transition.StateAfter = stateAfter;
+	}
+
+	void CommandContext::endSplitTransition(GpuResource& resource, TrackedResourceState& state) noexcept
+	{
+		addTransitionBarrier(resource, state.CurrentState, state.SplitState, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+		++m_BarrierStatistics.uNumSplitBarriers;
+
+		state.CurrentState = state.SplitState;
+		state.SplitState = INVALID_RESOURCE_STATE;
+	}
+
+	HRESULT CommandContext::resolveInitialStates(CommandQueue& queue, CommandContext** ppOutFixupContext) noexcept
+	{
+		HRESULT hr = S_OK;
+		*ppOutFixupContext = nullptr;
+
+		// Called with the owner's resource state lock held.  The global states are left alone, they are only
+		// committed once the list has been submitted.
+		std::vector<D3D12_RESOURCE_BARRIER> fixupBarriers;
+		BOOL bNeedsGraphicsQueue = FALSE;
+		for (auto& [pResource, state] : m_TrackedResources)
+		{
+			if (state.bIsDiscarded)
+			{
+				continue;
+			}
+
+			// A list that never leaves the state it expects can start in a combined read state covering it,
+			// the broader state is kept as is.  A list transitioning away has recorded the narrower one as
+			// the state before, so it still needs the fix-up.
+			if (IsRedundantTransition(pResource->m_UsageState, state.InitialState))
+			{
+				if (pResource->m_UsageState == state.InitialState)
+				{
+					continue;
+				}
+
+				if (state.CurrentState == state.InitialState)
+				{
+					state.InitialState = pResource->m_UsageState;
+					state.CurrentState = pResource->m_UsageState;
+					++m_BarrierStatistics.uNumSkippedTransitions;
+
+					continue;
+				}
+			}
+
+			bNeedsGraphicsQueue |= !IsSupportedState(m_Type, pResource->m_UsageState) || !IsSupportedState(m_Type, state.InitialState);
+			fixupBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource->GetResource(), pResource->m_UsageState, state.InitialState));
+		}
+
+		if (fixupBarriers.empty())
+		{
+			return hr;
+		}
+
+		// The fix-up barriers go in a small list queued right in front of this one.  Compute and copy queues
+		// cannot transition from or into graphics states, those fix-ups go to the graphics queue instead and
+		// this queue waits for them.
+		const ContextManager::eContextType fixupContextType = bNeedsGraphicsQueue ? ContextManager::eContextType::Graphics : static_cast<ContextManager::eContextType>(m_uPoolIndex);
+
+		CommandContext* pFixupContext = nullptr;
+		hr = m_pOwner->allocateContext(&pFixupContext, fixupContextType, L"Resource State Fix-up");
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Allocating fix-up Command Context failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		pFixupContext->m_pCommandList->ResourceBarrier(static_cast<UINT>(fixupBarriers.size()), fixupBarriers.data());
+
+		CommandQueue& fixupQueue = m_pCommandListManager->GetQueue(pFixupContext->m_Type);
+
+		UINT64 uFixupFenceValue = 0;
+		hr = fixupQueue.SubmitCommandList(uFixupFenceValue, pFixupContext->m_pCommandList.Get());
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Submitting fix-up Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			pFixupContext->retire(fixupQueue, fixupQueue.GetLastSubmittedFenceValue() + 1);
+
+			return hr;
+		}
+
+		if (&fixupQueue != &queue)
+		{
+			hr = queue.StallForFence(*m_pCommandListManager, uFixupFenceValue);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Waiting for the fix-up Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				// The fix-up went out all the same and leaves every resource in the state this list expected
+				for (auto& [pResource, state] : m_TrackedResources)
+				{
+					if (!state.bIsDiscarded)
+					{
+						pResource->m_UsageState = state.InitialState;
+					}
+				}
+
+				pFixupContext->retire(fixupQueue, uFixupFenceValue);
+
+				return hr;
+			}
+		}
+
+		m_BarrierStatistics.uNumFixupBarriers += fixupBarriers.size();
+
+		// Returned to the pool by the caller once the list it fixes up is queued behind it
+		*ppOutFixupContext = pFixupContext;
+
+		return hr;
+	}
+
+	void CommandContext::retire(CommandQueue& queue, UINT64 uFenceValue) noexcept
+	{
+		if (m_pCurrentAllocator)
+		{
+			queue.discardAllocator(uFenceValue, m_pCurrentAllocator);
+			m_pCurrentAllocator = nullptr;
+		}
+
+		// Reused only once the batch of uFenceValue has gone to the GPU
+		m_uSubmittedFenceValue = uFenceValue;
+		m_TrackedResources.clear();
+		m_uNumPendingBarriers = 0;
+		m_BarrierStatistics = {};
+
+		m_pOwner->freeContext(this);
+	}
+
+	HRESULT CommandContext::initialize(ContextManager& owner, CommandListManager& commandListManager) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		m_pOwner = &owner;
+		m_pCommandListManager = &commandListManager;
+
+		// The new list is created open, recording into an allocator fresh from the queue
+		m_TrackedResources.clear();
+		m_uNumPendingBarriers = 0;
+
+		hr = commandListManager.CreateNewCommandList(m_pCommandList.ReleaseAndGetAddressOf(), &m_pCurrentAllocator, m_Type);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Creating New Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		return hr;
+	}
+
+	HRESULT CommandContext::reset() noexcept
+	{
+		HRESULT hr = S_OK;
+
+		m_TrackedResources.clear();
+		m_uNumPendingBarriers = 0;
+
+		hr = m_pCommandListManager->GetQueue(m_Type).requestAllocator(&m_pCurrentAllocator);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Requesting allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_pCommandList->Reset(m_pCurrentAllocator, nullptr);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Resetting Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			// Nothing was recorded into the allocator, it is free again as soon as it was before
+			CommandQueue& queue = m_pCommandListManager->GetQueue(m_Type);
+			queue.discardAllocator(queue.GetLastSubmittedFenceValue(), m_pCurrentAllocator);
+			m_pCurrentAllocator = nullptr;
+
+			return hr;
+		}
+
+		return hr;
+	}
+
+	void CommandContext::setName(const std::wstring& strName) noexcept
+	{
+		m_strName = strName;
+#ifdef _DEBUG
+		m_pCommandList->SetName(m_strName.c_str());
+#endif
+	}
+
+	GraphicsContext::GraphicsContext() noexcept
+		: CommandContext(D3D12_COMMAND_LIST_TYPE_DIRECT)
+	{
+	}
+
+	void GraphicsContext::ClearColor(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT aColor[4]) noexcept
+	{
+		m_pCommandList->ClearRenderTargetView(rtv, aColor, 0, nullptr);
+	}
+
+	void GraphicsContext::SetRenderTargets(UINT uNumRtvs, const D3D12_CPU_DESCRIPTOR_HANDLE* pRtvs) noexcept
+	{
+		m_pCommandList->OMSetRenderTargets(uNumRtvs, pRtvs, FALSE, nullptr);
+	}
+
+	void GraphicsContext::SetViewportAndScissor(const D3D12_VIEWPORT& viewport, const D3D12_RECT& scissorRect) noexcept
+	{
+		m_pCommandList->RSSetViewports(1, &viewport);
+		m_pCommandList->RSSetScissorRects(1, &scissorRect);
+	}
+
+	void GraphicsContext::SetRootSignature(ID3D12RootSignature* pRootSignature) noexcept
+	{
+		m_pCommandList->SetGraphicsRootSignature(pRootSignature);
+	}
+
+	void GraphicsContext::SetPipelineState(ID3D12PipelineState* pPipelineState) noexcept
+	{
+		m_pCommandList->SetPipelineState(pPipelineState);
+	}
+
+	void GraphicsContext::SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) noexcept
+	{
+		m_pCommandList->IASetPrimitiveTopology(topology);
+	}
+
+	void GraphicsContext::SetVertexBuffer(UINT uSlot, const D3D12_VERTEX_BUFFER_VIEW& vertexBufferView) noexcept
+	{
+		m_pCommandList->IASetVertexBuffers(uSlot, 1, &vertexBufferView);
+	}
+
+	void GraphicsContext::DrawInstanced(UINT uVertexCountPerInstance, UINT uInstanceCount, UINT uStartVertexLocation, UINT uStartInstanceLocation) noexcept
+	{
+		m_pCommandList->DrawInstanced(uVertexCountPerInstance, uInstanceCount, uStartVertexLocation, uStartInstanceLocation);
+	}
+
+	ComputeContext::ComputeContext(D3D12_COMMAND_LIST_TYPE type) noexcept
+		: CommandContext(type)
+	{
+	}
+
+	void ComputeContext::SetRootSignature(ID3D12RootSignature* pRootSignature) noexcept
+	{
+		m_pCommandList->SetComputeRootSignature(pRootSignature);
+	}
+
+	void ComputeContext::SetPipelineState(ID3D12PipelineState* pPipelineState) noexcept
+	{
+		m_pCommandList->SetPipelineState(pPipelineState);
+	}
+
+	void ComputeContext::Dispatch(UINT uGroupCountX, UINT uGroupCountY, UINT uGroupCountZ) noexcept
+	{
+		m_pCommandList->Dispatch(uGroupCountX, uGroupCountY, uGroupCountZ);
+	}
+
+	ContextManager::ContextManager() noexcept
+		: m_pCommandListManager()
+		, m_ContextAllocationMutex()
+		, m_aContextPools()
+		, m_aAvailableContexts()
+		, m_ResourceStateMutex()
+		, m_BarrierStatistics()
+	{
+	}
+
+	HRESULT ContextManager::Initialize(std::shared_ptr<CommandListManager>& pCommandListManager) noexcept
+	{
+		if (!pCommandListManager)
+		{
+			GLOGE(L"Command list manager is null!");
+
+			return E_FAIL;
+		}
+
+		m_pCommandListManager = pCommandListManager;
+
+		return S_OK;
+	}
+
+	void ContextManager::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_ContextAllocationMutex);
+
+		for (size_t i = 0; i < static_cast<size_t>(eContextType::COUNT); ++i)
+		{
+			m_aAvailableContexts[i].clear();
+			m_aContextPools[i].clear();
+		}
+
+		m_pCommandListManager.reset();
+	}
+
+	HRESULT ContextManager::BeginGraphicsContext(GraphicsContext** ppOutContext, const std::wstring& strName) noexcept
+	{
+		CommandContext* pContext = nullptr;
+		HRESULT hr = allocateContext(&pContext, eContextType::Graphics, strName);
+		*ppOutContext = static_cast<GraphicsContext*>(pContext);
+
+		return hr;
+	}
+
+	HRESULT ContextManager::BeginComputeContext(ComputeContext** ppOutContext, const std::wstring& strName, BOOL bAsync) noexcept
+	{
+		CommandContext* pContext = nullptr;
+		HRESULT hr = allocateContext(&pContext, bAsync ? eContextType::AsyncCompute : eContextType::Compute, strName);
+		*ppOutContext = static_cast<ComputeContext*>(pContext);
+
+		return hr;
+	}
+
+	HRESULT ContextManager::BeginCopyContext(CommandContext** ppOutContext, const std::wstring& strName) noexcept
+	{
+		return allocateContext(ppOutContext, eContextType::Copy, strName);
+	}
+
+	void ContextManager::GetResourceBarrierStatistics(ResourceBarrierStatistics& outStatistics) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_ResourceStateMutex);
+
+		outStatistics = m_BarrierStatistics;
+	}
+
+	HRESULT ContextManager::allocateContext(CommandContext** ppOutContext, eContextType contextType, const std::wstring& strName) noexcept
+	{
+		HRESULT hr = S_OK;
+		*ppOutContext = nullptr;
+
+		const size_t uPoolIndex = static_cast<size_t>(contextType);
+		CommandContext* pContext = nullptr;
+		BOOL bIsNew = FALSE;
+
+		{
+			std::lock_guard<std::mutex> lockGuard(m_ContextAllocationMutex);
+
+			// A finished list may still wait in the pending batch of its queue, only one that has gone to the
+			// GPU can be reset.  Contexts are created until one is, which is at most a batch worth.
+			std::vector<CommandContext*>& availableContexts = m_aAvailableContexts[uPoolIndex];
+			for (auto it = availableContexts.rbegin(); it != availableContexts.rend(); ++it)
+			{
+				if (m_pCommandListManager->GetQueue((*it)->m_Type).IsBatchFlushed((*it)->m_uSubmittedFenceValue))
+				{
+					pContext = *it;
+					availableContexts.erase(std::next(it).base());
+
+					break;
+				}
+			}
+
+			if (!pContext)
+			{
+				std::unique_ptr<CommandContext> pNewContext;
+				switch (contextType)
+				{
+				case eContextType::Graphics:
+					pNewContext.reset(new (std::nothrow) GraphicsContext());
+					break;
+				case eContextType::Compute:
+					pNewContext.reset(new (std::nothrow) ComputeContext(D3D12_COMMAND_LIST_TYPE_DIRECT));
+					break;
+				case eContextType::AsyncCompute:
+					pNewContext.reset(new (std::nothrow) ComputeContext(D3D12_COMMAND_LIST_TYPE_COMPUTE));
+					break;
+				case eContextType::Copy:
+					pNewContext.reset(new (std::nothrow) CommandContext(D3D12_COMMAND_LIST_TYPE_COPY));
+					break;
+				case eContextType::COUNT:
+					[[fallthrough]];
+				default:
+					assert(false);
+					break;
+				}
+
+				if (!pNewContext)
+				{
+					GLOGE(L"Allocating Command Context failed");
+
+					return E_OUTOFMEMORY;
+				}
+
+				pNewContext->m_uPoolIndex = static_cast<uint8_t>(uPoolIndex);
+				pContext = pNewContext.get();
+				m_aContextPools[uPoolIndex].push_back(std::move(pNewContext));
+				bIsNew = TRUE;
+			}
+		}
+
+		// Creating or resetting the list happens outside the lock so threads can begin in parallel
+		hr = bIsNew ? pContext->initialize(*this, *m_pCommandListManager) : pContext->reset();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Preparing Command Context failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			if (bIsNew)
+			{
+				// A context without a list can never be begun, drop it instead of pooling it
+				std::lock_guard<std::mutex> lockGuard(m_ContextAllocationMutex);
+
+				std::erase_if(m_aContextPools[uPoolIndex],
+					[pContext](const std::unique_ptr<CommandContext>& pPooledContext)
+					{
+						return pPooledContext.get() == pContext;
+					});
+			}
+			else
+			{
+				freeContext(pContext);
+			}
+
+			return hr;
+		}
+
+		pContext->setName(strName);
+		*ppOutContext = pContext;
+
+		return hr;
+	}
+
+	void ContextManager::freeContext(CommandContext* pContext) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_ContextAllocationMutex);
+
+		m_aAvailableContexts[pContext->m_uPoolIndex].push_back(pContext);
+	}
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+	class CommandQueue;
+	class ComputeContext;
+	class ContextManager;
+	class GpuResource;
+	class GraphicsContext;
+
+	struct ResourceBarrierStatistics
+	{
+		uint64_t uNumTransitionBarriers;
+		uint64_t uNumSplitBarriers;
+		uint64_t uNumUavBarriers;
+		uint64_t uNumAliasBarriers;
+		uint64_t uNumFixupBarriers;
+		uint64_t uNumSkippedTransitions;
+		uint64_t uNumBarrierFlushes;
+	};
+
+	// A command list together with the allocator it is recording into.  Contexts are pooled by a
+	// ContextManager, any number of threads can Begin, record and Finish their own context at the same time.
+	// Finish queues the list in the next batch of its queue and hands the allocator back with the fence value
+	// of that batch.  Batches go to the GPU when full, when the queue is waited on or signaled, and at the end
+	// of every frame.
+	class CommandContext
+	{
+		friend class ContextManager;
+
+	public:
+		CommandContext() = delete;
+		explicit CommandContext(_In_ D3D12_COMMAND_LIST_TYPE type) noexcept;
+		CommandContext(const CommandContext& other) = delete;
+		CommandContext(CommandContext&& other) = delete;
+		CommandContext& operator=(const CommandContext& other) = delete;
+		CommandContext& operator=(CommandContext&& other) = delete;
+		virtual ~CommandContext() noexcept = default;
+
+		// Submits the recorded commands and returns the context to its pool, the context must not be used
+		// afterwards, whether the submission succeeded or not
+		HRESULT Finish(_Out_ UINT64& uOutFenceValue) noexcept;
+		HRESULT Finish(_Out_ UINT64& uOutFenceValue, _In_ BOOL bWaitForCompletion) noexcept;
+
+		GraphicsContext& GetGraphicsContext() noexcept;
+		ComputeContext& GetComputeContext() noexcept;
+
+		// Transitions are recorded lazily and go to the command list in one ResourceBarrier call when the
+		// batch is full, on FlushResourceBarriers or before the list is submitted.  The first transition of a
+		// resource in a list only records the state the list expects, it is resolved against the global state
+		// of the resource when the list is submitted.
+		void TransitionResource(_In_ GpuResource& resource, _In_ D3D12_RESOURCE_STATES newState) noexcept;
+		void TransitionResource(_In_ GpuResource& resource, _In_ D3D12_RESOURCE_STATES newState, _In_ BOOL bFlushImmediate) noexcept;
+
+		// Starts a split barrier, the transition is ended by the next TransitionResource to the same state
+		void BeginResourceTransition(_In_ GpuResource& resource, _In_ D3D12_RESOURCE_STATES newState) noexcept;
+		void InsertUAVBarrier(_In_ GpuResource& resource) noexcept;
+		void InsertUAVBarrier(_In_ GpuResource& resource, _In_ BOOL bFlushImmediate) noexcept;
+
+		// Activates a placed resource over memory another resource may have used, pBefore can be null
+		void InsertAliasBarrier(_In_opt_ GpuResource* pBefore, _In_ GpuResource& after) noexcept;
+
+		// Activates a placed resource and discards its contents in activeState, which has to be a render target
+		// or depth write state.  The state it was left in goes with the contents, the resource is tracked in
+		// activeState from here on and never gets a fix-up transition at submission.
+		void ActivateAliasedResource(_In_ GpuResource& resource, _In_ D3D12_RESOURCE_STATES activeState) noexcept;
+		void FlushResourceBarriers() noexcept;
+
+		static constexpr BOOL IsRedundantTransition(_In_ D3D12_RESOURCE_STATES currentState, _In_ D3D12_RESOURCE_STATES newState) noexcept;
+
+		// Whether a list of the given type can transition a resource from or into the state
+		static constexpr BOOL IsSupportedState(_In_ D3D12_COMMAND_LIST_TYPE type, _In_ D3D12_RESOURCE_STATES state) noexcept;
+
+		ID3D12GraphicsCommandList* GetCommandList() noexcept;
+		constexpr D3D12_COMMAND_LIST_TYPE GetType() const noexcept;
+
+	protected:
+		static constexpr const UINT MAX_NUM_PENDING_BARRIERS = 16u;
+		static constexpr const D3D12_RESOURCE_STATES INVALID_RESOURCE_STATE = static_cast<D3D12_RESOURCE_STATES>(-1);
+
+		struct TrackedResourceState
+		{
+			// State the resource must be in when the list starts executing
+			D3D12_RESOURCE_STATES InitialState;
+			D3D12_RESOURCE_STATES CurrentState;
+
+			// Target of a split barrier that has begun but not ended yet
+			D3D12_RESOURCE_STATES SplitState;
+
+			// Activated by this list with its contents discarded, whatever state it was in does not matter
+			BOOL bIsDiscarded;
+		};
+
+	protected:
+		void addTransitionBarrier(_In_ GpuResource& resource, _In_ D3D12_RESOURCE_STATES stateBefore, _In_ D3D12_RESOURCE_STATES stateAfter, _In_ D3D12_RESOURCE_BARRIER_FLAGS flags) noexcept;
+		void endSplitTransition(_In_ GpuResource& resource, _Inout_ TrackedResourceState& state) noexcept;
+		HRESULT resolveInitialStates(_Inout_ CommandQueue& queue, _Out_ CommandContext** ppOutFixupContext) noexcept;
+
+		// Hands the allocator back with the fence value that frees it and returns the context to its pool
+		void retire(_Inout_ CommandQueue& queue, _In_ UINT64 uFenceValue) noexcept;
+
+		HRESULT initialize(_In_ ContextManager& owner, _In_ CommandListManager& commandListManager) noexcept;
+		HRESULT reset() noexcept;
+		void setName(_In_ const std::wstring& strName) noexcept;
+
+	protected:
+		const D3D12_COMMAND_LIST_TYPE m_Type;
+		uint8_t m_uPoolIndex;
+		ContextManager* m_pOwner;
+		CommandListManager* m_pCommandListManager;
+		ComPtr<ID3D12GraphicsCommandList> m_pCommandList;
+		ID3D12CommandAllocator* m_pCurrentAllocator;
+		std::wstring m_strName;
+
+		// Fence value of the batch the list was last queued in, the list is only reset once that batch is flushed
+		UINT64 m_uSubmittedFenceValue;
+
+		std::unordered_map<GpuResource*, TrackedResourceState> m_TrackedResources;
+		D3D12_RESOURCE_BARRIER m_aPendingBarriers[MAX_NUM_PENDING_BARRIERS];
+		UINT m_uNumPendingBarriers;
+		ResourceBarrierStatistics m_BarrierStatistics;
+	};
+
+	class GraphicsContext final : public CommandContext
+	{
+	public:
+		explicit GraphicsContext() noexcept;
+		GraphicsContext(const GraphicsContext& other) = delete;
+		GraphicsContext(GraphicsContext&& other) = delete;
+		GraphicsContext& operator=(const GraphicsContext& other) = delete;
+		GraphicsContext& operator=(GraphicsContext&& other) = delete;
+		~GraphicsContext() noexcept = default;
+
+		void ClearColor(_In_ D3D12_CPU_DESCRIPTOR_HANDLE rtv, _In_ const FLOAT aColor[4]) noexcept;
+		void SetRenderTargets(_In_ UINT uNumRtvs, _In_reads_(uNumRtvs) const D3D12_CPU_DESCRIPTOR_HANDLE* pRtvs) noexcept;
+		void SetViewportAndScissor(_In_ const D3D12_VIEWPORT& viewport, _In_ const D3D12_RECT& scissorRect) noexcept;
+		void SetRootSignature(_In_ ID3D12RootSignature* pRootSignature) noexcept;
+		void SetPipelineState(_In_ ID3D12PipelineState* pPipelineState) noexcept;
+		void SetPrimitiveTopology(_In_ D3D12_PRIMITIVE_TOPOLOGY topology) noexcept;
+		void SetVertexBuffer(_In_ UINT uSlot, _In_ const D3D12_VERTEX_BUFFER_VIEW& vertexBufferView) noexcept;
+		void DrawInstanced(_In_ UINT uVertexCountPerInstance, _In_ UINT uInstanceCount, _In_ UINT uStartVertexLocation, _In_ UINT uStartInstanceLocation) noexcept;
+	};
+
+	class ComputeContext final : public CommandContext
+	{
+	public:
+		ComputeContext() = delete;
+		explicit ComputeContext(_In_ D3D12_COMMAND_LIST_TYPE type) noexcept;
+		ComputeContext(const ComputeContext& other) = delete;
+		ComputeContext(ComputeContext&& other) = delete;
+		ComputeContext& operator=(const ComputeContext& other) = delete;
+		ComputeContext& operator=(ComputeContext&& other) = delete;
+		~ComputeContext() noexcept = default;
+
+		void SetRootSignature(_In_ ID3D12RootSignature* pRootSignature) noexcept;
+		void SetPipelineState(_In_ ID3D12PipelineState* pPipelineState) noexcept;
+		void Dispatch(_In_ UINT uGroupCountX, _In_ UINT uGroupCountY, _In_ UINT uGroupCountZ) noexcept;
+	};
+
+	// Owns every context and hands out idle ones by command list type.  Only taking a context from the pool
+	// and putting it back is locked, recording is not.
+	class ContextManager final
+	{
+		friend class CommandContext;
+
+	public:
+		explicit ContextManager() noexcept;
+		ContextManager(const ContextManager& other) = delete;
+		ContextManager(ContextManager&& other) = delete;
+		ContextManager& operator=(const ContextManager& other) = delete;
+		ContextManager& operator=(ContextManager&& other) = delete;
+		~ContextManager() noexcept = default;
+
+		HRESULT Initialize(_In_ std::shared_ptr<CommandListManager>& pCommandListManager) noexcept;
+		void Destroy() noexcept;
+
+		HRESULT BeginGraphicsContext(_Out_ GraphicsContext** ppOutContext, _In_ const std::wstring& strName) noexcept;
+
+		// Async compute contexts record for the compute queue, the others for the graphics queue
+		HRESULT BeginComputeContext(_Out_ ComputeContext** ppOutContext, _In_ const std::wstring& strName, _In_ BOOL bAsync) noexcept;
+		HRESULT BeginCopyContext(_Out_ CommandContext** ppOutContext, _In_ const std::wstring& strName) noexcept;
+
+		void GetResourceBarrierStatistics(_Out_ ResourceBarrierStatistics& outStatistics) noexcept;
+
+	private:
+		enum class eContextType : uint8_t
+		{
+			Graphics,
+			Compute,
+			AsyncCompute,
+			Copy,
+			COUNT,
+		};
+
+	private:
+		HRESULT allocateContext(_Out_ CommandContext** ppOutContext, _In_ eContextType contextType, _In_ const std::wstring& strName) noexcept;
+		void freeContext(_In_ CommandContext* pContext) noexcept;
+
+	private:
+		std::shared_ptr<CommandListManager> m_pCommandListManager;
+		std::mutex m_ContextAllocationMutex;
+		std::vector<std::unique_ptr<CommandContext>> m_aContextPools[static_cast<size_t>(eContextType::COUNT)];
+		std::vector<CommandContext*> m_aAvailableContexts[static_cast<size_t>(eContextType::COUNT)];
+
+		// Serializes submission against the global state of every resource, so initial states are resolved
+		// in the same order the lists reach the queues
+		std::mutex m_ResourceStateMutex;
+		ResourceBarrierStatistics m_BarrierStatistics;
+	};
+
+	inline constexpr D3D12_COMMAND_LIST_TYPE CommandContext::GetType() const noexcept
+	{
+		return m_Type;
+	}
+
+	inline constexpr BOOL CommandContext::IsRedundantTransition(D3D12_RESOURCE_STATES currentState, D3D12_RESOURCE_STATES newState) noexcept
+	{
+		constexpr const D3D12_RESOURCE_STATES READ_ONLY_STATES = D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ;
+
+		if (currentState == newState)
+		{
+			return TRUE;
+		}
+
+		// A combined read state already covers any of its read-only parts
+		return newState != D3D12_RESOURCE_STATE_COMMON &&
+			(newState & ~READ_ONLY_STATES) == 0 &&
+			(currentState & newState) == newState;
+	}
+
+	inline constexpr BOOL CommandContext::IsSupportedState(D3D12_COMMAND_LIST_TYPE type, D3D12_RESOURCE_STATES state) noexcept
+	{
+		constexpr const D3D12_RESOURCE_STATES COPY_QUEUE_STATES = D3D12_RESOURCE_STATE_COPY_DEST | D3D12_RESOURCE_STATE_COPY_SOURCE;
+		constexpr const D3D12_RESOURCE_STATES COMPUTE_QUEUE_STATES = COPY_QUEUE_STATES | D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER |
+			D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+
+		switch (type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+			return (state & ~COMPUTE_QUEUE_STATES) == 0;
+		case D3D12_COMMAND_LIST_TYPE_COPY:
+			return (state & ~COPY_QUEUE_STATES) == 0;
+		default:
+			return TRUE;
+		}
+	}
+}
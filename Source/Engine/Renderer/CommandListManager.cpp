@@ -13,7 +13,8 @@ namespace esperanza
 		, m_pFence()
 		, m_uNextFenceValue(static_cast<UINT64>(type) << 56 | 1)
 		, m_uLastCompletedFenceValue(static_cast<UINT64>(type) << 56)
-		, m_hFenceEventHandle()
+		, m_PendingCommandLists()
+		, m_FenceEvents()
 	{
 	}
 
@@ -69,8 +70,8 @@ namespace esperanza
 		m_pFence->SetName(L"CommandListManager::m_pFence");
 		m_pFence->Signal(static_cast<UINT64>(m_Type) << 56);
 
-		m_hFenceEventHandle = CreateEvent(NULL, FALSE, FALSE, nullptr);
-		if (!m_hFenceEventHandle)
+		HANDLE hFenceEvent = CreateEvent(NULL, FALSE, FALSE, nullptr);
+		if (!hFenceEvent)
 		{
 			DWORD dwError = GetLastError();
 
@@ -85,6 +86,7 @@ namespace esperanza
 
 			return E_FAIL;
 		}
+		m_FenceEvents.push_back(hFenceEvent);
 
 		m_AllocatorPool.Initialize(pDevice);
 
@@ -106,7 +108,15 @@ namespace esperanza
 
 		m_AllocatorPool.Destroy();
 
-		CloseHandle(m_hFenceEventHandle);
+		{
+			std::lock_guard<std::mutex> lockGuard(m_EventMutex);
+
+			for (HANDLE hFenceEvent : m_FenceEvents)
+			{
+				CloseHandle(hFenceEvent);
+			}
+			m_FenceEvents.clear();
+		}
 
 		m_pFence.Reset();
 		m_pCommandQueue.Reset();
@@ -118,6 +128,12 @@ namespace esperanza
 
 		HRESULT hr = S_OK;
 
+		// The signal of a pending batch is as good as a new one
+		if (!m_PendingCommandLists.empty())
+		{
+			return flushCommandLists(uNextFenceValue);
+		}
+
 		hr = m_pCommandQueue->Signal(m_pFence.Get(), m_uNextFenceValue);
 		if (FAILED(hr))
 		{
@@ -134,15 +150,13 @@ namespace esperanza
 
 	BOOL CommandQueue::IsFenceComplete(UINT64 uFenceValue) noexcept
 	{
-		// Avoid querying the fence value by testing against the last one seen.
-		// The max() is to protect against an unlikely race condition that could cause the last
-		// completed fence value to regress.
-		if (uFenceValue > m_uLastCompletedFenceValue)
+		// Avoid querying the fence value by testing against the last one seen
+		if (uFenceValue > m_uLastCompletedFenceValue.load(std::memory_order_acquire))
 		{
-			m_uLastCompletedFenceValue = std::max(m_uLastCompletedFenceValue, m_pFence->GetCompletedValue());
+			updateLastCompletedFenceValue(m_pFence->GetCompletedValue());
 		}
 
-		return uFenceValue <= m_uLastCompletedFenceValue;
+		return uFenceValue <= m_uLastCompletedFenceValue.load(std::memory_order_acquire);
 	}
 
 	HRESULT CommandQueue::StallForFence(CommandListManager& commandListManager, UINT64 uFenceValue) noexcept
@@ -151,6 +165,28 @@ namespace esperanza
 
 		CommandQueue& producer = commandListManager.GetQueue(static_cast<D3D12_COMMAND_LIST_TYPE>(uFenceValue >> 56));
 
+		hr = producer.flushCommandListsUpTo(uFenceValue);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Flushing producer command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		// Lists already submitted here must not end up behind the wait
+		std::lock_guard<std::mutex> lockGuard(m_FenceMutex);
+
+		UINT64 uFlushedFenceValue = 0;
+		hr = flushCommandLists(uFlushedFenceValue);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Flushing consumer command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
 		hr = m_pCommandQueue->Wait(producer.m_pFence.Get(), uFenceValue);
 		if (FAILED(hr))
 		{
@@ -167,14 +203,32 @@ namespace esperanza
 	{
 		HRESULT hr = S_OK;
 
-		if (producer.m_uNextFenceValue <= 0)
+		// Everything the producer has submitted, including its pending batch.  The fence value is read under
+		// the producer's lock, other threads keep submitting to it.
+		const UINT64 uProducerFenceValue = producer.GetLastSubmittedFenceValue();
+		hr = producer.flushCommandListsUpTo(uProducerFenceValue);
+		if (FAILED(hr))
 		{
-			GLOGE(L"Producer's Next Fence Value is zero or negative!");
+			_com_error err(hr);
+			GLOGEF(L"Flushing producer command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
 
-			return E_FAIL;
+			return hr;
+		}
+
+		// Lists already submitted here must not end up behind the wait
+		std::lock_guard<std::mutex> lockGuard(m_FenceMutex);
+
+		UINT64 uFlushedFenceValue = 0;
+		hr = flushCommandLists(uFlushedFenceValue);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Flushing consumer command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
 		}
 
-		hr = m_pCommandQueue->Wait(producer.m_pFence.Get(), producer.m_uNextFenceValue - 1);
+		hr = m_pCommandQueue->Wait(producer.m_pFence.Get(), uProducerFenceValue);
 		if (FAILED(hr))
 		{
 			_com_error err(hr);
@@ -195,26 +249,42 @@ namespace esperanza
 			return hr;
 		}
 
-		// TODO:  Think about how this might affect a multi-threaded situation.  Suppose thread A
-		// wants to wait for fence 100, then thread B comes along and wants to wait for 99.  If
-		// the fence can only have one event set on completion, then thread B has to wait for 
-		// 100 before it knows 99 is ready.  Maybe insert sequential events?
+		// Waiting on a batch that was never sent would never return
+		hr = flushCommandListsUpTo(uFenceValue);
+		if (FAILED(hr))
 		{
-			std::lock_guard<std::mutex> lockGuard(m_EventMutex);
+			_com_error err(hr);
+			GLOGEF(L"Flushing command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
 
-			hr = m_pFence->SetEventOnCompletion(uFenceValue, m_hFenceEventHandle);
-			if (FAILED(hr))
-			{
-				_com_error err(hr);
-				GLOGEF(L"Set fence event on completion failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+			return hr;
+		}
 
-				return hr;
-			}
+		// Each waiter sets its own event, a thread waiting for 99 no longer waits behind one waiting for 100
+		HANDLE hFenceEvent = nullptr;
+		hr = acquireFenceEvent(hFenceEvent);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Acquiring fence event failed with HRESULT code %u, %s", hr, err.ErrorMessage());
 
-			WaitForSingleObject(m_hFenceEventHandle, INFINITE);
-			m_uLastCompletedFenceValue = uFenceValue;
+			return hr;
+		}
+
+		hr = m_pFence->SetEventOnCompletion(uFenceValue, hFenceEvent);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Set fence event on completion failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			releaseFenceEvent(hFenceEvent);
+
+			return hr;
 		}
 
+		WaitForSingleObject(hFenceEvent, INFINITE);
+		releaseFenceEvent(hFenceEvent);
+		updateLastCompletedFenceValue(uFenceValue);
+
 		return hr;
 	}
 
@@ -257,28 +327,78 @@ namespace esperanza
 		return m_pCommandQueue.Get();
 	}
 
-	constexpr UINT64 CommandQueue::GetNextFenceValue() const noexcept
+	HRESULT CommandQueue::SubmitCommandList(UINT64& uOutFenceValue, ID3D12CommandList* pList) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		// Closing is the expensive part and needs no lock
+		hr = static_cast<ID3D12GraphicsCommandList*>(pList)->Close();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Closing Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_FenceMutex);
+
+		m_PendingCommandLists.push_back(pList);
+		uOutFenceValue = m_uNextFenceValue;
+
+		if (m_PendingCommandLists.size() >= MAX_BATCH_SIZE)
+		{
+			hr = flushCommandLists(uOutFenceValue);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Flushing command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		return hr;
+	}
+
+	HRESULT CommandQueue::FlushCommandLists() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_FenceMutex);
+
+		UINT64 uFenceValue = 0;
+
+		return flushCommandLists(uFenceValue);
+	}
+
+	BOOL CommandQueue::IsBatchFlushed(UINT64 uFenceValue) noexcept
 	{
-		return m_uNextFenceValue;
+		std::lock_guard<std::mutex> lockGuard(m_FenceMutex);
+
+		return uFenceValue < m_uNextFenceValue;
 	}
 
-	HRESULT CommandQueue::executeCommandList(UINT64& uOutNextFenceValue, ID3D12CommandList* pList) noexcept
+	UINT64 CommandQueue::GetLastSubmittedFenceValue() noexcept
 	{
 		std::lock_guard<std::mutex> lockGuard(m_FenceMutex);
 
+		// A pending batch will signal the next value when it is flushed
+		return m_PendingCommandLists.empty() ? m_uNextFenceValue - 1 : m_uNextFenceValue;
+	}
+
+	HRESULT CommandQueue::flushCommandLists(UINT64& uOutFenceValue) noexcept
+	{
 		HRESULT hr = S_OK;
 
-		hr = static_cast<ID3D12GraphicsCommandList*>(pList)->Close();
-		if (FAILED(hr))
+		if (m_PendingCommandLists.empty())
 		{
-			_com_error err(hr);
-			GLOGEF(L"Closing Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+			uOutFenceValue = m_uNextFenceValue - 1;
 
 			return hr;
 		}
 
-		// Kickoff the command list
-		m_pCommandQueue->ExecuteCommandLists(1, &pList);
+		// Kickoff the command lists
+		m_pCommandQueue->ExecuteCommandLists(static_cast<UINT>(m_PendingCommandLists.size()), m_PendingCommandLists.data());
+		m_PendingCommandLists.clear();
 
 		// Signal the next fence value (with the GPU)
 		hr = m_pCommandQueue->Signal(m_pFence.Get(), m_uNextFenceValue);
@@ -290,11 +410,25 @@ namespace esperanza
 			return hr;
 		}
 
-		uOutNextFenceValue = m_uNextFenceValue++;
+		uOutFenceValue = m_uNextFenceValue++;
 
 		return hr;
 	}
 
+	HRESULT CommandQueue::flushCommandListsUpTo(UINT64 uFenceValue) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_FenceMutex);
+
+		if (uFenceValue < m_uNextFenceValue)
+		{
+			return S_OK;
+		}
+
+		UINT64 uFlushedFenceValue = 0;
+
+		return flushCommandLists(uFlushedFenceValue);
+	}
+
 	HRESULT CommandQueue::requestAllocator(_Out_ ID3D12CommandAllocator** ppOutAllocator) noexcept
 	{
 		HRESULT hr = S_OK;
@@ -318,11 +452,52 @@ namespace esperanza
 		m_AllocatorPool.DiscardAllocator(uFenceValueForReset, pAllocator);
 	}
 
+	void CommandQueue::updateLastCompletedFenceValue(UINT64 uFenceValue) noexcept
+	{
+		// Racing updates only ever move the cached value forward
+		UINT64 uLastCompletedFenceValue = m_uLastCompletedFenceValue.load(std::memory_order_relaxed);
+		while (uFenceValue > uLastCompletedFenceValue &&
+			!m_uLastCompletedFenceValue.compare_exchange_weak(uLastCompletedFenceValue, uFenceValue, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	HRESULT CommandQueue::acquireFenceEvent(HANDLE& hOutEvent) noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lockGuard(m_EventMutex);
+
+			if (!m_FenceEvents.empty())
+			{
+				hOutEvent = m_FenceEvents.back();
+				m_FenceEvents.pop_back();
+
+				return S_OK;
+			}
+		}
+
+		hOutEvent = CreateEvent(NULL, FALSE, FALSE, nullptr);
+		if (!hOutEvent)
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		return S_OK;
+	}
+
+	void CommandQueue::releaseFenceEvent(HANDLE hEvent) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_EventMutex);
+
+		m_FenceEvents.push_back(hEvent);
+	}
+
 	CommandListManager::CommandListManager() noexcept
 		: m_pDevice()
 		, m_GraphicsQueue(D3D12_COMMAND_LIST_TYPE_DIRECT)
 		, m_ComputeQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE)
 		, m_CopyQueue(D3D12_COMMAND_LIST_TYPE_COPY)
+		, m_DeferredReleaseQueue()
 	{
 	}
 
@@ -343,11 +518,22 @@ namespace esperanza
 		m_ComputeQueue.Initialize(pDevice);
 		m_CopyQueue.Initialize(pDevice);
 
+		hr = m_DeferredReleaseQueue.Initialize(*this);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing deferred release queue failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
 		return hr;
 	}
 
 	void CommandListManager::Destroy() noexcept
 	{
+		m_DeferredReleaseQueue.Destroy();
+
 		m_GraphicsQueue.Destroy();
 		m_ComputeQueue.Destroy();
 		m_CopyQueue.Destroy();
@@ -355,102 +541,6 @@ namespace esperanza
 		m_pDevice.Reset();
 	}
 
-	constexpr CommandQueue& CommandListManager::GetGraphicsQueue() noexcept
-	{
-		return m_GraphicsQueue;
-	}
-
-	constexpr const CommandQueue& CommandListManager::GetGraphicsQueue() const noexcept
-	{
-		return m_GraphicsQueue;
-	}
-
-	constexpr CommandQueue& CommandListManager::GetComputeQueue() noexcept
-	{
-		return m_ComputeQueue;
-	}
-
-	constexpr const CommandQueue& CommandListManager::GetComputeQueue() const noexcept
-	{
-		return m_ComputeQueue;
-	}
-
-	constexpr CommandQueue& CommandListManager::GetCopyQueue() noexcept
-	{
-		return m_CopyQueue;
-	}
-
-	constexpr const CommandQueue& CommandListManager::GetCopyQueue() const noexcept
-	{
-		return m_CopyQueue;
-	}
-
-	constexpr CommandQueue& CommandListManager::GetQueue(D3D12_COMMAND_LIST_TYPE type) noexcept
-	{
-		switch (type)
-		{
-		case D3D12_COMMAND_LIST_TYPE_DIRECT:
-			return m_GraphicsQueue;
-			break;
-		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
-			return m_ComputeQueue;
-			break;
-		case D3D12_COMMAND_LIST_TYPE_COPY:
-			return m_CopyQueue;
-			break;
-		case D3D12_COMMAND_LIST_TYPE_BUNDLE:
-			[[fallthrough]];
-		case D3D12_COMMAND_LIST_TYPE_VIDEO_DECODE:
-			[[fallthrough]];
-		case D3D12_COMMAND_LIST_TYPE_VIDEO_PROCESS:
-			[[fallthrough]];
-		case D3D12_COMMAND_LIST_TYPE_VIDEO_ENCODE:
-			[[fallthrough]];
-		default:
-			assert(false);
-			break;
-		}
-
-		return m_GraphicsQueue;
-	}
-
-	constexpr const CommandQueue& CommandListManager::GetQueue(D3D12_COMMAND_LIST_TYPE type) const noexcept
-	{
-		switch (type)
-		{
-		case D3D12_COMMAND_LIST_TYPE_DIRECT:
-			return m_GraphicsQueue;
-			break;
-		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
-			return m_ComputeQueue;
-			break;
-		case D3D12_COMMAND_LIST_TYPE_COPY:
-			return m_CopyQueue;
-			break;
-		case D3D12_COMMAND_LIST_TYPE_BUNDLE:
-			[[fallthrough]];
-		case D3D12_COMMAND_LIST_TYPE_VIDEO_DECODE:
-			[[fallthrough]];
-		case D3D12_COMMAND_LIST_TYPE_VIDEO_PROCESS:
-			[[fallthrough]];
-		case D3D12_COMMAND_LIST_TYPE_VIDEO_ENCODE:
-			[[fallthrough]];
-		default:
-			assert(false);
-			break;
-		}
-	}
-
-	constexpr CommandQueue& CommandListManager::GetQueue() noexcept
-	{
-		return GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-	}
-
-	constexpr const CommandQueue& CommandListManager::GetQueue() const noexcept
-	{
-		return GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-	}
-
 	ID3D12CommandQueue* CommandListManager::GetCommandQueue() noexcept
 	{
 		return m_GraphicsQueue.GetCommandQueue();
@@ -527,6 +617,10 @@ namespace esperanza
 			_com_error err(hr);
 			GLOGEF(L"Creating Command List failed with HRESULT code %u, %s", hr, err.ErrorMessage());
 
+			CommandQueue& queue = GetQueue(type);
+			queue.discardAllocator(queue.GetLastSubmittedFenceValue(), *ppOutAllocator);
+			*ppOutAllocator = nullptr;
+
 			return hr;
 		}
 		(*ppOutList)->SetName(L"CommandList");
@@ -534,10 +628,48 @@ namespace esperanza
 		return hr;
 	}
 
+	BOOL CommandListManager::IsFenceComplete(UINT64 uFenceValue) noexcept
+	{
+		// The producing queue is encoded in the top bits of every fence value
+		return GetQueue(static_cast<D3D12_COMMAND_LIST_TYPE>(uFenceValue >> 56)).IsFenceComplete(uFenceValue);
+	}
+
+	HRESULT CommandListManager::FlushCommandLists() noexcept
+	{
+		HRESULT hr = S_OK;
+
+		for (CommandQueue* pQueue : { &m_GraphicsQueue, &m_ComputeQueue, &m_CopyQueue })
+		{
+			hr = pQueue->FlushCommandLists();
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Flushing command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		return hr;
+	}
+
+	void CommandListManager::WaitForFence(UINT64 uFenceValue) noexcept
+	{
+		GetQueue(static_cast<D3D12_COMMAND_LIST_TYPE>(uFenceValue >> 56)).WaitForFence(uFenceValue);
+	}
+
 	void CommandListManager::IdleGpu() noexcept
 	{
+		// Idling signals every queue, which flushes its pending batch first
 		m_GraphicsQueue.WaitForIdle();
 		m_ComputeQueue.WaitForIdle();
 		m_CopyQueue.WaitForIdle();
+
+		m_DeferredReleaseQueue.ReleaseCompletedObjects();
+	}
+
+	DeferredReleaseQueue& CommandListManager::GetDeferredReleaseQueue() noexcept
+	{
+		return m_DeferredReleaseQueue;
 	}
 }
\ No newline at end of file
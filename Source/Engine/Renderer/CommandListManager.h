@@ -2,6 +2,7 @@
 
 #include "Pch.h"
 #include "Renderer/CommandAllocatorPool.h"
+#include "Renderer/DeferredReleaseQueue.h"
 
 namespace esperanza
 {
@@ -29,15 +30,36 @@ namespace esperanza
 		HRESULT WaitForFence(_In_ UINT64 uFenceValue) noexcept;
 		HRESULT WaitForIdle() noexcept;
 
+		// Closes the list and queues it behind every list submitted before it.  Queued lists go to the GPU
+		// in one ExecuteCommandLists call with a single signal, either once MAX_BATCH_SIZE lists are queued
+		// or on FlushCommandLists.  The returned fence value is the one that batch will signal.  Anything
+		// that signals or waits on this queue flushes the batch first, so ordering is kept.
+		HRESULT SubmitCommandList(_Out_ UINT64& uOutFenceValue, _In_ ID3D12CommandList* pList) noexcept;
+		HRESULT FlushCommandLists() noexcept;
+
+		// Whether the batch that signals uFenceValue has gone to the GPU, a list still queued in a batch
+		// must not be reset
+		BOOL IsBatchFlushed(_In_ UINT64 uFenceValue) noexcept;
+
+		// The fence value that covers every list submitted so far, including a batch not flushed yet
+		UINT64 GetLastSubmittedFenceValue() noexcept;
+
 		BOOL IsReady() const noexcept;
 		ID3D12CommandQueue* GetCommandQueue() noexcept;
 		const ID3D12CommandQueue* GetCommandQueue() const noexcept;
 		constexpr UINT64 GetNextFenceValue() const noexcept;
 
 	private:
-		HRESULT executeCommandList(_Out_ UINT64& uOutNextFenceValue, _In_ ID3D12CommandList* pList) noexcept;
+		static constexpr const size_t MAX_BATCH_SIZE = 16u;
+
+	private:
+		HRESULT flushCommandLists(_Out_ UINT64& uOutFenceValue) noexcept;
+		HRESULT flushCommandListsUpTo(_In_ UINT64 uFenceValue) noexcept;
 		HRESULT requestAllocator(_Out_ ID3D12CommandAllocator** ppOutAllocator) noexcept;
 		void discardAllocator(_In_ UINT64 uFenceValueForReset, _In_ ID3D12CommandAllocator* pAllocator);
+		void updateLastCompletedFenceValue(_In_ UINT64 uFenceValue) noexcept;
+		HRESULT acquireFenceEvent(_Out_ HANDLE& hOutEvent) noexcept;
+		void releaseFenceEvent(_In_ HANDLE hEvent) noexcept;
 
 	private:
 		ComPtr<ID3D12CommandQueue> m_pCommandQueue;
@@ -49,8 +71,14 @@ namespace esperanza
 		// Lifetime of these objects is managed by the descriptor cache
 		ComPtr<ID3D12Fence> m_pFence;
 		UINT64 m_uNextFenceValue;
-		UINT64 m_uLastCompletedFenceValue;
-		HANDLE m_hFenceEventHandle;
+		std::atomic<UINT64> m_uLastCompletedFenceValue;
+
+		// Closed lists waiting for the next batch, guarded by m_FenceMutex
+		std::vector<ID3D12CommandList*> m_PendingCommandLists;
+
+		// Every waiting thread registers its own event with the fence, so waits on different fence values
+		// are woken independently and in fence order.  Idle events are kept here for reuse.
+		std::vector<HANDLE> m_FenceEvents;
 	};
 
 	class CommandListManager final
@@ -83,15 +111,125 @@ namespace esperanza
 		const ID3D12CommandQueue* GetCommandQueue() const noexcept;
 
 		HRESULT CreateNewCommandList(_Out_ ID3D12GraphicsCommandList** ppOutList, _Out_ ID3D12CommandAllocator** ppOutAllocator, _In_ D3D12_COMMAND_LIST_TYPE type) noexcept;
-		constexpr BOOL IsFenceComplete(_In_ UINT64 uFenceValue) noexcept;
+		BOOL IsFenceComplete(_In_ UINT64 uFenceValue) noexcept;
+
+		// Sends the pending batch of every queue to the GPU, at the end of a frame or before presenting
+		HRESULT FlushCommandLists() noexcept;
 
 		void WaitForFence(_In_ UINT64 uFenceValue) noexcept;
 		void IdleGpu() noexcept;
 
+		// Released objects stay alive until all queues are past the work submitted before their release
+		DeferredReleaseQueue& GetDeferredReleaseQueue() noexcept;
+
 	private:
 		ComPtr<ID3D12Device> m_pDevice;
 		CommandQueue m_GraphicsQueue;
 		CommandQueue m_ComputeQueue;
 		CommandQueue m_CopyQueue;
+		DeferredReleaseQueue m_DeferredReleaseQueue;
 	};
+
+	inline constexpr UINT64 CommandQueue::GetNextFenceValue() const noexcept
+	{
+		return m_uNextFenceValue;
+	}
+
+	inline constexpr CommandQueue& CommandListManager::GetGraphicsQueue() noexcept
+	{
+		return m_GraphicsQueue;
+	}
+
+	inline constexpr const CommandQueue& CommandListManager::GetGraphicsQueue() const noexcept
+	{
+		return m_GraphicsQueue;
+	}
+
+	inline constexpr CommandQueue& CommandListManager::GetComputeQueue() noexcept
+	{
+		return m_ComputeQueue;
+	}
+
+	inline constexpr const CommandQueue& CommandListManager::GetComputeQueue() const noexcept
+	{
+		return m_ComputeQueue;
+	}
+
+	inline constexpr CommandQueue& CommandListManager::GetCopyQueue() noexcept
+	{
+		return m_CopyQueue;
+	}
+
+	inline constexpr const CommandQueue& CommandListManager::GetCopyQueue() const noexcept
+	{
+		return m_CopyQueue;
+	}
+
+	inline constexpr CommandQueue& CommandListManager::GetQueue(D3D12_COMMAND_LIST_TYPE type) noexcept
+	{
+		switch (type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_DIRECT:
+			return m_GraphicsQueue;
+			break;
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+			return m_ComputeQueue;
+			break;
+		case D3D12_COMMAND_LIST_TYPE_COPY:
+			return m_CopyQueue;
+			break;
+		case D3D12_COMMAND_LIST_TYPE_BUNDLE:
+			[[fallthrough]];
+		case D3D12_COMMAND_LIST_TYPE_VIDEO_DECODE:
+			[[fallthrough]];
+		case D3D12_COMMAND_LIST_TYPE_VIDEO_PROCESS:
+			[[fallthrough]];
+		case D3D12_COMMAND_LIST_TYPE_VIDEO_ENCODE:
+			[[fallthrough]];
+		default:
+			assert(false);
+			break;
+		}
+
+		return m_GraphicsQueue;
+	}
+
+	inline constexpr const CommandQueue& CommandListManager::GetQueue(D3D12_COMMAND_LIST_TYPE type) const noexcept
+	{
+		switch (type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_DIRECT:
+			return m_GraphicsQueue;
+			break;
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+			return m_ComputeQueue;
+			break;
+		case D3D12_COMMAND_LIST_TYPE_COPY:
+			return m_CopyQueue;
+			break;
+		case D3D12_COMMAND_LIST_TYPE_BUNDLE:
+			[[fallthrough]];
+		case D3D12_COMMAND_LIST_TYPE_VIDEO_DECODE:
+			[[fallthrough]];
+		case D3D12_COMMAND_LIST_TYPE_VIDEO_PROCESS:
+			[[fallthrough]];
+		case D3D12_COMMAND_LIST_TYPE_VIDEO_ENCODE:
+			[[fallthrough]];
+		default:
+			assert(false);
+			break;
+		}
+
+		return m_GraphicsQueue;
+	}
+
+	inline constexpr CommandQueue& CommandListManager::GetQueue() noexcept
+	{
+		return GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	}
+
+	inline constexpr const CommandQueue& CommandListManager::GetQueue() const noexcept
+	{
+		return GetQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+	}
 }
\ No newline at end of file
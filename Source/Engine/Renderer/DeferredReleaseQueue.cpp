@@ -0,0 +1,117 @@
+#include "Pch.h"
+#include "Renderer/DeferredReleaseQueue.h"
+
+#include "Renderer/CommandListManager.h"
+
+namespace esperanza
+{
+	static constexpr const D3D12_COMMAND_LIST_TYPE QUEUE_TYPES[] =
+	{
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		D3D12_COMMAND_LIST_TYPE_COMPUTE,
+		D3D12_COMMAND_LIST_TYPE_COPY,
+	};
+
+	DeferredReleaseQueue::DeferredReleaseQueue() noexcept
+		: m_pCommandListManager(nullptr)
+		, m_ReleaseMutex()
+		, m_PendingBatches()
+		, m_uNumPendingObjects(0)
+		, m_uNumReleasedObjects(0)
+	{
+	}
+
+	HRESULT DeferredReleaseQueue::Initialize(CommandListManager& commandListManager) noexcept
+	{
+		m_pCommandListManager = &commandListManager;
+
+		return S_OK;
+	}
+
+	void DeferredReleaseQueue::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_ReleaseMutex);
+
+		m_uNumReleasedObjects += m_uNumPendingObjects;
+		m_uNumPendingObjects = 0;
+		m_PendingBatches.clear();
+		m_pCommandListManager = nullptr;
+	}
+
+	HRESULT DeferredReleaseQueue::ReleaseObject(ComPtr<ID3D12Object>& pObject) noexcept
+	{
+		if (!pObject)
+		{
+			return S_OK;
+		}
+
+		if (!m_pCommandListManager)
+		{
+			GLOGE(L"Deferred release queue is not initialized!");
+
+			return E_FAIL;
+		}
+
+		// Anything already submitted to any queue, including a batch still waiting to be flushed, may use the object
+		UINT64 auFenceValues[NUM_QUEUES];
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			auFenceValues[i] = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).GetLastSubmittedFenceValue();
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_ReleaseMutex);
+
+		if (m_PendingBatches.empty() || std::memcmp(m_PendingBatches.back().auFenceValues, auFenceValues, sizeof(auFenceValues)) != 0)
+		{
+			ReleaseBatch& newBatch = m_PendingBatches.emplace_back();
+			std::memcpy(newBatch.auFenceValues, auFenceValues, sizeof(auFenceValues));
+		}
+
+		m_PendingBatches.back().Objects.push_back(std::move(pObject));
+		++m_uNumPendingObjects;
+
+		return S_OK;
+	}
+
+	void DeferredReleaseQueue::ReleaseCompletedObjects() noexcept
+	{
+		// Fence values only grow, so batches complete in the order they were queued
+		std::deque<ReleaseBatch> completedBatches;
+		{
+			std::lock_guard<std::mutex> lockGuard(m_ReleaseMutex);
+
+			while (!m_PendingBatches.empty() && isBatchComplete(m_PendingBatches.front()))
+			{
+				m_uNumPendingObjects -= m_PendingBatches.front().Objects.size();
+				m_uNumReleasedObjects += m_PendingBatches.front().Objects.size();
+
+				completedBatches.push_back(std::move(m_PendingBatches.front()));
+				m_PendingBatches.pop_front();
+			}
+		}
+
+		// The final Release calls happen outside the lock when completedBatches goes out of scope
+	}
+
+	void DeferredReleaseQueue::GetStatistics(DeferredReleaseStatistics& outStatistics) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_ReleaseMutex);
+
+		outStatistics.uNumPendingObjects = m_uNumPendingObjects;
+		outStatistics.uNumReleasedObjects = m_uNumReleasedObjects;
+		outStatistics.uNumPendingBatches = m_PendingBatches.size();
+	}
+
+	BOOL DeferredReleaseQueue::isBatchComplete(const ReleaseBatch& batch) noexcept
+	{
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			if (!m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).IsFenceComplete(batch.auFenceValues[i]))
+			{
+				return FALSE;
+			}
+		}
+
+		return TRUE;
+	}
+}
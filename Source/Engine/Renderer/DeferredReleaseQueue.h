@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+
+	struct DeferredReleaseStatistics
+	{
+		UINT64 uNumPendingObjects;
+		UINT64 uNumReleasedObjects;
+		UINT64 uNumPendingBatches;
+	};
+
+	// Keeps released D3D12 objects alive until every queue is past the work submitted before the release.
+	// Objects released between two submissions share the same fence values and are freed together, in
+	// release order, once IsFenceComplete passes for all queues.
+	class DeferredReleaseQueue final
+	{
+	public:
+		explicit DeferredReleaseQueue() noexcept;
+		DeferredReleaseQueue(const DeferredReleaseQueue& other) = delete;
+		DeferredReleaseQueue(DeferredReleaseQueue&& other) = delete;
+		DeferredReleaseQueue& operator=(const DeferredReleaseQueue& other) = delete;
+		DeferredReleaseQueue& operator=(DeferredReleaseQueue&& other) = delete;
+		~DeferredReleaseQueue() noexcept = default;
+
+		HRESULT Initialize(_In_ CommandListManager& commandListManager) noexcept;
+
+		// Frees everything right away, the GPU must be idle
+		void Destroy() noexcept;
+
+		// Takes over the reference held by pObject
+		HRESULT ReleaseObject(_Inout_ ComPtr<ID3D12Object>& pObject) noexcept;
+
+		template <typename T>
+		HRESULT ReleaseObject(_Inout_ ComPtr<T>& pObject) noexcept;
+
+		void ReleaseCompletedObjects() noexcept;
+		void GetStatistics(_Out_ DeferredReleaseStatistics& outStatistics) noexcept;
+
+	private:
+		static constexpr const size_t NUM_QUEUES = 3u;
+
+		struct ReleaseBatch
+		{
+			UINT64 auFenceValues[NUM_QUEUES];
+			std::vector<ComPtr<ID3D12Object>> Objects;
+		};
+
+	private:
+		BOOL isBatchComplete(_In_ const ReleaseBatch& batch) noexcept;
+
+	private:
+		CommandListManager* m_pCommandListManager;
+		std::mutex m_ReleaseMutex;
+		std::deque<ReleaseBatch> m_PendingBatches;
+		UINT64 m_uNumPendingObjects;
+		UINT64 m_uNumReleasedObjects;
+	};
+
+	template <typename T>
+	HRESULT DeferredReleaseQueue::ReleaseObject(ComPtr<T>& pObject) noexcept
+	{
+		ComPtr<ID3D12Object> pBaseObject;
+		pBaseObject.Attach(pObject.Detach());
+
+		return ReleaseObject(pBaseObject);
+	}
+}
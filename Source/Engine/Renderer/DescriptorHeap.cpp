@@ -6,6 +6,9 @@ namespace esperanza
 {
 	std::mutex DescriptorAllocator::sm_AllocationMutex;
 	std::vector<ComPtr<ID3D12DescriptorHeap>> DescriptorAllocator::sm_DescriptorHeapPool;
+	std::atomic<uint64_t> DescriptorAllocator::sm_uNextAllocatorId = 1;
+	std::atomic<uint32_t> DescriptorAllocator::sm_uNextThreadId = 1;
+	std::unordered_map<uint64_t, DescriptorAllocator*> DescriptorAllocator::sm_LiveAllocators;
 
 	void DescriptorAllocator::DestroyAll(void)
 	{
@@ -15,41 +18,315 @@ namespace esperanza
 	DescriptorAllocator::DescriptorAllocator(ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type) noexcept
 		: m_pDevice(pDevice)
 		, m_Type(type)
-		, m_pCurrentHeap(nullptr)
-		, m_CurrentHandle()
+		, m_uAllocatorId(sm_uNextAllocatorId.fetch_add(1, std::memory_order_relaxed))
 		, m_uDescriptorSize(0)
-		, m_uRemainingFreeHandles()
+		, m_HeapCreationMutex()
+		, m_apHeaps()
+		, m_uNumHeaps(0)
+		, m_uNextHeapIndex(0)
+		, m_auSharedFreeListHeads()
 	{
-		m_CurrentHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+		for (std::atomic<uint64_t>& uHead : m_auSharedFreeListHeads)
+		{
+			uHead.store(INVALID_RANGE_ID, std::memory_order_relaxed);
+		}
+
+		std::lock_guard<std::mutex> lockGuard(sm_AllocationMutex);
+		sm_LiveAllocators.emplace(m_uAllocatorId, this);
 	}
 
-	HRESULT DescriptorAllocator::Allocate(D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, ID3D12Device* pDevice, uint32_t uCount)
+	DescriptorAllocator::~DescriptorAllocator() noexcept
+	{
+		// Caches left on other threads find the allocator gone and drop their ranges instead of returning them
+		std::lock_guard<std::mutex> lockGuard(sm_AllocationMutex);
+		sm_LiveAllocators.erase(m_uAllocatorId);
+	}
+
+	HRESULT DescriptorAllocator::Allocate(DescriptorAllocation& outAllocation, ID3D12Device* pDevice, uint32_t uCount)
 	{
 		HRESULT hr = S_OK;
+		outAllocation = DescriptorAllocation();
+
+		if (uCount == 0 || uCount > NUM_DESCRIPTORS_PER_HEAP)
+		{
+			GLOGEF(L"Cannot allocate %u descriptors, a range must fit in a heap of %u", uCount, NUM_DESCRIPTORS_PER_HEAP);
+
+			return E_INVALIDARG;
+		}
+
+		const uint32_t uSizeClass = getSizeClass(uCount);
+		const uint32_t uRangeSize = 1u << uSizeClass;
+		FreeRange range = {};
 
-		if (!m_pCurrentHeap || m_uRemainingFreeHandles < uCount)
+		ThreadCache& cache = getThreadCache();
+		std::vector<FreeRange>& freeList = cache.aFreeLists[uSizeClass];
+		if (!freeList.empty())
+		{
+			range = freeList.back();
+			freeList.pop_back();
+		}
+		else if (!popSharedRange(uSizeClass, range))
 		{
-			hr = requestNewHeap(&m_pCurrentHeap, pDevice, m_Type);
-			if (FAILED(hr))
+			if (cache.uRemainingFreeHandles < uRangeSize)
 			{
-				_com_error err(hr);
-				GLOGEF(L"Requesting New Heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+				// Hand the tail of the current heap to the smaller size classes instead of wasting it
+				splitRemainingFreeHandles(cache, uSizeClass);
 
-				return hr;
+				hr = claimHeap(cache.uHeapIndex, pDevice);
+				if (FAILED(hr))
+				{
+					_com_error err(hr);
+					GLOGEF(L"Claiming a descriptor heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+					return hr;
+				}
+
+				cache.uRemainingFreeHandles = NUM_DESCRIPTORS_PER_HEAP;
 			}
 
-			m_CurrentHandle = m_pCurrentHeap->GetCPUDescriptorHandleForHeapStart();
-			m_uRemainingFreeHandles = NUM_DESCRIPTORS_PER_HEAP;
+			range.uHeapIndex = cache.uHeapIndex;
+			range.uOffset = NUM_DESCRIPTORS_PER_HEAP - cache.uRemainingFreeHandles;
+			cache.uRemainingFreeHandles -= uRangeSize;
+		}
+
+		HeapEntry& heap = *m_apHeaps[range.uHeapIndex];
+		heap.aAllocatingThreadIds[range.uOffset] = getThreadId();
+
+		outAllocation.Handle.ptr = heap.StartHandle.ptr + static_cast<SIZE_T>(range.uOffset) * m_uDescriptorSize;
+		outAllocation.uHeapIndex = range.uHeapIndex;
+		outAllocation.uCount = uCount;
+		outAllocation.uGeneration = heap.aGenerations[range.uOffset].load(std::memory_order_relaxed);
+
+		return hr;
+	}
+
+	HRESULT DescriptorAllocator::Free(const DescriptorAllocation& allocation)
+	{
+		if (!IsValid(allocation))
+		{
+			GLOGE(L"Freeing a stale descriptor allocation or one that does not belong to this allocator");
+
+			return E_INVALIDARG;
+		}
+
+		HeapEntry& heap = *m_apHeaps[allocation.uHeapIndex];
+		const uint32_t uOffset = static_cast<uint32_t>((allocation.Handle.ptr - heap.StartHandle.ptr) / m_uDescriptorSize);
+
+		// Only one of two racing frees of the same allocation can move the generation on
+		uint32_t uGeneration = allocation.uGeneration;
+		if (!heap.aGenerations[uOffset].compare_exchange_strong(uGeneration, uGeneration + 1, std::memory_order_relaxed))
+		{
+			GLOGE(L"Freeing a stale descriptor allocation or one that does not belong to this allocator");
+
+			return E_INVALIDARG;
+		}
+
+		const uint32_t uSizeClass = getSizeClass(allocation.uCount);
+		const FreeRange range = { allocation.uHeapIndex, uOffset };
+		if (heap.aAllocatingThreadIds[uOffset] == getThreadId())
+		{
+			getThreadCache().aFreeLists[uSizeClass].push_back(range);
+		}
+		else
+		{
+			pushSharedRange(uSizeClass, range);
+		}
+
+		return S_OK;
+	}
+
+	BOOL DescriptorAllocator::IsValid(const DescriptorAllocation& allocation) const noexcept
+	{
+		if (allocation.uHeapIndex >= m_uNumHeaps.load(std::memory_order_acquire) || allocation.uCount == 0 || allocation.uCount > NUM_DESCRIPTORS_PER_HEAP)
+		{
+			return FALSE;
+		}
+
+		const HeapEntry& heap = *m_apHeaps[allocation.uHeapIndex];
+		if (allocation.Handle.ptr < heap.StartHandle.ptr ||
+			allocation.Handle.ptr >= heap.StartHandle.ptr + static_cast<SIZE_T>(NUM_DESCRIPTORS_PER_HEAP) * m_uDescriptorSize ||
+			(allocation.Handle.ptr - heap.StartHandle.ptr) % m_uDescriptorSize != 0)
+		{
+			return FALSE;
+		}
+
+		const uint32_t uOffset = static_cast<uint32_t>((allocation.Handle.ptr - heap.StartHandle.ptr) / m_uDescriptorSize);
+
+		return heap.aGenerations[uOffset].load(std::memory_order_relaxed) == allocation.uGeneration;
+	}
+
+	HRESULT DescriptorAllocator::Allocate(D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, ID3D12Device* pDevice, uint32_t uCount)
+	{
+		DescriptorAllocation allocation;
+		HRESULT hr = Allocate(allocation, pDevice, uCount);
+		outHandle = allocation.Handle;
+
+		return hr;
+	}
+
+	uint32_t DescriptorAllocator::getThreadId() noexcept
+	{
+		thread_local const uint32_t s_uThreadId = sm_uNextThreadId.fetch_add(1, std::memory_order_relaxed);
+
+		return s_uThreadId;
+	}
+
+	DescriptorAllocator::ThreadCaches::~ThreadCaches() noexcept
+	{
+		for (ThreadCache& cache : aCaches)
+		{
+			releaseThreadCache(cache);
+		}
+	}
+
+	void DescriptorAllocator::releaseThreadCache(ThreadCache& cache) noexcept
+	{
+		if (cache.pOwner != nullptr)
+		{
+			// Holding the mutex keeps the owner from being destroyed while the ranges are handed back
+			std::lock_guard<std::mutex> lockGuard(sm_AllocationMutex);
+
+			std::unordered_map<uint64_t, DescriptorAllocator*>::iterator owner = sm_LiveAllocators.find(cache.uOwnerId);
+			if (owner != sm_LiveAllocators.end() && owner->second == cache.pOwner)
+			{
+				splitRemainingFreeHandles(cache, NUM_SIZE_CLASSES);
+
+				for (uint32_t uSizeClass = 0; uSizeClass < NUM_SIZE_CLASSES; ++uSizeClass)
+				{
+					for (const FreeRange& range : cache.aFreeLists[uSizeClass])
+					{
+						owner->second->pushSharedRange(uSizeClass, range);
+					}
+				}
+			}
+		}
+
+		cache.pOwner = nullptr;
+		cache.uOwnerId = 0;
+		cache.uHeapIndex = UINT32_MAX;
+		cache.uRemainingFreeHandles = 0;
+		for (std::vector<FreeRange>& freeList : cache.aFreeLists)
+		{
+			freeList.clear();
+		}
+	}
+
+	void DescriptorAllocator::splitRemainingFreeHandles(ThreadCache& cache, uint32_t uNumSizeClasses) noexcept
+	{
+		for (uint32_t uSizeClass = uNumSizeClasses; uSizeClass-- > 0 && cache.uRemainingFreeHandles > 0;)
+		{
+			if (cache.uRemainingFreeHandles >= (1u << uSizeClass))
+			{
+				cache.aFreeLists[uSizeClass].push_back(FreeRange{ cache.uHeapIndex, NUM_DESCRIPTORS_PER_HEAP - cache.uRemainingFreeHandles });
+				cache.uRemainingFreeHandles -= 1u << uSizeClass;
+			}
+		}
+	}
+
+	DescriptorAllocator::ThreadCache& DescriptorAllocator::getThreadCache() noexcept
+	{
+		thread_local ThreadCaches s_ThreadCaches = {};
+
+		for (ThreadCache& cache : s_ThreadCaches.aCaches)
+		{
+			if (cache.pOwner == this && cache.uOwnerId == m_uAllocatorId)
+			{
+				return cache;
+			}
+		}
+
+		// The evicted cache hands whatever it still holds to the shared pool of its allocator
+		ThreadCache& cache = s_ThreadCaches.aCaches[s_ThreadCaches.uNextEvictedCache++ % NUM_THREAD_CACHES];
+		releaseThreadCache(cache);
+		cache.pOwner = this;
+		cache.uOwnerId = m_uAllocatorId;
+
+		return cache;
+	}
+
+	void DescriptorAllocator::pushSharedRange(uint32_t uSizeClass, const FreeRange& range) noexcept
+	{
+		const uint32_t uRangeId = range.uHeapIndex * NUM_DESCRIPTORS_PER_HEAP + range.uOffset;
+		std::atomic<uint32_t>& uNextRangeId = m_apHeaps[range.uHeapIndex]->aNextSharedRangeIds[range.uOffset];
+		std::atomic<uint64_t>& uHead = m_auSharedFreeListHeads[uSizeClass];
+
+		uint64_t uOldHead = uHead.load(std::memory_order_relaxed);
+		uint64_t uNewHead = 0;
+		do
+		{
+			uNextRangeId.store(static_cast<uint32_t>(uOldHead), std::memory_order_relaxed);
+			uNewHead = (((uOldHead >> 32) + 1) << 32) | uRangeId;
+		} while (!uHead.compare_exchange_weak(uOldHead, uNewHead, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	BOOL DescriptorAllocator::popSharedRange(uint32_t uSizeClass, FreeRange& outRange) noexcept
+	{
+		outRange = {};
+		std::atomic<uint64_t>& uHead = m_auSharedFreeListHeads[uSizeClass];
+
+		uint64_t uOldHead = uHead.load(std::memory_order_acquire);
+		uint64_t uNewHead = 0;
+		uint32_t uRangeId = INVALID_RANGE_ID;
+		do
+		{
+			uRangeId = static_cast<uint32_t>(uOldHead);
+			if (uRangeId == INVALID_RANGE_ID)
+			{
+				return FALSE;
+			}
+
+			// Heaps are never released while the allocator lives, so the link can be read even if the range was
+			// popped by another thread in the meantime, in which case the tag makes the exchange fail
+			const uint32_t uNextRangeId = m_apHeaps[uRangeId / NUM_DESCRIPTORS_PER_HEAP]->aNextSharedRangeIds[uRangeId % NUM_DESCRIPTORS_PER_HEAP].load(std::memory_order_relaxed);
+			uNewHead = (((uOldHead >> 32) + 1) << 32) | uNextRangeId;
+		} while (!uHead.compare_exchange_weak(uOldHead, uNewHead, std::memory_order_acquire, std::memory_order_acquire));
+
+		outRange.uHeapIndex = uRangeId / NUM_DESCRIPTORS_PER_HEAP;
+		outRange.uOffset = uRangeId % NUM_DESCRIPTORS_PER_HEAP;
+
+		return TRUE;
+	}
+
+	HRESULT DescriptorAllocator::claimHeap(uint32_t& uOutHeapIndex, ID3D12Device* pDevice)
+	{
+		HRESULT hr = S_OK;
+
+		const uint32_t uHeapIndex = m_uNextHeapIndex.fetch_add(1, std::memory_order_relaxed);
+		if (uHeapIndex >= MAX_NUM_HEAPS)
+		{
+			GLOGEF(L"Descriptor allocator ran out of heaps, %u heaps are already in use", MAX_NUM_HEAPS);
+
+			return E_OUTOFMEMORY;
+		}
+
+		if (uHeapIndex >= m_uNumHeaps.load(std::memory_order_acquire))
+		{
+			std::lock_guard<std::mutex> lockGuard(m_HeapCreationMutex);
 
-			if (m_uDescriptorSize == 0)
+			// Heaps are created in index order, whichever thread gets here first creates all of the missing ones
+			for (uint32_t uNumHeaps = m_uNumHeaps.load(std::memory_order_relaxed); uNumHeaps <= uHeapIndex; ++uNumHeaps)
 			{
-				m_uDescriptorSize = m_pDevice->GetDescriptorHandleIncrementSize(m_Type);
+				ID3D12DescriptorHeap* pHeap = nullptr;
+				hr = requestNewHeap(&pHeap, pDevice, m_Type);
+				if (FAILED(hr))
+				{
+					_com_error err(hr);
+					GLOGEF(L"Requesting New Heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+					return hr;
+				}
+
+				if (m_uDescriptorSize == 0)
+				{
+					m_uDescriptorSize = m_pDevice->GetDescriptorHandleIncrementSize(m_Type);
+				}
+
+				m_apHeaps[uNumHeaps].reset(new HeapEntry{ pHeap, pHeap->GetCPUDescriptorHandleForHeapStart() });
+				m_uNumHeaps.store(uNumHeaps + 1, std::memory_order_release);
 			}
 		}
 
-		outHandle = m_CurrentHandle;
-		m_CurrentHandle.ptr += uCount * m_uDescriptorSize;
-		m_uRemainingFreeHandles -= uCount;
+		uOutHeapIndex = uHeapIndex;
 
 		return hr;
 	}
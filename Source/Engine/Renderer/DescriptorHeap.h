@@ -4,6 +4,16 @@
 
 namespace esperanza
 {
+    // A range of descriptors handed out by a DescriptorAllocator.  The generation of the range is bumped every
+    // time it is freed, so a copy kept around after Free no longer validates and freeing it twice is caught.
+    struct DescriptorAllocation
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE Handle = { D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN };
+        uint32_t uHeapIndex = UINT32_MAX;
+        uint32_t uCount = 0;
+        uint32_t uGeneration = 0;
+    };
+
     // This is an unbounded resource descriptor allocator.  It is intended to provide space for CPU-visible
     // resource descriptors as resources are created.  For those that need to be made shader-visible, they
     // will need to be copied to a DescriptorHeap or a DynamicDescriptorHeap.
@@ -19,25 +29,102 @@ namespace esperanza
         DescriptorAllocator(DescriptorAllocator&& other) = delete;
         DescriptorAllocator& operator=(const DescriptorAllocator& other) = delete;
         DescriptorAllocator& operator=(DescriptorAllocator&& other) = delete;
-        ~DescriptorAllocator() noexcept = default;
+        ~DescriptorAllocator() noexcept;
+
+        // Ranges are rounded up to a power of two and recycled through one free list per size class.  Each thread
+        // bumps through its own heap and keeps its own free lists, so neither call takes a lock unless a new heap
+        // has to be created.  A range freed on the thread that allocated it goes back to that thread.  Ranges freed
+        // on any other thread, and whatever an evicted or exiting thread cache still holds, go to a lock-free pool
+        // shared by every thread, which is drawn from before a new heap is claimed.
+        HRESULT Allocate(_Out_ DescriptorAllocation& outAllocation, _In_ ID3D12Device* pDevice, _In_ uint32_t uCount);
+        HRESULT Free(_In_ const DescriptorAllocation& allocation);
+        BOOL IsValid(_In_ const DescriptorAllocation& allocation) const noexcept;
+
+        uint32_t GetNumHeaps() const noexcept;
 
+        // Descriptors allocated through this overload can never be freed
         HRESULT Allocate(_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, _In_ ID3D12Device* pDevice, _In_ uint32_t uCount);
 
     protected:
         static HRESULT requestNewHeap(_Out_ ID3D12DescriptorHeap** ppOutDescriptorHeap, _In_ ID3D12Device* pDevice, D3D12_DESCRIPTOR_HEAP_TYPE type);
+        static constexpr uint32_t getSizeClass(_In_ uint32_t uCount) noexcept;
+        static uint32_t getThreadId() noexcept;
 
     protected:
         static constexpr const uint32_t NUM_DESCRIPTORS_PER_HEAP = 256;
+        static constexpr const uint32_t NUM_SIZE_CLASSES = 9;   // 1, 2, 4, ... NUM_DESCRIPTORS_PER_HEAP
+        static constexpr const uint32_t MAX_NUM_HEAPS = 4096;
+        static constexpr const uint32_t NUM_THREAD_CACHES = 8;
+        static constexpr const uint32_t INVALID_RANGE_ID = UINT32_MAX;
         static std::mutex sm_AllocationMutex;
         static std::vector<Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> sm_DescriptorHeapPool;
+        static std::atomic<uint64_t> sm_uNextAllocatorId;
+        static std::atomic<uint32_t> sm_uNextThreadId;
+
+        // Allocators that thread caches may still hand ranges back to, guarded by sm_AllocationMutex
+        static std::unordered_map<uint64_t, DescriptorAllocator*> sm_LiveAllocators;
+
+        // Only the first entry of a range is used in each of the per descriptor arrays
+        struct HeapEntry
+        {
+            ID3D12DescriptorHeap* pHeap;
+            D3D12_CPU_DESCRIPTOR_HANDLE StartHandle;
+            std::atomic<uint32_t> aGenerations[NUM_DESCRIPTORS_PER_HEAP];
+            std::atomic<uint32_t> aNextSharedRangeIds[NUM_DESCRIPTORS_PER_HEAP];
+            uint32_t aAllocatingThreadIds[NUM_DESCRIPTORS_PER_HEAP];
+        };
+
+        struct FreeRange
+        {
+            uint32_t uHeapIndex;
+            uint32_t uOffset;
+        };
+
+        // Thread local state of one allocator.  The id tells a cache apart from one left behind by a destroyed
+        // allocator that lived at the same address.
+        struct ThreadCache
+        {
+            const DescriptorAllocator* pOwner;
+            uint64_t uOwnerId;
+            uint32_t uHeapIndex;
+            uint32_t uRemainingFreeHandles;
+            std::vector<FreeRange> aFreeLists[NUM_SIZE_CLASSES];
+        };
+
+        // Hands every cache back to the shared pool of its allocator when the thread exits
+        struct ThreadCaches
+        {
+            ThreadCache aCaches[NUM_THREAD_CACHES];
+            uint32_t uNextEvictedCache;
+
+            ~ThreadCaches() noexcept;
+        };
+
+    protected:
+        static void releaseThreadCache(_Inout_ ThreadCache& cache) noexcept;
+        static void splitRemainingFreeHandles(_Inout_ ThreadCache& cache, _In_ uint32_t uNumSizeClasses) noexcept;
+
+        ThreadCache& getThreadCache() noexcept;
+        HRESULT claimHeap(_Out_ uint32_t& uOutHeapIndex, _In_ ID3D12Device* pDevice);
+
+        // A tagged Treiber stack per size class, linked through HeapEntry::aNextSharedRangeIds.  The upper half of
+        // a head counts every change to it so that a range popped and pushed again in between is not mistaken.
+        void pushSharedRange(_In_ uint32_t uSizeClass, _In_ const FreeRange& range) noexcept;
+        BOOL popSharedRange(_In_ uint32_t uSizeClass, _Out_ FreeRange& outRange) noexcept;
 
     protected:
         ComPtr<ID3D12Device> m_pDevice;
         D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
-        ID3D12DescriptorHeap* m_pCurrentHeap;
-        D3D12_CPU_DESCRIPTOR_HANDLE m_CurrentHandle;
+        uint64_t m_uAllocatorId;
         uint32_t m_uDescriptorSize;
-        uint32_t m_uRemainingFreeHandles;
+
+        // Heaps are claimed with a single increment and only created under the mutex.  A heap is published by
+        // the release store of m_uNumHeaps, so any index below it can be read without a lock.
+        std::mutex m_HeapCreationMutex;
+        std::unique_ptr<HeapEntry> m_apHeaps[MAX_NUM_HEAPS];
+        std::atomic<uint32_t> m_uNumHeaps;
+        std::atomic<uint32_t> m_uNextHeapIndex;
+        std::atomic<uint64_t> m_auSharedFreeListHeads[NUM_SIZE_CLASSES];
     };
 
     // This handle refers to a descriptor or a descriptor table (contiguous descriptors) that is shader visible.
@@ -96,6 +183,7 @@ namespace esperanza
         ID3D12DescriptorHeap* GetHeapPointer() const noexcept;
 
         constexpr uint32_t GetDescriptorSize(void) const noexcept;
+        constexpr uint32_t GetNumDescriptors(void) const noexcept;
 
     private:
         ComPtr<ID3D12DescriptorHeap> m_pHeap;
@@ -106,6 +194,22 @@ namespace esperanza
         DescriptorHandle m_NextFreeHandle;
     };
 
+    inline constexpr uint32_t DescriptorAllocator::getSizeClass(uint32_t uCount) noexcept
+    {
+        uint32_t uSizeClass = 0;
+        while ((1u << uSizeClass) < uCount)
+        {
+            ++uSizeClass;
+        }
+
+        return uSizeClass;
+    }
+
+    inline uint32_t DescriptorAllocator::GetNumHeaps() const noexcept
+    {
+        return m_uNumHeaps.load(std::memory_order_acquire);
+    }
+
     inline constexpr const D3D12_CPU_DESCRIPTOR_HANDLE* DescriptorHandle::operator&() const noexcept
     {
         return &m_CpuHandle;
@@ -155,4 +259,9 @@ namespace esperanza
     {
         return m_uDescriptorSize;
     }
+
+    inline constexpr uint32_t DescriptorHeap::GetNumDescriptors(void) const noexcept
+    {
+        return m_HeapDesc.NumDescriptors;
+    }
 }
\ No newline at end of file
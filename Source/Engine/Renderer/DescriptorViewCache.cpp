@@ -0,0 +1,470 @@
+#include "Pch.h"
+
+#include "Renderer/DescriptorViewCache.h"
+#include "Renderer/GpuResource.h"
+
+#include <bit>
+
+namespace esperanza
+{
+	DescriptorViewCache::DescriptorViewCache() noexcept
+		: m_pDevice()
+		, m_pAllocators(nullptr)
+		, m_Mutex()
+		, m_Views()
+		, m_ResourceViews()
+		, m_uNumHits(0)
+		, m_uNumMisses(0)
+	{
+	}
+
+	HRESULT DescriptorViewCache::Initialize(ID3D12Device* pDevice, DescriptorAllocator* pAllocators) noexcept
+	{
+		if (!pDevice || !pAllocators)
+		{
+			GLOGE(L"Device or descriptor allocators are null!");
+
+			return E_FAIL;
+		}
+
+		m_pDevice = pDevice;
+		m_pAllocators = pAllocators;
+
+		return S_OK;
+	}
+
+	void DescriptorViewCache::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		for (const std::pair<const ViewKey, DescriptorAllocation>& view : m_Views)
+		{
+			m_pAllocators[getHeapType(view.first.ViewType)].Free(view.second);
+		}
+
+		m_Views.clear();
+		m_ResourceViews.clear();
+		m_pDevice.Reset();
+	}
+
+	HRESULT DescriptorViewCache::GetRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, GpuResource& resource, const D3D12_RENDER_TARGET_VIEW_DESC* pDesc) noexcept
+	{
+		ViewKey key = makeKey(resource, eViewType::Rtv);
+		if (pDesc)
+		{
+			key.AppendDesc(*pDesc);
+		}
+
+		return getView(outHandle, resource, key, pDesc,
+			[](ID3D12Device* pDevice, ID3D12Resource* pResource, const void* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+			{
+				pDevice->CreateRenderTargetView(pResource, static_cast<const D3D12_RENDER_TARGET_VIEW_DESC*>(pDesc), handle);
+			});
+	}
+
+	HRESULT DescriptorViewCache::GetDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, GpuResource& resource, const D3D12_DEPTH_STENCIL_VIEW_DESC* pDesc) noexcept
+	{
+		ViewKey key = makeKey(resource, eViewType::Dsv);
+		if (pDesc)
+		{
+			key.AppendDesc(*pDesc);
+		}
+
+		return getView(outHandle, resource, key, pDesc,
+			[](ID3D12Device* pDevice, ID3D12Resource* pResource, const void* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+			{
+				pDevice->CreateDepthStencilView(pResource, static_cast<const D3D12_DEPTH_STENCIL_VIEW_DESC*>(pDesc), handle);
+			});
+	}
+
+	HRESULT DescriptorViewCache::GetShaderResourceView(D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, GpuResource& resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc) noexcept
+	{
+		ViewKey key = makeKey(resource, eViewType::Srv);
+		if (pDesc)
+		{
+			key.AppendDesc(*pDesc);
+		}
+
+		return getView(outHandle, resource, key, pDesc,
+			[](ID3D12Device* pDevice, ID3D12Resource* pResource, const void* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+			{
+				pDevice->CreateShaderResourceView(pResource, static_cast<const D3D12_SHADER_RESOURCE_VIEW_DESC*>(pDesc), handle);
+			});
+	}
+
+	HRESULT DescriptorViewCache::GetUnorderedAccessView(D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, GpuResource& resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc) noexcept
+	{
+		ViewKey key = makeKey(resource, eViewType::Uav);
+		if (pDesc)
+		{
+			key.AppendDesc(*pDesc);
+		}
+
+		return getView(outHandle, resource, key, pDesc,
+			[](ID3D12Device* pDevice, ID3D12Resource* pResource, const void* pDesc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+			{
+				pDevice->CreateUnorderedAccessView(pResource, nullptr, static_cast<const D3D12_UNORDERED_ACCESS_VIEW_DESC*>(pDesc), handle);
+			});
+	}
+
+	void DescriptorViewCache::Evict(const GpuResource& resource) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		auto resourceViews = m_ResourceViews.find(&resource);
+		if (resourceViews == m_ResourceViews.end())
+		{
+			return;
+		}
+
+		for (const ViewKey& key : resourceViews->second)
+		{
+			auto view = m_Views.find(key);
+			m_pAllocators[getHeapType(key.ViewType)].Free(view->second);
+			m_Views.erase(view);
+		}
+
+		m_ResourceViews.erase(resourceViews);
+	}
+
+	size_t DescriptorViewCache::GetNumHits() const noexcept
+	{
+		return m_uNumHits.load(std::memory_order_relaxed);
+	}
+
+	size_t DescriptorViewCache::GetNumMisses() const noexcept
+	{
+		return m_uNumMisses.load(std::memory_order_relaxed);
+	}
+
+	void DescriptorViewCache::ViewKey::Append(UINT uValue) noexcept
+	{
+		assert(uNumDescWords < MAX_VIEW_DESC_WORDS);
+
+		auDescWords[uNumDescWords++] = uValue;
+	}
+
+	void DescriptorViewCache::ViewKey::Append(UINT64 uValue) noexcept
+	{
+		Append(static_cast<UINT>(uValue));
+		Append(static_cast<UINT>(uValue >> 32));
+	}
+
+	void DescriptorViewCache::ViewKey::Append(FLOAT value) noexcept
+	{
+		Append(std::bit_cast<UINT>(value));
+	}
+
+	void DescriptorViewCache::ViewKey::AppendDesc(const D3D12_RENDER_TARGET_VIEW_DESC& desc) noexcept
+	{
+		Append(static_cast<UINT>(desc.Format));
+		Append(static_cast<UINT>(desc.ViewDimension));
+
+		switch (desc.ViewDimension)
+		{
+		case D3D12_RTV_DIMENSION_BUFFER:
+			Append(desc.Buffer.FirstElement);
+			Append(desc.Buffer.NumElements);
+			break;
+		case D3D12_RTV_DIMENSION_TEXTURE1D:
+			Append(desc.Texture1D.MipSlice);
+			break;
+		case D3D12_RTV_DIMENSION_TEXTURE1DARRAY:
+			Append(desc.Texture1DArray.MipSlice);
+			Append(desc.Texture1DArray.FirstArraySlice);
+			Append(desc.Texture1DArray.ArraySize);
+			break;
+		case D3D12_RTV_DIMENSION_TEXTURE2D:
+			Append(desc.Texture2D.MipSlice);
+			Append(desc.Texture2D.PlaneSlice);
+			break;
+		case D3D12_RTV_DIMENSION_TEXTURE2DARRAY:
+			Append(desc.Texture2DArray.MipSlice);
+			Append(desc.Texture2DArray.FirstArraySlice);
+			Append(desc.Texture2DArray.ArraySize);
+			Append(desc.Texture2DArray.PlaneSlice);
+			break;
+		case D3D12_RTV_DIMENSION_TEXTURE2DMSARRAY:
+			Append(desc.Texture2DMSArray.FirstArraySlice);
+			Append(desc.Texture2DMSArray.ArraySize);
+			break;
+		case D3D12_RTV_DIMENSION_TEXTURE3D:
+			Append(desc.Texture3D.MipSlice);
+			Append(desc.Texture3D.FirstWSlice);
+			Append(desc.Texture3D.WSize);
+			break;
+		case D3D12_RTV_DIMENSION_TEXTURE2DMS:
+			[[fallthrough]];
+		default:
+			break;
+		}
+	}
+
+	void DescriptorViewCache::ViewKey::AppendDesc(const D3D12_DEPTH_STENCIL_VIEW_DESC& desc) noexcept
+	{
+		Append(static_cast<UINT>(desc.Format));
+		Append(static_cast<UINT>(desc.ViewDimension));
+		Append(static_cast<UINT>(desc.Flags));
+
+		switch (desc.ViewDimension)
+		{
+		case D3D12_DSV_DIMENSION_TEXTURE1D:
+			Append(desc.Texture1D.MipSlice);
+			break;
+		case D3D12_DSV_DIMENSION_TEXTURE1DARRAY:
+			Append(desc.Texture1DArray.MipSlice);
+			Append(desc.Texture1DArray.FirstArraySlice);
+			Append(desc.Texture1DArray.ArraySize);
+			break;
+		case D3D12_DSV_DIMENSION_TEXTURE2D:
+			Append(desc.Texture2D.MipSlice);
+			break;
+		case D3D12_DSV_DIMENSION_TEXTURE2DARRAY:
+			Append(desc.Texture2DArray.MipSlice);
+			Append(desc.Texture2DArray.FirstArraySlice);
+			Append(desc.Texture2DArray.ArraySize);
+			break;
+		case D3D12_DSV_DIMENSION_TEXTURE2DMSARRAY:
+			Append(desc.Texture2DMSArray.FirstArraySlice);
+			Append(desc.Texture2DMSArray.ArraySize);
+			break;
+		case D3D12_DSV_DIMENSION_TEXTURE2DMS:
+			[[fallthrough]];
+		default:
+			break;
+		}
+	}
+
+	void DescriptorViewCache::ViewKey::AppendDesc(const D3D12_SHADER_RESOURCE_VIEW_DESC& desc) noexcept
+	{
+		Append(static_cast<UINT>(desc.Format));
+		Append(static_cast<UINT>(desc.ViewDimension));
+		Append(desc.Shader4ComponentMapping);
+
+		switch (desc.ViewDimension)
+		{
+		case D3D12_SRV_DIMENSION_BUFFER:
+			Append(desc.Buffer.FirstElement);
+			Append(desc.Buffer.NumElements);
+			Append(desc.Buffer.StructureByteStride);
+			Append(static_cast<UINT>(desc.Buffer.Flags));
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE1D:
+			Append(desc.Texture1D.MostDetailedMip);
+			Append(desc.Texture1D.MipLevels);
+			Append(desc.Texture1D.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE1DARRAY:
+			Append(desc.Texture1DArray.MostDetailedMip);
+			Append(desc.Texture1DArray.MipLevels);
+			Append(desc.Texture1DArray.FirstArraySlice);
+			Append(desc.Texture1DArray.ArraySize);
+			Append(desc.Texture1DArray.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2D:
+			Append(desc.Texture2D.MostDetailedMip);
+			Append(desc.Texture2D.MipLevels);
+			Append(desc.Texture2D.PlaneSlice);
+			Append(desc.Texture2D.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2DARRAY:
+			Append(desc.Texture2DArray.MostDetailedMip);
+			Append(desc.Texture2DArray.MipLevels);
+			Append(desc.Texture2DArray.FirstArraySlice);
+			Append(desc.Texture2DArray.ArraySize);
+			Append(desc.Texture2DArray.PlaneSlice);
+			Append(desc.Texture2DArray.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2DMSARRAY:
+			Append(desc.Texture2DMSArray.FirstArraySlice);
+			Append(desc.Texture2DMSArray.ArraySize);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE3D:
+			Append(desc.Texture3D.MostDetailedMip);
+			Append(desc.Texture3D.MipLevels);
+			Append(desc.Texture3D.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURECUBE:
+			Append(desc.TextureCube.MostDetailedMip);
+			Append(desc.TextureCube.MipLevels);
+			Append(desc.TextureCube.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURECUBEARRAY:
+			Append(desc.TextureCubeArray.MostDetailedMip);
+			Append(desc.TextureCubeArray.MipLevels);
+			Append(desc.TextureCubeArray.First2DArrayFace);
+			Append(desc.TextureCubeArray.NumCubes);
+			Append(desc.TextureCubeArray.ResourceMinLODClamp);
+			break;
+		case D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE:
+			Append(desc.RaytracingAccelerationStructure.Location);
+			break;
+		case D3D12_SRV_DIMENSION_TEXTURE2DMS:
+			[[fallthrough]];
+		default:
+			break;
+		}
+	}
+
+	void DescriptorViewCache::ViewKey::AppendDesc(const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc) noexcept
+	{
+		Append(static_cast<UINT>(desc.Format));
+		Append(static_cast<UINT>(desc.ViewDimension));
+
+		switch (desc.ViewDimension)
+		{
+		case D3D12_UAV_DIMENSION_BUFFER:
+			Append(desc.Buffer.FirstElement);
+			Append(desc.Buffer.NumElements);
+			Append(desc.Buffer.StructureByteStride);
+			Append(desc.Buffer.CounterOffsetInBytes);
+			Append(static_cast<UINT>(desc.Buffer.Flags));
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE1D:
+			Append(desc.Texture1D.MipSlice);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE1DARRAY:
+			Append(desc.Texture1DArray.MipSlice);
+			Append(desc.Texture1DArray.FirstArraySlice);
+			Append(desc.Texture1DArray.ArraySize);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE2D:
+			Append(desc.Texture2D.MipSlice);
+			Append(desc.Texture2D.PlaneSlice);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE2DARRAY:
+			Append(desc.Texture2DArray.MipSlice);
+			Append(desc.Texture2DArray.FirstArraySlice);
+			Append(desc.Texture2DArray.ArraySize);
+			Append(desc.Texture2DArray.PlaneSlice);
+			break;
+		case D3D12_UAV_DIMENSION_TEXTURE3D:
+			Append(desc.Texture3D.MipSlice);
+			Append(desc.Texture3D.FirstWSlice);
+			Append(desc.Texture3D.WSize);
+			break;
+		default:
+			break;
+		}
+	}
+
+	bool DescriptorViewCache::ViewKey::operator==(const ViewKey& other) const noexcept
+	{
+		return pResource == other.pResource &&
+			uVersionId == other.uVersionId &&
+			ViewType == other.ViewType &&
+			uNumDescWords == other.uNumDescWords &&
+			std::equal(auDescWords, auDescWords + uNumDescWords, other.auDescWords);
+	}
+
+	size_t DescriptorViewCache::ViewKeyHasher::operator()(const ViewKey& key) const noexcept
+	{
+		// FNV-1a over the identity of the view and the desc words in use
+		uint64_t uHash = 14695981039346656037ull;
+		auto hashWord = [&uHash](uint64_t uWord)
+		{
+			uHash = (uHash ^ uWord) * 1099511628211ull;
+		};
+
+		hashWord(reinterpret_cast<uintptr_t>(key.pResource));
+		hashWord(key.uVersionId);
+		hashWord(static_cast<uint64_t>(key.ViewType));
+		for (uint32_t i = 0; i < key.uNumDescWords; ++i)
+		{
+			hashWord(key.auDescWords[i]);
+		}
+
+		return static_cast<size_t>(uHash);
+	}
+
+	HRESULT DescriptorViewCache::getView(D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, GpuResource& resource, const ViewKey& key, const void* pDesc, PFN_CREATE_VIEW pfnCreateView) noexcept
+	{
+		HRESULT hr = S_OK;
+		outHandle.ptr = D3D12_GPU_VIRTUAL_ADDRESS_UNKNOWN;
+
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		auto view = m_Views.find(key);
+		if (view != m_Views.end())
+		{
+			m_uNumHits.fetch_add(1, std::memory_order_relaxed);
+			outHandle = view->second.Handle;
+
+			return hr;
+		}
+
+		m_uNumMisses.fetch_add(1, std::memory_order_relaxed);
+		evictStaleViews(resource, key.uVersionId);
+
+		DescriptorAllocation allocation;
+		hr = m_pAllocators[getHeapType(key.ViewType)].Allocate(allocation, m_pDevice.Get(), 1);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"View Descriptor Allocation failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		pfnCreateView(m_pDevice.Get(), resource.GetResource(), pDesc, allocation.Handle);
+
+		m_Views.emplace(key, allocation);
+		m_ResourceViews[&resource].push_back(key);
+		outHandle = allocation.Handle;
+
+		return hr;
+	}
+
+	void DescriptorViewCache::evictStaleViews(const GpuResource& resource, UINT uVersionId) noexcept
+	{
+		auto resourceViews = m_ResourceViews.find(&resource);
+		if (resourceViews == m_ResourceViews.end())
+		{
+			return;
+		}
+
+		std::vector<ViewKey>& keys = resourceViews->second;
+		for (size_t i = 0; i < keys.size();)
+		{
+			if (keys[i].uVersionId == uVersionId)
+			{
+				++i;
+				continue;
+			}
+
+			auto view = m_Views.find(keys[i]);
+			m_pAllocators[getHeapType(keys[i].ViewType)].Free(view->second);
+			m_Views.erase(view);
+
+			keys[i] = keys.back();
+			keys.pop_back();
+		}
+	}
+
+	DescriptorViewCache::ViewKey DescriptorViewCache::makeKey(const GpuResource& resource, eViewType viewType) noexcept
+	{
+		ViewKey key = {};
+		key.pResource = &resource;
+		key.uVersionId = resource.GetVersionId();
+		key.ViewType = viewType;
+
+		return key;
+	}
+
+	D3D12_DESCRIPTOR_HEAP_TYPE DescriptorViewCache::getHeapType(eViewType viewType) noexcept
+	{
+		switch (viewType)
+		{
+		case eViewType::Rtv:
+			return D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+		case eViewType::Dsv:
+			return D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+		case eViewType::Srv:
+			[[fallthrough]];
+		case eViewType::Uav:
+			[[fallthrough]];
+		default:
+			return D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		}
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Pch.h"
+#include "Renderer/DescriptorHeap.h"
+
+namespace esperanza
+{
+	class GpuResource;
+
+	// Hands out CPU-visible views and creates each distinct view only once.  A view is keyed on the resource,
+	// its version id, the kind of view and the fields of the view desc that its view dimension uses, so asking
+	// again for a view that already exists returns the same handle.  Views of an older version of a resource
+	// are freed the next time a view of it is requested, or right away with Evict.
+	class DescriptorViewCache final
+	{
+	public:
+		enum class eViewType : uint8_t
+		{
+			Rtv,
+			Dsv,
+			Srv,
+			Uav,
+			COUNT,
+		};
+
+	public:
+		explicit DescriptorViewCache() noexcept;
+		DescriptorViewCache(const DescriptorViewCache& other) = delete;
+		DescriptorViewCache(DescriptorViewCache&& other) = delete;
+		DescriptorViewCache& operator=(const DescriptorViewCache& other) = delete;
+		DescriptorViewCache& operator=(DescriptorViewCache&& other) = delete;
+		~DescriptorViewCache() noexcept = default;
+
+		// The allocators are indexed by descriptor heap type
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ DescriptorAllocator* pAllocators) noexcept;
+		void Destroy() noexcept;
+
+		HRESULT GetRenderTargetView(_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, _In_ GpuResource& resource, _In_opt_ const D3D12_RENDER_TARGET_VIEW_DESC* pDesc) noexcept;
+		HRESULT GetDepthStencilView(_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, _In_ GpuResource& resource, _In_opt_ const D3D12_DEPTH_STENCIL_VIEW_DESC* pDesc) noexcept;
+		HRESULT GetShaderResourceView(_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, _In_ GpuResource& resource, _In_opt_ const D3D12_SHADER_RESOURCE_VIEW_DESC* pDesc) noexcept;
+		HRESULT GetUnorderedAccessView(_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, _In_ GpuResource& resource, _In_opt_ const D3D12_UNORDERED_ACCESS_VIEW_DESC* pDesc) noexcept;
+
+		// Frees every view of the resource, call before the resource itself goes away
+		void Evict(_In_ const GpuResource& resource) noexcept;
+
+		size_t GetNumHits() const noexcept;
+		size_t GetNumMisses() const noexcept;
+
+	private:
+		// Enough for the largest view desc, a buffer UAV
+		static constexpr const uint32_t MAX_VIEW_DESC_WORDS = 12u;
+
+		// The desc is stored field by field as 32 bit words, so neither its padding nor the bytes of the union
+		// members its view dimension does not use can tell two equal views apart
+		struct ViewKey
+		{
+			const GpuResource* pResource;
+			UINT uVersionId;
+			eViewType ViewType;
+			uint32_t uNumDescWords;
+			uint32_t auDescWords[MAX_VIEW_DESC_WORDS];
+
+			void Append(_In_ UINT uValue) noexcept;
+			void Append(_In_ UINT64 uValue) noexcept;
+			void Append(_In_ FLOAT value) noexcept;
+			void AppendDesc(_In_ const D3D12_RENDER_TARGET_VIEW_DESC& desc) noexcept;
+			void AppendDesc(_In_ const D3D12_DEPTH_STENCIL_VIEW_DESC& desc) noexcept;
+			void AppendDesc(_In_ const D3D12_SHADER_RESOURCE_VIEW_DESC& desc) noexcept;
+			void AppendDesc(_In_ const D3D12_UNORDERED_ACCESS_VIEW_DESC& desc) noexcept;
+
+			bool operator==(const ViewKey& other) const noexcept;
+		};
+
+		struct ViewKeyHasher
+		{
+			size_t operator()(const ViewKey& key) const noexcept;
+		};
+
+		typedef void (*PFN_CREATE_VIEW)(_In_ ID3D12Device* pDevice, _In_ ID3D12Resource* pResource, _In_opt_ const void* pDesc, _In_ D3D12_CPU_DESCRIPTOR_HANDLE handle);
+
+	private:
+		HRESULT getView(_Out_ D3D12_CPU_DESCRIPTOR_HANDLE& outHandle, _In_ GpuResource& resource, _In_ const ViewKey& key, _In_opt_ const void* pDesc, _In_ PFN_CREATE_VIEW pfnCreateView) noexcept;
+		void evictStaleViews(_In_ const GpuResource& resource, _In_ UINT uVersionId) noexcept;
+
+		static ViewKey makeKey(_In_ const GpuResource& resource, _In_ eViewType viewType) noexcept;
+		static D3D12_DESCRIPTOR_HEAP_TYPE getHeapType(_In_ eViewType viewType) noexcept;
+
+	private:
+		ComPtr<ID3D12Device> m_pDevice;
+		DescriptorAllocator* m_pAllocators;
+		std::mutex m_Mutex;
+		std::unordered_map<ViewKey, DescriptorAllocation, ViewKeyHasher> m_Views;
+		std::unordered_map<const GpuResource*, std::vector<ViewKey>> m_ResourceViews;
+		std::atomic<size_t> m_uNumHits;
+		std::atomic<size_t> m_uNumMisses;
+	};
+}
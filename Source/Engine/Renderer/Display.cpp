@@ -11,7 +11,9 @@
 namespace esperanza
 {
 	Display::Display() noexcept
-		: m_uNativeWidth(0)
+		: m_pCommandListManager()
+		, m_FrameController()
+		, m_uNativeWidth(0)
 		, m_uNativeHeight(0)
 		, m_uDisplayWidth(1920)
 		, m_uDisplayHeight(1080)
@@ -130,13 +132,33 @@ namespace esperanza
 
 		// Set PSOs
 
+		hr = m_FrameController.Initialize(m_pCommandListManager, NUM_FRAMES_IN_FLIGHT);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing frame controller failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
 		setNativeResolution();
 
+		hr = m_FrameController.BeginFrame();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Beginning frame failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
 		return hr;
 	}
 
 	void Display::Destroy() noexcept
 	{
+		m_FrameController.Destroy();
+
 		m_pSwapChain1->SetFullscreenState(FALSE, nullptr);
 
 		for (UINT i = 0; i < NUM_SWAP_CHAIN_BUFFERS; ++i)
@@ -153,7 +175,16 @@ namespace esperanza
 	HRESULT Display::Resize(UINT uWidth, UINT uHeight) noexcept
 	{
 		HRESULT hr = S_OK;
-		m_pCommandListManager->IdleGpu();
+
+		// Frames in flight and the work already submitted for the open frame can reference the swap chain buffers
+		hr = m_FrameController.WaitForIdle();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Waiting for the GPU to go idle failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
 
 		m_uDisplayWidth = uWidth;
 		m_uDisplayHeight = uHeight;
@@ -201,8 +232,6 @@ namespace esperanza
 
 		m_uCurrentBufferIndex = 0;
 
-		m_pCommandListManager->IdleGpu();
-
 		//ResizeDisplayDependentBuffers(g_NativeWidth, g_NativeHeight);
 
 		return hr;
@@ -221,8 +250,23 @@ namespace esperanza
 
 		UINT uPresentInterval = m_bIsVSyncEnabled ? std::min(4u, static_cast<UINT>(std::roundf(m_FrameTime * 60.0f))) : 0;
 
+		// Lists of this frame still queued in a batch have to reach the GPU ahead of the present
+		HRESULT hr = m_pCommandListManager->FlushCommandLists();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Flushing command lists failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+		}
+
 		m_pSwapChain1->Present(uPresentInterval, 0);
 
+		hr = m_FrameController.EndFrame();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Ending frame failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+		}
+
 		m_uCurrentBufferIndex = (m_uCurrentBufferIndex + 1) % NUM_SWAP_CHAIN_BUFFERS;
 
 		LARGE_INTEGER currentTick;
@@ -259,6 +303,18 @@ namespace esperanza
 		// Update temporal effects
 
 		setNativeResolution();
+
+		hr = m_FrameController.BeginFrame();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Beginning frame failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+		}
+	}
+
+	FrameController& Display::GetFrameController() noexcept
+	{
+		return m_FrameController;
 	}
 
 	constexpr UINT Display::GetWidth() const noexcept
@@ -356,7 +412,7 @@ namespace esperanza
 		m_uNativeWidth = uNativeWidth;
 		m_uNativeHeight = uNativeHeight;
 
-		m_pCommandListManager->IdleGpu();
+		m_FrameController.WaitForIdle();
 
 		// InitializeRenderingBuffers
 	}
@@ -3,6 +3,7 @@
 #include "Pch.h"
 
 #include "Renderer/ColorBuffer.h"
+#include "Renderer/FrameController.h"
 
 namespace esperanza
 {
@@ -23,8 +24,12 @@ namespace esperanza
 		void Destroy() noexcept;
 
 		HRESULT Resize(_In_ UINT uWidth, _In_ UINT uHeight) noexcept;
+
+		// Ends the current frame and begins the next one, which blocks only when the CPU is too far ahead
 		void Present() noexcept;
 
+		FrameController& GetFrameController() noexcept;
+
 		constexpr UINT GetWidth() const noexcept;
 		constexpr UINT GetHeight() const noexcept;
 		constexpr BOOL IsHdrOutputEnabled() const noexcept;
@@ -106,11 +111,13 @@ namespace esperanza
 		};
 
 		static constexpr const size_t NUM_SWAP_CHAIN_BUFFERS = 3;
+		static constexpr const UINT NUM_FRAMES_IN_FLIGHT = 2u;
 		static constexpr const DXGI_FORMAT SWAP_CHAIN_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM;
 		//static constexpr const DXGI_FORMAT SWAP_CHAIN_FORMAT = DXGI_FORMAT_R10G10B10A2_UNORM;
 
 	private:
 		std::shared_ptr<CommandListManager> m_pCommandListManager;
+		FrameController m_FrameController;
 
 		UINT m_uNativeWidth;
 		UINT m_uNativeHeight;
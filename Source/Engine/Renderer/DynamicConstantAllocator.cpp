@@ -0,0 +1,245 @@
+#include "Pch.h"
+#include "Renderer/DynamicConstantAllocator.h"
+
+#include <emmintrin.h>
+
+namespace esperanza
+{
+	DynamicConstantAllocator::DynamicConstantAllocator() noexcept
+		: m_pPageProvider(nullptr)
+		, m_uPageSize(DEFAULT_PAGE_SIZE)
+		, m_AllocationMutex()
+		, m_aFrameSlots()
+		, m_uFrameIndex(0)
+		, m_uFrameNumber(UINT64_MAX)
+		, m_uPeakBytesPerFrame(0)
+	{
+	}
+
+	HRESULT DynamicConstantAllocator::Initialize(UploadPageProvider& pageProvider) noexcept
+	{
+		return Initialize(pageProvider, DEFAULT_PAGE_SIZE);
+	}
+
+	HRESULT DynamicConstantAllocator::Initialize(UploadPageProvider& pageProvider, UINT64 uPageSize) noexcept
+	{
+		if (uPageSize < D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT)
+		{
+			GLOGEF(L"Constant page size %llu is too small", uPageSize);
+
+			return E_INVALIDARG;
+		}
+
+		m_pPageProvider = &pageProvider;
+		m_uPageSize = uPageSize;
+
+		return S_OK;
+	}
+
+	void DynamicConstantAllocator::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		for (FrameSlot& slot : m_aFrameSlots)
+		{
+			for (UploadPage& page : slot.Pages)
+			{
+				m_pPageProvider->DestroyPage(page);
+			}
+
+			slot = {};
+		}
+
+		m_pPageProvider = nullptr;
+		m_uFrameNumber = UINT64_MAX;
+	}
+
+	void DynamicConstantAllocator::BeginFrame(UINT uFrameIndex, UINT64 uFrameNumber) noexcept
+	{
+		assert(uFrameIndex < FrameController::MAX_FRAMES_IN_FLIGHT);
+
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		if (uFrameNumber == m_uFrameNumber)
+		{
+			return;
+		}
+
+		m_uFrameIndex = uFrameIndex;
+		m_uFrameNumber = uFrameNumber;
+
+		FrameSlot& slot = m_aFrameSlots[m_uFrameIndex];
+		slot.uCurrentPageIndex = 0;
+		slot.uCurrentOffset = 0;
+		slot.uBytesAllocated = 0;
+	}
+
+	HRESULT DynamicConstantAllocator::Allocate(DynamicConstantAllocation& outAllocation, UINT64 uSize) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		return allocate(outAllocation, uSize);
+	}
+
+	HRESULT DynamicConstantAllocator::AllocateBulk(DynamicConstantAllocation& outAllocation, UINT uNumElements, UINT64 uElementSize) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		// Neither rounding the element size up to the stride nor the total size may wrap around
+		constexpr const UINT64 MAX_ELEMENT_SIZE = UINT64_MAX - (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+		if (uElementSize == 0 || uElementSize > MAX_ELEMENT_SIZE)
+		{
+			GLOGEF(L"Invalid constant element size %llu", uElementSize);
+
+			return E_INVALIDARG;
+		}
+
+		const UINT64 uStride = (uElementSize + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+		if (uNumElements > MAX_ELEMENT_SIZE / uStride)
+		{
+			GLOGEF(L"%u constant elements of %llu bytes overflow the allocation size", uNumElements, uStride);
+
+			return E_INVALIDARG;
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		hr = allocate(outAllocation, uStride * uNumElements);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Allocating %u constant elements failed with HRESULT code %u, %s", uNumElements, hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		outAllocation.uStride = uStride;
+
+		return hr;
+	}
+
+	HRESULT DynamicConstantAllocator::WriteBulk(DynamicConstantAllocation& outAllocation, const void* pElements, UINT uNumElements, UINT64 uElementSize) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		hr = AllocateBulk(outAllocation, uNumElements, uElementSize);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Allocating bulk constants failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		const BYTE* pSource = static_cast<const BYTE*>(pElements);
+		if (uElementSize == outAllocation.uStride)
+		{
+			// Already packed at the placement alignment, one streaming pass over everything
+			streamCopy(outAllocation.pCpuAddress, pSource, static_cast<size_t>(outAllocation.uSize));
+		}
+		else
+		{
+			for (UINT i = 0; i < uNumElements; ++i)
+			{
+				streamCopy(outAllocation.pCpuAddress + i * outAllocation.uStride, pSource + i * uElementSize, static_cast<size_t>(uElementSize));
+			}
+		}
+
+		// Non-temporal stores are weakly ordered, make them visible before the list referencing them is submitted
+		_mm_sfence();
+
+		return hr;
+	}
+
+	void DynamicConstantAllocator::GetStatistics(DynamicConstantAllocatorStatistics& outStatistics) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		outStatistics.uNumPages = 0;
+		for (const FrameSlot& slot : m_aFrameSlots)
+		{
+			outStatistics.uNumPages += slot.Pages.size();
+		}
+
+		outStatistics.uBytesAllocatedThisFrame = m_aFrameSlots[m_uFrameIndex].uBytesAllocated;
+		outStatistics.uPeakBytesPerFrame = m_uPeakBytesPerFrame;
+	}
+
+	void DynamicConstantAllocator::streamCopy(BYTE* pDestination, const BYTE* pSource, size_t uSize) noexcept
+	{
+		// The destination is always 256 byte aligned, the source may not even be 16 byte aligned
+		__m128i* pDestinationVector = reinterpret_cast<__m128i*>(pDestination);
+		const __m128i* pSourceVector = reinterpret_cast<const __m128i*>(pSource);
+
+		size_t uNumVectors = uSize / sizeof(__m128i);
+		for (; uNumVectors >= 4; uNumVectors -= 4, pDestinationVector += 4, pSourceVector += 4)
+		{
+			_mm_stream_si128(pDestinationVector + 0, _mm_loadu_si128(pSourceVector + 0));
+			_mm_stream_si128(pDestinationVector + 1, _mm_loadu_si128(pSourceVector + 1));
+			_mm_stream_si128(pDestinationVector + 2, _mm_loadu_si128(pSourceVector + 2));
+			_mm_stream_si128(pDestinationVector + 3, _mm_loadu_si128(pSourceVector + 3));
+		}
+
+		for (; uNumVectors > 0; --uNumVectors, ++pDestinationVector, ++pSourceVector)
+		{
+			_mm_stream_si128(pDestinationVector, _mm_loadu_si128(pSourceVector));
+		}
+
+		const size_t uRemainder = uSize % sizeof(__m128i);
+		if (uRemainder > 0)
+		{
+			std::memcpy(pDestinationVector, pSourceVector, uRemainder);
+		}
+	}
+
+	HRESULT DynamicConstantAllocator::allocate(DynamicConstantAllocation& outAllocation, UINT64 uSize) noexcept
+	{
+		HRESULT hr = S_OK;
+		outAllocation = {};
+
+		if (uSize == 0)
+		{
+			GLOGE(L"Constant allocation of zero bytes");
+
+			return E_INVALIDARG;
+		}
+
+		const UINT64 uAlignedSize = (uSize + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+		FrameSlot& slot = m_aFrameSlots[m_uFrameIndex];
+
+		// Move on to the next page of the slot that fits, pages stay with the slot from frame to frame
+		while (slot.uCurrentPageIndex < slot.Pages.size() && slot.uCurrentOffset + uAlignedSize > slot.Pages[slot.uCurrentPageIndex].uSize)
+		{
+			++slot.uCurrentPageIndex;
+			slot.uCurrentOffset = 0;
+		}
+
+		if (slot.uCurrentPageIndex == slot.Pages.size())
+		{
+			UploadPage newPage = {};
+			hr = m_pPageProvider->CreatePage(newPage, std::max(m_uPageSize, uAlignedSize));
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Creating constant page failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			slot.Pages.push_back(std::move(newPage));
+			slot.uCurrentOffset = 0;
+		}
+
+		const UploadPage& page = slot.Pages[slot.uCurrentPageIndex];
+		outAllocation.pCpuAddress = page.pCpuAddress + slot.uCurrentOffset;
+		outAllocation.GpuVirtualAddress = page.GpuVirtualAddress + slot.uCurrentOffset;
+		outAllocation.uSize = uAlignedSize;
+		outAllocation.uStride = uAlignedSize;
+
+		slot.uCurrentOffset += uAlignedSize;
+		slot.uBytesAllocated += uAlignedSize;
+		m_uPeakBytesPerFrame = std::max(m_uPeakBytesPerFrame, slot.uBytesAllocated);
+
+		return hr;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Pch.h"
+
+#include "Renderer/FrameController.h"
+#include "Renderer/UploadAllocator.h"
+
+namespace esperanza
+{
+	struct DynamicConstantAllocation
+	{
+		BYTE* pCpuAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuVirtualAddress;
+		UINT64 uSize;
+
+		// Distance between consecutive elements of a bulk allocation
+		UINT64 uStride;
+	};
+
+	struct DynamicConstantAllocatorStatistics
+	{
+		UINT64 uNumPages;
+		UINT64 uBytesAllocatedThisFrame;
+		UINT64 uPeakBytesPerFrame;
+	};
+
+	// Linear allocator for constant data that lives for one frame.  Every frame slot of the FrameController
+	// owns its own pages, a slot is only rewound in BeginFrame once the FrameController has made sure the
+	// frame that used it before is done, so allocating never waits on the GPU.
+	class DynamicConstantAllocator final
+	{
+	public:
+		static constexpr const UINT64 DEFAULT_PAGE_SIZE = 0x100000;	// 1MB
+
+	public:
+		explicit DynamicConstantAllocator() noexcept;
+		DynamicConstantAllocator(const DynamicConstantAllocator& other) = delete;
+		DynamicConstantAllocator(DynamicConstantAllocator&& other) = delete;
+		DynamicConstantAllocator& operator=(const DynamicConstantAllocator& other) = delete;
+		DynamicConstantAllocator& operator=(DynamicConstantAllocator&& other) = delete;
+		~DynamicConstantAllocator() noexcept = default;
+
+		HRESULT Initialize(_In_ UploadPageProvider& pageProvider) noexcept;
+		HRESULT Initialize(_In_ UploadPageProvider& pageProvider, _In_ UINT64 uPageSize) noexcept;
+
+		// The GPU must be done with every frame
+		void Destroy() noexcept;
+
+		// Rewinds the slot of the frame, calling it again within the same frame does nothing
+		void BeginFrame(_In_ UINT uFrameIndex, _In_ UINT64 uFrameNumber) noexcept;
+
+		// Allocations are D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT aligned
+		HRESULT Allocate(_Out_ DynamicConstantAllocation& outAllocation, _In_ UINT64 uSize) noexcept;
+		HRESULT AllocateBulk(_Out_ DynamicConstantAllocation& outAllocation, _In_ UINT uNumElements, _In_ UINT64 uElementSize) noexcept;
+
+		// Allocates one aligned slot per element and fills them with non-temporal stores, which skip the cache
+		// and suit the write-combined upload heap.  Element i lives at GpuVirtualAddress + i * uStride.
+		HRESULT WriteBulk(_Out_ DynamicConstantAllocation& outAllocation, _In_reads_bytes_(uNumElements * uElementSize) const void* pElements, _In_ UINT uNumElements, _In_ UINT64 uElementSize) noexcept;
+
+		void GetStatistics(_Out_ DynamicConstantAllocatorStatistics& outStatistics) noexcept;
+
+	private:
+		struct FrameSlot
+		{
+			std::vector<UploadPage> Pages;
+			size_t uCurrentPageIndex;
+			UINT64 uCurrentOffset;
+			UINT64 uBytesAllocated;
+		};
+
+	private:
+		static void streamCopy(_Out_writes_bytes_(uSize) BYTE* pDestination, _In_reads_bytes_(uSize) const BYTE* pSource, _In_ size_t uSize) noexcept;
+
+		HRESULT allocate(_Out_ DynamicConstantAllocation& outAllocation, _In_ UINT64 uSize) noexcept;
+
+	private:
+		UploadPageProvider* m_pPageProvider;
+		UINT64 m_uPageSize;
+		std::mutex m_AllocationMutex;
+		FrameSlot m_aFrameSlots[FrameController::MAX_FRAMES_IN_FLIGHT];
+		UINT m_uFrameIndex;
+		UINT64 m_uFrameNumber;
+		UINT64 m_uPeakBytesPerFrame;
+	};
+}
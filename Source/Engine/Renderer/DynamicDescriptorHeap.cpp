@@ -0,0 +1,125 @@
+#include "Pch.h"
+
+#include "Renderer/CommandListManager.h"
+#include "Renderer/DynamicDescriptorHeap.h"
+
+namespace esperanza
+{
+	DynamicDescriptorHeap::DynamicDescriptorHeap() noexcept
+		: m_Heap()
+		, m_Mutex()
+		, m_RetiredRanges()
+		, m_uCapacity(0)
+		, m_uHead(0)
+		, m_uTail(0)
+		, m_uRetiredHead(0)
+	{
+	}
+
+	HRESULT DynamicDescriptorHeap::Initialize(ID3D12Device* pDevice, const std::wstring& strDebugHeapName, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t uMaxCount) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		hr = m_Heap.Initialize(pDevice, strDebugHeapName, type, uMaxCount);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing Descriptor Heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		m_uCapacity = m_Heap.GetNumDescriptors();
+		m_uHead = 0;
+		m_uTail = 0;
+		m_uRetiredHead = 0;
+
+		return hr;
+	}
+
+	void DynamicDescriptorHeap::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		m_RetiredRanges = std::queue<RetiredRange>();
+		m_Heap.Destroy();
+		m_uCapacity = 0;
+	}
+
+	HRESULT DynamicDescriptorHeap::Allocate(DescriptorHandle& outHandle, CommandListManager& commandListManager, uint32_t uCount) noexcept
+	{
+		outHandle = DescriptorHandle();
+
+		if (uCount == 0 || uCount > m_uCapacity)
+		{
+			GLOGEF(L"Cannot allocate %u descriptors from a dynamic descriptor heap of %u", uCount, m_uCapacity);
+
+			return E_INVALIDARG;
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		// A table never wraps around the end of the heap, the skipped slots are reclaimed with the table
+		uint64_t uStart = m_uHead;
+		const uint32_t uOffset = static_cast<uint32_t>(uStart % m_uCapacity);
+		if (uOffset + uCount > m_uCapacity)
+		{
+			uStart += m_uCapacity - uOffset;
+		}
+		const uint64_t uEnd = uStart + uCount;
+
+		if (uEnd - m_uTail > m_uCapacity)
+		{
+			reclaimRanges(commandListManager);
+		}
+
+		while (uEnd - m_uTail > m_uCapacity)
+		{
+			if (m_RetiredRanges.empty())
+			{
+				GLOGEF(L"Dynamic descriptor heap out of space, %llu descriptors are in use without being retired", m_uHead - m_uTail);
+
+				return E_OUTOFMEMORY;
+			}
+
+			GLOGW(L"Dynamic descriptor heap is full, waiting for the GPU to release descriptors");
+
+			const RetiredRange& oldestRange = m_RetiredRanges.front();
+			commandListManager.WaitForFence(oldestRange.uFenceValue);
+			m_uTail = oldestRange.uEnd;
+			m_RetiredRanges.pop();
+		}
+
+		m_uHead = uEnd;
+		outHandle = m_Heap[static_cast<uint32_t>(uStart % m_uCapacity)];
+
+		return S_OK;
+	}
+
+	void DynamicDescriptorHeap::RetireRanges(UINT64 uFenceValue) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_Mutex);
+
+		if (m_uHead == m_uRetiredHead)
+		{
+			return;
+		}
+
+		m_RetiredRanges.push(RetiredRange{ uFenceValue, m_uHead });
+		m_uRetiredHead = m_uHead;
+	}
+
+	ID3D12DescriptorHeap* DynamicDescriptorHeap::GetHeapPointer() const noexcept
+	{
+		return m_Heap.GetHeapPointer();
+	}
+
+	void DynamicDescriptorHeap::reclaimRanges(CommandListManager& commandListManager) noexcept
+	{
+		while (!m_RetiredRanges.empty() && commandListManager.IsFenceComplete(m_RetiredRanges.front().uFenceValue))
+		{
+			m_uTail = m_RetiredRanges.front().uEnd;
+			m_RetiredRanges.pop();
+		}
+	}
+}
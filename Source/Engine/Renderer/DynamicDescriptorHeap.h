@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Pch.h"
+#include "Renderer/DescriptorHeap.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+
+	// A ring of shader-visible descriptors on top of a DescriptorHeap.  Tables allocated for a submission are
+	// retired with the fence value Finish returned for it and are handed out again once the GPU
+	// has passed that fence, so any number of frames can share one fixed-size heap.
+	class DynamicDescriptorHeap final
+	{
+	public:
+		explicit DynamicDescriptorHeap() noexcept;
+		DynamicDescriptorHeap(const DynamicDescriptorHeap& other) = delete;
+		DynamicDescriptorHeap(DynamicDescriptorHeap&& other) = delete;
+		DynamicDescriptorHeap& operator=(const DynamicDescriptorHeap& other) = delete;
+		DynamicDescriptorHeap& operator=(DynamicDescriptorHeap&& other) = delete;
+		~DynamicDescriptorHeap() noexcept = default;
+
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ const std::wstring& strDebugHeapName, _In_ D3D12_DESCRIPTOR_HEAP_TYPE type, _In_ uint32_t uMaxCount) noexcept;
+		void Destroy() noexcept;
+
+		// Returns uCount contiguous descriptors.  When the ring is full the completed ranges are reclaimed
+		// first, the oldest retired range is only waited on if that did not free enough space.
+		HRESULT Allocate(_Out_ DescriptorHandle& outHandle, _In_ CommandListManager& commandListManager, _In_ uint32_t uCount) noexcept;
+
+		// Everything allocated since the previous call is reclaimed once the GPU has passed uFenceValue
+		void RetireRanges(_In_ UINT64 uFenceValue) noexcept;
+
+		ID3D12DescriptorHeap* GetHeapPointer() const noexcept;
+		constexpr uint32_t GetDescriptorSize(void) const noexcept;
+
+	private:
+		void reclaimRanges(_In_ CommandListManager& commandListManager) noexcept;
+
+	private:
+		struct RetiredRange
+		{
+			UINT64 uFenceValue;
+			uint64_t uEnd;
+		};
+
+		DescriptorHeap m_Heap;
+		std::mutex m_Mutex;
+		std::queue<RetiredRange> m_RetiredRanges;
+		uint32_t m_uCapacity;
+
+		// Positions only grow, the slot in the heap is the position modulo the capacity
+		uint64_t m_uHead;
+		uint64_t m_uTail;
+		uint64_t m_uRetiredHead;
+	};
+
+	inline constexpr uint32_t DynamicDescriptorHeap::GetDescriptorSize(void) const noexcept
+	{
+		return m_Heap.GetDescriptorSize();
+	}
+}
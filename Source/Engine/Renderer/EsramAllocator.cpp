@@ -0,0 +1,345 @@
+#include "Pch.h"
+#include "Renderer/EsramAllocator.h"
+
+#include "Renderer/CommandListManager.h"
+
+namespace esperanza
+{
+	static constexpr const D3D12_COMMAND_LIST_TYPE QUEUE_TYPES[] =
+	{
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		D3D12_COMMAND_LIST_TYPE_COMPUTE,
+		D3D12_COMMAND_LIST_TYPE_COPY,
+	};
+
+	static constexpr const D3D12_HEAP_FLAGS HEAP_CATEGORY_FLAGS[] =
+	{
+		D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+	};
+
+	EsramAllocator::EsramAllocator() noexcept
+		: m_pDevice()
+		, m_pCommandListManager(nullptr)
+		, m_uHeapBlockSize(DEFAULT_HEAP_BLOCK_SIZE)
+		, m_AllocationMutex()
+		, m_aHeapBlocks()
+		, m_PendingFrees()
+	{
+	}
+
+	HRESULT EsramAllocator::Initialize(ID3D12Device* pDevice, CommandListManager& commandListManager) noexcept
+	{
+		return Initialize(pDevice, commandListManager, DEFAULT_HEAP_BLOCK_SIZE);
+	}
+
+	HRESULT EsramAllocator::Initialize(ID3D12Device* pDevice, CommandListManager& commandListManager, UINT64 uHeapBlockSize) noexcept
+	{
+		// Blocks of render targets are MSAA aligned, so they have to be a multiple of that alignment
+		if (uHeapBlockSize == 0 || uHeapBlockSize % D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT != 0)
+		{
+			GLOGEF(L"Heap block size %llu is not a multiple of %u", uHeapBlockSize, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+
+			return E_INVALIDARG;
+		}
+
+		m_pDevice = pDevice;
+		m_pCommandListManager = &commandListManager;
+		m_uHeapBlockSize = uHeapBlockSize;
+
+		return S_OK;
+	}
+
+	void EsramAllocator::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		m_PendingFrees.clear();
+		for (std::vector<std::unique_ptr<HeapBlock>>& heapBlocks : m_aHeapBlocks)
+		{
+			heapBlocks.clear();
+		}
+
+		m_pCommandListManager = nullptr;
+		m_pDevice.Reset();
+	}
+
+	HRESULT EsramAllocator::CreatePlacedResource(EsramAllocation& outAllocation, ID3D12Resource** ppOutResource, const D3D12_RESOURCE_DESC& resourceDesc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* pClearValue) noexcept
+	{
+		HRESULT hr = S_OK;
+		outAllocation = {};
+		*ppOutResource = nullptr;
+
+		if (!m_pDevice)
+		{
+			GLOGE(L"Esram allocator is not initialized!");
+
+			return E_FAIL;
+		}
+
+		ReleaseCompletedAllocations();
+
+		const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_pDevice->GetResourceAllocationInfo(0, 1, &resourceDesc);
+		if (allocationInfo.SizeInBytes == UINT64_MAX)
+		{
+			GLOGE(L"Resource description is invalid for placement");
+
+			return E_INVALIDARG;
+		}
+
+		const eHeapCategory category = getHeapCategory(resourceDesc);
+
+		{
+			std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+			hr = allocate(outAllocation, category, allocationInfo);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Allocating %llu bytes of heap memory failed with HRESULT code %u, %s", allocationInfo.SizeInBytes, hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		hr = m_pDevice->CreatePlacedResource(outAllocation.pHeap, outAllocation.uOffset, &resourceDesc, initialState, pClearValue, IID_PPV_ARGS(ppOutResource));
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Creating placed resource failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			// Nothing was ever placed in the range, it can be reused right away
+			std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+			freeRange(outAllocation);
+			outAllocation = {};
+
+			return hr;
+		}
+
+		return hr;
+	}
+
+	void EsramAllocator::Free(const EsramAllocation& allocation) noexcept
+	{
+		if (!allocation.pHeap)
+		{
+			return;
+		}
+
+		// Anything already submitted to any queue may still access the memory
+		PendingFree pendingFree = { .auFenceValues = {}, .Allocation = allocation };
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			pendingFree.auFenceValues[i] = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).GetLastSubmittedFenceValue();
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		m_PendingFrees.push_back(pendingFree);
+	}
+
+	void EsramAllocator::ReleaseCompletedAllocations() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		// Fence values only grow, so frees complete in the order they were queued
+		while (!m_PendingFrees.empty())
+		{
+			const PendingFree& pendingFree = m_PendingFrees.front();
+			for (size_t i = 0; i < NUM_QUEUES; ++i)
+			{
+				if (!m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).IsFenceComplete(pendingFree.auFenceValues[i]))
+				{
+					return;
+				}
+			}
+
+			freeRange(pendingFree.Allocation);
+			m_PendingFrees.pop_front();
+		}
+	}
+
+	void EsramAllocator::GetStatistics(EsramAllocatorStatistics& outStatistics) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		outStatistics = {};
+		outStatistics.uNumPendingFrees = m_PendingFrees.size();
+
+		for (const std::vector<std::unique_ptr<HeapBlock>>& heapBlocks : m_aHeapBlocks)
+		{
+			for (const std::unique_ptr<HeapBlock>& pHeapBlock : heapBlocks)
+			{
+				if (!pHeapBlock)
+				{
+					continue;
+				}
+
+				TlsfAllocatorStatistics heapStatistics;
+				pHeapBlock->Allocator.GetStatistics(heapStatistics);
+
+				++outStatistics.uNumHeaps;
+				outStatistics.uHeapBytes += heapStatistics.uTotalSize;
+				outStatistics.uAllocatedBytes += heapStatistics.uAllocatedSize;
+				outStatistics.uNumAllocations += heapStatistics.uNumAllocations;
+				outStatistics.uLargestFreeBlockSize = std::max(outStatistics.uLargestFreeBlockSize, heapStatistics.uLargestFreeBlockSize);
+			}
+		}
+
+		const UINT64 uFreeBytes = outStatistics.uHeapBytes - outStatistics.uAllocatedBytes;
+		outStatistics.Fragmentation = uFreeBytes > 0 ? 1.0f - static_cast<FLOAT>(outStatistics.uLargestFreeBlockSize) / static_cast<FLOAT>(uFreeBytes) : 0.0f;
+	}
+
+	EsramAllocator::eHeapCategory EsramAllocator::getHeapCategory(const D3D12_RESOURCE_DESC& resourceDesc) noexcept
+	{
+		if (resourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			return eHeapCategory::Buffers;
+		}
+
+		if (resourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+		{
+			return eHeapCategory::RenderTargetTextures;
+		}
+
+		return eHeapCategory::OtherTextures;
+	}
+
+	HRESULT EsramAllocator::allocate(EsramAllocation& outAllocation, eHeapCategory category, const D3D12_RESOURCE_ALLOCATION_INFO& allocationInfo) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		const uint32_t uCategoryIndex = static_cast<uint32_t>(category);
+		std::vector<std::unique_ptr<HeapBlock>>& heapBlocks = m_aHeapBlocks[uCategoryIndex];
+
+		uint32_t uHeapIndex = INVALID_HEAP_INDEX;
+		TlsfAllocation range = {};
+
+		if (allocationInfo.SizeInBytes > m_uHeapBlockSize)
+		{
+			hr = createHeapBlock(uHeapIndex, category, allocationInfo.SizeInBytes, TRUE);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Creating dedicated heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			hr = heapBlocks[uHeapIndex]->Allocator.Allocate(range, allocationInfo.SizeInBytes, allocationInfo.Alignment);
+		}
+		else
+		{
+			hr = E_OUTOFMEMORY;
+			for (size_t i = 0; i < heapBlocks.size() && FAILED(hr); ++i)
+			{
+				if (heapBlocks[i] && !heapBlocks[i]->bIsDedicated)
+				{
+					hr = heapBlocks[i]->Allocator.Allocate(range, allocationInfo.SizeInBytes, allocationInfo.Alignment);
+					uHeapIndex = static_cast<uint32_t>(i);
+				}
+			}
+
+			if (hr == E_OUTOFMEMORY)
+			{
+				hr = createHeapBlock(uHeapIndex, category, m_uHeapBlockSize, FALSE);
+				if (FAILED(hr))
+				{
+					_com_error err(hr);
+					GLOGEF(L"Creating heap block failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+					return hr;
+				}
+
+				hr = heapBlocks[uHeapIndex]->Allocator.Allocate(range, allocationInfo.SizeInBytes, allocationInfo.Alignment);
+			}
+		}
+
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Sub-allocating heap range failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		outAllocation.pHeap = heapBlocks[uHeapIndex]->pHeap.Get();
+		outAllocation.uOffset = range.uOffset;
+		outAllocation.uSize = range.uSize;
+		outAllocation.uCategoryIndex = uCategoryIndex;
+		outAllocation.uHeapIndex = uHeapIndex;
+		outAllocation.Range = range;
+
+		return hr;
+	}
+
+	HRESULT EsramAllocator::createHeapBlock(uint32_t& uOutHeapIndex, eHeapCategory category, UINT64 uSize, BOOL bIsDedicated) noexcept
+	{
+		HRESULT hr = S_OK;
+		uOutHeapIndex = INVALID_HEAP_INDEX;
+
+		// MSAA render targets need the larger alignment, which also covers every other placement
+		const UINT64 uAlignment = category == eHeapCategory::RenderTargetTextures ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		const UINT64 uHeapSize = (uSize + uAlignment - 1) & ~(uAlignment - 1);
+
+		std::unique_ptr<HeapBlock> pHeapBlock = std::make_unique<HeapBlock>();
+		pHeapBlock->bIsDedicated = bIsDedicated;
+
+		CD3DX12_HEAP_DESC heapDesc(uHeapSize, D3D12_HEAP_TYPE_DEFAULT, uAlignment, HEAP_CATEGORY_FLAGS[static_cast<size_t>(category)]);
+
+		hr = m_pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeapBlock->pHeap));
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Creating heap of %llu bytes failed with HRESULT code %u, %s", uHeapSize, hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+#ifdef _DEBUG
+		pHeapBlock->pHeap->SetName(bIsDedicated ? L"Esram Dedicated Heap" : L"Esram Heap Block");
+#endif
+
+		hr = pHeapBlock->Allocator.Initialize(uHeapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing heap block allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		std::vector<std::unique_ptr<HeapBlock>>& heapBlocks = m_aHeapBlocks[static_cast<size_t>(category)];
+		for (size_t i = 0; i < heapBlocks.size(); ++i)
+		{
+			if (!heapBlocks[i])
+			{
+				heapBlocks[i] = std::move(pHeapBlock);
+				uOutHeapIndex = static_cast<uint32_t>(i);
+
+				return hr;
+			}
+		}
+
+		heapBlocks.push_back(std::move(pHeapBlock));
+		uOutHeapIndex = static_cast<uint32_t>(heapBlocks.size() - 1);
+
+		return hr;
+	}
+
+	void EsramAllocator::freeRange(const EsramAllocation& allocation) noexcept
+	{
+		std::unique_ptr<HeapBlock>& pHeapBlock = m_aHeapBlocks[allocation.uCategoryIndex][allocation.uHeapIndex];
+		assert(pHeapBlock && pHeapBlock->pHeap.Get() == allocation.pHeap);
+
+		pHeapBlock->Allocator.Free(allocation.Range);
+
+		// Shared blocks are kept for the next textures, dedicated heaps only ever hold one resource
+		if (pHeapBlock->bIsDedicated)
+		{
+			pHeapBlock.reset();
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Pch.h"
+
+#include "Renderer/TlsfAllocator.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+
+	struct EsramAllocation
+	{
+		ID3D12Heap* pHeap;
+		UINT64 uOffset;
+		UINT64 uSize;
+		uint32_t uCategoryIndex;
+		uint32_t uHeapIndex;
+		TlsfAllocation Range;
+	};
+
+	struct EsramAllocatorStatistics
+	{
+		UINT64 uNumHeaps;
+		UINT64 uHeapBytes;
+		UINT64 uAllocatedBytes;
+		UINT64 uNumAllocations;
+		UINT64 uNumPendingFrees;
+		UINT64 uLargestFreeBlockSize;
+
+		// Of the free space in all heaps, see TlsfAllocatorStatistics
+		FLOAT Fragmentation;
+	};
+
+	// Hands out placed resources sub-allocated from large ID3D12Heap blocks instead of one committed
+	// resource per texture.  Heaps are split by resource category so that tier 1 hardware is supported,
+	// each one is managed by a TlsfAllocator.  Resources larger than a block get a heap of their own.
+	// The range of a freed allocation is only reused once every queue is past the work submitted before
+	// the Free call.
+	class EsramAllocator final
+	{
+	public:
+		static constexpr const UINT64 DEFAULT_HEAP_BLOCK_SIZE = 0x4000000;	// 64MB
+
+	public:
+		explicit EsramAllocator() noexcept;
+		EsramAllocator(const EsramAllocator& other) = delete;
+		EsramAllocator(EsramAllocator&& other) = delete;
+		EsramAllocator& operator=(const EsramAllocator& other) = delete;
+		EsramAllocator& operator=(EsramAllocator&& other) = delete;
+		~EsramAllocator() noexcept = default;
+
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ CommandListManager& commandListManager) noexcept;
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ CommandListManager& commandListManager, _In_ UINT64 uHeapBlockSize) noexcept;
+
+		// Every placed resource must already be released and the GPU idle
+		void Destroy() noexcept;
+
+		HRESULT CreatePlacedResource(_Out_ EsramAllocation& outAllocation, _Out_ ID3D12Resource** ppOutResource, _In_ const D3D12_RESOURCE_DESC& resourceDesc,
+			_In_ D3D12_RESOURCE_STATES initialState, _In_opt_ const D3D12_CLEAR_VALUE* pClearValue) noexcept;
+
+		// The resource placed in the allocation has to be released by the caller
+		void Free(_In_ const EsramAllocation& allocation) noexcept;
+
+		// Called from CreatePlacedResource as well, so ranges come back even if nobody calls this
+		void ReleaseCompletedAllocations() noexcept;
+
+		void GetStatistics(_Out_ EsramAllocatorStatistics& outStatistics) noexcept;
+
+	private:
+		static constexpr const size_t NUM_QUEUES = 3u;
+		static constexpr const uint32_t INVALID_HEAP_INDEX = UINT32_MAX;
+
+		enum class eHeapCategory : uint32_t
+		{
+			Buffers,
+			RenderTargetTextures,
+			OtherTextures,
+			COUNT,
+		};
+
+		struct HeapBlock
+		{
+			ComPtr<ID3D12Heap> pHeap;
+			TlsfAllocator Allocator;
+			BOOL bIsDedicated;
+		};
+
+		struct PendingFree
+		{
+			UINT64 auFenceValues[NUM_QUEUES];
+			EsramAllocation Allocation;
+		};
+
+	private:
+		static eHeapCategory getHeapCategory(_In_ const D3D12_RESOURCE_DESC& resourceDesc) noexcept;
+
+		HRESULT allocate(_Out_ EsramAllocation& outAllocation, _In_ eHeapCategory category, _In_ const D3D12_RESOURCE_ALLOCATION_INFO& allocationInfo) noexcept;
+		HRESULT createHeapBlock(_Out_ uint32_t& uOutHeapIndex, _In_ eHeapCategory category, _In_ UINT64 uSize, _In_ BOOL bIsDedicated) noexcept;
+		void freeRange(_In_ const EsramAllocation& allocation) noexcept;
+
+	private:
+		ComPtr<ID3D12Device> m_pDevice;
+		CommandListManager* m_pCommandListManager;
+		UINT64 m_uHeapBlockSize;
+		std::mutex m_AllocationMutex;
+
+		// Slots of destroyed dedicated heaps are left null and reused
+		std::vector<std::unique_ptr<HeapBlock>> m_aHeapBlocks[static_cast<size_t>(eHeapCategory::COUNT)];
+		std::deque<PendingFree> m_PendingFrees;
+	};
+}
@@ -0,0 +1,332 @@
+#include "Pch.h"
+#include "Renderer/FrameController.h"
+
+#include "Renderer/CommandListManager.h"
+
+namespace esperanza
+{
+	static constexpr const D3D12_COMMAND_LIST_TYPE QUEUE_TYPES[] =
+	{
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		D3D12_COMMAND_LIST_TYPE_COMPUTE,
+		D3D12_COMMAND_LIST_TYPE_COPY,
+	};
+
+	FrameController::FrameController() noexcept
+		: m_pCommandListManager()
+		, m_aFrameSlots()
+		, m_uNumFramesInFlight(MIN_FRAMES_IN_FLIGHT)
+		, m_uFrameIndex(0)
+		, m_uFrameNumber(0)
+		, m_bIsInFrame(FALSE)
+		, m_TickFrequency()
+		, m_uNumCpuStalls(0)
+		, m_uNumRetiredFrames(0)
+		, m_LastFrameLatency(0.0f)
+		, m_TotalFrameLatency(0.0f)
+		, m_LastCpuStallTime(0.0f)
+		, m_TotalCpuStallTime(0.0f)
+	{
+	}
+
+	HRESULT FrameController::Initialize(std::shared_ptr<CommandListManager>& pCommandListManager, UINT uNumFramesInFlight) noexcept
+	{
+		if (!pCommandListManager)
+		{
+			GLOGE(L"Command list manager is null!");
+
+			return E_FAIL;
+		}
+
+		if (uNumFramesInFlight < MIN_FRAMES_IN_FLIGHT || uNumFramesInFlight > MAX_FRAMES_IN_FLIGHT)
+		{
+			GLOGEF(L"Frames in flight must be between %u and %u, got %u", MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT, uNumFramesInFlight);
+
+			return E_INVALIDARG;
+		}
+
+		m_pCommandListManager = pCommandListManager;
+		m_uNumFramesInFlight = uNumFramesInFlight;
+		m_uFrameIndex = 0;
+		m_uFrameNumber = 0;
+		m_bIsInFrame = FALSE;
+
+		for (FrameSlot& slot : m_aFrameSlots)
+		{
+			slot = {};
+		}
+
+		QueryPerformanceFrequency(&m_TickFrequency);
+
+		return S_OK;
+	}
+
+	void FrameController::Destroy() noexcept
+	{
+		if (!m_pCommandListManager)
+		{
+			return;
+		}
+
+		WaitForAllFrames();
+		m_pCommandListManager.reset();
+	}
+
+	HRESULT FrameController::BeginFrame() noexcept
+	{
+		HRESULT hr = S_OK;
+
+		if (m_bIsInFrame)
+		{
+			GLOGE(L"BeginFrame called twice without EndFrame");
+
+			return E_FAIL;
+		}
+
+		// Retiring frames as soon as they are seen complete keeps the latency metric close to the real one
+		for (UINT i = 0; i < m_uNumFramesInFlight; ++i)
+		{
+			if (m_aFrameSlots[i].bIsInFlight && isFrameComplete(m_aFrameSlots[i]))
+			{
+				retireFrame(m_aFrameSlots[i]);
+			}
+		}
+
+		m_pCommandListManager->GetDeferredReleaseQueue().ReleaseCompletedObjects();
+
+		m_uFrameIndex = static_cast<UINT>(m_uFrameNumber % m_uNumFramesInFlight);
+
+		FrameSlot& slot = m_aFrameSlots[m_uFrameIndex];
+		if (slot.bIsInFlight)
+		{
+			// The CPU is N frames ahead, this is the only place it waits for the GPU
+			LARGE_INTEGER stallStartTick;
+			QueryPerformanceCounter(&stallStartTick);
+
+			hr = waitForFrame(slot);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Waiting for frame failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			m_LastCpuStallTime = getElapsedMilliseconds(stallStartTick);
+			m_TotalCpuStallTime += m_LastCpuStallTime;
+			++m_uNumCpuStalls;
+		}
+		else
+		{
+			m_LastCpuStallTime = 0.0f;
+		}
+
+		m_bIsInFrame = TRUE;
+
+		return hr;
+	}
+
+	HRESULT FrameController::EndFrame() noexcept
+	{
+		HRESULT hr = S_OK;
+
+		if (!m_bIsInFrame)
+		{
+			GLOGE(L"EndFrame called without BeginFrame");
+
+			return E_FAIL;
+		}
+
+		// Incrementing a fence also flushes the pending batch of its queue, so no list outlives its frame
+		FrameSlot& slot = m_aFrameSlots[m_uFrameIndex];
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			hr = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).IncrementFence(slot.auFenceValues[i]);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Incrementing Fence failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		QueryPerformanceCounter(&slot.SubmitTick);
+		slot.bIsInFlight = TRUE;
+
+		++m_uFrameNumber;
+		m_bIsInFrame = FALSE;
+
+		return hr;
+	}
+
+	HRESULT FrameController::WaitForAllFrames() noexcept
+	{
+		HRESULT hr = S_OK;
+
+		for (FrameSlot& slot : m_aFrameSlots)
+		{
+			if (!slot.bIsInFlight)
+			{
+				continue;
+			}
+
+			hr = waitForFrame(slot);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Waiting for frame failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		return hr;
+	}
+
+	HRESULT FrameController::WaitForIdle() noexcept
+	{
+		HRESULT hr = S_OK;
+
+		hr = WaitForAllFrames();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Waiting for all frames failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		if (!m_bIsInFrame)
+		{
+			return hr;
+		}
+
+		// The open frame gets its fence values only at EndFrame, so every queue is signaled now instead.
+		// Incrementing a fence also flushes the pending batch of its queue.
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			CommandQueue& queue = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]);
+
+			UINT64 uFenceValue = 0;
+			hr = queue.IncrementFence(uFenceValue);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Incrementing Fence failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			hr = queue.WaitForFence(uFenceValue);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Waiting for fence failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		return hr;
+	}
+
+	HRESULT FrameController::SetNumFramesInFlight(UINT uNumFramesInFlight) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		if (uNumFramesInFlight < MIN_FRAMES_IN_FLIGHT || uNumFramesInFlight > MAX_FRAMES_IN_FLIGHT)
+		{
+			GLOGEF(L"Frames in flight must be between %u and %u, got %u", MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT, uNumFramesInFlight);
+
+			return E_INVALIDARG;
+		}
+
+		if (uNumFramesInFlight == m_uNumFramesInFlight)
+		{
+			return hr;
+		}
+
+		// Slot indices change with the frame count, so nothing may be in flight
+		hr = WaitForAllFrames();
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Waiting for all frames failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		m_uNumFramesInFlight = uNumFramesInFlight;
+		m_uFrameIndex = static_cast<UINT>(m_uFrameNumber % m_uNumFramesInFlight);
+
+		return hr;
+	}
+
+	void FrameController::GetStatistics(FrameStatistics& outStatistics) const noexcept
+	{
+		outStatistics.uNumFrames = m_uFrameNumber;
+		outStatistics.uNumCpuStalls = m_uNumCpuStalls;
+		outStatistics.uNumFramesInFlight = 0;
+		for (const FrameSlot& slot : m_aFrameSlots)
+		{
+			outStatistics.uNumFramesInFlight += slot.bIsInFlight ? 1u : 0u;
+		}
+
+		outStatistics.LastFrameLatency = m_LastFrameLatency;
+		outStatistics.AverageFrameLatency = m_uNumRetiredFrames > 0 ? m_TotalFrameLatency / static_cast<FLOAT>(m_uNumRetiredFrames) : 0.0f;
+		outStatistics.LastCpuStallTime = m_LastCpuStallTime;
+		outStatistics.TotalCpuStallTime = m_TotalCpuStallTime;
+	}
+
+	BOOL FrameController::isFrameComplete(const FrameSlot& slot) noexcept
+	{
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			if (!m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).IsFenceComplete(slot.auFenceValues[i]))
+			{
+				return FALSE;
+			}
+		}
+
+		return TRUE;
+	}
+
+	HRESULT FrameController::waitForFrame(FrameSlot& slot) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			hr = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).WaitForFence(slot.auFenceValues[i]);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Waiting for fence failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		retireFrame(slot);
+
+		return hr;
+	}
+
+	void FrameController::retireFrame(FrameSlot& slot) noexcept
+	{
+		m_LastFrameLatency = getElapsedMilliseconds(slot.SubmitTick);
+		m_TotalFrameLatency += m_LastFrameLatency;
+		++m_uNumRetiredFrames;
+
+		slot.bIsInFlight = FALSE;
+	}
+
+	FLOAT FrameController::getElapsedMilliseconds(LARGE_INTEGER startTick) const noexcept
+	{
+		LARGE_INTEGER currentTick;
+		QueryPerformanceCounter(&currentTick);
+
+		return static_cast<FLOAT>(currentTick.QuadPart - startTick.QuadPart) * 1000.0f / static_cast<FLOAT>(m_TickFrequency.QuadPart);
+	}
+}
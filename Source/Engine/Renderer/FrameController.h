@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+
+	struct FrameStatistics
+	{
+		UINT64 uNumFrames;
+		UINT64 uNumCpuStalls;
+		UINT uNumFramesInFlight;
+
+		// Time from the end of CPU submission of a frame until the CPU observed its completion on the GPU
+		FLOAT LastFrameLatency;
+		FLOAT AverageFrameLatency;
+
+		// Time BeginFrame spent blocked on the GPU
+		FLOAT LastCpuStallTime;
+		FLOAT TotalCpuStallTime;
+	};
+
+	// Lets the CPU run up to N frames ahead of the GPU.  Every frame slot remembers the fence values of all
+	// queues at the end of its frame, BeginFrame only blocks when the slot it is about to reuse is still
+	// in flight.  Per-frame resources are indexed by GetFrameIndex.
+	class FrameController final
+	{
+	public:
+		static constexpr const UINT MIN_FRAMES_IN_FLIGHT = 2u;
+		static constexpr const UINT MAX_FRAMES_IN_FLIGHT = 3u;
+
+	public:
+		explicit FrameController() noexcept;
+		FrameController(const FrameController& other) = delete;
+		FrameController(FrameController&& other) = delete;
+		FrameController& operator=(const FrameController& other) = delete;
+		FrameController& operator=(FrameController&& other) = delete;
+		~FrameController() noexcept = default;
+
+		HRESULT Initialize(_In_ std::shared_ptr<CommandListManager>& pCommandListManager, _In_ UINT uNumFramesInFlight) noexcept;
+		void Destroy() noexcept;
+
+		HRESULT BeginFrame() noexcept;
+		HRESULT EndFrame() noexcept;
+
+		// Blocks until every submitted frame is done, without touching work outside of frames
+		HRESULT WaitForAllFrames() noexcept;
+
+		// Blocks until every submitted frame and the work submitted so far for the open frame are done, the
+		// frame stays open.  Needed before releasing anything the open frame may already reference.
+		HRESULT WaitForIdle() noexcept;
+		HRESULT SetNumFramesInFlight(_In_ UINT uNumFramesInFlight) noexcept;
+
+		constexpr UINT GetFrameIndex() const noexcept;
+		constexpr UINT GetNumFramesInFlight() const noexcept;
+		constexpr UINT64 GetFrameNumber() const noexcept;
+		void GetStatistics(_Out_ FrameStatistics& outStatistics) const noexcept;
+
+	private:
+		static constexpr const size_t NUM_QUEUES = 3u;
+
+		struct FrameSlot
+		{
+			UINT64 auFenceValues[NUM_QUEUES];
+			LARGE_INTEGER SubmitTick;
+			BOOL bIsInFlight;
+		};
+
+	private:
+		BOOL isFrameComplete(_In_ const FrameSlot& slot) noexcept;
+		HRESULT waitForFrame(_Inout_ FrameSlot& slot) noexcept;
+		void retireFrame(_Inout_ FrameSlot& slot) noexcept;
+		FLOAT getElapsedMilliseconds(_In_ LARGE_INTEGER startTick) const noexcept;
+
+	private:
+		std::shared_ptr<CommandListManager> m_pCommandListManager;
+		FrameSlot m_aFrameSlots[MAX_FRAMES_IN_FLIGHT];
+		UINT m_uNumFramesInFlight;
+		UINT m_uFrameIndex;
+		UINT64 m_uFrameNumber;
+		BOOL m_bIsInFrame;
+		LARGE_INTEGER m_TickFrequency;
+
+		UINT64 m_uNumCpuStalls;
+		UINT64 m_uNumRetiredFrames;
+		FLOAT m_LastFrameLatency;
+		FLOAT m_TotalFrameLatency;
+		FLOAT m_LastCpuStallTime;
+		FLOAT m_TotalCpuStallTime;
+	};
+
+	inline constexpr UINT FrameController::GetFrameIndex() const noexcept
+	{
+		return m_uFrameIndex;
+	}
+
+	inline constexpr UINT FrameController::GetNumFramesInFlight() const noexcept
+	{
+		return m_uNumFramesInFlight;
+	}
+
+	inline constexpr UINT64 FrameController::GetFrameNumber() const noexcept
+	{
+		return m_uFrameNumber;
+	}
+}
@@ -1,6 +1,8 @@
 #include "Pch.h"
 #include "GpuResource.h"
 
+#include "Renderer/DeferredReleaseQueue.h"
+
 namespace esperanza
 {
 	GpuResource::GpuResource() noexcept
@@ -28,6 +30,13 @@ namespace esperanza
 		++m_uVersionId;
 	}
 
+	void GpuResource::DestroyDeferred(DeferredReleaseQueue& releaseQueue) noexcept
+	{
+		releaseQueue.ReleaseObject(m_pResource);
+
+		Destroy();
+	}
+
 	ID3D12Resource* GpuResource::operator->() noexcept
 	{
 		return m_pResource.Get();
@@ -52,14 +61,4 @@ namespace esperanza
 	{
 		return m_pResource.GetAddressOf();
 	}
-
-	constexpr D3D12_GPU_VIRTUAL_ADDRESS GpuResource::GetGpuVirtualAddress() const noexcept
-	{
-		return m_GpuVirtualAddress;
-	}
-
-	constexpr UINT GpuResource::GetVersionId() const noexcept
-	{
-		return m_uVersionId;
-	}
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 
 namespace esperanza
 {
+	class DeferredReleaseQueue;
+
 	class GpuResource
 	{
 		friend class CommandContext;
@@ -21,6 +23,9 @@ namespace esperanza
 
 		virtual void Destroy() noexcept;
 
+		// Hands the resource to the release queue instead of freeing it while the GPU may still use it
+		void DestroyDeferred(_In_ DeferredReleaseQueue& releaseQueue) noexcept;
+
 		ID3D12Resource* operator->() noexcept;
 		const ID3D12Resource* operator->() const noexcept;
 
@@ -30,6 +35,9 @@ namespace esperanza
 		constexpr D3D12_GPU_VIRTUAL_ADDRESS GetGpuVirtualAddress() const noexcept;
 		constexpr UINT GetVersionId() const noexcept;
 
+		// State the resource is in once every submitted list has executed
+		constexpr D3D12_RESOURCE_STATES GetUsageState() const noexcept;
+
 	protected:
 		ComPtr<ID3D12Resource> m_pResource;
 		D3D12_RESOURCE_STATES m_UsageState;
@@ -39,4 +47,19 @@ namespace esperanza
 		// Used to identify when a resource changes so descriptors can be copied etc.
 		UINT m_uVersionId;
 	};
+
+	inline constexpr D3D12_GPU_VIRTUAL_ADDRESS GpuResource::GetGpuVirtualAddress() const noexcept
+	{
+		return m_GpuVirtualAddress;
+	}
+
+	inline constexpr UINT GpuResource::GetVersionId() const noexcept
+	{
+		return m_uVersionId;
+	}
+
+	inline constexpr D3D12_RESOURCE_STATES GpuResource::GetUsageState() const noexcept
+	{
+		return m_UsageState;
+	}
 }
\ No newline at end of file
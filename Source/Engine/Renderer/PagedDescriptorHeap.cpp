@@ -0,0 +1,246 @@
+#include "Pch.h"
+
+#include "Renderer/PagedDescriptorHeap.h"
+
+namespace esperanza
+{
+	PagedDescriptorHeap::PagedDescriptorHeap() noexcept
+		: m_pDevice()
+		, m_strDebugHeapName()
+		, m_Type(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+		, m_uNextPageSize(0)
+		, m_Pages()
+	{
+	}
+
+	HRESULT PagedDescriptorHeap::Initialize(ID3D12Device* pDevice, const std::wstring& strDebugHeapName, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t uFirstPageSize) noexcept
+	{
+		if (!pDevice)
+		{
+			GLOGE(L"Device is null!");
+
+			return E_FAIL;
+		}
+
+		// Every page is shader visible, which render target and depth stencil heaps cannot be
+		if (type == D3D12_DESCRIPTOR_HEAP_TYPE_RTV || type == D3D12_DESCRIPTOR_HEAP_TYPE_DSV)
+		{
+			GLOGE(L"A paged descriptor heap can only hold CBV/SRV/UAV or sampler descriptors");
+
+			return E_INVALIDARG;
+		}
+
+		if (uFirstPageSize == 0)
+		{
+			GLOGE(L"The first page of a paged descriptor heap cannot be empty");
+
+			return E_INVALIDARG;
+		}
+
+		m_pDevice = pDevice;
+		m_strDebugHeapName = strDebugHeapName;
+		m_Type = type;
+		m_uNextPageSize = uFirstPageSize;
+
+		return addPage(uFirstPageSize);
+	}
+
+	void PagedDescriptorHeap::Destroy() noexcept
+	{
+		for (Page& page : m_Pages)
+		{
+			page.pHeap->Destroy();
+		}
+
+		m_Pages.clear();
+		m_pDevice.Reset();
+	}
+
+	HRESULT PagedDescriptorHeap::Alloc(PagedDescriptorHandle& outHandle, uint32_t uCount) noexcept
+	{
+		HRESULT hr = S_OK;
+		outHandle = PagedDescriptorHandle();
+
+		if (uCount == 0)
+		{
+			return E_INVALIDARG;
+		}
+
+		// Best fit across every page that still has enough descriptors in total
+		uint32_t uBestPageIndex = UINT32_MAX;
+		size_t uBestRangeIndex = 0;
+		uint32_t uBestRangeCount = UINT32_MAX;
+		for (uint32_t uPageIndex = 0; uPageIndex < static_cast<uint32_t>(m_Pages.size()); ++uPageIndex)
+		{
+			const Page& page = m_Pages[uPageIndex];
+			if (page.uNumFreeDescriptors < uCount)
+			{
+				continue;
+			}
+
+			for (size_t i = 0; i < page.FreeRanges.size(); ++i)
+			{
+				const FreeRange& range = page.FreeRanges[i];
+				if (range.uCount >= uCount && range.uCount < uBestRangeCount)
+				{
+					uBestPageIndex = uPageIndex;
+					uBestRangeIndex = i;
+					uBestRangeCount = range.uCount;
+				}
+			}
+
+			if (uBestRangeCount == uCount)
+			{
+				break;
+			}
+		}
+
+		if (uBestPageIndex == UINT32_MAX)
+		{
+			hr = addPage(uCount);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Adding Descriptor Heap Page failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			uBestPageIndex = static_cast<uint32_t>(m_Pages.size() - 1);
+			uBestRangeIndex = 0;
+		}
+
+		Page& page = m_Pages[uBestPageIndex];
+		FreeRange& range = page.FreeRanges[uBestRangeIndex];
+
+		outHandle.Handle = (*page.pHeap)[range.uOffset];
+		outHandle.uPageIndex = uBestPageIndex;
+		outHandle.uOffset = range.uOffset;
+		outHandle.uCount = uCount;
+
+		range.uOffset += uCount;
+		range.uCount -= uCount;
+		if (range.uCount == 0)
+		{
+			page.FreeRanges.erase(page.FreeRanges.begin() + uBestRangeIndex);
+		}
+		page.uNumFreeDescriptors -= uCount;
+
+		return hr;
+	}
+
+	HRESULT PagedDescriptorHeap::Free(const PagedDescriptorHandle& handle) noexcept
+	{
+		if (handle.uPageIndex >= m_Pages.size() || handle.uCount == 0 ||
+			handle.uOffset + handle.uCount > m_Pages[handle.uPageIndex].pHeap->GetNumDescriptors())
+		{
+			GLOGE(L"Freeing a descriptor range that does not belong to this heap");
+
+			return E_INVALIDARG;
+		}
+
+		Page& page = m_Pages[handle.uPageIndex];
+		auto next = std::lower_bound(page.FreeRanges.begin(), page.FreeRanges.end(), handle.uOffset,
+			[](const FreeRange& range, uint32_t uOffset)
+			{
+				return range.uOffset < uOffset;
+			});
+
+		// Overlapping a free neighbour means the range was already freed
+		if ((next != page.FreeRanges.end() && handle.uOffset + handle.uCount > next->uOffset) ||
+			(next != page.FreeRanges.begin() && std::prev(next)->uOffset + std::prev(next)->uCount > handle.uOffset))
+		{
+			GLOGE(L"Freeing a descriptor range that is already free");
+
+			return E_INVALIDARG;
+		}
+
+		const BOOL bMergesWithPrevious = next != page.FreeRanges.begin() && std::prev(next)->uOffset + std::prev(next)->uCount == handle.uOffset;
+		const BOOL bMergesWithNext = next != page.FreeRanges.end() && handle.uOffset + handle.uCount == next->uOffset;
+
+		if (bMergesWithPrevious && bMergesWithNext)
+		{
+			std::prev(next)->uCount += handle.uCount + next->uCount;
+			page.FreeRanges.erase(next);
+		}
+		else if (bMergesWithPrevious)
+		{
+			std::prev(next)->uCount += handle.uCount;
+		}
+		else if (bMergesWithNext)
+		{
+			next->uOffset = handle.uOffset;
+			next->uCount += handle.uCount;
+		}
+		else
+		{
+			page.FreeRanges.insert(next, FreeRange{ handle.uOffset, handle.uCount });
+		}
+
+		page.uNumFreeDescriptors += handle.uCount;
+
+		return S_OK;
+	}
+
+	BOOL PagedDescriptorHeap::HasAvailableSpace(uint32_t uPageIndex, uint32_t uCount) const noexcept
+	{
+		if (uPageIndex >= m_Pages.size() || m_Pages[uPageIndex].uNumFreeDescriptors < uCount)
+		{
+			return FALSE;
+		}
+
+		for (const FreeRange& range : m_Pages[uPageIndex].FreeRanges)
+		{
+			if (range.uCount >= uCount)
+			{
+				return TRUE;
+			}
+		}
+
+		return FALSE;
+	}
+
+	uint32_t PagedDescriptorHeap::GetNumPages() const noexcept
+	{
+		return static_cast<uint32_t>(m_Pages.size());
+	}
+
+	const DescriptorHeap& PagedDescriptorHeap::GetPage(uint32_t uPageIndex) const noexcept
+	{
+		return *m_Pages[uPageIndex].pHeap;
+	}
+
+	HRESULT PagedDescriptorHeap::addPage(uint32_t uMinCount) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		uint32_t uPageSize = std::max(m_uNextPageSize, uMinCount);
+		if (m_Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
+		{
+			uPageSize = std::min(uPageSize, static_cast<uint32_t>(D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE));
+			if (uPageSize < uMinCount)
+			{
+				GLOGEF(L"Cannot allocate %u samplers, a shader-visible sampler heap holds at most %u", uMinCount, uPageSize);
+
+				return E_INVALIDARG;
+			}
+		}
+
+		std::unique_ptr<DescriptorHeap> pHeap = std::make_unique<DescriptorHeap>();
+		hr = pHeap->Initialize(m_pDevice.Get(), m_strDebugHeapName, m_Type, uPageSize);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing Descriptor Heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		m_Pages.push_back(Page{ std::move(pHeap), { FreeRange{ 0, uPageSize } }, uPageSize });
+		m_uNextPageSize = uPageSize * 2;
+
+		GLOGIF(L"Added a descriptor heap page of %u descriptors, %u pages in use", uPageSize, static_cast<uint32_t>(m_Pages.size()));
+
+		return hr;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Pch.h"
+#include "Renderer/DescriptorHeap.h"
+
+namespace esperanza
+{
+	// A range of descriptors in one page of a PagedDescriptorHeap
+	struct PagedDescriptorHandle
+	{
+		DescriptorHandle Handle;
+		uint32_t uPageIndex = UINT32_MAX;
+		uint32_t uOffset = 0;
+		uint32_t uCount = 0;
+	};
+
+	// A shader-visible descriptor heap that starts small and chains another page when no page has a free
+	// contiguous range large enough, each page twice the size of the previous one.  Ranges are taken from
+	// the smallest free range that fits across all pages and freed ranges are merged with their neighbours.
+	// Only CBV/SRV/UAV and sampler heaps can be shader visible, so those are the only types it takes.
+	class PagedDescriptorHeap final
+	{
+	public:
+		explicit PagedDescriptorHeap() noexcept;
+		PagedDescriptorHeap(const PagedDescriptorHeap& other) = delete;
+		PagedDescriptorHeap(PagedDescriptorHeap&& other) = delete;
+		PagedDescriptorHeap& operator=(const PagedDescriptorHeap& other) = delete;
+		PagedDescriptorHeap& operator=(PagedDescriptorHeap&& other) = delete;
+		~PagedDescriptorHeap() noexcept = default;
+
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ const std::wstring& strDebugHeapName, _In_ D3D12_DESCRIPTOR_HEAP_TYPE type, _In_ uint32_t uFirstPageSize) noexcept;
+		void Destroy() noexcept;
+
+		HRESULT Alloc(_Out_ PagedDescriptorHandle& outHandle, _In_ uint32_t uCount) noexcept;
+		HRESULT Free(_In_ const PagedDescriptorHandle& handle) noexcept;
+
+		// Whether the page has a contiguous free range of at least uCount descriptors
+		BOOL HasAvailableSpace(_In_ uint32_t uPageIndex, _In_ uint32_t uCount) const noexcept;
+
+		uint32_t GetNumPages() const noexcept;
+		const DescriptorHeap& GetPage(_In_ uint32_t uPageIndex) const noexcept;
+
+	private:
+		struct FreeRange
+		{
+			uint32_t uOffset;
+			uint32_t uCount;
+		};
+
+		struct Page
+		{
+			std::unique_ptr<DescriptorHeap> pHeap;
+			std::vector<FreeRange> FreeRanges;  // sorted by offset
+			uint32_t uNumFreeDescriptors;
+		};
+
+	private:
+		HRESULT addPage(_In_ uint32_t uMinCount) noexcept;
+
+	private:
+		ComPtr<ID3D12Device> m_pDevice;
+		std::wstring m_strDebugHeapName;
+		D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
+		uint32_t m_uNextPageSize;
+		std::vector<Page> m_Pages;
+	};
+}
@@ -11,9 +11,23 @@ namespace esperanza
         , m_uHeight(0)
         , m_uArraySize(0)
         , m_Format(DXGI_FORMAT_UNKNOWN)
+        , m_pEsramAllocator(nullptr)
+        , m_EsramAllocation()
     {
     }
 
+    void PixelBuffer::Destroy() noexcept
+    {
+        if (m_pEsramAllocator)
+        {
+            m_pEsramAllocator->Free(m_EsramAllocation);
+            m_pEsramAllocator = nullptr;
+            m_EsramAllocation = EsramAllocation();
+        }
+
+        GpuResource::Destroy();
+    }
+
     constexpr UINT PixelBuffer::GetWidth() const noexcept
     {
         return m_uWidth;
@@ -533,12 +547,12 @@ namespace esperanza
         return hr;
     }
 
-    HRESULT PixelBuffer::createTextureResource(ID3D12Device* pDevice, const std::wstring& strName, const D3D12_RESOURCE_DESC& resourceDesc, D3D12_CLEAR_VALUE clearValue) noexcept
+    HRESULT PixelBuffer::initializeTextureResource(ID3D12Device* pDevice, const std::wstring& strName, const D3D12_RESOURCE_DESC& resourceDesc, D3D12_CLEAR_VALUE clearValue) noexcept
     {
-        return createTextureResource(pDevice, strName, resourceDesc, clearValue, D3D12_GPU_VIRTUAL_ADDRESS_NULL);
+        return initializeTextureResource(pDevice, strName, resourceDesc, clearValue, D3D12_GPU_VIRTUAL_ADDRESS_NULL);
     }
 
-    HRESULT PixelBuffer::createTextureResource(ID3D12Device* pDevice, const std::wstring& strName, const D3D12_RESOURCE_DESC& resourceDesc, D3D12_CLEAR_VALUE clearValue, D3D12_GPU_VIRTUAL_ADDRESS vidMemPtr) noexcept
+    HRESULT PixelBuffer::initializeTextureResource(ID3D12Device* pDevice, const std::wstring& strName, const D3D12_RESOURCE_DESC& resourceDesc, D3D12_CLEAR_VALUE clearValue, D3D12_GPU_VIRTUAL_ADDRESS vidMemPtr) noexcept
     {
         HRESULT hr = S_OK;
         Destroy();
@@ -570,14 +584,35 @@ namespace esperanza
         return hr;
     }
 
-    HRESULT PixelBuffer::createTextureResource(ID3D12Device* pDevice, const std::wstring& strName, const D3D12_RESOURCE_DESC& resourceDesc, D3D12_CLEAR_VALUE clearValue, EsramAllocator& allocator) noexcept
+    HRESULT PixelBuffer::initializeTextureResource(ID3D12Device* pDevice, const std::wstring& strName, const D3D12_RESOURCE_DESC& resourceDesc, D3D12_CLEAR_VALUE clearValue, EsramAllocator& allocator) noexcept
     {
         HRESULT hr = S_OK;
+        Destroy();
+
+        UNREFERENCED_PARAMETER(pDevice);
 
-        UNREFERENCED_PARAMETER(allocator);
+        // Clear values are only allowed on render targets and depth stencils
+        const BOOL bHasClearValue = (resourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+
+        hr = allocator.CreatePlacedResource(m_EsramAllocation, m_pResource.ReleaseAndGetAddressOf(), resourceDesc, D3D12_RESOURCE_STATE_COMMON, bHasClearValue ? &clearValue : nullptr);
+        if (FAILED(hr))
+        {
+            _com_error err(hr);
+            GLOGEF(L"Creating Placed Resource failed with HRESULT code %u, %s", hr, err.ErrorMessage());
 
-        createTextureResource(pDevice, strName, resourceDesc, clearValue);
+            return hr;
+        }
+
+        m_pEsramAllocator = &allocator;
+        m_UsageState = D3D12_RESOURCE_STATE_COMMON;
+        m_GpuVirtualAddress = D3D12_GPU_VIRTUAL_ADDRESS_NULL;
+
+#ifdef _DEBUG
+        m_pResource->SetName(strName.c_str());
+#else
+        UNREFERENCED_PARAMETER(strName);
+#endif
 
         return hr;
     }
-}
\ No newline at end of file
+}
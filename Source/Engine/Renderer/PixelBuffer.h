@@ -1,16 +1,19 @@
 #pragma once
 
+#include "Renderer/EsramAllocator.h"
 #include "Renderer/GpuResource.h"
 
 namespace esperanza
 {
-	class EsramAllocator;
 
 	class PixelBuffer : public GpuResource
 	{
 	public:
 		explicit PixelBuffer() noexcept;
 
+		// Also returns placed memory to the allocator it came from
+		void Destroy() noexcept override;
+
 		constexpr UINT GetWidth() const noexcept;
 		constexpr UINT GetHeight() const noexcept;
 		constexpr UINT GetDepth() const noexcept;
@@ -38,5 +41,7 @@ namespace esperanza
 		UINT m_uHeight;
 		UINT m_uArraySize;
 		DXGI_FORMAT m_Format;
+		EsramAllocator* m_pEsramAllocator;
+		EsramAllocation m_EsramAllocation;
 	};
 }
\ No newline at end of file
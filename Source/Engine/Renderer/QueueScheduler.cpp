@@ -0,0 +1,289 @@
+#include "Pch.h"
+#include "Renderer/QueueScheduler.h"
+
+#include "Renderer/CommandContext.h"
+#include "Renderer/CommandListManager.h"
+
+namespace esperanza
+{
+	QueueScheduler::QueueScheduler() noexcept
+		: m_Jobs()
+		, m_Statistics()
+		, m_aKnownFences()
+	{
+	}
+
+	void QueueScheduler::Reset() noexcept
+	{
+		m_Jobs.clear();
+		m_Statistics = {};
+	}
+
+	HRESULT QueueScheduler::AddJob(uint32_t& uOutJobIndex, const std::wstring& strName, D3D12_COMMAND_LIST_TYPE type, PFN_QUEUE_JOB_RECORD pfnRecord, void* pContext) noexcept
+	{
+		return AddJob(uOutJobIndex, strName, type, pfnRecord, pContext, 1u);
+	}
+
+	HRESULT QueueScheduler::AddJob(uint32_t& uOutJobIndex, const std::wstring& strName, D3D12_COMMAND_LIST_TYPE type, PFN_QUEUE_JOB_RECORD pfnRecord, void* pContext, UINT64 uCostHint) noexcept
+	{
+		uOutJobIndex = INVALID_JOB_INDEX;
+
+		if (type != D3D12_COMMAND_LIST_TYPE_DIRECT && type != D3D12_COMMAND_LIST_TYPE_COMPUTE && type != D3D12_COMMAND_LIST_TYPE_COPY)
+		{
+			GLOGEF(L"Job %s has an unsupported command list type %d", strName.c_str(), type);
+
+			return E_INVALIDARG;
+		}
+
+		Job& newJob = m_Jobs.emplace_back();
+		newJob.strName = strName;
+		newJob.Type = type;
+		newJob.pfnRecord = pfnRecord;
+		newJob.pContext = pContext;
+		newJob.uCostHint = uCostHint;
+		newJob.Clock = {};
+		newJob.uFenceValue = 0;
+
+		uOutJobIndex = static_cast<uint32_t>(m_Jobs.size() - 1);
+
+		return S_OK;
+	}
+
+	HRESULT QueueScheduler::AddDependency(uint32_t uJobIndex, uint32_t uDependencyIndex) noexcept
+	{
+		// Only earlier jobs can be depended on, so submission order is always a valid order
+		if (uJobIndex >= m_Jobs.size() || uDependencyIndex >= uJobIndex)
+		{
+			GLOGEF(L"Job %u cannot depend on job %u", uJobIndex, uDependencyIndex);
+
+			return E_INVALIDARG;
+		}
+
+		m_Jobs[uJobIndex].Dependencies.push_back(uDependencyIndex);
+
+		return S_OK;
+	}
+
+	HRESULT QueueScheduler::Execute(ContextManager& contextManager, CommandListManager& commandListManager) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		for (Job& job : m_Jobs)
+		{
+			const size_t uQueueIndex = getQueueIndex(job.Type);
+
+			// The waits only have to be in the queue before the list is.  Inserting them before the context is
+			// begun leaves nothing that can fail between Begin and Finish, and Finish hands the context and its
+			// allocator back whether it succeeds or not.
+			hr = insertWaits(commandListManager, job);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Inserting waits for job %s failed with HRESULT code %u, %s", job.strName.c_str(), hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			CommandContext* pContext = nullptr;
+			hr = beginContext(&pContext, contextManager, job);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Beginning context for job %s failed with HRESULT code %u, %s", job.strName.c_str(), hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			if (job.pfnRecord)
+			{
+				job.pfnRecord(*pContext, job.pContext);
+			}
+
+			hr = pContext->Finish(job.uFenceValue);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Finishing job %s failed with HRESULT code %u, %s", job.strName.c_str(), hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			FenceClock& knownFences = m_aKnownFences[uQueueIndex];
+			knownFences[uQueueIndex] = job.uFenceValue;
+			job.Clock = knownFences;
+
+			switch (uQueueIndex)
+			{
+			case 0:
+				++m_Statistics.uNumGraphicsJobs;
+				break;
+			case 1:
+				++m_Statistics.uNumComputeJobs;
+				break;
+			default:
+				++m_Statistics.uNumCopyJobs;
+				break;
+			}
+		}
+
+		estimateOverlap();
+
+		return hr;
+	}
+
+	UINT64 QueueScheduler::GetJobFenceValue(uint32_t uJobIndex) const noexcept
+	{
+		assert(uJobIndex < m_Jobs.size());
+
+		return m_Jobs[uJobIndex].uFenceValue;
+	}
+
+	void QueueScheduler::GetStatistics(QueueSchedulerStatistics& outStatistics) const noexcept
+	{
+		outStatistics = m_Statistics;
+	}
+
+	HRESULT QueueScheduler::beginContext(CommandContext** ppOutContext, ContextManager& contextManager, const Job& job) noexcept
+	{
+		switch (job.Type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+		{
+			ComputeContext* pComputeContext = nullptr;
+			HRESULT hr = contextManager.BeginComputeContext(&pComputeContext, job.strName, TRUE);
+			*ppOutContext = pComputeContext;
+
+			return hr;
+		}
+		case D3D12_COMMAND_LIST_TYPE_COPY:
+			return contextManager.BeginCopyContext(ppOutContext, job.strName);
+		case D3D12_COMMAND_LIST_TYPE_DIRECT:
+			[[fallthrough]];
+		default:
+		{
+			GraphicsContext* pGraphicsContext = nullptr;
+			HRESULT hr = contextManager.BeginGraphicsContext(&pGraphicsContext, job.strName);
+			*ppOutContext = pGraphicsContext;
+
+			return hr;
+		}
+		}
+	}
+
+	HRESULT QueueScheduler::insertWaits(CommandListManager& commandListManager, const Job& job) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		const size_t uQueueIndex = getQueueIndex(job.Type);
+		FenceClock& knownFences = m_aKnownFences[uQueueIndex];
+
+		// Only the latest dependency on each producer queue matters
+		uint32_t auLatestDependencies[NUM_QUEUES] = { INVALID_JOB_INDEX, INVALID_JOB_INDEX, INVALID_JOB_INDEX };
+		for (uint32_t uDependencyIndex : job.Dependencies)
+		{
+			const Job& dependency = m_Jobs[uDependencyIndex];
+			const size_t uProducerIndex = getQueueIndex(dependency.Type);
+			if (uProducerIndex == uQueueIndex)
+			{
+				continue;
+			}
+
+			++m_Statistics.uNumCrossQueueDependencies;
+
+			uint32_t& uLatest = auLatestDependencies[uProducerIndex];
+			if (uLatest == INVALID_JOB_INDEX || m_Jobs[uLatest].uFenceValue < dependency.uFenceValue)
+			{
+				uLatest = uDependencyIndex;
+			}
+		}
+
+		// A wait is needed unless the queue is already past the fence, or another wait of this job already
+		// implies it because its producer waited for the fence first
+		BOOL abNeedsWait[NUM_QUEUES] = {};
+		for (size_t uProducerIndex = 0; uProducerIndex < NUM_QUEUES; ++uProducerIndex)
+		{
+			const uint32_t uLatest = auLatestDependencies[uProducerIndex];
+			abNeedsWait[uProducerIndex] = uLatest != INVALID_JOB_INDEX && knownFences[uProducerIndex] < m_Jobs[uLatest].uFenceValue;
+		}
+
+		for (size_t uProducerIndex = 0; uProducerIndex < NUM_QUEUES; ++uProducerIndex)
+		{
+			if (!abNeedsWait[uProducerIndex])
+			{
+				continue;
+			}
+
+			const UINT64 uRequiredFenceValue = m_Jobs[auLatestDependencies[uProducerIndex]].uFenceValue;
+			for (size_t uOtherIndex = 0; uOtherIndex < NUM_QUEUES; ++uOtherIndex)
+			{
+				if (uOtherIndex != uProducerIndex && abNeedsWait[uOtherIndex] &&
+					m_Jobs[auLatestDependencies[uOtherIndex]].Clock[uProducerIndex] >= uRequiredFenceValue)
+				{
+					abNeedsWait[uProducerIndex] = FALSE;
+					break;
+				}
+			}
+		}
+
+		for (size_t uProducerIndex = 0; uProducerIndex < NUM_QUEUES; ++uProducerIndex)
+		{
+			if (!abNeedsWait[uProducerIndex])
+			{
+				continue;
+			}
+
+			const Job& dependency = m_Jobs[auLatestDependencies[uProducerIndex]];
+
+			hr = commandListManager.GetQueue(job.Type).StallForFence(commandListManager, dependency.uFenceValue);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Stalling for job %s failed with HRESULT code %u, %s", dependency.strName.c_str(), hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			++m_Statistics.uNumWaits;
+
+			for (size_t i = 0; i < NUM_QUEUES; ++i)
+			{
+				knownFences[i] = std::max(knownFences[i], dependency.Clock[i]);
+			}
+		}
+
+		m_Statistics.uNumElidedWaits = m_Statistics.uNumCrossQueueDependencies - m_Statistics.uNumWaits;
+
+		return hr;
+	}
+
+	void QueueScheduler::estimateOverlap() noexcept
+	{
+		// Every job starts once its queue is free and its dependencies are done
+		std::vector<UINT64> finishTimes(m_Jobs.size(), 0);
+		UINT64 auQueueFreeTimes[NUM_QUEUES] = {};
+		UINT64 uSerialCost = 0;
+		UINT64 uScheduledCost = 0;
+
+		for (size_t i = 0; i < m_Jobs.size(); ++i)
+		{
+			const Job& job = m_Jobs[i];
+			const size_t uQueueIndex = getQueueIndex(job.Type);
+
+			UINT64 uStartTime = auQueueFreeTimes[uQueueIndex];
+			for (uint32_t uDependencyIndex : job.Dependencies)
+			{
+				uStartTime = std::max(uStartTime, finishTimes[uDependencyIndex]);
+			}
+
+			finishTimes[i] = uStartTime + job.uCostHint;
+			auQueueFreeTimes[uQueueIndex] = finishTimes[i];
+
+			uSerialCost += job.uCostHint;
+			uScheduledCost = std::max(uScheduledCost, finishTimes[i]);
+		}
+
+		m_Statistics.uSerialCost = uSerialCost;
+		m_Statistics.uScheduledCost = uScheduledCost;
+		m_Statistics.EstimatedOverlap = uSerialCost > 0 ? 1.0f - static_cast<FLOAT>(uScheduledCost) / static_cast<FLOAT>(uSerialCost) : 0.0f;
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class CommandContext;
+	class CommandListManager;
+	class ContextManager;
+
+	typedef void (*PFN_QUEUE_JOB_RECORD)(_In_ CommandContext& context, _In_opt_ void* pContext);
+
+	struct QueueSchedulerStatistics
+	{
+		uint32_t uNumGraphicsJobs;
+		uint32_t uNumComputeJobs;
+		uint32_t uNumCopyJobs;
+		uint32_t uNumCrossQueueDependencies;
+		uint32_t uNumWaits;
+		uint32_t uNumElidedWaits;
+
+		// Estimated from the cost hints: running every job back to back against the scheduled makespan
+		UINT64 uSerialCost;
+		UINT64 uScheduledCost;
+		FLOAT EstimatedOverlap;
+	};
+
+	// Runs jobs on the graphics, async compute and copy queues.  Jobs are submitted in the order they were added
+	// and can only depend on jobs added before them.  Dependencies on the same queue are kept by queue order,
+	// for cross-queue ones the scheduler remembers which fence values every queue has already waited for,
+	// directly or through another queue, and only inserts the GPU waits that are still missing.
+	class QueueScheduler final
+	{
+	public:
+		static constexpr const uint32_t INVALID_JOB_INDEX = UINT32_MAX;
+
+	public:
+		explicit QueueScheduler() noexcept;
+		QueueScheduler(const QueueScheduler& other) = delete;
+		QueueScheduler(QueueScheduler&& other) = delete;
+		QueueScheduler& operator=(const QueueScheduler& other) = delete;
+		QueueScheduler& operator=(QueueScheduler&& other) = delete;
+		~QueueScheduler() noexcept = default;
+
+		void Reset() noexcept;
+
+		HRESULT AddJob(_Out_ uint32_t& uOutJobIndex, _In_ const std::wstring& strName, _In_ D3D12_COMMAND_LIST_TYPE type, _In_ PFN_QUEUE_JOB_RECORD pfnRecord, _In_opt_ void* pContext) noexcept;
+		HRESULT AddJob(_Out_ uint32_t& uOutJobIndex, _In_ const std::wstring& strName, _In_ D3D12_COMMAND_LIST_TYPE type, _In_ PFN_QUEUE_JOB_RECORD pfnRecord, _In_opt_ void* pContext, _In_ UINT64 uCostHint) noexcept;
+		HRESULT AddDependency(_In_ uint32_t uJobIndex, _In_ uint32_t uDependencyIndex) noexcept;
+
+		HRESULT Execute(_In_ ContextManager& contextManager, _In_ CommandListManager& commandListManager) noexcept;
+
+		// Valid once Execute has submitted the job
+		UINT64 GetJobFenceValue(_In_ uint32_t uJobIndex) const noexcept;
+		void GetStatistics(_Out_ QueueSchedulerStatistics& outStatistics) const noexcept;
+
+	private:
+		static constexpr const size_t NUM_QUEUES = 3u;
+
+		typedef std::array<UINT64, NUM_QUEUES> FenceClock;
+
+		struct Job
+		{
+			std::wstring strName;
+			D3D12_COMMAND_LIST_TYPE Type;
+			PFN_QUEUE_JOB_RECORD pfnRecord;
+			void* pContext;
+			UINT64 uCostHint;
+			std::vector<uint32_t> Dependencies;
+
+			// Fence values of every queue known to be reached when this job completes
+			FenceClock Clock;
+			UINT64 uFenceValue;
+		};
+
+	private:
+		static constexpr size_t getQueueIndex(_In_ D3D12_COMMAND_LIST_TYPE type) noexcept;
+
+		HRESULT beginContext(_Out_ CommandContext** ppOutContext, _In_ ContextManager& contextManager, _In_ const Job& job) noexcept;
+		HRESULT insertWaits(_In_ CommandListManager& commandListManager, _In_ const Job& job) noexcept;
+		void estimateOverlap() noexcept;
+
+	private:
+		std::vector<Job> m_Jobs;
+		QueueSchedulerStatistics m_Statistics;
+
+		// Per queue, the latest fence value of every queue it is already ordered after.  Fence values only grow,
+		// so this is kept across frames.
+		FenceClock m_aKnownFences[NUM_QUEUES];
+	};
+
+	inline constexpr size_t QueueScheduler::getQueueIndex(D3D12_COMMAND_LIST_TYPE type) noexcept
+	{
+		switch (type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+			return 1u;
+		case D3D12_COMMAND_LIST_TYPE_COPY:
+			return 2u;
+		case D3D12_COMMAND_LIST_TYPE_DIRECT:
+			[[fallthrough]];
+		default:
+			return 0u;
+		}
+	}
+}
@@ -0,0 +1,787 @@
+#include "Pch.h"
+#include "Renderer/RenderGraph.h"
+
+#include "Renderer/CommandContext.h"
+#include "Renderer/CommandListManager.h"
+#include "Renderer/GpuResource.h"
+
+namespace esperanza
+{
+	RenderGraph::RenderGraph() noexcept
+		: m_Passes()
+		, m_Resources()
+		, m_FinalBarriers()
+		, m_bIsCompiled(FALSE)
+		, m_Statistics()
+		, m_pTransientHeap()
+		, m_uTransientHeapSize(0)
+		, m_TransientSlots()
+		, m_HeapOccupants()
+	{
+	}
+
+	void RenderGraph::Destroy() noexcept
+	{
+		Reset();
+
+		m_TransientSlots.clear();
+		m_HeapOccupants.clear();
+		m_pTransientHeap.Reset();
+		m_uTransientHeapSize = 0;
+	}
+
+	void RenderGraph::Reset() noexcept
+	{
+		m_Passes.clear();
+		m_Resources.clear();
+		m_FinalBarriers.clear();
+		m_bIsCompiled = FALSE;
+		m_Statistics = {};
+	}
+
+	HRESULT RenderGraph::ImportResource(RenderGraphResourceHandle& outHandle, GpuResource& resource, D3D12_RESOURCE_STATES finalState, const std::wstring& strName) noexcept
+	{
+		outHandle = INVALID_HANDLE;
+
+		Resource& newResource = m_Resources.emplace_back();
+		newResource.strName = strName;
+		newResource.pImportedResource = &resource;
+		newResource.pRealizedResource = &resource;
+		newResource.FinalState = finalState;
+		newResource.TextureDesc = {};
+		newResource.uFirstPassIndex = INVALID_PASS_INDEX;
+		newResource.uLastPassIndex = INVALID_PASS_INDEX;
+		newResource.uHeapOffset = 0;
+		newResource.bNeedsAliasBarrier = FALSE;
+
+		outHandle = static_cast<RenderGraphResourceHandle>(m_Resources.size() - 1);
+		m_bIsCompiled = FALSE;
+
+		return S_OK;
+	}
+
+	HRESULT RenderGraph::CreateTransientResource(RenderGraphResourceHandle& outHandle, const RenderGraphTextureDesc& desc, const std::wstring& strName) noexcept
+	{
+		outHandle = INVALID_HANDLE;
+
+		// The transient heap only holds render target and depth stencil textures
+		if ((desc.Desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) == 0 ||
+			desc.Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			GLOGEF(L"Transient resource %s must be a render target or depth stencil texture", strName.c_str());
+
+			return E_INVALIDARG;
+		}
+
+		if (desc.AllocationInfo.SizeInBytes == 0 || desc.AllocationInfo.Alignment == 0)
+		{
+			GLOGEF(L"Transient resource %s has no allocation info", strName.c_str());
+
+			return E_INVALIDARG;
+		}
+
+		Resource& newResource = m_Resources.emplace_back();
+		newResource.strName = strName;
+		newResource.pImportedResource = nullptr;
+		newResource.pRealizedResource = nullptr;
+		newResource.FinalState = UNKNOWN_RESOURCE_STATE;
+		newResource.TextureDesc = desc;
+		newResource.uFirstPassIndex = INVALID_PASS_INDEX;
+		newResource.uLastPassIndex = INVALID_PASS_INDEX;
+		newResource.uHeapOffset = 0;
+		newResource.bNeedsAliasBarrier = FALSE;
+
+		outHandle = static_cast<RenderGraphResourceHandle>(m_Resources.size() - 1);
+		m_bIsCompiled = FALSE;
+
+		return S_OK;
+	}
+
+	HRESULT RenderGraph::AddPass(uint32_t& uOutPassIndex, const std::wstring& strName, PFN_RENDER_GRAPH_EXECUTE pfnExecute, void* pContext) noexcept
+	{
+		uOutPassIndex = INVALID_PASS_INDEX;
+
+		Pass& newPass = m_Passes.emplace_back();
+		newPass.strName = strName;
+		newPass.pfnExecute = pfnExecute;
+		newPass.pContext = pContext;
+		newPass.bHasSideEffects = FALSE;
+		newPass.bIsCulled = FALSE;
+
+		uOutPassIndex = static_cast<uint32_t>(m_Passes.size() - 1);
+		m_bIsCompiled = FALSE;
+
+		return S_OK;
+	}
+
+	HRESULT RenderGraph::ReadResource(uint32_t uPassIndex, RenderGraphResourceHandle handle, D3D12_RESOURCE_STATES state) noexcept
+	{
+		return addAccess(uPassIndex, handle, state, FALSE);
+	}
+
+	HRESULT RenderGraph::WriteResource(uint32_t uPassIndex, RenderGraphResourceHandle handle, D3D12_RESOURCE_STATES state) noexcept
+	{
+		return addAccess(uPassIndex, handle, state, TRUE);
+	}
+
+	HRESULT RenderGraph::SetHasSideEffects(uint32_t uPassIndex) noexcept
+	{
+		if (uPassIndex >= m_Passes.size())
+		{
+			GLOGEF(L"Invalid pass index %u", uPassIndex);
+
+			return E_INVALIDARG;
+		}
+
+		m_Passes[uPassIndex].bHasSideEffects = TRUE;
+		m_bIsCompiled = FALSE;
+
+		return S_OK;
+	}
+
+	HRESULT RenderGraph::Compile() noexcept
+	{
+		m_FinalBarriers.clear();
+		m_Statistics = {};
+
+		for (Pass& pass : m_Passes)
+		{
+			pass.Barriers.clear();
+		}
+
+		for (Resource& resource : m_Resources)
+		{
+			resource.uFirstPassIndex = INVALID_PASS_INDEX;
+			resource.uLastPassIndex = INVALID_PASS_INDEX;
+			resource.uHeapOffset = 0;
+			resource.bNeedsAliasBarrier = FALSE;
+		}
+
+		cullPasses();
+
+		std::vector<std::vector<std::pair<uint32_t, ResourceAccess>>> resourceAccesses;
+		computeLifetimes(resourceAccesses);
+		placeTransientResources();
+		planBarriers(resourceAccesses);
+
+		m_Statistics.uNumPasses = static_cast<uint32_t>(m_Passes.size());
+		m_Statistics.uNumResources = static_cast<uint32_t>(m_Resources.size());
+		m_bIsCompiled = TRUE;
+
+		return S_OK;
+	}
+
+	HRESULT RenderGraph::Execute(ID3D12Device* pDevice, ContextManager& contextManager, CommandListManager& commandListManager, UINT64& uOutFenceValue) noexcept
+	{
+		HRESULT hr = S_OK;
+		uOutFenceValue = 0;
+
+		if (!m_bIsCompiled)
+		{
+			hr = Compile();
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Compiling render graph failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		hr = realizeTransientResources(pDevice, commandListManager);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Realizing transient resources failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			// Nothing was submitted, the slots keep the fence value of their last use
+			releaseTransientSlots(0);
+
+			return hr;
+		}
+
+		std::vector<HeapOccupant> occupants;
+		planActivations(occupants);
+
+		GraphicsContext* pContext = nullptr;
+		hr = contextManager.BeginGraphicsContext(&pContext, L"Render Graph");
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Beginning graphics context failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			releaseTransientSlots(0);
+
+			return hr;
+		}
+
+		for (Pass& pass : m_Passes)
+		{
+			if (pass.bIsCulled)
+			{
+				continue;
+			}
+
+			for (RenderGraphResourceHandle handle : pass.Activations)
+			{
+				activateResource(*pContext, handle);
+			}
+
+			recordBarriers(*pContext, pass.Barriers);
+
+			if (pass.pfnExecute)
+			{
+				pass.pfnExecute(*pContext, *this, pass.pContext);
+			}
+		}
+
+		recordBarriers(*pContext, m_FinalBarriers);
+
+		hr = pContext->Finish(uOutFenceValue);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Finishing render graph context failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			// Part of the frame may still have reached the GPU, so which resource holds the memory is unknown
+			// and every transient is activated again next frame
+			releaseTransientSlots(commandListManager.GetGraphicsQueue().GetLastSubmittedFenceValue());
+			m_HeapOccupants.clear();
+
+			return hr;
+		}
+
+		releaseTransientSlots(uOutFenceValue);
+		m_HeapOccupants.swap(occupants);
+
+		return hr;
+	}
+
+	GpuResource& RenderGraph::GetResource(RenderGraphResourceHandle handle) noexcept
+	{
+		assert(handle < m_Resources.size() && m_Resources[handle].pRealizedResource);
+
+		return *m_Resources[handle].pRealizedResource;
+	}
+
+	BOOL RenderGraph::IsPassCulled(uint32_t uPassIndex) const noexcept
+	{
+		assert(uPassIndex < m_Passes.size());
+
+		return m_Passes[uPassIndex].bIsCulled;
+	}
+
+	void RenderGraph::GetStatistics(RenderGraphStatistics& outStatistics) const noexcept
+	{
+		outStatistics = m_Statistics;
+	}
+
+	HRESULT RenderGraph::addAccess(uint32_t uPassIndex, RenderGraphResourceHandle handle, D3D12_RESOURCE_STATES state, BOOL bIsWrite) noexcept
+	{
+		if (uPassIndex >= m_Passes.size() || handle >= m_Resources.size())
+		{
+			GLOGEF(L"Invalid pass index %u or resource handle %u", uPassIndex, handle);
+
+			return E_INVALIDARG;
+		}
+
+		m_bIsCompiled = FALSE;
+
+		// A pass touching the same resource twice gets one access, writes win over reads
+		for (ResourceAccess& access : m_Passes[uPassIndex].Accesses)
+		{
+			if (access.Handle != handle)
+			{
+				continue;
+			}
+
+			if (bIsWrite && !access.bIsWrite)
+			{
+				access.State = state;
+				access.bIsWrite = TRUE;
+			}
+			else if (bIsWrite == access.bIsWrite)
+			{
+				access.State |= state;
+			}
+
+			return S_OK;
+		}
+
+		m_Passes[uPassIndex].Accesses.push_back(ResourceAccess{ handle, state, bIsWrite });
+
+		return S_OK;
+	}
+
+	void RenderGraph::cullPasses() noexcept
+	{
+		// Walk backwards from what leaves the graph, a pass survives if a surviving pass or the caller
+		// consumes something it writes.  A resource stays needed once anything later reads it, passes that
+		// only write into it without reading are treated as partial writes.
+		std::vector<BOOL> needed(m_Resources.size(), FALSE);
+		for (size_t i = 0; i < m_Resources.size(); ++i)
+		{
+			needed[i] = m_Resources[i].pImportedResource != nullptr;
+		}
+
+		for (size_t uPassIndex = m_Passes.size(); uPassIndex-- > 0;)
+		{
+			Pass& pass = m_Passes[uPassIndex];
+
+			pass.bIsCulled = !pass.bHasSideEffects;
+			for (const ResourceAccess& access : pass.Accesses)
+			{
+				if (access.bIsWrite && needed[access.Handle])
+				{
+					pass.bIsCulled = FALSE;
+					break;
+				}
+			}
+
+			if (pass.bIsCulled)
+			{
+				++m_Statistics.uNumCulledPasses;
+				continue;
+			}
+
+			for (const ResourceAccess& access : pass.Accesses)
+			{
+				needed[access.Handle] = TRUE;
+			}
+		}
+	}
+
+	void RenderGraph::computeLifetimes(std::vector<std::vector<std::pair<uint32_t, ResourceAccess>>>& outResourceAccesses) noexcept
+	{
+		outResourceAccesses.clear();
+		outResourceAccesses.resize(m_Resources.size());
+
+		for (uint32_t uPassIndex = 0; uPassIndex < m_Passes.size(); ++uPassIndex)
+		{
+			const Pass& pass = m_Passes[uPassIndex];
+			if (pass.bIsCulled)
+			{
+				continue;
+			}
+
+			for (const ResourceAccess& access : pass.Accesses)
+			{
+				Resource& resource = m_Resources[access.Handle];
+				if (resource.uFirstPassIndex == INVALID_PASS_INDEX)
+				{
+					resource.uFirstPassIndex = uPassIndex;
+				}
+
+				resource.uLastPassIndex = uPassIndex;
+				outResourceAccesses[access.Handle].emplace_back(uPassIndex, access);
+			}
+		}
+	}
+
+	void RenderGraph::placeTransientResources() noexcept
+	{
+		std::vector<RenderGraphResourceHandle> transients;
+		for (RenderGraphResourceHandle handle = 0; handle < m_Resources.size(); ++handle)
+		{
+			const Resource& resource = m_Resources[handle];
+			if (!resource.pImportedResource && resource.uFirstPassIndex != INVALID_PASS_INDEX)
+			{
+				transients.push_back(handle);
+			}
+		}
+
+		std::stable_sort(transients.begin(), transients.end(),
+			[this](RenderGraphResourceHandle a, RenderGraphResourceHandle b)
+			{
+				return m_Resources[a].uFirstPassIndex < m_Resources[b].uFirstPassIndex;
+			});
+
+		// Greedy placement in order of first use: every resource goes to the lowest offset that does not
+		// overlap a resource alive at the same time
+		std::vector<RenderGraphResourceHandle> placed;
+		std::vector<RenderGraphResourceHandle> conflicts;
+		UINT64 uHeapSize = 0;
+
+		for (RenderGraphResourceHandle handle : transients)
+		{
+			Resource& resource = m_Resources[handle];
+			const UINT64 uSize = resource.TextureDesc.AllocationInfo.SizeInBytes;
+			const UINT64 uAlignment = resource.TextureDesc.AllocationInfo.Alignment;
+
+			conflicts.clear();
+			for (RenderGraphResourceHandle other : placed)
+			{
+				const Resource& otherResource = m_Resources[other];
+				if (otherResource.uLastPassIndex >= resource.uFirstPassIndex && otherResource.uFirstPassIndex <= resource.uLastPassIndex)
+				{
+					conflicts.push_back(other);
+				}
+			}
+
+			std::sort(conflicts.begin(), conflicts.end(),
+				[this](RenderGraphResourceHandle a, RenderGraphResourceHandle b)
+				{
+					return m_Resources[a].uHeapOffset < m_Resources[b].uHeapOffset;
+				});
+
+			UINT64 uOffset = 0;
+			for (RenderGraphResourceHandle other : conflicts)
+			{
+				const Resource& otherResource = m_Resources[other];
+				if (uOffset + uSize <= otherResource.uHeapOffset)
+				{
+					break;
+				}
+
+				const UINT64 uOtherEnd = otherResource.uHeapOffset + otherResource.TextureDesc.AllocationInfo.SizeInBytes;
+				uOffset = std::max(uOffset, (uOtherEnd + uAlignment - 1) & ~(uAlignment - 1));
+			}
+
+			resource.uHeapOffset = uOffset;
+
+			// Anything placed before over the same memory has to be deactivated first
+			for (RenderGraphResourceHandle other : placed)
+			{
+				const Resource& otherResource = m_Resources[other];
+				if (otherResource.uHeapOffset < uOffset + uSize &&
+					uOffset < otherResource.uHeapOffset + otherResource.TextureDesc.AllocationInfo.SizeInBytes)
+				{
+					resource.bNeedsAliasBarrier = TRUE;
+					++m_Statistics.uNumAliasBarriers;
+					break;
+				}
+			}
+
+			placed.push_back(handle);
+			uHeapSize = std::max(uHeapSize, uOffset + uSize);
+
+			++m_Statistics.uNumTransientResources;
+			m_Statistics.uTransientBytesRequested += uSize;
+		}
+
+		m_Statistics.uTransientHeapSize = uHeapSize;
+	}
+
+	void RenderGraph::planBarriers(const std::vector<std::vector<std::pair<uint32_t, ResourceAccess>>>& resourceAccesses) noexcept
+	{
+		constexpr const D3D12_RESOURCE_STATES READ_ONLY_STATES = D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ;
+
+		for (RenderGraphResourceHandle handle = 0; handle < m_Resources.size(); ++handle)
+		{
+			const Resource& resource = m_Resources[handle];
+			const std::vector<std::pair<uint32_t, ResourceAccess>>& accesses = resourceAccesses[handle];
+			D3D12_RESOURCE_STATES currentState = UNKNOWN_RESOURCE_STATE;
+
+			// A UAV write not yet ordered against later unordered access by a barrier or a transition
+			BOOL bHasPendingUavWrite = FALSE;
+
+			for (size_t i = 0; i < accesses.size(); ++i)
+			{
+				const uint32_t uPassIndex = accesses[i].first;
+				const ResourceAccess& access = accesses[i].second;
+				D3D12_RESOURCE_STATES targetState = access.State;
+
+				// A run of reads shares one transition into the union of their read states
+				if (!access.bIsWrite && (targetState & ~READ_ONLY_STATES) == 0)
+				{
+					for (size_t j = i + 1; j < accesses.size() && !accesses[j].second.bIsWrite && (accesses[j].second.State & ~READ_ONLY_STATES) == 0; ++j)
+					{
+						targetState |= accesses[j].second.State;
+					}
+				}
+
+				std::vector<PlannedBarrier>& barriers = m_Passes[uPassIndex].Barriers;
+				if (currentState == UNKNOWN_RESOURCE_STATE)
+				{
+					// Resolved against the real state of the resource when the list is submitted.  Transients
+					// over memory that held another resource are activated on Execute before this.
+					barriers.push_back(PlannedBarrier{ handle, eBarrierType::Transition, UNKNOWN_RESOURCE_STATE, targetState });
+					currentState = targetState;
+				}
+				else if (!CommandContext::IsRedundantTransition(currentState, targetState))
+				{
+					barriers.push_back(PlannedBarrier{ handle, eBarrierType::Transition, currentState, targetState });
+					++m_Statistics.uNumTransitionBarriers;
+					currentState = targetState;
+				}
+				else if (bHasPendingUavWrite && currentState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+				{
+					// Reads after a write need the barrier as much as writes do
+					barriers.push_back(PlannedBarrier{ handle, eBarrierType::Uav, currentState, currentState });
+					++m_Statistics.uNumUavBarriers;
+				}
+
+				bHasPendingUavWrite = access.bIsWrite && currentState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+			}
+
+			if (resource.pImportedResource && currentState != UNKNOWN_RESOURCE_STATE && currentState != resource.FinalState)
+			{
+				m_FinalBarriers.push_back(PlannedBarrier{ handle, eBarrierType::Transition, currentState, resource.FinalState });
+				++m_Statistics.uNumTransitionBarriers;
+			}
+		}
+	}
+
+	HRESULT RenderGraph::realizeTransientResources(ID3D12Device* pDevice, CommandListManager& commandListManager) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		if (m_Statistics.uTransientHeapSize > m_uTransientHeapSize)
+		{
+			// Everything placed in the old heap may still be in flight
+			DeferredReleaseQueue& releaseQueue = commandListManager.GetDeferredReleaseQueue();
+			for (TransientSlot& slot : m_TransientSlots)
+			{
+				slot.pResource->DestroyDeferred(releaseQueue);
+			}
+
+			m_TransientSlots.clear();
+			m_HeapOccupants.clear();
+			releaseQueue.ReleaseObject(m_pTransientHeap);
+			m_uTransientHeapSize = 0;
+
+			UINT64 uAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			for (const Resource& resource : m_Resources)
+			{
+				if (!resource.pImportedResource)
+				{
+					uAlignment = std::max(uAlignment, resource.TextureDesc.AllocationInfo.Alignment);
+				}
+			}
+
+			CD3DX12_HEAP_DESC heapDesc((m_Statistics.uTransientHeapSize + uAlignment - 1) & ~(uAlignment - 1), D3D12_HEAP_TYPE_DEFAULT, uAlignment, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES);
+
+			hr = pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_pTransientHeap));
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Creating transient heap failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+#ifdef _DEBUG
+			m_pTransientHeap->SetName(L"Render Graph Transient Heap");
+#endif
+
+			m_uTransientHeapSize = heapDesc.SizeInBytes;
+		}
+
+		// Every resource takes back a slot it can reuse before any slot is retired
+		for (RenderGraphResourceHandle handle = 0; handle < m_Resources.size(); ++handle)
+		{
+			Resource& resource = m_Resources[handle];
+			if (resource.pImportedResource || resource.uFirstPassIndex == INVALID_PASS_INDEX)
+			{
+				continue;
+			}
+
+			resource.pRealizedResource = nullptr;
+			for (TransientSlot& slot : m_TransientSlots)
+			{
+				if (!slot.bIsInUse && slot.uHeapOffset == resource.uHeapOffset && isSameResourceDesc(slot.Desc, resource.TextureDesc.Desc))
+				{
+					slot.bIsInUse = TRUE;
+					resource.pRealizedResource = slot.pResource.get();
+					break;
+				}
+			}
+		}
+
+		// Placed resources this frame does not use go away once the GPU is done with them.  The memory they
+		// held is still marked as taken by someone, so whoever uses it next is activated.
+		std::erase_if(m_TransientSlots,
+			[this, &commandListManager](const TransientSlot& slot)
+			{
+				if (slot.bIsInUse || !commandListManager.IsFenceComplete(slot.uLastUsedFenceValue))
+				{
+					return false;
+				}
+
+				for (HeapOccupant& occupant : m_HeapOccupants)
+				{
+					if (occupant.pResource == slot.pResource.get())
+					{
+						occupant.pResource = nullptr;
+					}
+				}
+
+				return true;
+			});
+
+		for (RenderGraphResourceHandle handle = 0; handle < m_Resources.size(); ++handle)
+		{
+			Resource& resource = m_Resources[handle];
+			if (resource.pImportedResource || resource.uFirstPassIndex == INVALID_PASS_INDEX || resource.pRealizedResource)
+			{
+				continue;
+			}
+
+			// New placed resources start out in the state their first pass wants
+			D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON;
+			for (const ResourceAccess& access : m_Passes[resource.uFirstPassIndex].Accesses)
+			{
+				if (access.Handle == handle)
+				{
+					initialState = access.State;
+					break;
+				}
+			}
+
+			ComPtr<ID3D12Resource> pPlacedResource;
+			hr = pDevice->CreatePlacedResource(m_pTransientHeap.Get(), resource.uHeapOffset, &resource.TextureDesc.Desc, initialState,
+				resource.TextureDesc.bHasClearValue ? &resource.TextureDesc.ClearValue : nullptr, IID_PPV_ARGS(&pPlacedResource));
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Creating placed resource %s failed with HRESULT code %u, %s", resource.strName.c_str(), hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+#ifdef _DEBUG
+			pPlacedResource->SetName(resource.strName.c_str());
+#endif
+
+			TransientSlot& slot = m_TransientSlots.emplace_back();
+			slot.Desc = resource.TextureDesc.Desc;
+			slot.uHeapOffset = resource.uHeapOffset;
+			slot.pResource = std::make_unique<GpuResource>(pPlacedResource.Get(), initialState);
+			slot.uLastUsedFenceValue = 0;
+			slot.bIsInUse = TRUE;
+
+			resource.pRealizedResource = slot.pResource.get();
+		}
+
+		return hr;
+	}
+
+	void RenderGraph::planActivations(std::vector<HeapOccupant>& outOccupants) noexcept
+	{
+		outOccupants.clear();
+		m_Statistics.uNumActivations = 0;
+
+		for (Pass& pass : m_Passes)
+		{
+			pass.Activations.clear();
+		}
+
+		std::vector<RenderGraphResourceHandle> transients;
+		for (RenderGraphResourceHandle handle = 0; handle < m_Resources.size(); ++handle)
+		{
+			const Resource& resource = m_Resources[handle];
+			if (!resource.pImportedResource && resource.uFirstPassIndex != INVALID_PASS_INDEX)
+			{
+				transients.push_back(handle);
+			}
+		}
+
+		std::stable_sort(transients.begin(), transients.end(),
+			[this](RenderGraphResourceHandle a, RenderGraphResourceHandle b)
+			{
+				return m_Resources[a].uFirstPassIndex < m_Resources[b].uFirstPassIndex;
+			});
+
+		// A placed resource is only still active if no other resource took any of its memory since it last
+		// did, in this frame or in the one executed before.  New placed resources are activated as well.
+		for (RenderGraphResourceHandle handle : transients)
+		{
+			const Resource& resource = m_Resources[handle];
+			const UINT64 uSize = resource.TextureDesc.AllocationInfo.SizeInBytes;
+
+			BOOL bNeedsActivation = resource.bNeedsAliasBarrier;
+			if (!bNeedsActivation)
+			{
+				size_t uLastHeldIndex = m_HeapOccupants.size();
+				for (size_t i = m_HeapOccupants.size(); i-- > 0;)
+				{
+					if (m_HeapOccupants[i].pResource == resource.pRealizedResource)
+					{
+						uLastHeldIndex = i;
+						break;
+					}
+				}
+
+				bNeedsActivation = uLastHeldIndex == m_HeapOccupants.size();
+				for (size_t i = uLastHeldIndex + 1; i < m_HeapOccupants.size() && !bNeedsActivation; ++i)
+				{
+					const HeapOccupant& occupant = m_HeapOccupants[i];
+					bNeedsActivation = occupant.uHeapOffset < resource.uHeapOffset + uSize && resource.uHeapOffset < occupant.uHeapOffset + occupant.uSize;
+				}
+			}
+
+			if (bNeedsActivation)
+			{
+				m_Passes[resource.uFirstPassIndex].Activations.push_back(handle);
+				++m_Statistics.uNumActivations;
+			}
+
+			outOccupants.push_back(HeapOccupant{ resource.uHeapOffset, uSize, resource.pRealizedResource });
+		}
+	}
+
+	void RenderGraph::releaseTransientSlots(UINT64 uFenceValue) noexcept
+	{
+		for (TransientSlot& slot : m_TransientSlots)
+		{
+			if (slot.bIsInUse)
+			{
+				slot.uLastUsedFenceValue = std::max(slot.uLastUsedFenceValue, uFenceValue);
+				slot.bIsInUse = FALSE;
+			}
+		}
+	}
+
+	void RenderGraph::activateResource(GraphicsContext& context, RenderGraphResourceHandle handle) noexcept
+	{
+		const Resource& resource = m_Resources[handle];
+		GpuResource& gpuResource = *resource.pRealizedResource;
+
+		// Contents of a render target or depth stencil over memory another resource used are undefined until
+		// it is cleared, discarded or copied to, and discarding needs the writable state.  The state the last
+		// frame left it in is dropped along with the contents, so no fix-up ever transitions it before the
+		// aliasing barrier.
+		const D3D12_RESOURCE_STATES activeState = (resource.TextureDesc.Desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) ?
+			D3D12_RESOURCE_STATE_RENDER_TARGET : D3D12_RESOURCE_STATE_DEPTH_WRITE;
+
+		context.ActivateAliasedResource(gpuResource, activeState);
+	}
+
+	void RenderGraph::recordBarriers(GraphicsContext& context, const std::vector<PlannedBarrier>& barriers) noexcept
+	{
+		for (const PlannedBarrier& barrier : barriers)
+		{
+			GpuResource& resource = *m_Resources[barrier.Handle].pRealizedResource;
+
+			switch (barrier.Type)
+			{
+			case eBarrierType::Transition:
+				context.TransitionResource(resource, barrier.StateAfter);
+				break;
+			case eBarrierType::Uav:
+				context.InsertUAVBarrier(resource);
+				break;
+			default:
+				assert(false);
+				break;
+			}
+		}
+
+		context.FlushResourceBarriers();
+	}
+
+	BOOL RenderGraph::isSameResourceDesc(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b) noexcept
+	{
+		return a.Dimension == b.Dimension &&
+			a.Alignment == b.Alignment &&
+			a.Width == b.Width &&
+			a.Height == b.Height &&
+			a.DepthOrArraySize == b.DepthOrArraySize &&
+			a.MipLevels == b.MipLevels &&
+			a.Format == b.Format &&
+			a.SampleDesc.Count == b.SampleDesc.Count &&
+			a.SampleDesc.Quality == b.SampleDesc.Quality &&
+			a.Layout == b.Layout &&
+			a.Flags == b.Flags;
+	}
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+	class ContextManager;
+	class GpuResource;
+	class GraphicsContext;
+	class RenderGraph;
+
+	typedef uint32_t RenderGraphResourceHandle;
+	typedef void (*PFN_RENDER_GRAPH_EXECUTE)(_In_ GraphicsContext& context, _In_ RenderGraph& graph, _In_opt_ void* pContext);
+
+	// Transient resources are placed in a heap shared by every transient of the frame, so the allocation
+	// info has to be known up front (ID3D12Device::GetResourceAllocationInfo).  Compile never touches the device.
+	struct RenderGraphTextureDesc
+	{
+		D3D12_RESOURCE_DESC Desc;
+		D3D12_RESOURCE_ALLOCATION_INFO AllocationInfo;
+		D3D12_CLEAR_VALUE ClearValue;
+		BOOL bHasClearValue;
+	};
+
+	struct RenderGraphStatistics
+	{
+		uint32_t uNumPasses;
+		uint32_t uNumCulledPasses;
+		uint32_t uNumResources;
+		uint32_t uNumTransientResources;
+		uint32_t uNumTransitionBarriers;
+		uint32_t uNumUavBarriers;
+		uint32_t uNumAliasBarriers;
+
+		// Transients the last Execute activated with an aliasing barrier and a discard, including those whose
+		// memory another resource took since the frame executed before
+		uint32_t uNumActivations;
+		UINT64 uTransientHeapSize;
+		UINT64 uTransientBytesRequested;
+	};
+
+	// A frame graph that is rebuilt every frame.  Passes declare which resources they read and write,
+	// Compile culls the passes nothing consumes, computes the lifetime of every resource, places the
+	// transient render targets of the frame in one aliased heap and plans the barriers between passes.
+	// Execute records the surviving passes into a single graphics context.
+	class RenderGraph final
+	{
+	public:
+		static constexpr const RenderGraphResourceHandle INVALID_HANDLE = UINT32_MAX;
+
+	public:
+		explicit RenderGraph() noexcept;
+		RenderGraph(const RenderGraph& other) = delete;
+		RenderGraph(RenderGraph&& other) = delete;
+		RenderGraph& operator=(const RenderGraph& other) = delete;
+		RenderGraph& operator=(RenderGraph&& other) = delete;
+		~RenderGraph() noexcept = default;
+
+		void Destroy() noexcept;
+
+		// Drops the passes and resources of the last frame, realized transient memory is kept
+		void Reset() noexcept;
+
+		// Imported resources outlive the graph, they are never culled and end the frame in finalState
+		HRESULT ImportResource(_Out_ RenderGraphResourceHandle& outHandle, _In_ GpuResource& resource, _In_ D3D12_RESOURCE_STATES finalState, _In_ const std::wstring& strName) noexcept;
+		HRESULT CreateTransientResource(_Out_ RenderGraphResourceHandle& outHandle, _In_ const RenderGraphTextureDesc& desc, _In_ const std::wstring& strName) noexcept;
+
+		HRESULT AddPass(_Out_ uint32_t& uOutPassIndex, _In_ const std::wstring& strName, _In_ PFN_RENDER_GRAPH_EXECUTE pfnExecute, _In_opt_ void* pContext) noexcept;
+		HRESULT ReadResource(_In_ uint32_t uPassIndex, _In_ RenderGraphResourceHandle handle, _In_ D3D12_RESOURCE_STATES state) noexcept;
+		HRESULT WriteResource(_In_ uint32_t uPassIndex, _In_ RenderGraphResourceHandle handle, _In_ D3D12_RESOURCE_STATES state) noexcept;
+
+		// Passes with side effects outside the graph (readbacks, queries...) are never culled
+		HRESULT SetHasSideEffects(_In_ uint32_t uPassIndex) noexcept;
+
+		HRESULT Compile() noexcept;
+		HRESULT Execute(_In_ ID3D12Device* pDevice, _In_ ContextManager& contextManager, _In_ CommandListManager& commandListManager, _Out_ UINT64& uOutFenceValue) noexcept;
+
+		// Only valid inside pass callbacks for transient resources
+		GpuResource& GetResource(_In_ RenderGraphResourceHandle handle) noexcept;
+
+		BOOL IsPassCulled(_In_ uint32_t uPassIndex) const noexcept;
+		void GetStatistics(_Out_ RenderGraphStatistics& outStatistics) const noexcept;
+
+	private:
+		static constexpr const uint32_t INVALID_PASS_INDEX = UINT32_MAX;
+		static constexpr const D3D12_RESOURCE_STATES UNKNOWN_RESOURCE_STATE = static_cast<D3D12_RESOURCE_STATES>(-1);
+
+		enum class eBarrierType : uint8_t
+		{
+			Transition,
+			Uav,
+		};
+
+		struct ResourceAccess
+		{
+			RenderGraphResourceHandle Handle;
+			D3D12_RESOURCE_STATES State;
+			BOOL bIsWrite;
+		};
+
+		struct PlannedBarrier
+		{
+			RenderGraphResourceHandle Handle;
+			eBarrierType Type;
+
+			// UNKNOWN_RESOURCE_STATE on the first use in the frame, the command context resolves it at submission
+			D3D12_RESOURCE_STATES StateBefore;
+			D3D12_RESOURCE_STATES StateAfter;
+		};
+
+		struct Pass
+		{
+			std::wstring strName;
+			PFN_RENDER_GRAPH_EXECUTE pfnExecute;
+			void* pContext;
+			std::vector<ResourceAccess> Accesses;
+			std::vector<PlannedBarrier> Barriers;
+
+			// Transient resources first used by this pass over memory another resource held last, set on Execute
+			std::vector<RenderGraphResourceHandle> Activations;
+			BOOL bHasSideEffects;
+			BOOL bIsCulled;
+		};
+
+		struct Resource
+		{
+			std::wstring strName;
+			GpuResource* pImportedResource;
+			GpuResource* pRealizedResource;
+			D3D12_RESOURCE_STATES FinalState;
+			RenderGraphTextureDesc TextureDesc;
+			uint32_t uFirstPassIndex;
+			uint32_t uLastPassIndex;
+			UINT64 uHeapOffset;
+
+			// Overlaps a resource of the same frame placed before it
+			BOOL bNeedsAliasBarrier;
+		};
+
+		// A placed resource kept across frames, reused while its description and heap offset match
+		struct TransientSlot
+		{
+			D3D12_RESOURCE_DESC Desc;
+			UINT64 uHeapOffset;
+			std::unique_ptr<GpuResource> pResource;
+			UINT64 uLastUsedFenceValue;
+			BOOL bIsInUse;
+		};
+
+		// Which placed resource took a range of the transient heap, in the order the last executed frame did
+		struct HeapOccupant
+		{
+			UINT64 uHeapOffset;
+			UINT64 uSize;
+			const GpuResource* pResource;
+		};
+
+	private:
+		HRESULT addAccess(_In_ uint32_t uPassIndex, _In_ RenderGraphResourceHandle handle, _In_ D3D12_RESOURCE_STATES state, _In_ BOOL bIsWrite) noexcept;
+		void cullPasses() noexcept;
+		void computeLifetimes(_Out_ std::vector<std::vector<std::pair<uint32_t, ResourceAccess>>>& outResourceAccesses) noexcept;
+		void placeTransientResources() noexcept;
+		void planBarriers(_In_ const std::vector<std::vector<std::pair<uint32_t, ResourceAccess>>>& resourceAccesses) noexcept;
+		HRESULT realizeTransientResources(_In_ ID3D12Device* pDevice, _In_ CommandListManager& commandListManager) noexcept;
+		void planActivations(_Out_ std::vector<HeapOccupant>& outOccupants) noexcept;
+		void releaseTransientSlots(_In_ UINT64 uFenceValue) noexcept;
+		void activateResource(_In_ GraphicsContext& context, _In_ RenderGraphResourceHandle handle) noexcept;
+		void recordBarriers(_In_ GraphicsContext& context, _In_ const std::vector<PlannedBarrier>& barriers) noexcept;
+
+		// Compares every field, the padding of the structure is not initialized
+		static BOOL isSameResourceDesc(_In_ const D3D12_RESOURCE_DESC& a, _In_ const D3D12_RESOURCE_DESC& b) noexcept;
+
+	private:
+		std::vector<Pass> m_Passes;
+		std::vector<Resource> m_Resources;
+		std::vector<PlannedBarrier> m_FinalBarriers;
+		BOOL m_bIsCompiled;
+		RenderGraphStatistics m_Statistics;
+
+		ComPtr<ID3D12Heap> m_pTransientHeap;
+		UINT64 m_uTransientHeapSize;
+		std::vector<TransientSlot> m_TransientSlots;
+		std::vector<HeapOccupant> m_HeapOccupants;
+	};
+}
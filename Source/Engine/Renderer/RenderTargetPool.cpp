@@ -0,0 +1,307 @@
+#include "Pch.h"
+#include "Renderer/RenderTargetPool.h"
+
+#include "Renderer/ColorBuffer.h"
+#include "Renderer/CommandListManager.h"
+#include "Renderer/EsramAllocator.h"
+
+namespace esperanza
+{
+	static constexpr const D3D12_COMMAND_LIST_TYPE QUEUE_TYPES[] =
+	{
+		D3D12_COMMAND_LIST_TYPE_DIRECT,
+		D3D12_COMMAND_LIST_TYPE_COMPUTE,
+		D3D12_COMMAND_LIST_TYPE_COPY,
+	};
+
+	RenderTargetPool::RenderTargetPool() noexcept
+		: m_pDevice()
+		, m_pCommandListManager(nullptr)
+		, m_pEsramAllocator(nullptr)
+		, m_pViewCache(nullptr)
+		, m_uMemoryBudget(DEFAULT_MEMORY_BUDGET)
+		, m_PoolMutex()
+		, m_Entries()
+		, m_EntriesInUse()
+		, m_uTick(0)
+		, m_uPooledBytes(0)
+		, m_Statistics()
+	{
+	}
+
+	HRESULT RenderTargetPool::Initialize(ID3D12Device* pDevice, CommandListManager& commandListManager) noexcept
+	{
+		return Initialize(pDevice, commandListManager, DEFAULT_MEMORY_BUDGET, nullptr, nullptr);
+	}
+
+	HRESULT RenderTargetPool::Initialize(ID3D12Device* pDevice, CommandListManager& commandListManager, UINT64 uMemoryBudget, EsramAllocator* pEsramAllocator, DescriptorViewCache* pViewCache) noexcept
+	{
+		m_pDevice = pDevice;
+		m_pCommandListManager = &commandListManager;
+		m_pEsramAllocator = pEsramAllocator;
+		m_pViewCache = pViewCache;
+		m_uMemoryBudget = uMemoryBudget;
+
+		return S_OK;
+	}
+
+	void RenderTargetPool::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_PoolMutex);
+
+		for (auto& [key, entries] : m_Entries)
+		{
+			for (std::unique_ptr<Entry>& pEntry : entries)
+			{
+				pEntry->pColorBuffer->Destroy();
+			}
+		}
+
+		m_Entries.clear();
+		m_EntriesInUse.clear();
+		m_uPooledBytes = 0;
+		m_pCommandListManager = nullptr;
+		m_pEsramAllocator = nullptr;
+		m_pViewCache = nullptr;
+		m_pDevice.Reset();
+	}
+
+	HRESULT RenderTargetPool::Acquire(ColorBuffer** ppOutColorBuffer, const RenderTargetPoolKey& key, const std::wstring& strName) noexcept
+	{
+		HRESULT hr = S_OK;
+		*ppOutColorBuffer = nullptr;
+
+		if (!m_pDevice)
+		{
+			GLOGE(L"Render target pool is not initialized!");
+
+			return E_FAIL;
+		}
+
+		// A zero size or fragment count would only fail later in the device or in SetMsaaMode
+		if (key.uWidth == 0 || key.uHeight == 0 || key.uFragmentCount == 0)
+		{
+			GLOGEF(L"Invalid render target pool key %ux%u with %u fragments", key.uWidth, key.uHeight, key.uFragmentCount);
+
+			return E_INVALIDARG;
+		}
+
+		// A full chain spelled out and one asked for with 0 are the same resource, so they share buffers
+		RenderTargetPoolKey resolvedKey = key;
+		if (resolvedKey.uNumMips == 0)
+		{
+			resolvedKey.uNumMips = ColorBuffer::ComputeNumMips(key.uWidth, key.uHeight);
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_PoolMutex);
+
+		++m_Statistics.uNumRequests;
+
+		Entry* pEntry = nullptr;
+
+		auto it = m_Entries.find(resolvedKey);
+		if (it != m_Entries.end())
+		{
+			for (std::unique_ptr<Entry>& pCandidate : it->second)
+			{
+				if (isEntryAvailable(*pCandidate))
+				{
+					pEntry = pCandidate.get();
+					break;
+				}
+			}
+		}
+
+		if (pEntry)
+		{
+			++m_Statistics.uNumHits;
+
+#ifdef _DEBUG
+			pEntry->pColorBuffer->GetResource()->SetName(strName.c_str());
+#endif
+		}
+		else
+		{
+			++m_Statistics.uNumMisses;
+
+			hr = createEntry(&pEntry, resolvedKey, strName);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Creating pooled render target %s failed with HRESULT code %u, %s", strName.c_str(), hr, err.ErrorMessage());
+
+				return hr;
+			}
+		}
+
+		pEntry->bIsInUse = TRUE;
+		pEntry->uLastUsedTick = ++m_uTick;
+		m_EntriesInUse.emplace(pEntry->pColorBuffer.get(), pEntry);
+
+		// Making room only after the new buffer is in use keeps it from being evicted right away
+		evictEntries();
+
+		*ppOutColorBuffer = pEntry->pColorBuffer.get();
+
+		return hr;
+	}
+
+	HRESULT RenderTargetPool::Release(ColorBuffer* pColorBuffer) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_PoolMutex);
+
+		auto it = m_EntriesInUse.find(pColorBuffer);
+		if (it == m_EntriesInUse.end())
+		{
+			GLOGE(L"Color buffer was not acquired from this pool!");
+
+			return E_INVALIDARG;
+		}
+
+		// Anything already submitted to any queue may still use the buffer
+		Entry& entry = *it->second;
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			entry.auFenceValues[i] = m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).GetLastSubmittedFenceValue();
+		}
+
+		entry.bIsInUse = FALSE;
+		entry.uLastUsedTick = ++m_uTick;
+		m_EntriesInUse.erase(it);
+
+		evictEntries();
+
+		return S_OK;
+	}
+
+	void RenderTargetPool::SetMemoryBudget(UINT64 uMemoryBudget) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_PoolMutex);
+
+		m_uMemoryBudget = uMemoryBudget;
+		evictEntries();
+	}
+
+	void RenderTargetPool::GetStatistics(RenderTargetPoolStatistics& outStatistics) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_PoolMutex);
+
+		outStatistics = m_Statistics;
+		outStatistics.uNumEntriesInUse = m_EntriesInUse.size();
+		outStatistics.uPooledBytes = m_uPooledBytes;
+		outStatistics.HitRate = m_Statistics.uNumRequests > 0 ? static_cast<FLOAT>(m_Statistics.uNumHits) / static_cast<FLOAT>(m_Statistics.uNumRequests) : 0.0f;
+
+		outStatistics.uNumEntries = 0;
+		for (const auto& [key, entries] : m_Entries)
+		{
+			outStatistics.uNumEntries += entries.size();
+		}
+	}
+
+	size_t RenderTargetPool::KeyHash::operator()(const RenderTargetPoolKey& key) const noexcept
+	{
+		size_t uHash = std::hash<uint32_t>()(key.uWidth);
+		uHash = uHash * 31 + std::hash<uint32_t>()(key.uHeight);
+		uHash = uHash * 31 + std::hash<uint32_t>()(key.uNumMips);
+		uHash = uHash * 31 + std::hash<uint32_t>()(static_cast<uint32_t>(key.Format));
+		uHash = uHash * 31 + std::hash<uint32_t>()(key.uFragmentCount);
+
+		return uHash;
+	}
+
+	HRESULT RenderTargetPool::createEntry(Entry** ppOutEntry, const RenderTargetPoolKey& key, const std::wstring& strName) noexcept
+	{
+		HRESULT hr = S_OK;
+		*ppOutEntry = nullptr;
+
+		std::unique_ptr<Entry> pEntry = std::make_unique<Entry>();
+		pEntry->Key = key;
+		pEntry->pColorBuffer = std::make_unique<ColorBuffer>();
+		pEntry->pColorBuffer->SetMsaaMode(key.uFragmentCount, key.uFragmentCount);
+		pEntry->pColorBuffer->SetViewCache(m_pViewCache);
+
+		if (m_pEsramAllocator)
+		{
+			hr = pEntry->pColorBuffer->Initialize(m_pDevice.Get(), strName, key.uWidth, key.uHeight, key.uNumMips, key.Format, *m_pEsramAllocator);
+		}
+		else
+		{
+			hr = pEntry->pColorBuffer->Initialize(m_pDevice.Get(), strName, key.uWidth, key.uHeight, key.uNumMips, key.Format);
+		}
+
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Initializing color buffer failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		const D3D12_RESOURCE_DESC resourceDesc = pEntry->pColorBuffer->GetResource()->GetDesc();
+		pEntry->uSize = m_pDevice->GetResourceAllocationInfo(0, 1, &resourceDesc).SizeInBytes;
+		m_uPooledBytes += pEntry->uSize;
+
+		*ppOutEntry = pEntry.get();
+		m_Entries[key].push_back(std::move(pEntry));
+
+		return hr;
+	}
+
+	BOOL RenderTargetPool::isEntryAvailable(const Entry& entry) noexcept
+	{
+		if (entry.bIsInUse)
+		{
+			return FALSE;
+		}
+
+		for (size_t i = 0; i < NUM_QUEUES; ++i)
+		{
+			if (!m_pCommandListManager->GetQueue(QUEUE_TYPES[i]).IsFenceComplete(entry.auFenceValues[i]))
+			{
+				return FALSE;
+			}
+		}
+
+		return TRUE;
+	}
+
+	void RenderTargetPool::evictEntries() noexcept
+	{
+		while (m_uPooledBytes > m_uMemoryBudget)
+		{
+			// Least recently released first, buffers in use are never evicted
+			std::vector<std::unique_ptr<Entry>>* pOldestEntries = nullptr;
+			size_t uOldestIndex = 0;
+			for (auto& [key, entries] : m_Entries)
+			{
+				for (size_t i = 0; i < entries.size(); ++i)
+				{
+					if (!entries[i]->bIsInUse && (!pOldestEntries || entries[i]->uLastUsedTick < (*pOldestEntries)[uOldestIndex]->uLastUsedTick))
+					{
+						pOldestEntries = &entries;
+						uOldestIndex = i;
+					}
+				}
+			}
+
+			if (!pOldestEntries)
+			{
+				return;
+			}
+
+			// The GPU may still be using it, the release queue keeps the resource alive until it is done
+			std::unique_ptr<Entry> pEvicted = std::move((*pOldestEntries)[uOldestIndex]);
+			(*pOldestEntries)[uOldestIndex] = std::move(pOldestEntries->back());
+			pOldestEntries->pop_back();
+
+			if (pOldestEntries->empty())
+			{
+				m_Entries.erase(pEvicted->Key);
+			}
+
+			pEvicted->pColorBuffer->DestroyDeferred(m_pCommandListManager->GetDeferredReleaseQueue());
+			m_uPooledBytes -= pEvicted->uSize;
+			++m_Statistics.uNumEvictions;
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class ColorBuffer;
+	class CommandListManager;
+	class DescriptorViewCache;
+	class EsramAllocator;
+
+	// Everything that decides the resource behind a pooled color buffer.  The resource flags of a
+	// ColorBuffer follow from its fragment count, so that is what stands for them here.
+	struct RenderTargetPoolKey
+	{
+		uint32_t uWidth;
+		uint32_t uHeight;
+		uint32_t uNumMips;
+		DXGI_FORMAT Format;
+		uint32_t uFragmentCount;
+
+		bool operator==(const RenderTargetPoolKey& other) const noexcept = default;
+	};
+
+	struct RenderTargetPoolStatistics
+	{
+		UINT64 uNumRequests;
+		UINT64 uNumHits;
+		UINT64 uNumMisses;
+		UINT64 uNumEvictions;
+		UINT64 uNumEntries;
+		UINT64 uNumEntriesInUse;
+		UINT64 uPooledBytes;
+		FLOAT HitRate;
+	};
+
+	// Hands out color buffers and takes them back instead of destroying them.  A released buffer is
+	// handed out again for the same key once every queue is past the work submitted before the release.
+	// When the pool is over its memory budget the least recently released buffers are evicted.
+	class RenderTargetPool final
+	{
+	public:
+		static constexpr const UINT64 DEFAULT_MEMORY_BUDGET = 0x10000000;	// 256MB
+
+	public:
+		explicit RenderTargetPool() noexcept;
+		RenderTargetPool(const RenderTargetPool& other) = delete;
+		RenderTargetPool(RenderTargetPool&& other) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool& other) = delete;
+		RenderTargetPool& operator=(RenderTargetPool&& other) = delete;
+		~RenderTargetPool() noexcept = default;
+
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ CommandListManager& commandListManager) noexcept;
+
+		// Buffers are placed through pEsramAllocator when one is given, committed otherwise.  Their views come
+		// from pViewCache when one is given.
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ CommandListManager& commandListManager, _In_ UINT64 uMemoryBudget, _In_opt_ EsramAllocator* pEsramAllocator,
+			_In_opt_ DescriptorViewCache* pViewCache) noexcept;
+
+		// Buffers still acquired are destroyed as well, the GPU must be idle
+		void Destroy() noexcept;
+
+		// uNumMips of 0 means a full chain, as in ColorBuffer::Initialize, and is resolved before the lookup.
+		// The width, height and fragment count must not be 0.
+		HRESULT Acquire(_Out_ ColorBuffer** ppOutColorBuffer, _In_ const RenderTargetPoolKey& key, _In_ const std::wstring& strName) noexcept;
+		HRESULT Release(_In_ ColorBuffer* pColorBuffer) noexcept;
+
+		// Evicts released buffers until the pool fits, buffers still used by the GPU are released deferred
+		void SetMemoryBudget(_In_ UINT64 uMemoryBudget) noexcept;
+
+		void GetStatistics(_Out_ RenderTargetPoolStatistics& outStatistics) noexcept;
+
+	private:
+		static constexpr const size_t NUM_QUEUES = 3u;
+
+		struct KeyHash
+		{
+			size_t operator()(const RenderTargetPoolKey& key) const noexcept;
+		};
+
+		struct Entry
+		{
+			RenderTargetPoolKey Key;
+			std::unique_ptr<ColorBuffer> pColorBuffer;
+			UINT64 uSize;
+			UINT64 auFenceValues[NUM_QUEUES];
+			UINT64 uLastUsedTick;
+			BOOL bIsInUse;
+		};
+
+	private:
+		HRESULT createEntry(_Out_ Entry** ppOutEntry, _In_ const RenderTargetPoolKey& key, _In_ const std::wstring& strName) noexcept;
+		BOOL isEntryAvailable(_In_ const Entry& entry) noexcept;
+		void evictEntries() noexcept;
+
+	private:
+		ComPtr<ID3D12Device> m_pDevice;
+		CommandListManager* m_pCommandListManager;
+		EsramAllocator* m_pEsramAllocator;
+		DescriptorViewCache* m_pViewCache;
+		UINT64 m_uMemoryBudget;
+		std::mutex m_PoolMutex;
+
+		std::unordered_map<RenderTargetPoolKey, std::vector<std::unique_ptr<Entry>>, KeyHash> m_Entries;
+		std::unordered_map<ColorBuffer*, Entry*> m_EntriesInUse;
+		UINT64 m_uTick;
+		UINT64 m_uPooledBytes;
+		RenderTargetPoolStatistics m_Statistics;
+	};
+}
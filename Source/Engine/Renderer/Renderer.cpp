@@ -11,7 +11,17 @@ namespace esperanza
 		, m_uWidth()
 		, m_uHeight()
 		, m_pCommandManager(std::make_shared<CommandListManager>())
+		, m_ContextManager()
 		, m_Display()
+		, m_RenderGraph()
+		, m_QueueScheduler()
+		, m_UploadPageProvider()
+		, m_UploadAllocator()
+		, m_UploadBatcher()
+		, m_DynamicConstantAllocator()
+		, m_EsramAllocator()
+		, m_DescriptorViewCache()
+		, m_RenderTargetPool()
 		, m_Viewport()
 		, m_ScissorRect()
 		, m_pDevice()
@@ -24,10 +34,6 @@ namespace esperanza
 		, m_uRtvDescriptorSize()
 		, m_VertexBuffer()
 		, m_VertexBufferView()
-		, m_uFrameIndex()
-		, m_hFenceEvent()
-		, m_pFence()
-		, m_uFenceValue()
 		, m_bTypedUAVLoadSupport_R11G11B10_FLOAT(FALSE)
 		, m_bTypedUAVLoadSupport_R16G16B16A16_FLOAT(FALSE)
 	{
@@ -382,6 +388,78 @@ namespace esperanza
 		
 			return hr;
 		}
+
+		hr = m_ContextManager.Initialize(m_pCommandManager);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing context manager failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_UploadPageProvider.Initialize(m_pDevice.Get(), *m_pCommandManager);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing upload page provider failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_UploadAllocator.Initialize(m_UploadPageProvider);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing upload allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_UploadBatcher.Initialize(m_pDevice.Get(), m_UploadAllocator, m_ContextManager, *m_pCommandManager);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing upload batcher failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_DynamicConstantAllocator.Initialize(m_UploadPageProvider);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing dynamic constant allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_EsramAllocator.Initialize(m_pDevice.Get(), *m_pCommandManager);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing esram allocator failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_DescriptorViewCache.Initialize(m_pDevice.Get(), m_pDescriptorAllocator);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing descriptor view cache failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		hr = m_RenderTargetPool.Initialize(m_pDevice.Get(), *m_pCommandManager, RenderTargetPool::DEFAULT_MEMORY_BUDGET, &m_EsramAllocator, &m_DescriptorViewCache);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			LOGEF(m_Logger, L"Initializing render target pool failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
 		
 		// Initialize Common States
 		
@@ -393,6 +471,16 @@ namespace esperanza
 	void Renderer::Destroy() noexcept
 	{
 		m_pCommandManager->IdleGpu();
+		m_RenderGraph.Destroy();
+		m_QueueScheduler.Reset();
+		m_DynamicConstantAllocator.Destroy();
+		m_UploadBatcher.Destroy();
+		m_UploadAllocator.Destroy();
+		m_UploadPageProvider.Destroy();
+		m_RenderTargetPool.Destroy();
+		m_DescriptorViewCache.Destroy();
+		m_EsramAllocator.Destroy();
+		m_ContextManager.Destroy();
 		m_pCommandManager->Destroy();
 		
 		m_Display.Destroy();
@@ -414,7 +502,6 @@ namespace esperanza
 		m_Logger.Destroy();
 
 
-		m_pFence.Reset();
 		m_VertexBuffer.Reset();
 		m_pPipelineState.Reset();
 		m_pRtvDescriptorHeap.Reset();
@@ -434,6 +521,10 @@ namespace esperanza
 
 	void Renderer::Render() noexcept
 	{
+		// The frame controller already waited for the frame that last used this slot
+		const FrameController& frameController = m_Display.GetFrameController();
+		m_DynamicConstantAllocator.BeginFrame(frameController.GetFrameIndex(), frameController.GetFrameNumber());
+
 		// https://docs.microsoft.com/en-us/windows/win32/direct3d12/creating-a-basic-direct3d-12-component
 		// Populate the command list
 			// Reset the command list allocator
@@ -446,8 +537,7 @@ namespace esperanza
 			// Close the command list to further recording
 
 		// Execute the command list
-		// Present the frame
-		// Wait for the GPU to finish
+		// Present the frame, this only blocks when the CPU is a full set of frames ahead of the GPU
 	}
 
 	void Renderer::getHardwareAdapter(_Out_ IDXGIAdapter1** ppOutAdapter, _Inout_ IDXGIFactory1* pFactory) noexcept
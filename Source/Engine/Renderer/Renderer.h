@@ -2,8 +2,17 @@
 
 #include "Pch.h"
 
+#include "Renderer/CommandContext.h"
 #include "Renderer/DescriptorHeap.h"
+#include "Renderer/DescriptorViewCache.h"
 #include "Renderer/Display.h"
+#include "Renderer/DynamicConstantAllocator.h"
+#include "Renderer/EsramAllocator.h"
+#include "Renderer/QueueScheduler.h"
+#include "Renderer/RenderTargetPool.h"
+#include "Renderer/RenderGraph.h"
+#include "Renderer/UploadAllocator.h"
+#include "Renderer/UploadBatcher.h"
 
 namespace esperanza
 {
@@ -36,7 +45,17 @@ namespace esperanza
 		UINT m_uHeight;
 
 		std::shared_ptr<CommandListManager> m_pCommandManager;
+		ContextManager m_ContextManager;
 		Display m_Display;
+		RenderGraph m_RenderGraph;
+		QueueScheduler m_QueueScheduler;
+		D3D12UploadPageProvider m_UploadPageProvider;
+		LinearUploadAllocator m_UploadAllocator;
+		UploadBatcher m_UploadBatcher;
+		DynamicConstantAllocator m_DynamicConstantAllocator;
+		EsramAllocator m_EsramAllocator;
+		DescriptorViewCache m_DescriptorViewCache;
+		RenderTargetPool m_RenderTargetPool;
 
 		// Pipeline objects
 		D3D12_VIEWPORT m_Viewport;
@@ -54,12 +73,6 @@ namespace esperanza
 		ComPtr<ID3D12Resource> m_VertexBuffer;
 		D3D12_VERTEX_BUFFER_VIEW m_VertexBufferView;
 
-		// Synchronization objects
-		UINT m_uFrameIndex;
-		HANDLE m_hFenceEvent;
-		ComPtr<ID3D12Fence> m_pFence;
-		UINT64 m_uFenceValue;
-
 		// Flags
 		BOOL m_bTypedUAVLoadSupport_R11G11B10_FLOAT;
 		BOOL m_bTypedUAVLoadSupport_R16G16B16A16_FLOAT;
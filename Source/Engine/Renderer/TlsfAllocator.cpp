@@ -0,0 +1,360 @@
+#include "Pch.h"
+#include "Renderer/TlsfAllocator.h"
+
+namespace esperanza
+{
+	TlsfAllocator::TlsfAllocator() noexcept
+		: m_uSize(0)
+		, m_uGranularity(1)
+		, m_uGranularityLog2(0)
+		, m_Blocks()
+		, m_FreeBlockSlots()
+		, m_uFirstLevelBitmap(0)
+		, m_auSecondLevelBitmaps()
+		, m_aauFreeListHeads()
+		, m_uAllocatedSize(0)
+		, m_uNumAllocations(0)
+	{
+	}
+
+	HRESULT TlsfAllocator::Initialize(UINT64 uSize, UINT64 uGranularity) noexcept
+	{
+		if (uGranularity == 0 || (uGranularity & (uGranularity - 1)) != 0 || uSize < uGranularity)
+		{
+			GLOGEF(L"Invalid TLSF range of %llu bytes with a granularity of %llu", uSize, uGranularity);
+
+			return E_INVALIDARG;
+		}
+
+		Destroy();
+
+		unsigned long uGranularityLog2 = 0;
+		_BitScanForward64(&uGranularityLog2, uGranularity);
+
+		m_uSize = uSize & ~(uGranularity - 1);
+		m_uGranularity = uGranularity;
+		m_uGranularityLog2 = static_cast<uint32_t>(uGranularityLog2);
+
+		// The whole range starts out as a single free block
+		insertFreeBlock(createBlock(0, m_uSize >> m_uGranularityLog2));
+
+		return S_OK;
+	}
+
+	void TlsfAllocator::Destroy() noexcept
+	{
+		m_Blocks.clear();
+		m_FreeBlockSlots.clear();
+		m_uFirstLevelBitmap = 0;
+		std::memset(m_auSecondLevelBitmaps, 0, sizeof(m_auSecondLevelBitmaps));
+		std::fill(&m_aauFreeListHeads[0][0], &m_aauFreeListHeads[0][0] + FL_COUNT * SL_COUNT, INVALID_BLOCK_INDEX);
+		m_uSize = 0;
+		m_uAllocatedSize = 0;
+		m_uNumAllocations = 0;
+	}
+
+	HRESULT TlsfAllocator::Allocate(TlsfAllocation& outAllocation, UINT64 uSize, UINT64 uAlignment) noexcept
+	{
+		outAllocation = { .uOffset = 0, .uSize = 0, .uBlockIndex = INVALID_BLOCK_INDEX };
+
+		if (uSize == 0 || uAlignment == 0 || (uAlignment & (uAlignment - 1)) != 0)
+		{
+			GLOGEF(L"Invalid TLSF allocation of %llu bytes aligned to %llu", uSize, uAlignment);
+
+			return E_INVALIDARG;
+		}
+
+		const UINT64 uNumUnits = (uSize + m_uGranularity - 1) >> m_uGranularityLog2;
+		const UINT64 uAlignmentUnits = uAlignment > m_uGranularity ? uAlignment >> m_uGranularityLog2 : 1;
+
+		// Any block this big can hold an aligned range of uNumUnits whatever its offset
+		uint32_t uBlockIndex = findFreeBlock(uNumUnits + uAlignmentUnits - 1);
+		if (uBlockIndex == INVALID_BLOCK_INDEX)
+		{
+			return E_OUTOFMEMORY;
+		}
+
+		removeFreeBlock(uBlockIndex);
+
+		// The physical neighbours of a free block are never free, so the pieces cut off can go straight back
+		const UINT64 uAlignedOffset = (m_Blocks[uBlockIndex].uOffset + uAlignmentUnits - 1) & ~(uAlignmentUnits - 1);
+		const UINT64 uPadding = uAlignedOffset - m_Blocks[uBlockIndex].uOffset;
+		if (uPadding > 0)
+		{
+			const uint32_t uAlignedIndex = splitBlock(uBlockIndex, uPadding);
+			insertFreeBlock(uBlockIndex);
+			uBlockIndex = uAlignedIndex;
+		}
+
+		if (m_Blocks[uBlockIndex].uSize > uNumUnits)
+		{
+			insertFreeBlock(splitBlock(uBlockIndex, uNumUnits));
+		}
+
+		Block& block = m_Blocks[uBlockIndex];
+		block.bIsFree = FALSE;
+
+		m_uAllocatedSize += block.uSize << m_uGranularityLog2;
+		++m_uNumAllocations;
+
+		outAllocation.uOffset = block.uOffset << m_uGranularityLog2;
+		outAllocation.uSize = block.uSize << m_uGranularityLog2;
+		outAllocation.uBlockIndex = uBlockIndex;
+
+		return S_OK;
+	}
+
+	void TlsfAllocator::Free(const TlsfAllocation& allocation) noexcept
+	{
+		assert(allocation.uBlockIndex < m_Blocks.size() && !m_Blocks[allocation.uBlockIndex].bIsFree);
+		assert(m_Blocks[allocation.uBlockIndex].uOffset << m_uGranularityLog2 == allocation.uOffset);
+
+		uint32_t uBlockIndex = allocation.uBlockIndex;
+		m_Blocks[uBlockIndex].bIsFree = TRUE;
+
+		m_uAllocatedSize -= m_Blocks[uBlockIndex].uSize << m_uGranularityLog2;
+		--m_uNumAllocations;
+
+		const uint32_t uPrevIndex = m_Blocks[uBlockIndex].uPrevPhysicalIndex;
+		if (uPrevIndex != INVALID_BLOCK_INDEX && m_Blocks[uPrevIndex].bIsFree)
+		{
+			removeFreeBlock(uPrevIndex);
+			mergeBlocks(uPrevIndex, uBlockIndex);
+			uBlockIndex = uPrevIndex;
+		}
+
+		const uint32_t uNextIndex = m_Blocks[uBlockIndex].uNextPhysicalIndex;
+		if (uNextIndex != INVALID_BLOCK_INDEX && m_Blocks[uNextIndex].bIsFree)
+		{
+			removeFreeBlock(uNextIndex);
+			mergeBlocks(uBlockIndex, uNextIndex);
+		}
+
+		insertFreeBlock(uBlockIndex);
+	}
+
+	void TlsfAllocator::GetStatistics(TlsfAllocatorStatistics& outStatistics) const noexcept
+	{
+		outStatistics = {};
+		outStatistics.uTotalSize = m_uSize;
+		outStatistics.uAllocatedSize = m_uAllocatedSize;
+		outStatistics.uNumAllocations = m_uNumAllocations;
+
+		for (const Block& block : m_Blocks)
+		{
+			if (block.bIsFree && block.uSize > 0)
+			{
+				++outStatistics.uNumFreeBlocks;
+				outStatistics.uLargestFreeBlockSize = std::max(outStatistics.uLargestFreeBlockSize, block.uSize << m_uGranularityLog2);
+			}
+		}
+
+		const UINT64 uFreeSize = m_uSize - m_uAllocatedSize;
+		outStatistics.Fragmentation = uFreeSize > 0 ? 1.0f - static_cast<FLOAT>(outStatistics.uLargestFreeBlockSize) / static_cast<FLOAT>(uFreeSize) : 0.0f;
+	}
+
+	void TlsfAllocator::mapInsert(UINT64 uSize, uint32_t& uOutFirstLevel, uint32_t& uOutSecondLevel) noexcept
+	{
+		// Sizes below SL_COUNT get one exact bin each in the first level
+		if (uSize < SL_COUNT)
+		{
+			uOutFirstLevel = 0;
+			uOutSecondLevel = static_cast<uint32_t>(uSize);
+
+			return;
+		}
+
+		unsigned long uHighestBit = 0;
+		_BitScanReverse64(&uHighestBit, uSize);
+
+		uOutFirstLevel = static_cast<uint32_t>(uHighestBit) - SL_COUNT_LOG2 + 1;
+		uOutSecondLevel = static_cast<uint32_t>(uSize >> (uHighestBit - SL_COUNT_LOG2)) - SL_COUNT;
+	}
+
+	void TlsfAllocator::mapSearch(UINT64 uSize, uint32_t& uOutFirstLevel, uint32_t& uOutSecondLevel) noexcept
+	{
+		// Round up to the next bin so that every block found there is big enough
+		if (uSize >= SL_COUNT)
+		{
+			unsigned long uHighestBit = 0;
+			_BitScanReverse64(&uHighestBit, uSize);
+
+			uSize += (1ull << (uHighestBit - SL_COUNT_LOG2)) - 1;
+		}
+
+		mapInsert(uSize, uOutFirstLevel, uOutSecondLevel);
+	}
+
+	uint32_t TlsfAllocator::findFreeBlock(UINT64 uSize) const noexcept
+	{
+		uint32_t uFirstLevel = 0;
+		uint32_t uSecondLevel = 0;
+		mapSearch(uSize, uFirstLevel, uSecondLevel);
+
+		if (uFirstLevel >= FL_COUNT)
+		{
+			return INVALID_BLOCK_INDEX;
+		}
+
+		uint32_t uSecondLevelMap = m_auSecondLevelBitmaps[uFirstLevel] & (~0u << uSecondLevel);
+		if (uSecondLevelMap == 0)
+		{
+			const UINT64 uFirstLevelMap = uFirstLevel + 1 < FL_COUNT ? m_uFirstLevelBitmap & (~0ull << (uFirstLevel + 1)) : 0;
+			if (uFirstLevelMap == 0)
+			{
+				// Rounding up skipped the bin of the size itself, a block in there may still fit exactly
+				mapInsert(uSize, uFirstLevel, uSecondLevel);
+				for (uint32_t uBlockIndex = m_aauFreeListHeads[uFirstLevel][uSecondLevel]; uBlockIndex != INVALID_BLOCK_INDEX; uBlockIndex = m_Blocks[uBlockIndex].uNextFreeIndex)
+				{
+					if (m_Blocks[uBlockIndex].uSize >= uSize)
+					{
+						return uBlockIndex;
+					}
+				}
+
+				return INVALID_BLOCK_INDEX;
+			}
+
+			unsigned long uLowestBit = 0;
+			_BitScanForward64(&uLowestBit, uFirstLevelMap);
+			uFirstLevel = static_cast<uint32_t>(uLowestBit);
+			uSecondLevelMap = m_auSecondLevelBitmaps[uFirstLevel];
+		}
+
+		unsigned long uLowestBit = 0;
+		_BitScanForward(&uLowestBit, uSecondLevelMap);
+
+		return m_aauFreeListHeads[uFirstLevel][uLowestBit];
+	}
+
+	void TlsfAllocator::insertFreeBlock(uint32_t uBlockIndex) noexcept
+	{
+		Block& block = m_Blocks[uBlockIndex];
+
+		uint32_t uFirstLevel = 0;
+		uint32_t uSecondLevel = 0;
+		mapInsert(block.uSize, uFirstLevel, uSecondLevel);
+
+		uint32_t& uHeadIndex = m_aauFreeListHeads[uFirstLevel][uSecondLevel];
+		block.bIsFree = TRUE;
+		block.uPrevFreeIndex = INVALID_BLOCK_INDEX;
+		block.uNextFreeIndex = uHeadIndex;
+		if (uHeadIndex != INVALID_BLOCK_INDEX)
+		{
+			m_Blocks[uHeadIndex].uPrevFreeIndex = uBlockIndex;
+		}
+
+		uHeadIndex = uBlockIndex;
+		m_uFirstLevelBitmap |= 1ull << uFirstLevel;
+		m_auSecondLevelBitmaps[uFirstLevel] |= 1u << uSecondLevel;
+	}
+
+	void TlsfAllocator::removeFreeBlock(uint32_t uBlockIndex) noexcept
+	{
+		Block& block = m_Blocks[uBlockIndex];
+
+		uint32_t uFirstLevel = 0;
+		uint32_t uSecondLevel = 0;
+		mapInsert(block.uSize, uFirstLevel, uSecondLevel);
+
+		if (block.uPrevFreeIndex != INVALID_BLOCK_INDEX)
+		{
+			m_Blocks[block.uPrevFreeIndex].uNextFreeIndex = block.uNextFreeIndex;
+		}
+		else
+		{
+			m_aauFreeListHeads[uFirstLevel][uSecondLevel] = block.uNextFreeIndex;
+		}
+
+		if (block.uNextFreeIndex != INVALID_BLOCK_INDEX)
+		{
+			m_Blocks[block.uNextFreeIndex].uPrevFreeIndex = block.uPrevFreeIndex;
+		}
+
+		if (m_aauFreeListHeads[uFirstLevel][uSecondLevel] == INVALID_BLOCK_INDEX)
+		{
+			m_auSecondLevelBitmaps[uFirstLevel] &= ~(1u << uSecondLevel);
+			if (m_auSecondLevelBitmaps[uFirstLevel] == 0)
+			{
+				m_uFirstLevelBitmap &= ~(1ull << uFirstLevel);
+			}
+		}
+
+		block.uPrevFreeIndex = INVALID_BLOCK_INDEX;
+		block.uNextFreeIndex = INVALID_BLOCK_INDEX;
+	}
+
+	uint32_t TlsfAllocator::createBlock(UINT64 uOffset, UINT64 uSize) noexcept
+	{
+		const Block newBlock =
+		{
+			.uOffset = uOffset,
+			.uSize = uSize,
+			.uPrevPhysicalIndex = INVALID_BLOCK_INDEX,
+			.uNextPhysicalIndex = INVALID_BLOCK_INDEX,
+			.uPrevFreeIndex = INVALID_BLOCK_INDEX,
+			.uNextFreeIndex = INVALID_BLOCK_INDEX,
+			.bIsFree = FALSE,
+		};
+
+		if (!m_FreeBlockSlots.empty())
+		{
+			const uint32_t uBlockIndex = m_FreeBlockSlots.back();
+			m_FreeBlockSlots.pop_back();
+			m_Blocks[uBlockIndex] = newBlock;
+
+			return uBlockIndex;
+		}
+
+		m_Blocks.push_back(newBlock);
+
+		return static_cast<uint32_t>(m_Blocks.size() - 1);
+	}
+
+	void TlsfAllocator::destroyBlock(uint32_t uBlockIndex) noexcept
+	{
+		// Zero sized so that GetStatistics skips the slot until it is reused
+		m_Blocks[uBlockIndex].uSize = 0;
+		m_Blocks[uBlockIndex].bIsFree = FALSE;
+		m_FreeBlockSlots.push_back(uBlockIndex);
+	}
+
+	uint32_t TlsfAllocator::splitBlock(uint32_t uBlockIndex, UINT64 uSize) noexcept
+	{
+		assert(uSize < m_Blocks[uBlockIndex].uSize);
+
+		const uint32_t uRestIndex = createBlock(m_Blocks[uBlockIndex].uOffset + uSize, m_Blocks[uBlockIndex].uSize - uSize);
+
+		// createBlock may have grown m_Blocks, so no references are held across it
+		Block& block = m_Blocks[uBlockIndex];
+		Block& rest = m_Blocks[uRestIndex];
+
+		rest.uPrevPhysicalIndex = uBlockIndex;
+		rest.uNextPhysicalIndex = block.uNextPhysicalIndex;
+		if (block.uNextPhysicalIndex != INVALID_BLOCK_INDEX)
+		{
+			m_Blocks[block.uNextPhysicalIndex].uPrevPhysicalIndex = uRestIndex;
+		}
+
+		block.uNextPhysicalIndex = uRestIndex;
+		block.uSize = uSize;
+
+		return uRestIndex;
+	}
+
+	void TlsfAllocator::mergeBlocks(uint32_t uBlockIndex, uint32_t uNextIndex) noexcept
+	{
+		Block& block = m_Blocks[uBlockIndex];
+		const Block& next = m_Blocks[uNextIndex];
+		assert(block.uNextPhysicalIndex == uNextIndex);
+
+		block.uSize += next.uSize;
+		block.uNextPhysicalIndex = next.uNextPhysicalIndex;
+		if (next.uNextPhysicalIndex != INVALID_BLOCK_INDEX)
+		{
+			m_Blocks[next.uNextPhysicalIndex].uPrevPhysicalIndex = uBlockIndex;
+		}
+
+		destroyBlock(uNextIndex);
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	struct TlsfAllocation
+	{
+		UINT64 uOffset;
+		UINT64 uSize;
+		uint32_t uBlockIndex;
+	};
+
+	struct TlsfAllocatorStatistics
+	{
+		UINT64 uTotalSize;
+		UINT64 uAllocatedSize;
+		UINT64 uLargestFreeBlockSize;
+		uint32_t uNumAllocations;
+		uint32_t uNumFreeBlocks;
+
+		// 0 when all the free space is one block, close to 1 when it is scattered in small pieces
+		FLOAT Fragmentation;
+	};
+
+	// Two-level segregated fit allocator over an abstract range of memory.  It only does the bookkeeping of
+	// offsets, so it runs without a device.  Free blocks are binned by the position of their highest bit
+	// and SL_COUNT linear subdivisions below it, both Allocate and Free are O(1) and freed blocks are
+	// merged with their physical neighbours right away.  Sizes are rounded up to the granularity.
+	class TlsfAllocator final
+	{
+	public:
+		static constexpr const uint32_t INVALID_BLOCK_INDEX = UINT32_MAX;
+
+	public:
+		explicit TlsfAllocator() noexcept;
+		TlsfAllocator(const TlsfAllocator& other) = delete;
+		TlsfAllocator(TlsfAllocator&& other) = delete;
+		TlsfAllocator& operator=(const TlsfAllocator& other) = delete;
+		TlsfAllocator& operator=(TlsfAllocator&& other) = delete;
+		~TlsfAllocator() noexcept = default;
+
+		// uGranularity has to be a power of two
+		HRESULT Initialize(_In_ UINT64 uSize, _In_ UINT64 uGranularity) noexcept;
+		void Destroy() noexcept;
+
+		// Returns E_OUTOFMEMORY without logging when no free block fits, callers are expected to try elsewhere
+		HRESULT Allocate(_Out_ TlsfAllocation& outAllocation, _In_ UINT64 uSize, _In_ UINT64 uAlignment) noexcept;
+		void Free(_In_ const TlsfAllocation& allocation) noexcept;
+
+		constexpr BOOL IsEmpty() const noexcept;
+		constexpr UINT64 GetSize() const noexcept;
+		void GetStatistics(_Out_ TlsfAllocatorStatistics& outStatistics) const noexcept;
+
+	private:
+		static constexpr const uint32_t SL_COUNT_LOG2 = 4;
+		static constexpr const uint32_t SL_COUNT = 1u << SL_COUNT_LOG2;
+		static constexpr const uint32_t FL_COUNT = 64;
+
+		// Sizes and offsets are in units of the granularity
+		struct Block
+		{
+			UINT64 uOffset;
+			UINT64 uSize;
+			uint32_t uPrevPhysicalIndex;
+			uint32_t uNextPhysicalIndex;
+			uint32_t uPrevFreeIndex;
+			uint32_t uNextFreeIndex;
+			BOOL bIsFree;
+		};
+
+	private:
+		static void mapInsert(_In_ UINT64 uSize, _Out_ uint32_t& uOutFirstLevel, _Out_ uint32_t& uOutSecondLevel) noexcept;
+		static void mapSearch(_In_ UINT64 uSize, _Out_ uint32_t& uOutFirstLevel, _Out_ uint32_t& uOutSecondLevel) noexcept;
+
+		uint32_t findFreeBlock(_In_ UINT64 uSize) const noexcept;
+		void insertFreeBlock(_In_ uint32_t uBlockIndex) noexcept;
+		void removeFreeBlock(_In_ uint32_t uBlockIndex) noexcept;
+		uint32_t createBlock(_In_ UINT64 uOffset, _In_ UINT64 uSize) noexcept;
+		void destroyBlock(_In_ uint32_t uBlockIndex) noexcept;
+
+		// Cuts uSize units off the front of the block, the front keeps uBlockIndex and the rest is returned
+		uint32_t splitBlock(_In_ uint32_t uBlockIndex, _In_ UINT64 uSize) noexcept;
+
+		// Merges uNextIndex into uBlockIndex, both must be free and already out of the free lists
+		void mergeBlocks(_In_ uint32_t uBlockIndex, _In_ uint32_t uNextIndex) noexcept;
+
+	private:
+		UINT64 m_uSize;
+		UINT64 m_uGranularity;
+		uint32_t m_uGranularityLog2;
+
+		std::vector<Block> m_Blocks;
+		std::vector<uint32_t> m_FreeBlockSlots;
+
+		UINT64 m_uFirstLevelBitmap;
+		uint32_t m_auSecondLevelBitmaps[FL_COUNT];
+		uint32_t m_aauFreeListHeads[FL_COUNT][SL_COUNT];
+
+		UINT64 m_uAllocatedSize;
+		uint32_t m_uNumAllocations;
+	};
+
+	inline constexpr BOOL TlsfAllocator::IsEmpty() const noexcept
+	{
+		return m_uNumAllocations == 0;
+	}
+
+	inline constexpr UINT64 TlsfAllocator::GetSize() const noexcept
+	{
+		return m_uSize;
+	}
+}
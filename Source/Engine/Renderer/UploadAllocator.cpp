@@ -0,0 +1,392 @@
+#include "Pch.h"
+#include "Renderer/UploadAllocator.h"
+
+#include "Renderer/CommandListManager.h"
+
+namespace esperanza
+{
+	D3D12UploadPageProvider::D3D12UploadPageProvider() noexcept
+		: m_pDevice()
+		, m_pCommandListManager(nullptr)
+	{
+	}
+
+	HRESULT D3D12UploadPageProvider::Initialize(ID3D12Device* pDevice, CommandListManager& commandListManager) noexcept
+	{
+		if (!pDevice)
+		{
+			GLOGE(L"Device is null!");
+
+			return E_FAIL;
+		}
+
+		m_pDevice = pDevice;
+		m_pCommandListManager = &commandListManager;
+
+		return S_OK;
+	}
+
+	void D3D12UploadPageProvider::Destroy() noexcept
+	{
+		m_pDevice.Reset();
+		m_pCommandListManager = nullptr;
+	}
+
+	HRESULT D3D12UploadPageProvider::CreatePage(UploadPage& outPage, UINT64 uSize) noexcept
+	{
+		HRESULT hr = S_OK;
+		outPage = {};
+
+		CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+		CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(uSize);
+
+		hr = m_pDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&outPage.pResource));
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Creating upload page failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+#ifdef _DEBUG
+		outPage.pResource->SetName(L"Upload Page");
+#endif
+
+		// Upload pages stay mapped for their whole life, the CPU never reads from them
+		CD3DX12_RANGE readRange(0, 0);
+		hr = outPage.pResource->Map(0, &readRange, reinterpret_cast<void**>(&outPage.pCpuAddress));
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Mapping upload page failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			outPage.pResource.Reset();
+
+			return hr;
+		}
+
+		outPage.GpuVirtualAddress = outPage.pResource->GetGPUVirtualAddress();
+		outPage.uSize = uSize;
+
+		return hr;
+	}
+
+	void D3D12UploadPageProvider::DestroyPage(UploadPage& page) noexcept
+	{
+		if (page.pResource)
+		{
+			page.pResource->Unmap(0, nullptr);
+			page.pResource.Reset();
+		}
+
+		page = {};
+	}
+
+	BOOL D3D12UploadPageProvider::IsFenceComplete(UINT64 uFenceValue) noexcept
+	{
+		return m_pCommandListManager->IsFenceComplete(uFenceValue);
+	}
+
+	CpuUploadPageProvider::CpuUploadPageProvider() noexcept
+		: m_uCompletedFenceValue(0)
+		, m_uNumLivePages(0)
+		, m_uNumCreatedPages(0)
+	{
+	}
+
+	HRESULT CpuUploadPageProvider::CreatePage(UploadPage& outPage, UINT64 uSize) noexcept
+	{
+		outPage = {};
+
+		// Aligned like a committed buffer, so offsets behave the same as on an upload heap
+		outPage.pCpuAddress = static_cast<BYTE*>(_aligned_malloc(static_cast<size_t>(uSize), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+		if (!outPage.pCpuAddress)
+		{
+			GLOGEF(L"Allocating CPU upload page of %llu bytes failed", uSize);
+
+			return E_OUTOFMEMORY;
+		}
+
+		outPage.GpuVirtualAddress = reinterpret_cast<D3D12_GPU_VIRTUAL_ADDRESS>(outPage.pCpuAddress);
+		outPage.uSize = uSize;
+
+		m_uNumLivePages.fetch_add(1, std::memory_order_relaxed);
+		m_uNumCreatedPages.fetch_add(1, std::memory_order_relaxed);
+
+		return S_OK;
+	}
+
+	void CpuUploadPageProvider::DestroyPage(UploadPage& page) noexcept
+	{
+		if (page.pCpuAddress)
+		{
+			_aligned_free(page.pCpuAddress);
+			m_uNumLivePages.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		page = {};
+	}
+
+	BOOL CpuUploadPageProvider::IsFenceComplete(UINT64 uFenceValue) noexcept
+	{
+		return uFenceValue <= m_uCompletedFenceValue.load(std::memory_order_acquire);
+	}
+
+	LinearUploadAllocator::LinearUploadAllocator() noexcept
+		: m_pPageProvider(nullptr)
+		, m_uPageSize(DEFAULT_PAGE_SIZE)
+		, m_AllocationMutex()
+		, m_Pages()
+		, m_FreePageSlots()
+		, m_AvailablePages()
+		, m_UsedPages()
+		, m_UsedLargePages()
+		, m_RetiredPages()
+		, m_uCurrentPageIndex(INVALID_PAGE_INDEX)
+		, m_uCurrentOffset(0)
+		, m_uNumRecycledPages(0)
+		, m_uNumLargePages(0)
+		, m_uBytesAllocated(0)
+	{
+	}
+
+	HRESULT LinearUploadAllocator::Initialize(UploadPageProvider& pageProvider) noexcept
+	{
+		return Initialize(pageProvider, DEFAULT_PAGE_SIZE);
+	}
+
+	HRESULT LinearUploadAllocator::Initialize(UploadPageProvider& pageProvider, UINT64 uPageSize) noexcept
+	{
+		if (uPageSize == 0)
+		{
+			GLOGE(L"Upload page size is zero!");
+
+			return E_INVALIDARG;
+		}
+
+		m_pPageProvider = &pageProvider;
+		m_uPageSize = uPageSize;
+
+		return S_OK;
+	}
+
+	void LinearUploadAllocator::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		if (m_pPageProvider)
+		{
+			for (UploadPage& page : m_Pages)
+			{
+				if (page.pCpuAddress)
+				{
+					m_pPageProvider->DestroyPage(page);
+				}
+			}
+		}
+
+		m_Pages.clear();
+		m_FreePageSlots.clear();
+		m_AvailablePages.clear();
+		m_UsedPages.clear();
+		m_UsedLargePages.clear();
+		m_RetiredPages = {};
+		m_uCurrentPageIndex = INVALID_PAGE_INDEX;
+		m_uCurrentOffset = 0;
+		m_pPageProvider = nullptr;
+	}
+
+	HRESULT LinearUploadAllocator::Allocate(UploadAllocation& outAllocation, UINT64 uSize, UINT64 uAlignment) noexcept
+	{
+		HRESULT hr = S_OK;
+		outAllocation = {};
+
+		if (uAlignment == 0)
+		{
+			uAlignment = 1;
+		}
+
+		if ((uAlignment & (uAlignment - 1)) != 0 || uSize == 0)
+		{
+			GLOGEF(L"Invalid upload allocation of %llu bytes aligned to %llu", uSize, uAlignment);
+
+			return E_INVALIDARG;
+		}
+
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		if (uSize > m_uPageSize)
+		{
+			return allocateLargePage(outAllocation, uSize);
+		}
+
+		UINT64 uAlignedOffset = (m_uCurrentOffset + uAlignment - 1) & ~(uAlignment - 1);
+		if (m_uCurrentPageIndex == INVALID_PAGE_INDEX || uAlignedOffset + uSize > m_uPageSize)
+		{
+			hr = acquirePage(m_uCurrentPageIndex);
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"Acquiring upload page failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			uAlignedOffset = 0;
+		}
+
+		const UploadPage& page = m_Pages[m_uCurrentPageIndex];
+		outAllocation.pResource = page.pResource.Get();
+		outAllocation.uOffset = uAlignedOffset;
+		outAllocation.pCpuAddress = page.pCpuAddress + uAlignedOffset;
+		outAllocation.GpuVirtualAddress = page.GpuVirtualAddress + uAlignedOffset;
+		outAllocation.uSize = uSize;
+
+		m_uCurrentOffset = uAlignedOffset + uSize;
+		m_uBytesAllocated += uSize;
+
+		return hr;
+	}
+
+	void LinearUploadAllocator::RetirePages(UINT64 uFenceValue) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		for (size_t uPageIndex : m_UsedPages)
+		{
+			m_RetiredPages.push(RetiredPage{ uFenceValue, uPageIndex, FALSE });
+		}
+
+		for (size_t uPageIndex : m_UsedLargePages)
+		{
+			m_RetiredPages.push(RetiredPage{ uFenceValue, uPageIndex, TRUE });
+		}
+
+		m_UsedPages.clear();
+		m_UsedLargePages.clear();
+
+		// The next allocation starts a fresh page, the current one is owned by the fence now
+		m_uCurrentPageIndex = INVALID_PAGE_INDEX;
+		m_uCurrentOffset = 0;
+	}
+
+	void LinearUploadAllocator::GetStatistics(UploadAllocatorStatistics& outStatistics) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_AllocationMutex);
+
+		outStatistics.uNumPages = m_Pages.size() - m_FreePageSlots.size();
+		outStatistics.uNumAvailablePages = m_AvailablePages.size();
+		outStatistics.uNumRetiredPages = m_RetiredPages.size();
+		outStatistics.uNumRecycledPages = m_uNumRecycledPages;
+		outStatistics.uNumLargePages = m_uNumLargePages;
+		outStatistics.uBytesAllocated = m_uBytesAllocated;
+	}
+
+	HRESULT LinearUploadAllocator::acquirePage(size_t& uOutPageIndex) noexcept
+	{
+		HRESULT hr = S_OK;
+		uOutPageIndex = INVALID_PAGE_INDEX;
+
+		collectCompletedPages();
+
+		if (!m_AvailablePages.empty())
+		{
+			uOutPageIndex = m_AvailablePages.back();
+			m_AvailablePages.pop_back();
+			m_UsedPages.push_back(uOutPageIndex);
+			++m_uNumRecycledPages;
+
+			return hr;
+		}
+
+		UploadPage newPage = {};
+		hr = m_pPageProvider->CreatePage(newPage, m_uPageSize);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Creating upload page failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		if (!m_FreePageSlots.empty())
+		{
+			uOutPageIndex = m_FreePageSlots.back();
+			m_FreePageSlots.pop_back();
+			m_Pages[uOutPageIndex] = std::move(newPage);
+		}
+		else
+		{
+			uOutPageIndex = m_Pages.size();
+			m_Pages.push_back(std::move(newPage));
+		}
+
+		m_UsedPages.push_back(uOutPageIndex);
+
+		return hr;
+	}
+
+	HRESULT LinearUploadAllocator::allocateLargePage(UploadAllocation& outAllocation, UINT64 uSize) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		collectCompletedPages();
+
+		UploadPage newPage = {};
+		hr = m_pPageProvider->CreatePage(newPage, uSize);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Creating large upload page failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		size_t uPageIndex = INVALID_PAGE_INDEX;
+		if (!m_FreePageSlots.empty())
+		{
+			uPageIndex = m_FreePageSlots.back();
+			m_FreePageSlots.pop_back();
+			m_Pages[uPageIndex] = std::move(newPage);
+		}
+		else
+		{
+			uPageIndex = m_Pages.size();
+			m_Pages.push_back(std::move(newPage));
+		}
+
+		m_UsedLargePages.push_back(uPageIndex);
+		++m_uNumLargePages;
+
+		const UploadPage& page = m_Pages[uPageIndex];
+		outAllocation.pResource = page.pResource.Get();
+		outAllocation.uOffset = 0;
+		outAllocation.pCpuAddress = page.pCpuAddress;
+		outAllocation.GpuVirtualAddress = page.GpuVirtualAddress;
+		outAllocation.uSize = uSize;
+
+		m_uBytesAllocated += uSize;
+
+		return hr;
+	}
+
+	void LinearUploadAllocator::collectCompletedPages() noexcept
+	{
+		while (!m_RetiredPages.empty() && m_pPageProvider->IsFenceComplete(m_RetiredPages.front().uFenceValue))
+		{
+			const RetiredPage& retiredPage = m_RetiredPages.front();
+			if (retiredPage.bIsLargePage)
+			{
+				m_pPageProvider->DestroyPage(m_Pages[retiredPage.uPageIndex]);
+				m_FreePageSlots.push_back(retiredPage.uPageIndex);
+			}
+			else
+			{
+				m_AvailablePages.push_back(retiredPage.uPageIndex);
+			}
+
+			m_RetiredPages.pop();
+		}
+	}
+}
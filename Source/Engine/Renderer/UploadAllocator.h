@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+
+	// Backing memory of one upload page.  pResource is null for pages that do not come from the GPU.
+	struct UploadPage
+	{
+		ComPtr<ID3D12Resource> pResource;
+		BYTE* pCpuAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuVirtualAddress;
+		UINT64 uSize;
+	};
+
+	struct UploadAllocation
+	{
+		ID3D12Resource* pResource;
+		UINT64 uOffset;
+		BYTE* pCpuAddress;
+		D3D12_GPU_VIRTUAL_ADDRESS GpuVirtualAddress;
+		UINT64 uSize;
+	};
+
+	struct UploadAllocatorStatistics
+	{
+		UINT64 uNumPages;
+		UINT64 uNumAvailablePages;
+		UINT64 uNumRetiredPages;
+		UINT64 uNumRecycledPages;
+		UINT64 uNumLargePages;
+		UINT64 uBytesAllocated;
+	};
+
+	// Where upload pages come from and how their fences are checked.  The allocator only talks to the GPU
+	// through this, so its paging and recycling can run against plain CPU memory and a fake fence.
+	class UploadPageProvider
+	{
+	public:
+		virtual ~UploadPageProvider() noexcept = default;
+
+		virtual HRESULT CreatePage(_Out_ UploadPage& outPage, _In_ UINT64 uSize) noexcept = 0;
+		virtual void DestroyPage(_Inout_ UploadPage& page) noexcept = 0;
+		virtual BOOL IsFenceComplete(_In_ UINT64 uFenceValue) noexcept = 0;
+	};
+
+	// Persistently mapped upload heap buffers, fences are checked through the command list manager
+	class D3D12UploadPageProvider final : public UploadPageProvider
+	{
+	public:
+		explicit D3D12UploadPageProvider() noexcept;
+		D3D12UploadPageProvider(const D3D12UploadPageProvider& other) = delete;
+		D3D12UploadPageProvider(D3D12UploadPageProvider&& other) = delete;
+		D3D12UploadPageProvider& operator=(const D3D12UploadPageProvider& other) = delete;
+		D3D12UploadPageProvider& operator=(D3D12UploadPageProvider&& other) = delete;
+		~D3D12UploadPageProvider() noexcept = default;
+
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ CommandListManager& commandListManager) noexcept;
+		void Destroy() noexcept;
+
+		HRESULT CreatePage(_Out_ UploadPage& outPage, _In_ UINT64 uSize) noexcept override;
+		void DestroyPage(_Inout_ UploadPage& page) noexcept override;
+		BOOL IsFenceComplete(_In_ UINT64 uFenceValue) noexcept override;
+
+	private:
+		ComPtr<ID3D12Device> m_pDevice;
+		CommandListManager* m_pCommandListManager;
+	};
+
+	// Pages in plain CPU memory with a fence the caller completes by hand, so the allocators built on upload
+	// pages run without a device.  GPU virtual addresses are the CPU addresses of the pages.
+	class CpuUploadPageProvider final : public UploadPageProvider
+	{
+	public:
+		explicit CpuUploadPageProvider() noexcept;
+		CpuUploadPageProvider(const CpuUploadPageProvider& other) = delete;
+		CpuUploadPageProvider(CpuUploadPageProvider&& other) = delete;
+		CpuUploadPageProvider& operator=(const CpuUploadPageProvider& other) = delete;
+		CpuUploadPageProvider& operator=(CpuUploadPageProvider&& other) = delete;
+		~CpuUploadPageProvider() noexcept = default;
+
+		HRESULT CreatePage(_Out_ UploadPage& outPage, _In_ UINT64 uSize) noexcept override;
+		void DestroyPage(_Inout_ UploadPage& page) noexcept override;
+		BOOL IsFenceComplete(_In_ UINT64 uFenceValue) noexcept override;
+
+		void SetCompletedFenceValue(_In_ UINT64 uFenceValue) noexcept;
+
+		UINT64 GetNumLivePages() const noexcept;
+		UINT64 GetNumCreatedPages() const noexcept;
+
+	private:
+		std::atomic<UINT64> m_uCompletedFenceValue;
+		std::atomic<UINT64> m_uNumLivePages;
+		std::atomic<UINT64> m_uNumCreatedPages;
+	};
+
+	// Sub-allocates large upload pages linearly.  Pages used since the last RetirePages call are tagged with
+	// the given fence value and handed out again once it completes.  Requests bigger than a page get a page
+	// of their own which is destroyed instead of recycled.
+	class LinearUploadAllocator final
+	{
+	public:
+		static constexpr const UINT64 DEFAULT_PAGE_SIZE = 0x200000;	// 2MB
+
+	public:
+		explicit LinearUploadAllocator() noexcept;
+		LinearUploadAllocator(const LinearUploadAllocator& other) = delete;
+		LinearUploadAllocator(LinearUploadAllocator&& other) = delete;
+		LinearUploadAllocator& operator=(const LinearUploadAllocator& other) = delete;
+		LinearUploadAllocator& operator=(LinearUploadAllocator&& other) = delete;
+		~LinearUploadAllocator() noexcept = default;
+
+		HRESULT Initialize(_In_ UploadPageProvider& pageProvider) noexcept;
+		HRESULT Initialize(_In_ UploadPageProvider& pageProvider, _In_ UINT64 uPageSize) noexcept;
+
+		// Pages still in flight are destroyed as well, the GPU must be done with them
+		void Destroy() noexcept;
+
+		HRESULT Allocate(_Out_ UploadAllocation& outAllocation, _In_ UINT64 uSize, _In_ UINT64 uAlignment) noexcept;
+		void RetirePages(_In_ UINT64 uFenceValue) noexcept;
+
+		constexpr UINT64 GetPageSize() const noexcept;
+		void GetStatistics(_Out_ UploadAllocatorStatistics& outStatistics) noexcept;
+
+	private:
+		static constexpr const size_t INVALID_PAGE_INDEX = SIZE_MAX;
+
+		struct RetiredPage
+		{
+			UINT64 uFenceValue;
+			size_t uPageIndex;
+			BOOL bIsLargePage;
+		};
+
+	private:
+		HRESULT acquirePage(_Out_ size_t& uOutPageIndex) noexcept;
+		HRESULT allocateLargePage(_Out_ UploadAllocation& outAllocation, _In_ UINT64 uSize) noexcept;
+		void collectCompletedPages() noexcept;
+
+	private:
+		UploadPageProvider* m_pPageProvider;
+		UINT64 m_uPageSize;
+		std::mutex m_AllocationMutex;
+
+		// Slots of destroyed large pages are reused through m_FreePageSlots
+		std::vector<UploadPage> m_Pages;
+		std::vector<size_t> m_FreePageSlots;
+		std::vector<size_t> m_AvailablePages;
+		std::vector<size_t> m_UsedPages;
+		std::vector<size_t> m_UsedLargePages;
+		std::queue<RetiredPage> m_RetiredPages;
+
+		size_t m_uCurrentPageIndex;
+		UINT64 m_uCurrentOffset;
+
+		UINT64 m_uNumRecycledPages;
+		UINT64 m_uNumLargePages;
+		UINT64 m_uBytesAllocated;
+	};
+
+	inline void CpuUploadPageProvider::SetCompletedFenceValue(UINT64 uFenceValue) noexcept
+	{
+		m_uCompletedFenceValue.store(uFenceValue, std::memory_order_release);
+	}
+
+	inline UINT64 CpuUploadPageProvider::GetNumLivePages() const noexcept
+	{
+		return m_uNumLivePages.load(std::memory_order_relaxed);
+	}
+
+	inline UINT64 CpuUploadPageProvider::GetNumCreatedPages() const noexcept
+	{
+		return m_uNumCreatedPages.load(std::memory_order_relaxed);
+	}
+
+	inline constexpr UINT64 LinearUploadAllocator::GetPageSize() const noexcept
+	{
+		return m_uPageSize;
+	}
+}
@@ -0,0 +1,239 @@
+#include "Pch.h"
+#include "Renderer/UploadBatcher.h"
+
+#include "Renderer/CommandContext.h"
+#include "Renderer/CommandListManager.h"
+#include "Renderer/GpuResource.h"
+#include "Renderer/UploadAllocator.h"
+
+namespace esperanza
+{
+	UploadBatcher::UploadBatcher() noexcept
+		: m_pDevice()
+		, m_pUploadAllocator(nullptr)
+		, m_pContextManager(nullptr)
+		, m_pCommandListManager(nullptr)
+		, m_UploadMutex()
+		, m_PendingBufferCopies()
+		, m_PendingTextureCopies()
+		, m_uLastFenceValue(0)
+		, m_Statistics()
+	{
+	}
+
+	HRESULT UploadBatcher::Initialize(ID3D12Device* pDevice, LinearUploadAllocator& uploadAllocator, ContextManager& contextManager, CommandListManager& commandListManager) noexcept
+	{
+		if (!pDevice)
+		{
+			GLOGE(L"Device is null!");
+
+			return E_FAIL;
+		}
+
+		m_pDevice = pDevice;
+		m_pUploadAllocator = &uploadAllocator;
+		m_pContextManager = &contextManager;
+		m_pCommandListManager = &commandListManager;
+
+		return S_OK;
+	}
+
+	void UploadBatcher::Destroy() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_UploadMutex);
+
+		m_PendingBufferCopies.clear();
+		m_PendingTextureCopies.clear();
+		m_pUploadAllocator = nullptr;
+		m_pContextManager = nullptr;
+		m_pCommandListManager = nullptr;
+		m_pDevice.Reset();
+	}
+
+	HRESULT UploadBatcher::UploadBuffer(GpuResource& destination, UINT64 uDestinationOffset, const void* pData, UINT64 uSize) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		std::lock_guard<std::mutex> lockGuard(m_UploadMutex);
+
+		// CopyBufferRegion has no alignment requirement, packing tightly keeps consecutive uploads mergeable
+		UploadAllocation allocation;
+		hr = m_pUploadAllocator->Allocate(allocation, uSize, 1u);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Allocating upload memory failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		std::memcpy(allocation.pCpuAddress, pData, static_cast<size_t>(uSize));
+
+		ID3D12Resource* pDestination = destination.GetResource();
+		if (!m_PendingBufferCopies.empty())
+		{
+			PendingBufferCopy& lastCopy = m_PendingBufferCopies.back();
+			if (lastCopy.pDestination == pDestination && lastCopy.uDestinationOffset + lastCopy.uSize == uDestinationOffset &&
+				lastCopy.pSource == allocation.pResource && lastCopy.uSourceOffset + lastCopy.uSize == allocation.uOffset)
+			{
+				lastCopy.uSize += uSize;
+				pDestination = nullptr;
+			}
+		}
+
+		if (pDestination)
+		{
+			m_PendingBufferCopies.push_back(PendingBufferCopy{ pDestination, uDestinationOffset, allocation.pResource, allocation.uOffset, uSize });
+		}
+
+		++m_Statistics.uNumBufferUploads;
+		m_Statistics.uBytesUploaded += uSize;
+
+		if (getNumPendingCopies() >= MAX_NUM_PENDING_COPIES)
+		{
+			UINT64 uFenceValue = 0;
+			hr = flush(uFenceValue);
+		}
+
+		return hr;
+	}
+
+	HRESULT UploadBatcher::UploadTexture(GpuResource& destination, UINT uFirstSubresource, UINT uNumSubresources, const D3D12_SUBRESOURCE_DATA* pData) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		ID3D12Resource* pDestination = destination.GetResource();
+		D3D12_RESOURCE_DESC resourceDesc = pDestination->GetDesc();
+
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(uNumSubresources);
+		std::vector<UINT> numRows(uNumSubresources);
+		std::vector<UINT64> rowSizes(uNumSubresources);
+		UINT64 uTotalSize = 0;
+		m_pDevice->GetCopyableFootprints(&resourceDesc, uFirstSubresource, uNumSubresources, 0, footprints.data(), numRows.data(), rowSizes.data(), &uTotalSize);
+
+		std::lock_guard<std::mutex> lockGuard(m_UploadMutex);
+
+		UploadAllocation allocation;
+		hr = m_pUploadAllocator->Allocate(allocation, uTotalSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Allocating upload memory failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		for (UINT i = 0; i < uNumSubresources; ++i)
+		{
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = footprints[i];
+			BYTE* pDestinationSubresource = allocation.pCpuAddress + footprint.Offset;
+			const BYTE* pSourceSubresource = static_cast<const BYTE*>(pData[i].pData);
+
+			// Rows in the upload page are padded to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+			for (UINT z = 0; z < footprint.Footprint.Depth; ++z)
+			{
+				for (UINT y = 0; y < numRows[i]; ++y)
+				{
+					std::memcpy(pDestinationSubresource + (static_cast<UINT64>(z) * numRows[i] + y) * footprint.Footprint.RowPitch,
+						pSourceSubresource + z * pData[i].SlicePitch + y * pData[i].RowPitch,
+						static_cast<size_t>(rowSizes[i]));
+				}
+			}
+
+			PendingTextureCopy& textureCopy = m_PendingTextureCopies.emplace_back();
+			textureCopy.pDestination = pDestination;
+			textureCopy.uSubresource = uFirstSubresource + i;
+			textureCopy.pSource = allocation.pResource;
+			textureCopy.Footprint = footprint;
+			textureCopy.Footprint.Offset += allocation.uOffset;
+		}
+
+		++m_Statistics.uNumTextureUploads;
+		m_Statistics.uBytesUploaded += uTotalSize;
+
+		if (getNumPendingCopies() >= MAX_NUM_PENDING_COPIES)
+		{
+			UINT64 uFenceValue = 0;
+			hr = flush(uFenceValue);
+		}
+
+		return hr;
+	}
+
+	HRESULT UploadBatcher::Flush(UINT64& uOutFenceValue) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_UploadMutex);
+
+		return flush(uOutFenceValue);
+	}
+
+	UINT64 UploadBatcher::GetLastFenceValue() noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_UploadMutex);
+
+		return m_uLastFenceValue;
+	}
+
+	void UploadBatcher::GetStatistics(UploadBatcherStatistics& outStatistics) noexcept
+	{
+		std::lock_guard<std::mutex> lockGuard(m_UploadMutex);
+
+		outStatistics = m_Statistics;
+	}
+
+	HRESULT UploadBatcher::flush(UINT64& uOutFenceValue) noexcept
+	{
+		HRESULT hr = S_OK;
+
+		if (getNumPendingCopies() == 0)
+		{
+			uOutFenceValue = m_uLastFenceValue;
+
+			return hr;
+		}
+
+		CommandContext* pContext = nullptr;
+		hr = m_pContextManager->BeginCopyContext(&pContext, L"Upload Batch");
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Beginning copy context failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		ID3D12GraphicsCommandList* pCommandList = pContext->GetCommandList();
+		for (const PendingBufferCopy& bufferCopy : m_PendingBufferCopies)
+		{
+			pCommandList->CopyBufferRegion(bufferCopy.pDestination, bufferCopy.uDestinationOffset, bufferCopy.pSource, bufferCopy.uSourceOffset, bufferCopy.uSize);
+		}
+
+		for (const PendingTextureCopy& textureCopy : m_PendingTextureCopies)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(textureCopy.pDestination, textureCopy.uSubresource);
+			CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(textureCopy.pSource, textureCopy.Footprint);
+			pCommandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+		}
+
+		hr = pContext->Finish(uOutFenceValue);
+		if (FAILED(hr))
+		{
+			_com_error err(hr);
+			GLOGEF(L"Submitting upload batch failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+			return hr;
+		}
+
+		m_pUploadAllocator->RetirePages(uOutFenceValue);
+
+		m_Statistics.uNumBufferCopies += m_PendingBufferCopies.size();
+		m_Statistics.uNumTextureCopies += m_PendingTextureCopies.size();
+		++m_Statistics.uNumSubmissions;
+
+		m_PendingBufferCopies.clear();
+		m_PendingTextureCopies.clear();
+		m_uLastFenceValue = uOutFenceValue;
+
+		return hr;
+	}
+}
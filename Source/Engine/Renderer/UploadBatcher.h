@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza
+{
+	class CommandListManager;
+	class ContextManager;
+	class GpuResource;
+	class LinearUploadAllocator;
+
+	struct UploadBatcherStatistics
+	{
+		UINT64 uNumBufferUploads;
+		UINT64 uNumTextureUploads;
+		UINT64 uNumBufferCopies;
+		UINT64 uNumTextureCopies;
+		UINT64 uNumSubmissions;
+		UINT64 uBytesUploaded;
+	};
+
+	// Stages uploads in the linear upload allocator and records them into a single copy queue submission on
+	// Flush.  Buffer uploads into consecutive ranges of the same buffer come out as one CopyBufferRegion.
+	// Destinations must be in the common state, they are promoted to copy dest by the copy queue and decay
+	// back when the copy is done, so no barriers are needed.  Consumers on other queues wait for the fence
+	// value returned by Flush.  The upload allocator must not be shared, every page it handed out is retired
+	// with the fence of the batch.
+	class UploadBatcher final
+	{
+	public:
+		static constexpr const size_t MAX_NUM_PENDING_COPIES = 256u;
+
+	public:
+		explicit UploadBatcher() noexcept;
+		UploadBatcher(const UploadBatcher& other) = delete;
+		UploadBatcher(UploadBatcher&& other) = delete;
+		UploadBatcher& operator=(const UploadBatcher& other) = delete;
+		UploadBatcher& operator=(UploadBatcher&& other) = delete;
+		~UploadBatcher() noexcept = default;
+
+		HRESULT Initialize(_In_ ID3D12Device* pDevice, _In_ LinearUploadAllocator& uploadAllocator, _In_ ContextManager& contextManager, _In_ CommandListManager& commandListManager) noexcept;
+		void Destroy() noexcept;
+
+		HRESULT UploadBuffer(_In_ GpuResource& destination, _In_ UINT64 uDestinationOffset, _In_reads_bytes_(uSize) const void* pData, _In_ UINT64 uSize) noexcept;
+		HRESULT UploadTexture(_In_ GpuResource& destination, _In_ UINT uFirstSubresource, _In_ UINT uNumSubresources, _In_reads_(uNumSubresources) const D3D12_SUBRESOURCE_DATA* pData) noexcept;
+
+		// Submits every staged copy, uOutFenceValue is the copy queue fence value they complete with
+		HRESULT Flush(_Out_ UINT64& uOutFenceValue) noexcept;
+
+		UINT64 GetLastFenceValue() noexcept;
+		void GetStatistics(_Out_ UploadBatcherStatistics& outStatistics) noexcept;
+
+	private:
+		struct PendingBufferCopy
+		{
+			ID3D12Resource* pDestination;
+			UINT64 uDestinationOffset;
+			ID3D12Resource* pSource;
+			UINT64 uSourceOffset;
+			UINT64 uSize;
+		};
+
+		struct PendingTextureCopy
+		{
+			ID3D12Resource* pDestination;
+			UINT uSubresource;
+			ID3D12Resource* pSource;
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT Footprint;
+		};
+
+	private:
+		HRESULT flush(_Out_ UINT64& uOutFenceValue) noexcept;
+		constexpr size_t getNumPendingCopies() const noexcept;
+
+	private:
+		ComPtr<ID3D12Device> m_pDevice;
+		LinearUploadAllocator* m_pUploadAllocator;
+		ContextManager* m_pContextManager;
+		CommandListManager* m_pCommandListManager;
+
+		std::mutex m_UploadMutex;
+		std::vector<PendingBufferCopy> m_PendingBufferCopies;
+		std::vector<PendingTextureCopy> m_PendingTextureCopies;
+		UINT64 m_uLastFenceValue;
+		UploadBatcherStatistics m_Statistics;
+	};
+
+	inline constexpr size_t UploadBatcher::getNumPendingCopies() const noexcept
+	{
+		return m_PendingBufferCopies.size() + m_PendingTextureCopies.size();
+	}
+}
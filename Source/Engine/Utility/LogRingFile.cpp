@@ -0,0 +1,212 @@
+#include "Pch.h"
+#include "Utility/LogRingFile.h"
+
+#include <fstream>
+
+namespace esperanza
+{
+	HRESULT LogRingFile::Recover(const std::filesystem::path& path, std::wstring& strOutLogs) noexcept
+	{
+		strOutLogs.clear();
+
+		std::ifstream inFile(path, std::ios::in | std::ios::binary);
+		if (!inFile)
+		{
+			return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+		}
+
+		Header header = {};
+		inFile.read(reinterpret_cast<char*>(&header), sizeof(Header));
+		if (!inFile || header.uMagic != MAGIC || header.uVersion != VERSION || header.uCapacity == 0)
+		{
+			return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+		}
+
+		std::vector<BYTE> data(static_cast<size_t>(header.uCapacity));
+		inFile.read(reinterpret_cast<char*>(data.data()), data.size());
+		if (!inFile)
+		{
+			return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+		}
+
+		// Until the ring wraps the logs are simply the first cursor bytes, afterwards the oldest byte sits at the cursor
+		const size_t uCursor = static_cast<size_t>(header.uWriteCursor % header.uCapacity);
+		const BOOL bHasWrapped = header.uWriteCursor >= header.uCapacity;
+		std::vector<BYTE> ordered;
+		ordered.reserve(data.size());
+		if (bHasWrapped)
+		{
+			ordered.insert(ordered.end(), data.begin() + uCursor, data.end());
+		}
+		ordered.insert(ordered.end(), data.begin(), data.begin() + uCursor);
+
+		strOutLogs.assign(reinterpret_cast<const WCHAR*>(ordered.data()), ordered.size() / sizeof(WCHAR));
+
+		// The oldest line was partially overwritten
+		if (bHasWrapped)
+		{
+			const size_t uFirstLineEnd = strOutLogs.find(L'\n');
+			strOutLogs.erase(0, uFirstLineEnd == std::wstring::npos ? strOutLogs.size() : uFirstLineEnd + 1);
+		}
+
+		return S_OK;
+	}
+
+	LogRingFile::LogRingFile() noexcept
+		: m_hFile(INVALID_HANDLE_VALUE)
+		, m_hFileMapping()
+		, m_pHeader(nullptr)
+		, m_pData(nullptr)
+		, m_uCapacity(0)
+		, m_uBatchLength(0)
+		, m_szBatch{ L'\0', }
+	{
+	}
+
+	LogRingFile::~LogRingFile() noexcept
+	{
+		Destroy();
+	}
+
+	HRESULT LogRingFile::Initialize(const std::filesystem::path& path, size_t uSizeInBytes) noexcept
+	{
+		if (IsOpen())
+		{
+			return E_ILLEGAL_METHOD_CALL;
+		}
+
+		// Whole characters only, so a wrapped line never splits a WCHAR
+		const size_t uCapacity = uSizeInBytes / sizeof(WCHAR) * sizeof(WCHAR);
+		if (uCapacity == 0)
+		{
+			return E_INVALIDARG;
+		}
+
+		m_hFile = CreateFile(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_hFile == INVALID_HANDLE_VALUE)
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		const ULONGLONG ullFileSize = sizeof(Header) + uCapacity;
+		m_hFileMapping = CreateFileMapping(m_hFile, nullptr, PAGE_READWRITE, static_cast<DWORD>(ullFileSize >> 32), static_cast<DWORD>(ullFileSize), nullptr);
+		if (!m_hFileMapping)
+		{
+			HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+			Destroy();
+
+			return hr;
+		}
+
+		void* pView = MapViewOfFile(m_hFileMapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(ullFileSize));
+		if (!pView)
+		{
+			HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+			Destroy();
+
+			return hr;
+		}
+
+		m_pHeader = static_cast<Header*>(pView);
+		m_pData = static_cast<BYTE*>(pView) + sizeof(Header);
+		m_uCapacity = uCapacity;
+
+		// Keep appending to the logs of the previous run when the layout matches
+		if (m_pHeader->uMagic != MAGIC || m_pHeader->uVersion != VERSION || m_pHeader->uCapacity != uCapacity)
+		{
+			ZeroMemory(m_pHeader, sizeof(Header));
+			m_pHeader->uMagic = MAGIC;
+			m_pHeader->uVersion = VERSION;
+			m_pHeader->uCapacity = uCapacity;
+		}
+
+		return S_OK;
+	}
+
+	void LogRingFile::Destroy() noexcept
+	{
+		Flush();
+
+		if (m_pHeader)
+		{
+			UnmapViewOfFile(m_pHeader);
+			m_pHeader = nullptr;
+			m_pData = nullptr;
+		}
+
+		if (m_hFileMapping)
+		{
+			CloseHandle(m_hFileMapping);
+			m_hFileMapping = nullptr;
+		}
+
+		if (m_hFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_hFile);
+			m_hFile = INVALID_HANDLE_VALUE;
+		}
+
+		m_uCapacity = 0;
+		m_uBatchLength = 0;
+	}
+
+	BOOL LogRingFile::IsOpen() const noexcept
+	{
+		return m_pHeader != nullptr;
+	}
+
+	void LogRingFile::Append(const WCHAR* pszLine) noexcept
+	{
+		if (!IsOpen())
+		{
+			return;
+		}
+
+		size_t uLength = wcslen(pszLine);
+		if (m_uBatchLength + uLength > MAX_BATCH_SIZE)
+		{
+			Flush();
+		}
+
+		if (uLength > MAX_BATCH_SIZE)
+		{
+			write(reinterpret_cast<const BYTE*>(pszLine), uLength * sizeof(WCHAR));
+			return;
+		}
+
+		memcpy(m_szBatch + m_uBatchLength, pszLine, uLength * sizeof(WCHAR));
+		m_uBatchLength += uLength;
+	}
+
+	void LogRingFile::Flush() noexcept
+	{
+		if (!IsOpen() || m_uBatchLength == 0)
+		{
+			return;
+		}
+
+		write(reinterpret_cast<const BYTE*>(m_szBatch), m_uBatchLength * sizeof(WCHAR));
+		m_uBatchLength = 0;
+	}
+
+	void LogRingFile::write(const BYTE* pData, size_t uSizeInBytes) noexcept
+	{
+		// Only the newest capacity bytes of an oversized write can survive anyway
+		if (uSizeInBytes > m_uCapacity)
+		{
+			pData += uSizeInBytes - m_uCapacity;
+			uSizeInBytes = m_uCapacity;
+		}
+
+		std::atomic_ref<uint64_t> writeCursor(m_pHeader->uWriteCursor);
+		const uint64_t uCursor = writeCursor.load(std::memory_order_relaxed);
+		const size_t uOffset = static_cast<size_t>(uCursor % m_uCapacity);
+		const size_t uFirstPartSize = std::min(uSizeInBytes, m_uCapacity - uOffset);
+
+		memcpy(m_pData + uOffset, pData, uFirstPartSize);
+		memcpy(m_pData, pData + uFirstPartSize, uSizeInBytes - uFirstPartSize);
+
+		// Publish the cursor after the text so a reader never sees a cursor ahead of the data
+		writeCursor.store(uCursor + uSizeInBytes, std::memory_order_release);
+	}
+}
\ No newline at end of file
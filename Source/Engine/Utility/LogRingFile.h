@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+
+namespace esperanza
+{
+	// A fixed-size log file mapped into memory and written as a ring.  Lines are copied into the mapping and
+	// the write cursor in the header is published after them, nothing is flushed to disk on the hot path.
+	// The pages belong to the system file cache, so whatever was written survives if the process crashes or
+	// is killed and Recover can read the tail of the log back afterwards.
+	class LogRingFile final
+	{
+	public:
+		static HRESULT Recover(_In_ const std::filesystem::path& path, _Out_ std::wstring& strOutLogs) noexcept;
+
+	public:
+		explicit LogRingFile() noexcept;
+		LogRingFile(const LogRingFile& other) = delete;
+		LogRingFile(LogRingFile&& other) = delete;
+		LogRingFile& operator=(const LogRingFile& other) = delete;
+		LogRingFile& operator=(LogRingFile&& other) = delete;
+		~LogRingFile() noexcept;
+
+		HRESULT Initialize(_In_ const std::filesystem::path& path, _In_ size_t uSizeInBytes) noexcept;
+		void Destroy() noexcept;
+
+		BOOL IsOpen() const noexcept;
+
+		// Lines are batched and only copied into the mapping when the batch fills up or on Flush
+		void Append(_In_ const WCHAR* pszLine) noexcept;
+		void Flush() noexcept;
+
+	private:
+		struct Header
+		{
+			uint32_t uMagic;
+			uint32_t uVersion;
+			uint64_t uCapacity;
+
+			// Total number of bytes ever written, the ring position is the cursor modulo the capacity
+			uint64_t uWriteCursor;
+			uint8_t aPadding[40];
+		};
+		static_assert(sizeof(Header) == 64, "The ring file header should fill exactly one cache line");
+
+		static constexpr const uint32_t MAGIC = 0x4C505345;	// "ESPL"
+		static constexpr const uint32_t VERSION = 1u;
+		static constexpr const size_t MAX_BATCH_SIZE = 4096u;
+
+	private:
+		void write(_In_reads_bytes_(uSizeInBytes) const BYTE* pData, _In_ size_t uSizeInBytes) noexcept;
+
+	private:
+		HANDLE m_hFile;
+		HANDLE m_hFileMapping;
+		Header* m_pHeader;
+		BYTE* m_pData;
+		size_t m_uCapacity;
+		size_t m_uBatchLength;
+		WCHAR m_szBatch[MAX_BATCH_SIZE];
+	};
+}
\ No newline at end of file
@@ -6,78 +6,338 @@ namespace esperanza
 	Log g_Log;
 
 	Log::Log() noexcept
+		: Log(DEFAULT_NUM_LOG_RECORDS)
+	{
+	}
+
+	Log::Log(size_t uNumRecords) noexcept
 		: m_CurrentVerbosity(eVerbosity::All)
-		, m_szLogBuffer{ L'\0', }
-		, m_StringQueue()
-		, m_bIsStringPrinting(TRUE)
-		, m_Os()
+		, m_OverflowPolicy(eOverflowPolicy::CountDropped)
+		, m_pRecords()
+		, m_uRecordMask(0)
+		, m_bIsStringPrinting(FALSE)
+		, m_bIsConsumerParked(FALSE)
+		, m_uWakeSequence(0)
+		, m_uNumDroppedRecords(0)
 		, m_LogThread()
-		, m_QueueMutex()
+		, m_RingFile()
+		, m_pfnSink(printDebugString)
+		, m_pSinkContext(nullptr)
+		, m_uNumPrintedRecords(0)
+		, m_uConsumerLag(0)
+		, m_uMaxConsumerLag(0)
+		, m_uEnqueuePosition(0)
+		, m_uDequeuePosition(0)
 	{
+		// Records are preallocated so that anything logged before Initialize is kept until the log thread starts
+		size_t uCapacity = 1;
+		while (uCapacity < uNumRecords)
+		{
+			uCapacity <<= 1;
+		}
+
+		m_pRecords.reset(new (std::nothrow) LogRecord[uCapacity]);
+		if (!m_pRecords)
+		{
+			return;
+		}
+
+		for (size_t i = 0; i < uCapacity; ++i)
+		{
+			m_pRecords[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+		m_uRecordMask = uCapacity - 1;
 	}
 
 	void Log::Initialize(eVerbosity verbosity) noexcept
 	{
+		Initialize(verbosity, m_OverflowPolicy.load(std::memory_order_relaxed));
+	}
+
+	void Log::Initialize(eVerbosity verbosity, eOverflowPolicy overflowPolicy) noexcept
+	{
+		if (m_LogThread.joinable())
+		{
+			return;
+		}
+
 		SetVerbosity(verbosity);
-		m_bIsStringPrinting = TRUE;
+		SetOverflowPolicy(overflowPolicy);
+		m_bIsStringPrinting.store(TRUE, std::memory_order_release);
 
-		m_LogThread = std::thread(processLog, &m_bIsStringPrinting, &m_QueueMutex, &m_StringQueue);
+		m_LogThread = std::thread(processLog, this);
 	}
 
 	void Log::Destroy() noexcept
 	{
-		while (!m_StringQueue.empty())
+		if (!m_LogThread.joinable())
 		{
+			return;
 		}
 
-		m_bIsStringPrinting = FALSE;
+		// The log thread drains every published record before it observes the stop request
+		m_bIsStringPrinting.store(FALSE, std::memory_order_seq_cst);
+		m_uWakeSequence.fetch_add(1, std::memory_order_release);
+		m_uWakeSequence.notify_one();
+
 		m_LogThread.join();
+
+		m_RingFile.Destroy();
+	}
+
+	HRESULT Log::OpenRingFile(const std::filesystem::path& path, size_t uSizeInBytes) noexcept
+	{
+		// The ring file belongs to the log thread once it is running
+		if (m_LogThread.joinable())
+		{
+			return E_ILLEGAL_METHOD_CALL;
+		}
+
+		return m_RingFile.Initialize(path, uSizeInBytes);
+	}
+
+	HRESULT Log::SetSink(PFN_LOG_SINK pfnSink, void* pContext) noexcept
+	{
+		// The sink is read by the log thread without synchronization
+		if (m_LogThread.joinable())
+		{
+			return E_ILLEGAL_METHOD_CALL;
+		}
+
+		m_pfnSink = pfnSink ? pfnSink : printDebugString;
+		m_pSinkContext = pfnSink ? pContext : nullptr;
+
+		return S_OK;
 	}
 
 	void Log::SetVerbosity(eVerbosity verbosity) noexcept
 	{
-		m_CurrentVerbosity = verbosity;
+		m_CurrentVerbosity.store(verbosity, std::memory_order_relaxed);
 	}
 
-	void Log::PrintLog(eVerbosity verbosity, const char* pszFileName, const char* pszFunctionName, uint32_t uLineNumber, const wchar_t* pszMessage) noexcept
+	void Log::SetOverflowPolicy(eOverflowPolicy overflowPolicy) noexcept
 	{
-		std::lock_guard<std::mutex> lock(m_QueueMutex);
+		m_OverflowPolicy.store(overflowPolicy, std::memory_order_relaxed);
+	}
 
-		if (verbosity < m_CurrentVerbosity)
+	void Log::PrintLog(eVerbosity verbosity, const char* pszFileName, const char* pszFunctionName, uint32_t uLineNumber, const wchar_t* pszMessage) noexcept
+	{
+		if (!IsEnabled(verbosity))
 		{
 			return;
 		}
 
-		std::wstring szLogBuffer;
+		LogRecord* pRecord = acquireRecord();
+		if (!pRecord)
+		{
+			return;
+		}
 
-		m_Os.flush();
-		m_Os.clear();
+		const size_t uPosition = pRecord->Sequence.load(std::memory_order_relaxed);
+		pRecord->Verbosity = verbosity;
+		pRecord->pCallsite = nullptr;
+		pRecord->pfnFormatArguments = nullptr;
+		pRecord->uNumSuppressedBefore = 0;
+		_snwprintf_s(pRecord->szMessage, MAX_LOG_BUFFER_SIZE, _TRUNCATE, L"%hs/%hsline: %u :\t%s\n", pszFileName, pszFunctionName, uLineNumber, pszMessage);
 
-		m_Os << pszFileName << L'/' << pszFunctionName << L"line: " << uLineNumber << L" :\t" << pszMessage << std::endl;
-		szLogBuffer.append(m_Os.str());
-		m_StringQueue.push(szLogBuffer);
+		publishRecord(pRecord, uPosition);
 	}
 
 	void Log::PrintLogFormat(eVerbosity verbosity, const char* pszFileName, const char* pszFunctionName, uint32_t uLineNumber, const wchar_t* pszMessage, ...) noexcept
 	{
+		if (!IsEnabled(verbosity))
+		{
+			return;
+		}
+
+		WCHAR szLogBuffer[MAX_LOG_BUFFER_SIZE];
+
 		va_list vl;
 		va_start(vl, pszMessage);
-		vswprintf(m_szLogBuffer, MAX_LOG_BUFFER_SIZE, pszMessage, vl);
-		PrintLog(verbosity, pszFileName, pszFunctionName, uLineNumber, m_szLogBuffer);
+		vswprintf(szLogBuffer, MAX_LOG_BUFFER_SIZE, pszMessage, vl);
+		PrintLog(verbosity, pszFileName, pszFunctionName, uLineNumber, szLogBuffer);
 		va_end(vl);
 	}
 
-	void Log::processLog(const BOOL* bIsStringPrinting, std::mutex* queueMutex, std::queue<std::wstring>* stringQueue) noexcept
+	size_t Log::GetNumDroppedRecords() const noexcept
+	{
+		return m_uNumDroppedRecords.load(std::memory_order_relaxed);
+	}
+
+	void Log::GetStatistics(LogStatistics& outStatistics) const noexcept
+	{
+		outStatistics.uNumSubmittedRecords = m_uEnqueuePosition.load(std::memory_order_relaxed);
+		outStatistics.uNumPrintedRecords = m_uNumPrintedRecords.load(std::memory_order_relaxed);
+		outStatistics.uNumDroppedRecords = m_uNumDroppedRecords.load(std::memory_order_relaxed);
+		outStatistics.uConsumerLag = m_uConsumerLag.load(std::memory_order_relaxed);
+		outStatistics.uMaxConsumerLag = m_uMaxConsumerLag.load(std::memory_order_relaxed);
+	}
+
+	Log::LogRecord* Log::acquireRecord() noexcept
+	{
+		if (!m_pRecords)
+		{
+			return nullptr;
+		}
+
+		size_t uPosition = m_uEnqueuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			LogRecord& record = m_pRecords[uPosition & m_uRecordMask];
+			const size_t uSequence = record.Sequence.load(std::memory_order_acquire);
+			const intptr_t nDifference = static_cast<intptr_t>(uSequence) - static_cast<intptr_t>(uPosition);
+
+			if (nDifference == 0)
+			{
+				if (m_uEnqueuePosition.compare_exchange_weak(uPosition, uPosition + 1, std::memory_order_relaxed))
+				{
+					return &record;
+				}
+			}
+			else if (nDifference < 0)
+			{
+				// The ring is full, the slot still holds a record the log thread has not printed yet.
+				// Blocking is only safe while there is a log thread to make room.
+				if (m_OverflowPolicy.load(std::memory_order_relaxed) == eOverflowPolicy::Block &&
+					m_bIsStringPrinting.load(std::memory_order_acquire))
+				{
+					wakeConsumer();
+					std::this_thread::yield();
+					uPosition = m_uEnqueuePosition.load(std::memory_order_relaxed);
+					continue;
+				}
+
+				if (m_OverflowPolicy.load(std::memory_order_relaxed) != eOverflowPolicy::Drop)
+				{
+					m_uNumDroppedRecords.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				return nullptr;
+			}
+			else
+			{
+				uPosition = m_uEnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void Log::publishRecord(LogRecord* pRecord, size_t uPosition) noexcept
+	{
+		pRecord->Sequence.store(uPosition + 1, std::memory_order_release);
+		wakeConsumer();
+	}
+
+	BOOL Log::hasPendingRecord() const noexcept
+	{
+		const LogRecord& record = m_pRecords[m_uDequeuePosition & m_uRecordMask];
+
+		return record.Sequence.load(std::memory_order_acquire) == m_uDequeuePosition + 1;
+	}
+
+	void Log::wakeConsumer() noexcept
+	{
+		// Pairs with the fence in processLog so that either the producer sees the parked flag or the
+		// consumer sees the published record, the wake up can never be lost.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (m_bIsConsumerParked.load(std::memory_order_relaxed))
+		{
+			m_uWakeSequence.fetch_add(1, std::memory_order_release);
+			m_uWakeSequence.notify_one();
+		}
+	}
+
+	void Log::printLine(const WCHAR* pszLine) noexcept
+	{
+		m_pfnSink(pszLine, m_pSinkContext);
+		m_RingFile.Append(pszLine);
+	}
+
+	void Log::printDebugString(const WCHAR* pszLine, void* pContext) noexcept
 	{
-		while (*bIsStringPrinting)
+		UNREFERENCED_PARAMETER(pContext);
+
+		OutputDebugString(pszLine);
+	}
+
+	void Log::processLog(Log* pLog) noexcept
+	{
+		size_t uNumReportedDroppedRecords = 0;
+
+		if (!pLog->m_pRecords)
 		{
-			std::lock_guard<std::mutex> lock(*queueMutex);
+			return;
+		}
+
+		for (;;)
+		{
+			if (pLog->hasPendingRecord())
+			{
+				LogRecord& record = pLog->m_pRecords[pLog->m_uDequeuePosition & pLog->m_uRecordMask];
+
+				if (record.pCallsite)
+				{
+					const LogCallsite& callsite = *record.pCallsite;
+					WCHAR szMessage[MAX_LOG_BUFFER_SIZE];
+					WCHAR szLine[MAX_LOG_BUFFER_SIZE];
+
+					if (record.uNumSuppressedBefore > 0)
+					{
+						_snwprintf_s(szLine, MAX_LOG_BUFFER_SIZE, _TRUNCATE, L"%hs/%hsline: %u :\tlast message repeated %u times\n", callsite.pszFileName, callsite.pszFunctionName, callsite.uLineNumber, record.uNumSuppressedBefore);
+						pLog->printLine(szLine);
+					}
 
-			while (!stringQueue->empty())
+					record.pfnFormatArguments(szMessage, MAX_LOG_BUFFER_SIZE, callsite.pszFormat, record.aArguments);
+					_snwprintf_s(szLine, MAX_LOG_BUFFER_SIZE, _TRUNCATE, L"%hs/%hsline: %u :\t%s\n", callsite.pszFileName, callsite.pszFunctionName, callsite.uLineNumber, szMessage);
+					pLog->printLine(szLine);
+				}
+				else
+				{
+					pLog->printLine(record.szMessage);
+				}
+
+				record.Sequence.store(pLog->m_uDequeuePosition + pLog->m_uRecordMask + 1, std::memory_order_release);
+				++pLog->m_uDequeuePosition;
+
+				const size_t uConsumerLag = pLog->m_uEnqueuePosition.load(std::memory_order_relaxed) - pLog->m_uDequeuePosition;
+				pLog->m_uNumPrintedRecords.store(pLog->m_uDequeuePosition, std::memory_order_relaxed);
+				pLog->m_uConsumerLag.store(uConsumerLag, std::memory_order_relaxed);
+				if (uConsumerLag > pLog->m_uMaxConsumerLag.load(std::memory_order_relaxed))
+				{
+					pLog->m_uMaxConsumerLag.store(uConsumerLag, std::memory_order_relaxed);
+				}
+				continue;
+			}
+
+			const size_t uNumDroppedRecords = pLog->m_uNumDroppedRecords.load(std::memory_order_relaxed);
+			if (uNumDroppedRecords != uNumReportedDroppedRecords)
+			{
+				WCHAR szDroppedMessage[MAX_LOG_BUFFER_SIZE];
+				swprintf_s(szDroppedMessage, L"Log ring overflowed, %zu records were dropped\n", uNumDroppedRecords - uNumReportedDroppedRecords);
+				pLog->printLine(szDroppedMessage);
+
+				uNumReportedDroppedRecords = uNumDroppedRecords;
+			}
+
+			// The ring is drained, hand the batched lines to the file before going idle
+			pLog->m_RingFile.Flush();
+
+			if (!pLog->m_bIsStringPrinting.load(std::memory_order_acquire))
 			{
-				OutputDebugString(stringQueue->front().c_str());
-				stringQueue->pop();
+				break;
 			}
+
+			// Park until a producer publishes a record or Destroy is called
+			const uint32_t uWakeSequence = pLog->m_uWakeSequence.load(std::memory_order_acquire);
+			pLog->m_bIsConsumerParked.store(TRUE, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if (!pLog->hasPendingRecord() && pLog->m_bIsStringPrinting.load(std::memory_order_acquire))
+			{
+				pLog->m_uWakeSequence.wait(uWakeSequence, std::memory_order_acquire);
+			}
+
+			pLog->m_bIsConsumerParked.store(FALSE, std::memory_order_relaxed);
 		}
 	}
-}
+}
\ No newline at end of file
@@ -1,9 +1,26 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdarg>
-#include <sstream>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <thread>
+#include <tuple>
+#include <type_traits>
+
+#include "Utility/LogRingFile.h"
+
+// Log statements below this verbosity are compiled out.  Release builds only keep errors and asserts,
+// which is what Game::Initialize sets the runtime verbosity to anyway.
+#ifndef ESPERANZA_LOG_MIN_VERBOSITY
+#ifdef NDEBUG
+#define ESPERANZA_LOG_MIN_VERBOSITY Error
+#else
+#define ESPERANZA_LOG_MIN_VERBOSITY All
+#endif
+#endif
 
 namespace esperanza
 {
@@ -11,8 +28,117 @@ namespace esperanza
 
 	extern Log g_Log;
 
+	// Everything about a log statement that is known at compile time.  The logging macros keep one of these
+	// in a static per expansion so that a deferred record only has to carry a pointer to it.  The callsite
+	// also owns its rate limiter, a token bucket packed into one word plus a count of suppressed calls.
+	struct LogCallsite
+	{
+		const char* pszFileName;
+		const char* pszFunctionName;
+		uint32_t uLineNumber;
+		const wchar_t* pszFormat;
+		std::atomic<uint64_t> uRateLimitState = 0;
+		std::atomic<uint32_t> uNumSuppressed = 0;
+	};
+
+	// Serializes one printf argument into a deferred log record and reads it back on the log thread.
+	// Arguments are copied by value, strings are copied inline because the caller's buffer may be gone
+	// by the time the record is formatted.
+	template<typename T>
+	struct LogArgument
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Deferred log arguments must be trivially copyable");
+
+		using Type = T;
+		static constexpr const size_t FIXED_SIZE = sizeof(T);
+
+		static void Encode(_Inout_ BYTE*& pCursor, _Inout_ size_t& uStringBudget, _In_ const T& value) noexcept
+		{
+			UNREFERENCED_PARAMETER(uStringBudget);
+
+			memcpy(pCursor, &value, sizeof(T));
+			pCursor += sizeof(T);
+		}
+
+		static Type Decode(_Inout_ const BYTE*& pCursor) noexcept
+		{
+			Type value;
+			memcpy(&value, pCursor, sizeof(T));
+			pCursor += sizeof(T);
+
+			return value;
+		}
+	};
+
+	template<typename Char>
+	struct LogStringArgument
+	{
+		using Type = const Char*;
+		// Worst case alignment padding plus the terminator, the characters themselves come out of the string budget
+		static constexpr const size_t FIXED_SIZE = alignof(Char) - 1 + sizeof(Char);
+
+		static void Encode(_Inout_ BYTE*& pCursor, _Inout_ size_t& uStringBudget, _In_opt_ const Char* pszValue) noexcept
+		{
+			pCursor += (alignof(Char) - reinterpret_cast<uintptr_t>(pCursor) % alignof(Char)) % alignof(Char);
+
+			size_t uLength = 0;
+			if (pszValue)
+			{
+				const size_t uMaxLength = uStringBudget / sizeof(Char);
+				while (uLength < uMaxLength && pszValue[uLength] != 0)
+				{
+					++uLength;
+				}
+				memcpy(pCursor, pszValue, uLength * sizeof(Char));
+			}
+
+			reinterpret_cast<Char*>(pCursor)[uLength] = 0;
+			pCursor += (uLength + 1) * sizeof(Char);
+			uStringBudget -= uLength * sizeof(Char);
+		}
+
+		static Type Decode(_Inout_ const BYTE*& pCursor) noexcept
+		{
+			pCursor += (alignof(Char) - reinterpret_cast<uintptr_t>(pCursor) % alignof(Char)) % alignof(Char);
+
+			const Char* pszValue = reinterpret_cast<const Char*>(pCursor);
+			size_t uLength = 0;
+			while (pszValue[uLength] != 0)
+			{
+				++uLength;
+			}
+			pCursor += (uLength + 1) * sizeof(Char);
+
+			return pszValue;
+		}
+	};
+
+	template<> struct LogArgument<wchar_t*> : LogStringArgument<wchar_t> {};
+	template<> struct LogArgument<const wchar_t*> : LogStringArgument<wchar_t> {};
+	template<> struct LogArgument<char*> : LogStringArgument<char> {};
+	template<> struct LogArgument<const char*> : LogStringArgument<char> {};
+
+	// Counters for measuring the log under load.  Submitted and printed records are counted since construction,
+	// consumer lag is how many published records were still waiting behind the record the log thread just printed.
+	struct LogStatistics
+	{
+		size_t uNumSubmittedRecords;
+		size_t uNumPrintedRecords;
+		size_t uNumDroppedRecords;
+		size_t uConsumerLag;
+		size_t uMaxConsumerLag;
+	};
+
+	// The ring positions and the deferred argument bytes are over-aligned on purpose, the padding that
+	// causes is not worth a warning.
+#pragma warning(push)
+#pragma warning(disable : 4324)
 	class Log final
 	{
+	public:
+		// Receives every finished line on the log thread
+		typedef void (*PFN_LOG_SINK)(_In_ const WCHAR* pszLine, _In_opt_ void* pContext);
+
 	public:
 		enum class eVerbosity : uint8_t
 		{
@@ -26,8 +152,23 @@ namespace esperanza
 			COUNT,
 		};
 
+		// What a producer does when every record in the ring is waiting for the log thread.
+		enum class eOverflowPolicy : uint8_t
+		{
+			Block,
+			Drop,
+			CountDropped,
+			COUNT,
+		};
+
+	public:
+		static constexpr const eVerbosity MIN_COMPILED_VERBOSITY = eVerbosity::ESPERANZA_LOG_MIN_VERBOSITY;
+
+		static constexpr BOOL IsCompiledIn(_In_ eVerbosity verbosity) noexcept;
+
 	public:
 		explicit Log() noexcept;
+		explicit Log(_In_ size_t uNumRecords) noexcept;
 		Log(const Log& other) = delete;
 		Log(Log&& other) = delete;
 		Log& operator=(const Log& other) = delete;
@@ -35,54 +176,251 @@ namespace esperanza
 		~Log() noexcept = default;
 
 		void Initialize(_In_ eVerbosity verbosity) noexcept;
+		void Initialize(_In_ eVerbosity verbosity, _In_ eOverflowPolicy overflowPolicy) noexcept;
 		void Destroy() noexcept;
 
+		// Also writes every line into a memory-mapped ring file.  Must be called before Initialize.
+		HRESULT OpenRingFile(_In_ const std::filesystem::path& path, _In_ size_t uSizeInBytes) noexcept;
+
+		// Replaces OutputDebugString as the sink of the log, nullptr restores it.  Must be called before Initialize.
+		HRESULT SetSink(_In_opt_ PFN_LOG_SINK pfnSink, _In_opt_ void* pContext) noexcept;
+
 		void SetVerbosity(_In_ eVerbosity verbosity) noexcept;
+		BOOL IsEnabled(_In_ eVerbosity verbosity) const noexcept;
+		void SetOverflowPolicy(_In_ eOverflowPolicy overflowPolicy) noexcept;
 		void PrintLog(_In_ eVerbosity verbosity, _In_ const char* pszFileName, _In_ const char* pszFunctionName, _In_ uint32_t uLineNumber, _In_ const wchar_t* pszMessage) noexcept;
 		void PrintLogFormat(_In_ eVerbosity verbosity, _In_ const char* pszFileName, _In_ const char* pszFunctionName, _In_ uint32_t uLineNumber, _In_ const wchar_t* pszMessage, ...) noexcept;
 
-	private:
-		static void processLog(const BOOL* bIsStringPrinting, std::mutex* queueMutex, std::queue<std::wstring>* stringQueue) noexcept;
+		// Only captures the callsite and the raw argument bytes, the log thread does the formatting
+		// A callsite may print a burst of RATE_LIMIT_BURST records and then one every RATE_LIMIT_INTERVAL_MS,
+		// the calls in between are only counted and reported as repeats with the next record that gets through
+		template<typename... Args>
+		void PrintLogDeferred(_In_ eVerbosity verbosity, _Inout_ LogCallsite& callsite, _In_ const Args&... args) noexcept;
+
+		size_t GetNumDroppedRecords() const noexcept;
+		void GetStatistics(_Out_ LogStatistics& outStatistics) const noexcept;
+
 	private:
 		static constexpr const size_t MAX_LOG_BUFFER_SIZE = 256u;
+		static constexpr const size_t DEFAULT_NUM_LOG_RECORDS = 1024u;
+		static constexpr const size_t MAX_LOG_ARGUMENTS_SIZE = MAX_LOG_BUFFER_SIZE * sizeof(WCHAR);
+		static constexpr const uint64_t RATE_LIMIT_BURST = 8u;
+		static constexpr const uint64_t RATE_LIMIT_INTERVAL_MS = 1000u;
+		static constexpr const uint64_t RATE_LIMIT_TOKEN_BITS = 16u;
+		static constexpr const uint64_t RATE_LIMIT_TOKEN_MASK = (1ull << RATE_LIMIT_TOKEN_BITS) - 1;
+
+		typedef void (*PFN_FORMAT_LOG_ARGUMENTS)(_Out_writes_(uBufferSize) WCHAR* pszBuffer, _In_ size_t uBufferSize, _In_ const wchar_t* pszFormat, _In_ const BYTE* pArguments);
+
+		// One preallocated slot of the ring.  Follows Dmitry Vyukov's bounded queue: the sequence equals
+		// the slot's position while it is free and position + 1 once a producer has published it.
+		// Immediate records carry the finished line in szMessage, deferred records carry their callsite
+		// and the encoded arguments instead.
+		struct LogRecord
+		{
+			std::atomic<size_t> Sequence;
+			eVerbosity Verbosity;
+			const LogCallsite* pCallsite;
+			PFN_FORMAT_LOG_ARGUMENTS pfnFormatArguments;
+			uint32_t uNumSuppressedBefore;
+			union
+			{
+				WCHAR szMessage[MAX_LOG_BUFFER_SIZE];
+				alignas(8) BYTE aArguments[MAX_LOG_ARGUMENTS_SIZE];
+			};
+		};
 
 	private:
-		eVerbosity m_CurrentVerbosity;
-		WCHAR m_szLogBuffer[MAX_LOG_BUFFER_SIZE];
-		std::queue<std::wstring> m_StringQueue;
-		BOOL m_bIsStringPrinting;
-		std::wostringstream m_Os;
+		static BOOL acquireRateLimitToken(_Inout_ LogCallsite& callsite) noexcept;
+
+		template<typename... Args>
+		static void formatArguments(_Out_writes_(uBufferSize) WCHAR* pszBuffer, _In_ size_t uBufferSize, _In_ const wchar_t* pszFormat, _In_ const BYTE* pArguments) noexcept;
+
+		LogRecord* acquireRecord() noexcept;
+		void publishRecord(_In_ LogRecord* pRecord, _In_ size_t uPosition) noexcept;
+		BOOL hasPendingRecord() const noexcept;
+		void wakeConsumer() noexcept;
+		void printLine(_In_ const WCHAR* pszLine) noexcept;
+
+		static void processLog(_In_ Log* pLog) noexcept;
+		static void printDebugString(_In_ const WCHAR* pszLine, _In_opt_ void* pContext) noexcept;
+
+	private:
+		std::atomic<eVerbosity> m_CurrentVerbosity;
+		std::atomic<eOverflowPolicy> m_OverflowPolicy;
+		std::unique_ptr<LogRecord[]> m_pRecords;
+		size_t m_uRecordMask;
+		std::atomic<BOOL> m_bIsStringPrinting;
+		std::atomic<BOOL> m_bIsConsumerParked;
+		std::atomic<uint32_t> m_uWakeSequence;
+		std::atomic<size_t> m_uNumDroppedRecords;
 		std::thread m_LogThread;
-		std::mutex m_QueueMutex;
+		LogRingFile m_RingFile;
+		PFN_LOG_SINK m_pfnSink;
+		void* m_pSinkContext;
+
+		// Only written by the log thread
+		std::atomic<size_t> m_uNumPrintedRecords;
+		std::atomic<size_t> m_uConsumerLag;
+		std::atomic<size_t> m_uMaxConsumerLag;
+
+		// Producers and the consumer hammer different ends of the ring, keep them on separate cache lines
+		alignas(64) std::atomic<size_t> m_uEnqueuePosition;
+		alignas(64) size_t m_uDequeuePosition;
 	};
+#pragma warning(pop)
+
+	inline constexpr BOOL Log::IsCompiledIn(eVerbosity verbosity) noexcept
+	{
+		return verbosity >= MIN_COMPILED_VERBOSITY;
+	}
+
+	inline BOOL Log::IsEnabled(eVerbosity verbosity) const noexcept
+	{
+		return IsCompiledIn(verbosity) && verbosity >= m_CurrentVerbosity.load(std::memory_order_relaxed);
+	}
+
+	template<typename... Args>
+	inline void Log::PrintLogDeferred(eVerbosity verbosity, LogCallsite& callsite, const Args&... args) noexcept
+	{
+		constexpr const size_t FIXED_ARGUMENTS_SIZE = (static_cast<size_t>(0) + ... + LogArgument<std::decay_t<Args>>::FIXED_SIZE);
+		static_assert(FIXED_ARGUMENTS_SIZE < MAX_LOG_ARGUMENTS_SIZE, "Too many arguments for a deferred log record");
+
+		if (!IsEnabled(verbosity))
+		{
+			return;
+		}
+
+		if (!acquireRateLimitToken(callsite))
+		{
+			callsite.uNumSuppressed.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		LogRecord* pRecord = acquireRecord();
+		if (!pRecord)
+		{
+			return;
+		}
+
+		const size_t uPosition = pRecord->Sequence.load(std::memory_order_relaxed);
+		pRecord->Verbosity = verbosity;
+		pRecord->pCallsite = &callsite;
+		pRecord->pfnFormatArguments = &formatArguments<std::decay_t<Args>...>;
+		pRecord->uNumSuppressedBefore = callsite.uNumSuppressed.exchange(0, std::memory_order_relaxed);
+
+		BYTE* pCursor = pRecord->aArguments;
+		size_t uStringBudget = MAX_LOG_ARGUMENTS_SIZE - FIXED_ARGUMENTS_SIZE;
+		(LogArgument<std::decay_t<Args>>::Encode(pCursor, uStringBudget, args), ...);
+
+		publishRecord(pRecord, uPosition);
+	}
+
+	inline BOOL Log::acquireRateLimitToken(LogCallsite& callsite) noexcept
+	{
+		const uint64_t uNow = GetTickCount64();
+		uint64_t uState = callsite.uRateLimitState.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			const uint64_t uLastRefill = uState >> RATE_LIMIT_TOKEN_BITS;
+			const uint64_t uElapsed = uNow - uLastRefill;
+			const uint64_t uNumRefills = uElapsed / RATE_LIMIT_INTERVAL_MS;
+			uint64_t uNumTokens = uState & RATE_LIMIT_TOKEN_MASK;
+
+			// Suppressed calls stop here without writing to the callsite
+			if (uNumTokens == 0 && uNumRefills == 0)
+			{
+				return FALSE;
+			}
+
+			uint64_t uRefillTime = uLastRefill;
+			if (uNumRefills > 0)
+			{
+				uNumTokens = std::min(RATE_LIMIT_BURST, uNumTokens + uNumRefills);
+				uRefillTime = uNow - uElapsed % RATE_LIMIT_INTERVAL_MS;
+			}
+
+			const uint64_t uNewState = (uRefillTime << RATE_LIMIT_TOKEN_BITS) | (uNumTokens - 1);
+			if (callsite.uRateLimitState.compare_exchange_weak(uState, uNewState, std::memory_order_relaxed))
+			{
+				return TRUE;
+			}
+		}
+	}
+
+	template<typename... Args>
+	inline void Log::formatArguments(WCHAR* pszBuffer, size_t uBufferSize, const wchar_t* pszFormat, const BYTE* pArguments) noexcept
+	{
+		if constexpr (sizeof...(Args) == 0)
+		{
+			UNREFERENCED_PARAMETER(pArguments);
+
+			// Messages without arguments are printed verbatim, a stray '%' in them is not a conversion
+			wcsncpy_s(pszBuffer, uBufferSize, pszFormat, _TRUNCATE);
+		}
+		else
+		{
+			// Braced initialization guarantees the arguments are decoded left to right
+			const BYTE* pCursor = pArguments;
+			std::tuple<typename LogArgument<Args>::Type...> arguments{ LogArgument<Args>::Decode(pCursor)... };
+
+			std::apply(
+				[pszBuffer, uBufferSize, pszFormat](const auto&... decodedArgs)
+				{
+					_snwprintf_s(pszBuffer, uBufferSize, _TRUNCATE, pszFormat, decodedArgs...);
+				},
+				arguments
+			);
+		}
+	}
+
+// With deferred formatting every macro expansion owns a static LogCallsite and the producer only copies the
+// raw argument bytes into the ring, the log thread runs the printf.  Format strings must be literals.
+#ifndef ESPERANZA_DEFERRED_LOG_FORMAT
+#define ESPERANZA_DEFERRED_LOG_FORMAT (1)
+#endif
+
+#if ESPERANZA_DEFERRED_LOG_FORMAT
+#define ESPERANZA_LOGF_CALL(logger, verbosity, message, ...) { static esperanza::LogCallsite s_LogCallsite = { __FILE__, __func__, __LINE__, message }; (logger).PrintLogDeferred(verbosity, s_LogCallsite, __VA_ARGS__); }
+#define ESPERANZA_LOG_CALL(logger, verbosity, message) { static esperanza::LogCallsite s_LogCallsite = { __FILE__, __func__, __LINE__, message }; (logger).PrintLogDeferred(verbosity, s_LogCallsite); }
+#else
+#define ESPERANZA_LOGF_CALL(logger, verbosity, message, ...) { (logger).PrintLogFormat(verbosity, __FILE__, __func__, __LINE__, message, __VA_ARGS__); }
+#define ESPERANZA_LOG_CALL(logger, verbosity, message) { (logger).PrintLog(verbosity, __FILE__, __func__, __LINE__, message); }
+#endif
+
+// Statements below the compile time minimum verbosity are discarded together with their arguments, the rest
+// are filtered by a relaxed load of the runtime verbosity before anything else happens.  The verbosity passed
+// to the macros must therefore be a constant expression.
+#define ESPERANZA_LOGF_IMPL(logger, verbosity, message, ...) { if constexpr (esperanza::Log::IsCompiledIn(verbosity)) { if ((logger).IsEnabled(verbosity)) ESPERANZA_LOGF_CALL(logger, verbosity, message, __VA_ARGS__) } }
+#define ESPERANZA_LOG_IMPL(logger, verbosity, message) { if constexpr (esperanza::Log::IsCompiledIn(verbosity)) { if ((logger).IsEnabled(verbosity)) ESPERANZA_LOG_CALL(logger, verbosity, message) } }
+
+#define GLOGF(verbosity, message, ...) ESPERANZA_LOGF_IMPL(g_Log, verbosity, message, __VA_ARGS__)
+#define GLOG(verbosity, message, ...) ESPERANZA_LOG_IMPL(g_Log, verbosity, message)
+#define GLOGAF(message, ...) ESPERANZA_LOGF_IMPL(g_Log, esperanza::Log::eVerbosity::All, message, __VA_ARGS__)
+#define GLOGA(message, ...) ESPERANZA_LOG_IMPL(g_Log, esperanza::Log::eVerbosity::All, message)
+#define GLOGVF(message, ...) ESPERANZA_LOGF_IMPL(g_Log, esperanza::Log::eVerbosity::Verbose, message, __VA_ARGS__)
+#define GLOGV(message, ...) ESPERANZA_LOG_IMPL(g_Log, esperanza::Log::eVerbosity::Verbose, message)
+#define GLOGIF(message, ...) ESPERANZA_LOGF_IMPL(g_Log, esperanza::Log::eVerbosity::Info, message, __VA_ARGS__)
+#define GLOGI(message, ...) ESPERANZA_LOG_IMPL(g_Log, esperanza::Log::eVerbosity::Info, message)
+#define GLOGWF(message, ...) ESPERANZA_LOGF_IMPL(g_Log, esperanza::Log::eVerbosity::Warn, message, __VA_ARGS__)
+#define GLOGW(message, ...) ESPERANZA_LOG_IMPL(g_Log, esperanza::Log::eVerbosity::Warn, message)
+#define GLOGEF(message, ...) ESPERANZA_LOGF_IMPL(g_Log, esperanza::Log::eVerbosity::Error, message, __VA_ARGS__)
+#define GLOGE(message, ...) ESPERANZA_LOG_IMPL(g_Log, esperanza::Log::eVerbosity::Error, message)
+#define GLOGASF(message, ...) ESPERANZA_LOGF_IMPL(g_Log, esperanza::Log::eVerbosity::Assert, message, __VA_ARGS__)
+#define GLOGAS(message, ...) ESPERANZA_LOG_IMPL(g_Log, esperanza::Log::eVerbosity::Assert, message)
 
-#define GLOGF(verbosity, message, ...) (g_Log.PrintLogFormat(verbosity, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOG(verbosity, message, ...) (g_Log.PrintLog(verbosity, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGAF(message, ...) (g_Log.PrintLogFormat(esperanza::Log::eVerbosity::All, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGA(message, ...) (g_Log.PrintLog(esperanza::Log::eVerbosity::All, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGVF(message, ...) (g_Log.PrintLogFormat(esperanza::Log::eVerbosity::Verbose, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGV(message, ...) (g_Log.PrintLog(esperanza::Log::eVerbosity::Verbose, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGIF(message, ...) (g_Log.PrintLogFormat(esperanza::Log::eVerbosity::Info, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGI(message, ...) (g_Log.PrintLog(esperanza::Log::eVerbosity::Info, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGWF(message, ...) (g_Log.PrintLogFormat(esperanza::Log::eVerbosity::Warn, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGW(message, ...) (g_Log.PrintLog(esperanza::Log::eVerbosity::Warn, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGEF(message, ...) (g_Log.PrintLogFormat(esperanza::Log::eVerbosity::Error, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGE(message, ...) (g_Log.PrintLog(esperanza::Log::eVerbosity::Error, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGASF(message, ...) (g_Log.PrintLogFormat(esperanza::Log::eVerbosity::Assert, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define GLOGAS(message, ...) (g_Log.PrintLog(esperanza::Log::eVerbosity::Assert, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-
-#define LOGF(logger, verbosity, message, ...) (logger.PrintLogFormat(verbosity, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOG(logger, verbosity, message, ...) (logger.PrintLog(verbosity, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGAF(logger, message, ...) (logger.PrintLogFormat(esperanza::Log::eVerbosity::All, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGA(logger, message, ...) (logger.PrintLog(esperanza::Log::eVerbosity::All, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGVF(logger, message, ...) (logger.PrintLogFormat(esperanza::Log::eVerbosity::Verbose, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGV(logger, message, ...) (logger.PrintLog(esperanza::Log::eVerbosity::Verbose, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGIF(logger, message, ...) (logger.PrintLogFormat(esperanza::Log::eVerbosity::Info, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGI(logger, message, ...) (logger.PrintLog(esperanza::Log::eVerbosity::Info, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGWF(logger, message, ...) (logger.PrintLogFormat(esperanza::Log::eVerbosity::Warn, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGW(logger, message, ...) (logger.PrintLog(esperanza::Log::eVerbosity::Warn, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGEF(logger, message, ...) (logger.PrintLogFormat(esperanza::Log::eVerbosity::Error, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGE(logger, message, ...) (logger.PrintLog(esperanza::Log::eVerbosity::Error, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGASF(logger, message, ...) (logger.PrintLogFormat(esperanza::Log::eVerbosity::Assert, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
-#define LOGAS(logger, message, ...) (logger.PrintLog(esperanza::Log::eVerbosity::Assert, __FILE__, __func__, __LINE__, message, __VA_ARGS__));
+#define LOGF(logger, verbosity, message, ...) ESPERANZA_LOGF_IMPL(logger, verbosity, message, __VA_ARGS__)
+#define LOG(logger, verbosity, message, ...) ESPERANZA_LOG_IMPL(logger, verbosity, message)
+#define LOGAF(logger, message, ...) ESPERANZA_LOGF_IMPL(logger, esperanza::Log::eVerbosity::All, message, __VA_ARGS__)
+#define LOGA(logger, message, ...) ESPERANZA_LOG_IMPL(logger, esperanza::Log::eVerbosity::All, message)
+#define LOGVF(logger, message, ...) ESPERANZA_LOGF_IMPL(logger, esperanza::Log::eVerbosity::Verbose, message, __VA_ARGS__)
+#define LOGV(logger, message, ...) ESPERANZA_LOG_IMPL(logger, esperanza::Log::eVerbosity::Verbose, message)
+#define LOGIF(logger, message, ...) ESPERANZA_LOGF_IMPL(logger, esperanza::Log::eVerbosity::Info, message, __VA_ARGS__)
+#define LOGI(logger, message, ...) ESPERANZA_LOG_IMPL(logger, esperanza::Log::eVerbosity::Info, message)
+#define LOGWF(logger, message, ...) ESPERANZA_LOGF_IMPL(logger, esperanza::Log::eVerbosity::Warn, message, __VA_ARGS__)
+#define LOGW(logger, message, ...) ESPERANZA_LOG_IMPL(logger, esperanza::Log::eVerbosity::Warn, message)
+#define LOGEF(logger, message, ...) ESPERANZA_LOGF_IMPL(logger, esperanza::Log::eVerbosity::Error, message, __VA_ARGS__)
+#define LOGE(logger, message, ...) ESPERANZA_LOG_IMPL(logger, esperanza::Log::eVerbosity::Error, message)
+#define LOGASF(logger, message, ...) ESPERANZA_LOGF_IMPL(logger, esperanza::Log::eVerbosity::Assert, message, __VA_ARGS__)
+#define LOGAS(logger, message, ...) ESPERANZA_LOG_IMPL(logger, esperanza::Log::eVerbosity::Assert, message)
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "HeadlessDevice.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		HRESULT createWarpDevice(_Out_ ID3D12Device** ppOutDevice) noexcept
+		{
+			HRESULT hr = S_OK;
+			*ppOutDevice = nullptr;
+
+			ComPtr<IDXGIFactory4> pFactory;
+			hr = CreateDXGIFactory2(0, IID_PPV_ARGS(&pFactory));
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"CreateDXGIFactory2 failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			ComPtr<IDXGIAdapter> pWarpAdapter;
+			hr = pFactory->EnumWarpAdapter(IID_PPV_ARGS(&pWarpAdapter));
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"EnumWarpAdapter failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			hr = D3D12CreateDevice(pWarpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(ppOutDevice));
+			if (FAILED(hr))
+			{
+				_com_error err(hr);
+				GLOGEF(L"D3D12CreateDevice failed with HRESULT code %u, %s", hr, err.ErrorMessage());
+
+				return hr;
+			}
+
+			return hr;
+		}
+	}
+
+	ID3D12Device* GetHeadlessDevice() noexcept
+	{
+		static ComPtr<ID3D12Device> s_pDevice;
+		static std::once_flag s_CreateFlag;
+
+		std::call_once(s_CreateFlag, []() { createWarpDevice(&s_pDevice); });
+
+		return s_pDevice.Get();
+	}
+}
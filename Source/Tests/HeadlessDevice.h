@@ -0,0 +1,10 @@
+#pragma once
+
+#include "Pch.h"
+
+namespace esperanza::tests
+{
+	// A WARP device shared by every test and benchmark that needs one.  It needs no GPU or display, so runs on
+	// build machines, and is created on first use.  Returns nullptr if WARP is not available.
+	ID3D12Device* GetHeadlessDevice() noexcept;
+}
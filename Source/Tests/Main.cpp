@@ -0,0 +1,39 @@
+#include "Test.h"
+
+// Runs every registered test, or only those named on the command line, and fails if any check failed
+INT wmain(_In_ INT argc, _In_reads_(argc) WCHAR** argv)
+{
+	esperanza::g_Log.Initialize(esperanza::Log::eVerbosity::Error);
+
+	INT nNumRun = 0;
+	INT nNumFailed = 0;
+	for (const esperanza::tests::TestCase& test : esperanza::tests::GetTests())
+	{
+		BOOL bIsSelected = argc <= 1;
+		for (INT i = 1; i < argc && !bIsSelected; ++i)
+		{
+			WCHAR szName[128];
+			swprintf_s(szName, L"%hs", test.pszName);
+			bIsSelected = wcscmp(szName, argv[i]) == 0;
+		}
+
+		if (!bIsSelected)
+		{
+			continue;
+		}
+
+		const size_t uNumFailures = esperanza::tests::GetNumFailures();
+		test.pfnRun();
+
+		const BOOL bHasPassed = esperanza::tests::GetNumFailures() == uNumFailures;
+		printf("%s %s\n", bHasPassed ? "[ PASS ]" : "[ FAIL ]", test.pszName);
+		++nNumRun;
+		nNumFailed += bHasPassed ? 0 : 1;
+	}
+
+	printf("%d of %d tests passed\n", nNumRun - nNumFailed, nNumRun);
+
+	esperanza::g_Log.Destroy();
+
+	return nNumRun > 0 && nNumFailed == 0 ? 0 : 1;
+}
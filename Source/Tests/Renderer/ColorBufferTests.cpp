@@ -0,0 +1,19 @@
+#include "Test.h"
+
+#include "Renderer/ColorBuffer.h"
+
+namespace esperanza::tests
+{
+	// A full chain goes down to 1x1 along the larger dimension, truncating odd sizes on the way
+	TEST_CASE(ColorBufferComputesFullMipChains)
+	{
+		static_assert(ColorBuffer::ComputeNumMips(1, 1) == 1);
+
+		CHECK(ColorBuffer::ComputeNumMips(256, 1) == 9);
+		CHECK(ColorBuffer::ComputeNumMips(511, 1) == 9);
+		CHECK(ColorBuffer::ComputeNumMips(512, 256) == 10);
+		CHECK(ColorBuffer::ComputeNumMips(1280, 720) == 11);
+		CHECK(ColorBuffer::ComputeNumMips(1920, 1080) == 11);
+		CHECK(ColorBuffer::ComputeNumMips(1, 4096) == 13);
+	}
+}
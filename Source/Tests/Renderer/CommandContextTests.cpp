@@ -0,0 +1,291 @@
+#include "Test.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/CommandContext.h"
+#include "Renderer/CommandListManager.h"
+#include "Renderer/GpuResource.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		constexpr const uint32_t NUM_FRAMES = 3u;
+		constexpr const uint32_t NUM_TEXTURES = 2u;
+
+		constexpr const D3D12_RESOURCE_STATES SHADER_READ_STATES = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+
+		// A command list manager, a context manager and a few render target textures on the headless device,
+		// every trace starts from textures in the common state
+		struct ContextTestFixture final
+		{
+			explicit ContextTestFixture() noexcept
+				: pDevice(GetHeadlessDevice())
+				, pCommandListManager(std::make_shared<CommandListManager>())
+				, pContextManager(std::make_unique<ContextManager>())
+				, apTextures()
+			{
+			}
+
+			ContextTestFixture(const ContextTestFixture& other) = delete;
+			ContextTestFixture(ContextTestFixture&& other) = delete;
+			ContextTestFixture& operator=(const ContextTestFixture& other) = delete;
+			ContextTestFixture& operator=(ContextTestFixture&& other) = delete;
+
+			~ContextTestFixture() noexcept
+			{
+				if (pCommandListManager->GetGraphicsQueue().IsReady())
+				{
+					pCommandListManager->IdleGpu();
+				}
+
+				for (std::unique_ptr<GpuResource>& pTexture : apTextures)
+				{
+					if (pTexture)
+					{
+						pTexture->Destroy();
+					}
+				}
+
+				pContextManager->Destroy();
+				pCommandListManager->Destroy();
+			}
+
+			HRESULT Initialize() noexcept
+			{
+				if (!pDevice)
+				{
+					return E_FAIL;
+				}
+
+				HRESULT hr = pCommandListManager->Initialize(pDevice);
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				hr = pContextManager->Initialize(pCommandListManager);
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				const D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+				const D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 1, 1, 0,
+					D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+
+				for (std::unique_ptr<GpuResource>& pTexture : apTextures)
+				{
+					ComPtr<ID3D12Resource> pResource;
+					hr = pDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pResource));
+					if (FAILED(hr))
+					{
+						return hr;
+					}
+
+					pTexture = std::make_unique<GpuResource>(pResource.Get(), D3D12_RESOURCE_STATE_COMMON);
+				}
+
+				return hr;
+			}
+
+			ResourceBarrierStatistics GetStatistics() noexcept
+			{
+				ResourceBarrierStatistics statistics;
+				pContextManager->GetResourceBarrierStatistics(statistics);
+
+				return statistics;
+			}
+
+			ID3D12Device* pDevice;
+			std::shared_ptr<CommandListManager> pCommandListManager;
+			std::unique_ptr<ContextManager> pContextManager;
+			std::unique_ptr<GpuResource> apTextures[NUM_TEXTURES];
+		};
+	}
+
+	// Each frame renders both textures and reads them back in shaders.  The first transition of a texture in a
+	// list is resolved at submission, so every frame pays one fix-up per texture and one transition per texture
+	// inside the list, and reading a combined read state again is skipped.
+	TEST_CASE(CommandContextCountsBarriersOfRenderThenSampleFrames)
+	{
+		ContextTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		GpuResource& textureA = *fixture.apTextures[0];
+		GpuResource& textureB = *fixture.apTextures[1];
+
+		for (uint32_t uFrame = 0; uFrame < NUM_FRAMES; ++uFrame)
+		{
+			GraphicsContext* pContext = nullptr;
+			REQUIRE(SUCCEEDED(fixture.pContextManager->BeginGraphicsContext(&pContext, L"Render Then Sample")));
+
+			pContext->TransitionResource(textureA, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			pContext->TransitionResource(textureA, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			pContext->TransitionResource(textureB, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			pContext->TransitionResource(textureB, SHADER_READ_STATES);
+			pContext->TransitionResource(textureB, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+			UINT64 uFenceValue = 0;
+			REQUIRE(SUCCEEDED(pContext->Finish(uFenceValue)));
+		}
+
+		fixture.pCommandListManager->IdleGpu();
+
+		const ResourceBarrierStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumTransitionBarriers == 2 * NUM_FRAMES);
+		CHECK(statistics.uNumFixupBarriers == 2 * NUM_FRAMES);
+		CHECK(statistics.uNumSkippedTransitions == NUM_FRAMES);
+		CHECK(statistics.uNumSplitBarriers == 0);
+
+		CHECK(textureA.GetUsageState() == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		CHECK(textureB.GetUsageState() == SHADER_READ_STATES);
+		CHECK(fixture.pDevice->GetDeviceRemovedReason() == S_OK);
+	}
+
+	// A frame that hands its texture back in the state it found it needs no fix-up after the first frame
+	TEST_CASE(CommandContextSkipsFixupsWhenFramesEndInTheirInitialState)
+	{
+		ContextTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		GpuResource& texture = *fixture.apTextures[0];
+
+		for (uint32_t uFrame = 0; uFrame < NUM_FRAMES; ++uFrame)
+		{
+			GraphicsContext* pContext = nullptr;
+			REQUIRE(SUCCEEDED(fixture.pContextManager->BeginGraphicsContext(&pContext, L"Round Trip")));
+
+			pContext->TransitionResource(texture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			pContext->TransitionResource(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			pContext->TransitionResource(texture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+			UINT64 uFenceValue = 0;
+			REQUIRE(SUCCEEDED(pContext->Finish(uFenceValue)));
+		}
+
+		fixture.pCommandListManager->IdleGpu();
+
+		const ResourceBarrierStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumTransitionBarriers == 2 * NUM_FRAMES);
+		CHECK(statistics.uNumFixupBarriers == 1);
+		CHECK(texture.GetUsageState() == D3D12_RESOURCE_STATE_RENDER_TARGET);
+	}
+
+	// A split barrier counts its begin and its end, a UAV barrier counts once, and the split begun on an
+	// untracked texture is left to the fix-up
+	TEST_CASE(CommandContextCountsSplitAndUavBarriers)
+	{
+		ContextTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		GpuResource& textureA = *fixture.apTextures[0];
+		GpuResource& textureB = *fixture.apTextures[1];
+
+		GraphicsContext* pContext = nullptr;
+		REQUIRE(SUCCEEDED(fixture.pContextManager->BeginGraphicsContext(&pContext, L"Split And Uav")));
+
+		pContext->TransitionResource(textureA, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+		pContext->InsertUAVBarrier(textureA);
+		pContext->BeginResourceTransition(textureA, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		pContext->TransitionResource(textureA, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		pContext->BeginResourceTransition(textureB, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		UINT64 uFenceValue = 0;
+		REQUIRE(SUCCEEDED(pContext->Finish(uFenceValue, TRUE)));
+
+		const ResourceBarrierStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumSplitBarriers == 2);
+		CHECK(statistics.uNumUavBarriers == 1);
+		CHECK(statistics.uNumTransitionBarriers == 0);
+		CHECK(statistics.uNumFixupBarriers == 2);
+
+		CHECK(textureA.GetUsageState() == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		CHECK(textureB.GetUsageState() == D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	}
+
+	// Many frames finished without a flush in between keep fix-up lists and their main lists queued together.
+	// Neither may be reset while it waits in a batch, which the device would report by removing itself.
+	TEST_CASE(CommandContextKeepsQueuedFixupListsAlive)
+	{
+		ContextTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		constexpr const uint32_t NUM_BATCHED_FRAMES = 64u;
+
+		GpuResource& texture = *fixture.apTextures[0];
+
+		for (uint32_t uFrame = 0; uFrame < NUM_BATCHED_FRAMES; ++uFrame)
+		{
+			GraphicsContext* pContext = nullptr;
+			REQUIRE(SUCCEEDED(fixture.pContextManager->BeginGraphicsContext(&pContext, L"Batched")));
+
+			// Alternating states force a fix-up in front of every list
+			pContext->TransitionResource(texture, uFrame % 2 ? D3D12_RESOURCE_STATE_RENDER_TARGET : D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+			UINT64 uFenceValue = 0;
+			REQUIRE(SUCCEEDED(pContext->Finish(uFenceValue)));
+		}
+
+		fixture.pCommandListManager->IdleGpu();
+
+		const ResourceBarrierStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumFixupBarriers == NUM_BATCHED_FRAMES);
+		CHECK(texture.GetUsageState() == D3D12_RESOURCE_STATE_RENDER_TARGET);
+		CHECK(fixture.pDevice->GetDeviceRemovedReason() == S_OK);
+	}
+
+	// A list that only reads a texture already in a combined read state covering the read needs no fix-up,
+	// and the texture keeps the combined state
+	TEST_CASE(CommandContextSkipsFixupsCoveredByTheCurrentReadState)
+	{
+		ContextTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		GpuResource& texture = *fixture.apTextures[0];
+
+		GraphicsContext* pContext = nullptr;
+		REQUIRE(SUCCEEDED(fixture.pContextManager->BeginGraphicsContext(&pContext, L"Combined Read")));
+		pContext->TransitionResource(texture, SHADER_READ_STATES);
+
+		UINT64 uFenceValue = 0;
+		REQUIRE(SUCCEEDED(pContext->Finish(uFenceValue)));
+
+		REQUIRE(SUCCEEDED(fixture.pContextManager->BeginGraphicsContext(&pContext, L"Pixel Read")));
+		pContext->TransitionResource(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		REQUIRE(SUCCEEDED(pContext->Finish(uFenceValue, TRUE)));
+
+		const ResourceBarrierStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumFixupBarriers == 1);
+		CHECK(statistics.uNumSkippedTransitions == 1);
+		CHECK(texture.GetUsageState() == SHADER_READ_STATES);
+	}
+
+	// An async compute list reading a texture left as a render target cannot transition it itself, the fix-up
+	// goes to the graphics queue and the compute queue waits for it
+	TEST_CASE(CommandContextSendsGraphicsFixupsToTheGraphicsQueue)
+	{
+		ContextTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		GpuResource& texture = *fixture.apTextures[0];
+
+		GraphicsContext* pGraphicsContext = nullptr;
+		REQUIRE(SUCCEEDED(fixture.pContextManager->BeginGraphicsContext(&pGraphicsContext, L"Render")));
+		pGraphicsContext->TransitionResource(texture, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+		UINT64 uFenceValue = 0;
+		REQUIRE(SUCCEEDED(pGraphicsContext->Finish(uFenceValue)));
+
+		ComputeContext* pComputeContext = nullptr;
+		REQUIRE(SUCCEEDED(fixture.pContextManager->BeginComputeContext(&pComputeContext, L"Async Read", TRUE)));
+		pComputeContext->TransitionResource(texture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		REQUIRE(SUCCEEDED(pComputeContext->Finish(uFenceValue, TRUE)));
+
+		fixture.pCommandListManager->IdleGpu();
+
+		const ResourceBarrierStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumFixupBarriers == 2);
+		CHECK(texture.GetUsageState() == D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+		CHECK(fixture.pDevice->GetDeviceRemovedReason() == S_OK);
+	}
+}
@@ -0,0 +1,148 @@
+#include "Test.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/CommandListManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		constexpr const uint32_t NUM_FENCE_VALUES = 8u;
+		constexpr const uint32_t NUM_WAITERS_PER_FENCE_VALUE = 4u;
+		constexpr const uint32_t NUM_WAITERS = NUM_FENCE_VALUES * NUM_WAITERS_PER_FENCE_VALUE;
+
+		// How long waiters are given to block before the next fence value is released, and how long a woken
+		// waiter may take before the test gives up on it
+		constexpr const std::chrono::milliseconds SETTLE_TIME(20);
+		constexpr const std::chrono::milliseconds WAKE_TIMEOUT(2000);
+
+		INT64 getTimeNanoseconds() noexcept
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	}
+
+	// Each fence value is held back by a gate fence the queue waits on, so the test releases them one at a time
+	// from the CPU.  Waiters on a value must wake once that value is signaled, while the waiters on every higher
+	// value stay blocked, and no waiter may miss its wake up when several share one value.
+	TEST_CASE(CommandQueueWakesEachWaiterAtItsOwnFenceValue)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		std::unique_ptr<CommandQueue> pQueue = std::make_unique<CommandQueue>(D3D12_COMMAND_LIST_TYPE_DIRECT);
+		REQUIRE(SUCCEEDED(pQueue->Initialize(pDevice)));
+
+		ComPtr<ID3D12Fence> pGateFence;
+		REQUIRE(SUCCEEDED(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&pGateFence))));
+
+		UINT64 auFenceValues[NUM_FENCE_VALUES] = {};
+		for (uint32_t i = 0; i < NUM_FENCE_VALUES; ++i)
+		{
+			REQUIRE(SUCCEEDED(pQueue->GetCommandQueue()->Wait(pGateFence.Get(), i + 1)));
+			REQUIRE(SUCCEEDED(pQueue->IncrementFence(auFenceValues[i])));
+		}
+
+		std::atomic<INT64> anWakeTimes[NUM_WAITERS] = {};
+		std::atomic<HRESULT> aWaitResults[NUM_WAITERS] = {};
+
+		std::vector<std::thread> waiters;
+		for (uint32_t uWaiter = 0; uWaiter < NUM_WAITERS; ++uWaiter)
+		{
+			waiters.emplace_back(
+				[&, uWaiter]()
+				{
+					aWaitResults[uWaiter].store(pQueue->WaitForFence(auFenceValues[uWaiter % NUM_FENCE_VALUES]), std::memory_order_relaxed);
+					anWakeTimes[uWaiter].store(getTimeNanoseconds(), std::memory_order_release);
+				}
+			);
+		}
+
+		std::this_thread::sleep_for(SETTLE_TIME);
+
+		std::vector<INT64> latencies;
+		BOOL bHasTimedOut = FALSE;
+		for (uint32_t uFence = 0; uFence < NUM_FENCE_VALUES && !bHasTimedOut; ++uFence)
+		{
+			// Nobody waiting on this or a higher value may be awake before it is released
+			for (uint32_t uWaiter = 0; uWaiter < NUM_WAITERS; ++uWaiter)
+			{
+				if (uWaiter % NUM_FENCE_VALUES >= uFence)
+				{
+					CHECK(anWakeTimes[uWaiter].load(std::memory_order_acquire) == 0);
+				}
+			}
+
+			const INT64 nSignalTime = getTimeNanoseconds();
+			CHECK(SUCCEEDED(pGateFence->Signal(uFence + 1)));
+
+			for (uint32_t uWaiter = uFence; uWaiter < NUM_WAITERS; uWaiter += NUM_FENCE_VALUES)
+			{
+				const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + WAKE_TIMEOUT;
+				while (anWakeTimes[uWaiter].load(std::memory_order_acquire) == 0 && std::chrono::steady_clock::now() < deadline)
+				{
+					std::this_thread::yield();
+				}
+
+				const INT64 nWakeTime = anWakeTimes[uWaiter].load(std::memory_order_acquire);
+				if (nWakeTime == 0)
+				{
+					bHasTimedOut = TRUE;
+
+					break;
+				}
+
+				latencies.push_back(nWakeTime - nSignalTime);
+			}
+
+			std::this_thread::sleep_for(SETTLE_TIME);
+		}
+
+		// Release everything left, so no waiter is stuck if a check above failed
+		pGateFence->Signal(NUM_FENCE_VALUES);
+		for (std::thread& waiter : waiters)
+		{
+			waiter.join();
+		}
+
+		CHECK(!bHasTimedOut);
+		for (uint32_t uWaiter = 0; uWaiter < NUM_WAITERS; ++uWaiter)
+		{
+			CHECK(SUCCEEDED(aWaitResults[uWaiter].load(std::memory_order_relaxed)));
+		}
+
+		if (!latencies.empty())
+		{
+			std::sort(latencies.begin(), latencies.end());
+			printf("fence wake latency over %zu waiters: p50 %lld us, p99 %lld us, max %lld us\n", latencies.size(),
+				latencies[latencies.size() / 2] / 1000, latencies[latencies.size() * 99 / 100] / 1000, latencies.back() / 1000);
+		}
+
+		CHECK(pQueue->IsFenceComplete(auFenceValues[NUM_FENCE_VALUES - 1]));
+
+		pQueue->Destroy();
+	}
+
+	// A value that has already completed returns without flushing or taking a fence event
+	TEST_CASE(CommandQueueWaitForCompletedFenceReturnsImmediately)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		std::unique_ptr<CommandQueue> pQueue = std::make_unique<CommandQueue>(D3D12_COMMAND_LIST_TYPE_DIRECT);
+		REQUIRE(SUCCEEDED(pQueue->Initialize(pDevice)));
+
+		CHECK(SUCCEEDED(pQueue->WaitForIdle()));
+
+		const UINT64 uFenceValue = pQueue->GetLastSubmittedFenceValue();
+		CHECK(pQueue->IsFenceComplete(uFenceValue));
+
+		CHECK(SUCCEEDED(pQueue->WaitForFence(uFenceValue)));
+
+		pQueue->Destroy();
+	}
+}
@@ -0,0 +1,95 @@
+#include "Test.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/DescriptorHeap.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		constexpr const uint32_t NUM_RESIZE_CYCLES = 10000u;
+		constexpr const uint32_t NUM_WARM_UP_CYCLES = 100u;
+		constexpr const uint32_t NUM_BUFFERS_PER_CYCLE = 3u;
+		constexpr const uint32_t MAX_NUM_MIPS = 12u;
+	}
+
+	// Every resize recreates a swap chain worth of buffers with one RTV and SRV each and a UAV per mip, and the
+	// mip count changes with the size.  Once freed ranges are recycled the heap count must stop growing.
+	TEST_CASE(DescriptorAllocatorReachesSteadyStateAcrossResizes)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		std::unique_ptr<DescriptorAllocator> pRtvAllocator = std::make_unique<DescriptorAllocator>(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+		std::unique_ptr<DescriptorAllocator> pViewAllocator = std::make_unique<DescriptorAllocator>(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		std::vector<std::pair<DescriptorAllocator*, DescriptorAllocation>> liveAllocations;
+		std::vector<std::pair<DescriptorAllocator*, DescriptorAllocation>> previousAllocations;
+		uint32_t uNumHeapsAfterWarmUp = 0;
+
+		for (uint32_t uCycle = 0; uCycle < NUM_RESIZE_CYCLES; ++uCycle)
+		{
+			const uint32_t uNumMips = 1u + uCycle % MAX_NUM_MIPS;
+
+			// The new buffers are created while the old ones are still alive, as the display does on a resize
+			for (uint32_t uBuffer = 0; uBuffer < NUM_BUFFERS_PER_CYCLE; ++uBuffer)
+			{
+				DescriptorAllocation allocation;
+				REQUIRE(SUCCEEDED(pRtvAllocator->Allocate(allocation, pDevice, 1)));
+				liveAllocations.emplace_back(pRtvAllocator.get(), allocation);
+
+				REQUIRE(SUCCEEDED(pViewAllocator->Allocate(allocation, pDevice, 1)));
+				liveAllocations.emplace_back(pViewAllocator.get(), allocation);
+
+				REQUIRE(SUCCEEDED(pViewAllocator->Allocate(allocation, pDevice, uNumMips)));
+				liveAllocations.emplace_back(pViewAllocator.get(), allocation);
+			}
+
+			for (const std::pair<DescriptorAllocator*, DescriptorAllocation>& allocation : previousAllocations)
+			{
+				REQUIRE(SUCCEEDED(allocation.first->Free(allocation.second)));
+			}
+
+			previousAllocations.swap(liveAllocations);
+			liveAllocations.clear();
+
+			if (uCycle + 1 == NUM_WARM_UP_CYCLES)
+			{
+				uNumHeapsAfterWarmUp = pRtvAllocator->GetNumHeaps() + pViewAllocator->GetNumHeaps();
+			}
+		}
+
+		printf("descriptor heaps after %u resize cycles: %u rtv, %u cbv/srv/uav\n", NUM_RESIZE_CYCLES, pRtvAllocator->GetNumHeaps(), pViewAllocator->GetNumHeaps());
+
+		CHECK(pRtvAllocator->GetNumHeaps() + pViewAllocator->GetNumHeaps() == uNumHeapsAfterWarmUp);
+		CHECK(pRtvAllocator->GetNumHeaps() == 1);
+	}
+
+	TEST_CASE(DescriptorAllocatorRejectsStaleAllocations)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		DescriptorAllocator allocator(pDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		DescriptorAllocation allocation;
+		REQUIRE(SUCCEEDED(allocator.Allocate(allocation, pDevice, 4)));
+		CHECK(allocator.IsValid(allocation));
+
+		REQUIRE(SUCCEEDED(allocator.Free(allocation)));
+		CHECK(!allocator.IsValid(allocation));
+		CHECK(FAILED(allocator.Free(allocation)));
+
+		// The range is handed out again under a new generation, which the old copy must not alias
+		DescriptorAllocation reusedAllocation;
+		REQUIRE(SUCCEEDED(allocator.Allocate(reusedAllocation, pDevice, 3)));
+		CHECK(reusedAllocation.Handle.ptr == allocation.Handle.ptr);
+		CHECK(reusedAllocation.uGeneration != allocation.uGeneration);
+		CHECK(allocator.IsValid(reusedAllocation));
+		CHECK(!allocator.IsValid(allocation));
+		CHECK(FAILED(allocator.Free(allocation)));
+		CHECK(SUCCEEDED(allocator.Free(reusedAllocation)));
+
+		CHECK(FAILED(allocator.Allocate(allocation, pDevice, 0)));
+	}
+}
@@ -0,0 +1,190 @@
+#include "Test.h"
+
+#include "Renderer/DynamicConstantAllocator.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		constexpr const UINT64 PAGE_SIZE = 4u * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		constexpr const UINT64 ALIGNMENT = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+		BYTE makeByte(_In_ UINT64 uIndex, _In_ UINT uSeed) noexcept
+		{
+			return static_cast<BYTE>((uIndex * 31u + uSeed * 7u) & 0xff);
+		}
+	}
+
+	// Every allocation starts on a constant buffer boundary and takes its size rounded up to one
+	TEST_CASE(DynamicConstantAllocatorAlignsAllocations)
+	{
+		CpuUploadPageProvider pageProvider;
+		DynamicConstantAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+		allocator.BeginFrame(0, 0);
+
+		DynamicConstantAllocation first = {};
+		DynamicConstantAllocation second = {};
+		DynamicConstantAllocation third = {};
+		REQUIRE(SUCCEEDED(allocator.Allocate(first, 1)));
+		REQUIRE(SUCCEEDED(allocator.Allocate(second, ALIGNMENT + 44)));
+		REQUIRE(SUCCEEDED(allocator.Allocate(third, ALIGNMENT)));
+
+		CHECK(first.GpuVirtualAddress % ALIGNMENT == 0);
+		CHECK(first.uSize == ALIGNMENT);
+		CHECK(second.GpuVirtualAddress == first.GpuVirtualAddress + ALIGNMENT);
+		CHECK(second.uSize == 2 * ALIGNMENT);
+		CHECK(third.GpuVirtualAddress == second.GpuVirtualAddress + 2 * ALIGNMENT);
+		CHECK(third.pCpuAddress == first.pCpuAddress + 3 * ALIGNMENT);
+
+		DynamicConstantAllocation invalid = {};
+		CHECK(allocator.Allocate(invalid, 0) == E_INVALIDARG);
+
+		DynamicConstantAllocatorStatistics statistics;
+		allocator.GetStatistics(statistics);
+		CHECK(statistics.uNumPages == 1);
+		CHECK(statistics.uBytesAllocatedThisFrame == 4 * ALIGNMENT);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+
+	// Each frame slot keeps its own pages and only its own slot is rewound, calling BeginFrame again for the
+	// same frame leaves the slot alone
+	TEST_CASE(DynamicConstantAllocatorRewindsOnlyTheSlotOfTheFrame)
+	{
+		CpuUploadPageProvider pageProvider;
+		DynamicConstantAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+
+		DynamicConstantAllocation firstFrame = {};
+		allocator.BeginFrame(0, 0);
+		REQUIRE(SUCCEEDED(allocator.Allocate(firstFrame, ALIGNMENT)));
+
+		DynamicConstantAllocation secondFrame = {};
+		allocator.BeginFrame(1, 1);
+		REQUIRE(SUCCEEDED(allocator.Allocate(secondFrame, ALIGNMENT)));
+		CHECK(secondFrame.pCpuAddress != firstFrame.pCpuAddress);
+
+		DynamicConstantAllocation sameFrame = {};
+		allocator.BeginFrame(1, 1);
+		REQUIRE(SUCCEEDED(allocator.Allocate(sameFrame, ALIGNMENT)));
+		CHECK(sameFrame.GpuVirtualAddress == secondFrame.GpuVirtualAddress + ALIGNMENT);
+
+		// The first slot comes around again and starts over on its page
+		DynamicConstantAllocation fourthFrame = {};
+		allocator.BeginFrame(0, 3);
+		REQUIRE(SUCCEEDED(allocator.Allocate(fourthFrame, ALIGNMENT)));
+		CHECK(fourthFrame.GpuVirtualAddress == firstFrame.GpuVirtualAddress);
+		CHECK(pageProvider.GetNumCreatedPages() == 2);
+
+		DynamicConstantAllocatorStatistics statistics;
+		allocator.GetStatistics(statistics);
+		CHECK(statistics.uBytesAllocatedThisFrame == ALIGNMENT);
+		CHECK(statistics.uPeakBytesPerFrame == 2 * ALIGNMENT);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+
+	// A full page chains another one to the slot, a request larger than a page gets a page of its size, and
+	// once rewound the slot walks the same pages again without creating any
+	TEST_CASE(DynamicConstantAllocatorGrowsAndReusesPages)
+	{
+		constexpr const UINT NUM_FRAMES = 4u;
+
+		CpuUploadPageProvider pageProvider;
+		DynamicConstantAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+
+		for (UINT uFrame = 0; uFrame < NUM_FRAMES; ++uFrame)
+		{
+			allocator.BeginFrame(0, uFrame);
+
+			DynamicConstantAllocation allocation = {};
+			for (UINT64 uOffset = 0; uOffset < PAGE_SIZE; uOffset += ALIGNMENT)
+			{
+				REQUIRE(SUCCEEDED(allocator.Allocate(allocation, ALIGNMENT)));
+			}
+
+			DynamicConstantAllocation overflow = {};
+			REQUIRE(SUCCEEDED(allocator.Allocate(overflow, ALIGNMENT)));
+			CHECK(overflow.pCpuAddress != allocation.pCpuAddress + ALIGNMENT);
+
+			DynamicConstantAllocation large = {};
+			REQUIRE(SUCCEEDED(allocator.Allocate(large, 3 * PAGE_SIZE)));
+			CHECK(large.uSize == 3 * PAGE_SIZE);
+
+			CHECK(pageProvider.GetNumCreatedPages() == 3);
+		}
+
+		DynamicConstantAllocatorStatistics statistics;
+		allocator.GetStatistics(statistics);
+		CHECK(statistics.uNumPages == 3);
+		CHECK(statistics.uPeakBytesPerFrame == 4 * PAGE_SIZE + ALIGNMENT);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+
+	// Elements smaller than the alignment are spread one per slot, elements already a multiple of it are
+	// written in one pass, and either way element i reads back at i * uStride
+	TEST_CASE(DynamicConstantAllocatorWritesStridedAndPackedElements)
+	{
+		constexpr const UINT NUM_ELEMENTS = 5u;
+		constexpr const UINT64 STRIDED_ELEMENT_SIZE = 100u;
+		constexpr const UINT64 PACKED_ELEMENT_SIZE = 2 * ALIGNMENT;
+
+		CpuUploadPageProvider pageProvider;
+		DynamicConstantAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider)));
+		allocator.BeginFrame(0, 0);
+
+		for (const UINT64 uElementSize : { STRIDED_ELEMENT_SIZE, PACKED_ELEMENT_SIZE })
+		{
+			std::vector<BYTE> elements(static_cast<size_t>(NUM_ELEMENTS * uElementSize));
+			for (size_t j = 0; j < elements.size(); ++j)
+			{
+				elements[j] = makeByte(j, static_cast<UINT>(uElementSize));
+			}
+
+			DynamicConstantAllocation allocation = {};
+			REQUIRE(SUCCEEDED(allocator.WriteBulk(allocation, elements.data(), NUM_ELEMENTS, uElementSize)));
+
+			const UINT64 uExpectedStride = (uElementSize + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+			CHECK(allocation.uStride == uExpectedStride);
+			CHECK(allocation.uSize == NUM_ELEMENTS * uExpectedStride);
+			CHECK(allocation.GpuVirtualAddress % ALIGNMENT == 0);
+
+			for (UINT i = 0; i < NUM_ELEMENTS; ++i)
+			{
+				CHECK(std::memcmp(allocation.pCpuAddress + i * allocation.uStride, elements.data() + i * uElementSize, static_cast<size_t>(uElementSize)) == 0);
+			}
+		}
+
+		allocator.Destroy();
+	}
+
+	// Bulk sizes that wrap around are refused before anything is allocated
+	TEST_CASE(DynamicConstantAllocatorRejectsOverflowingBulkAllocations)
+	{
+		CpuUploadPageProvider pageProvider;
+		DynamicConstantAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+		allocator.BeginFrame(0, 0);
+
+		DynamicConstantAllocation allocation = {};
+		CHECK(allocator.AllocateBulk(allocation, 2, UINT64_MAX / 2) == E_INVALIDARG);
+		CHECK(allocator.AllocateBulk(allocation, UINT_MAX, 1ull << 40) == E_INVALIDARG);
+		CHECK(allocator.AllocateBulk(allocation, 1, UINT64_MAX) == E_INVALIDARG);
+		CHECK(allocator.AllocateBulk(allocation, 1, 0) == E_INVALIDARG);
+		CHECK(pageProvider.GetNumCreatedPages() == 0);
+
+		REQUIRE(SUCCEEDED(allocator.AllocateBulk(allocation, 3, 1)));
+		CHECK(allocation.uStride == ALIGNMENT);
+		CHECK(allocation.uSize == 3 * ALIGNMENT);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+}
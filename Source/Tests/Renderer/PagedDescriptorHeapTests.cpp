@@ -0,0 +1,170 @@
+#include "Test.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/PagedDescriptorHeap.h"
+
+namespace esperanza::tests
+{
+	// A request no page has room for chains a page twice the size of the last one, or the size of the request
+	// when that is larger, and the pages already there keep their descriptors
+	TEST_CASE(PagedDescriptorHeapGrowsByDoublingPages)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		PagedDescriptorHeap heap;
+		REQUIRE(SUCCEEDED(heap.Initialize(pDevice, L"Paged Heap", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 4)));
+		CHECK(heap.GetNumPages() == 1);
+
+		PagedDescriptorHandle first;
+		REQUIRE(SUCCEEDED(heap.Alloc(first, 4)));
+		CHECK(first.uPageIndex == 0);
+		CHECK(first.Handle.IsShaderVisible());
+
+		PagedDescriptorHandle second;
+		REQUIRE(SUCCEEDED(heap.Alloc(second, 1)));
+		CHECK(second.uPageIndex == 1);
+		CHECK(second.uOffset == 0);
+		CHECK(heap.GetPage(1).GetNumDescriptors() == 8);
+
+		PagedDescriptorHandle large;
+		REQUIRE(SUCCEEDED(heap.Alloc(large, 20)));
+		CHECK(large.uPageIndex == 2);
+		CHECK(heap.GetPage(2).GetNumDescriptors() == 20);
+		CHECK(heap.GetNumPages() == 3);
+
+		// The rest of the second page still takes small requests instead of a fourth page
+		PagedDescriptorHandle third;
+		REQUIRE(SUCCEEDED(heap.Alloc(third, 7)));
+		CHECK(third.uPageIndex == 1);
+		CHECK(third.uOffset == 1);
+		CHECK(heap.GetNumPages() == 3);
+
+		heap.Destroy();
+	}
+
+	// Of the free ranges that fit, the smallest one is taken even when a larger one comes first
+	TEST_CASE(PagedDescriptorHeapTakesTheBestFittingRange)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		PagedDescriptorHeap heap;
+		REQUIRE(SUCCEEDED(heap.Initialize(pDevice, L"Paged Heap", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 16)));
+
+		PagedDescriptorHandle handles[4];
+		const uint32_t auCounts[] = { 6, 2, 4, 4 };
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			REQUIRE(SUCCEEDED(heap.Alloc(handles[i], auCounts[i])));
+			CHECK(handles[i].uPageIndex == 0);
+		}
+
+		// Leaves a free range of 6 at offset 0 and one of 4 at offset 8
+		REQUIRE(SUCCEEDED(heap.Free(handles[0])));
+		REQUIRE(SUCCEEDED(heap.Free(handles[2])));
+
+		PagedDescriptorHandle small;
+		REQUIRE(SUCCEEDED(heap.Alloc(small, 3)));
+		CHECK(small.uPageIndex == 0);
+		CHECK(small.uOffset == 8);
+
+		PagedDescriptorHandle medium;
+		REQUIRE(SUCCEEDED(heap.Alloc(medium, 5)));
+		CHECK(medium.uPageIndex == 0);
+		CHECK(medium.uOffset == 0);
+		CHECK(heap.GetNumPages() == 1);
+
+		heap.Destroy();
+	}
+
+	// A freed range merges with free neighbours on both sides, so the page can hand out the whole span again
+	TEST_CASE(PagedDescriptorHeapMergesFreedRanges)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		PagedDescriptorHeap heap;
+		REQUIRE(SUCCEEDED(heap.Initialize(pDevice, L"Paged Heap", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 8)));
+
+		PagedDescriptorHandle handles[4];
+		for (PagedDescriptorHandle& handle : handles)
+		{
+			REQUIRE(SUCCEEDED(heap.Alloc(handle, 2)));
+		}
+		CHECK(!heap.HasAvailableSpace(0, 1));
+
+		REQUIRE(SUCCEEDED(heap.Free(handles[0])));
+		REQUIRE(SUCCEEDED(heap.Free(handles[2])));
+		CHECK(heap.HasAvailableSpace(0, 2));
+		CHECK(!heap.HasAvailableSpace(0, 3));
+
+		// Bridges the two free ranges
+		REQUIRE(SUCCEEDED(heap.Free(handles[1])));
+		CHECK(heap.HasAvailableSpace(0, 6));
+		CHECK(!heap.HasAvailableSpace(0, 7));
+
+		PagedDescriptorHandle merged;
+		REQUIRE(SUCCEEDED(heap.Alloc(merged, 6)));
+		CHECK(merged.uPageIndex == 0);
+		CHECK(merged.uOffset == 0);
+		CHECK(heap.GetNumPages() == 1);
+
+		heap.Destroy();
+	}
+
+	// Freeing a range twice, a range overlapping a free one or a range from no page is refused and leaves the
+	// free ranges as they were
+	TEST_CASE(PagedDescriptorHeapRejectsDoubleFrees)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		PagedDescriptorHeap heap;
+		REQUIRE(SUCCEEDED(heap.Initialize(pDevice, L"Paged Heap", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 8)));
+
+		PagedDescriptorHandle first;
+		PagedDescriptorHandle second;
+		REQUIRE(SUCCEEDED(heap.Alloc(first, 4)));
+		REQUIRE(SUCCEEDED(heap.Alloc(second, 4)));
+
+		REQUIRE(SUCCEEDED(heap.Free(first)));
+		CHECK(heap.Free(first) == E_INVALIDARG);
+
+		PagedDescriptorHandle overlapping = second;
+		overlapping.uOffset = 2;
+		CHECK(heap.Free(overlapping) == E_INVALIDARG);
+
+		PagedDescriptorHandle foreign = second;
+		foreign.uPageIndex = 1;
+		CHECK(heap.Free(foreign) == E_INVALIDARG);
+
+		// Only the first range is free, so the page still cannot take more than four descriptors in one go
+		CHECK(heap.HasAvailableSpace(0, 4));
+		CHECK(!heap.HasAvailableSpace(0, 5));
+
+		REQUIRE(SUCCEEDED(heap.Free(second)));
+		CHECK(heap.HasAvailableSpace(0, 8));
+
+		heap.Destroy();
+	}
+
+	// Pages are shader visible, which render target and depth stencil heaps cannot be
+	TEST_CASE(PagedDescriptorHeapRejectsRenderTargetAndDepthStencilTypes)
+	{
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		PagedDescriptorHeap rtvHeap;
+		CHECK(rtvHeap.Initialize(pDevice, L"Paged Heap", D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 8) == E_INVALIDARG);
+		CHECK(rtvHeap.GetNumPages() == 0);
+
+		PagedDescriptorHeap dsvHeap;
+		CHECK(dsvHeap.Initialize(pDevice, L"Paged Heap", D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 8) == E_INVALIDARG);
+		CHECK(dsvHeap.GetNumPages() == 0);
+
+		PagedDescriptorHeap samplerHeap;
+		CHECK(SUCCEEDED(samplerHeap.Initialize(pDevice, L"Paged Heap", D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 8)));
+		samplerHeap.Destroy();
+	}
+}
@@ -0,0 +1,299 @@
+#include "Test.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/CommandContext.h"
+#include "Renderer/CommandListManager.h"
+#include "Renderer/GpuResource.h"
+#include "Renderer/RenderGraph.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		constexpr const UINT64 PLACEMENT_ALIGNMENT = 64u * 1024u;
+
+		// Compile only looks at the allocation info, so the size is made up instead of asking a device
+		RenderGraphTextureDesc makeTextureDesc(_In_ D3D12_RESOURCE_FLAGS flags) noexcept
+		{
+			RenderGraphTextureDesc desc = {};
+			desc.Desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1280, 720, 1, 1, 1, 0, flags);
+			desc.AllocationInfo.SizeInBytes = 1280u * 720u * 4u;
+			desc.AllocationInfo.SizeInBytes = (desc.AllocationInfo.SizeInBytes + PLACEMENT_ALIGNMENT - 1) & ~(PLACEMENT_ALIGNMENT - 1);
+			desc.AllocationInfo.Alignment = PLACEMENT_ALIGNMENT;
+
+			return desc;
+		}
+	}
+
+	// Passes only feeding a resource nobody reads are culled, passes with side effects never are
+	TEST_CASE(RenderGraphCullsPassesNothingConsumes)
+	{
+		RenderGraph graph;
+		GpuResource backBuffer;
+
+		RenderGraphResourceHandle backBufferHandle = RenderGraph::INVALID_HANDLE;
+		RenderGraphResourceHandle sceneHandle = RenderGraph::INVALID_HANDLE;
+		RenderGraphResourceHandle unusedHandle = RenderGraph::INVALID_HANDLE;
+		REQUIRE(SUCCEEDED(graph.ImportResource(backBufferHandle, backBuffer, D3D12_RESOURCE_STATE_PRESENT, L"Back Buffer")));
+		REQUIRE(SUCCEEDED(graph.CreateTransientResource(sceneHandle, makeTextureDesc(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET), L"Scene")));
+		REQUIRE(SUCCEEDED(graph.CreateTransientResource(unusedHandle, makeTextureDesc(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET), L"Unused")));
+
+		uint32_t uScenePass = 0;
+		uint32_t uUnusedPass = 0;
+		uint32_t uReadbackPass = 0;
+		uint32_t uCompositePass = 0;
+		REQUIRE(SUCCEEDED(graph.AddPass(uScenePass, L"Scene", nullptr, nullptr)));
+		REQUIRE(SUCCEEDED(graph.AddPass(uUnusedPass, L"Unused", nullptr, nullptr)));
+		REQUIRE(SUCCEEDED(graph.AddPass(uReadbackPass, L"Readback", nullptr, nullptr)));
+		REQUIRE(SUCCEEDED(graph.AddPass(uCompositePass, L"Composite", nullptr, nullptr)));
+
+		REQUIRE(SUCCEEDED(graph.WriteResource(uScenePass, sceneHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+		REQUIRE(SUCCEEDED(graph.WriteResource(uUnusedPass, unusedHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+		REQUIRE(SUCCEEDED(graph.SetHasSideEffects(uReadbackPass)));
+		REQUIRE(SUCCEEDED(graph.ReadResource(uCompositePass, sceneHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)));
+		REQUIRE(SUCCEEDED(graph.WriteResource(uCompositePass, backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+
+		REQUIRE(SUCCEEDED(graph.Compile()));
+
+		CHECK(!graph.IsPassCulled(uScenePass));
+		CHECK(graph.IsPassCulled(uUnusedPass));
+		CHECK(!graph.IsPassCulled(uReadbackPass));
+		CHECK(!graph.IsPassCulled(uCompositePass));
+
+		RenderGraphStatistics statistics;
+		graph.GetStatistics(statistics);
+		CHECK(statistics.uNumPasses == 4);
+		CHECK(statistics.uNumCulledPasses == 1);
+		CHECK(statistics.uNumTransientResources == 1);
+	}
+
+	// A chain of three transients only ever has two alive at once, so the third reuses the memory of the first
+	TEST_CASE(RenderGraphAliasesTransientsWithDisjointLifetimes)
+	{
+		RenderGraph graph;
+		GpuResource backBuffer;
+
+		RenderGraphResourceHandle backBufferHandle = RenderGraph::INVALID_HANDLE;
+		REQUIRE(SUCCEEDED(graph.ImportResource(backBufferHandle, backBuffer, D3D12_RESOURCE_STATE_PRESENT, L"Back Buffer")));
+
+		const RenderGraphTextureDesc desc = makeTextureDesc(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+		RenderGraphResourceHandle aHandles[3] = {};
+		for (RenderGraphResourceHandle& handle : aHandles)
+		{
+			REQUIRE(SUCCEEDED(graph.CreateTransientResource(handle, desc, L"Chain")));
+		}
+
+		for (uint32_t i = 0; i <= ARRAYSIZE(aHandles); ++i)
+		{
+			uint32_t uPass = 0;
+			REQUIRE(SUCCEEDED(graph.AddPass(uPass, L"Chain", nullptr, nullptr)));
+
+			if (i > 0)
+			{
+				REQUIRE(SUCCEEDED(graph.ReadResource(uPass, aHandles[i - 1], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)));
+			}
+
+			REQUIRE(SUCCEEDED(graph.WriteResource(uPass, i < ARRAYSIZE(aHandles) ? aHandles[i] : backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+		}
+
+		REQUIRE(SUCCEEDED(graph.Compile()));
+
+		RenderGraphStatistics statistics;
+		graph.GetStatistics(statistics);
+		CHECK(statistics.uNumTransientResources == 3);
+		CHECK(statistics.uTransientBytesRequested == 3 * desc.AllocationInfo.SizeInBytes);
+		CHECK(statistics.uTransientHeapSize == 2 * desc.AllocationInfo.SizeInBytes);
+		CHECK(statistics.uNumAliasBarriers == 1);
+
+		// One transition from render target to shader resource per transient, then to present at the end
+		CHECK(statistics.uNumTransitionBarriers == 4);
+	}
+
+	// Unordered access after an unordered write needs a UAV barrier whether it reads or writes, a read after a
+	// read does not
+	TEST_CASE(RenderGraphPlansUavBarriersAfterUavWrites)
+	{
+		RenderGraph graph;
+		GpuResource backBuffer;
+
+		RenderGraphResourceHandle backBufferHandle = RenderGraph::INVALID_HANDLE;
+		RenderGraphResourceHandle bufferHandle = RenderGraph::INVALID_HANDLE;
+		REQUIRE(SUCCEEDED(graph.ImportResource(backBufferHandle, backBuffer, D3D12_RESOURCE_STATE_PRESENT, L"Back Buffer")));
+		REQUIRE(SUCCEEDED(graph.CreateTransientResource(bufferHandle,
+			makeTextureDesc(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS), L"Simulation")));
+
+		const BOOL abIsWrite[] = { TRUE, TRUE, FALSE, FALSE };
+		for (BOOL bIsWrite : abIsWrite)
+		{
+			uint32_t uPass = 0;
+			REQUIRE(SUCCEEDED(graph.AddPass(uPass, L"Simulate", nullptr, nullptr)));
+			REQUIRE(SUCCEEDED(bIsWrite ?
+				graph.WriteResource(uPass, bufferHandle, D3D12_RESOURCE_STATE_UNORDERED_ACCESS) :
+				graph.ReadResource(uPass, bufferHandle, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)));
+			REQUIRE(SUCCEEDED(graph.SetHasSideEffects(uPass)));
+		}
+
+		uint32_t uCompositePass = 0;
+		REQUIRE(SUCCEEDED(graph.AddPass(uCompositePass, L"Composite", nullptr, nullptr)));
+		REQUIRE(SUCCEEDED(graph.ReadResource(uCompositePass, bufferHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)));
+		REQUIRE(SUCCEEDED(graph.WriteResource(uCompositePass, backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+
+		REQUIRE(SUCCEEDED(graph.Compile()));
+
+		RenderGraphStatistics statistics;
+		graph.GetStatistics(statistics);
+		CHECK(statistics.uNumUavBarriers == 2);
+		CHECK(statistics.uNumTransitionBarriers == 2);
+		CHECK(statistics.uNumAliasBarriers == 0);
+	}
+
+	// Consecutive reads in different read states share a single transition into their union
+	TEST_CASE(RenderGraphMergesReadRunsIntoOneTransition)
+	{
+		RenderGraph graph;
+		GpuResource backBuffer;
+
+		RenderGraphResourceHandle backBufferHandle = RenderGraph::INVALID_HANDLE;
+		RenderGraphResourceHandle shadowHandle = RenderGraph::INVALID_HANDLE;
+		REQUIRE(SUCCEEDED(graph.ImportResource(backBufferHandle, backBuffer, D3D12_RESOURCE_STATE_PRESENT, L"Back Buffer")));
+		REQUIRE(SUCCEEDED(graph.CreateTransientResource(shadowHandle, makeTextureDesc(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET), L"Shadow")));
+
+		uint32_t uShadowPass = 0;
+		REQUIRE(SUCCEEDED(graph.AddPass(uShadowPass, L"Shadow", nullptr, nullptr)));
+		REQUIRE(SUCCEEDED(graph.WriteResource(uShadowPass, shadowHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+
+		const D3D12_RESOURCE_STATES aReadStates[] = { D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE };
+		for (D3D12_RESOURCE_STATES readState : aReadStates)
+		{
+			uint32_t uPass = 0;
+			REQUIRE(SUCCEEDED(graph.AddPass(uPass, L"Lighting", nullptr, nullptr)));
+			REQUIRE(SUCCEEDED(graph.ReadResource(uPass, shadowHandle, readState)));
+			REQUIRE(SUCCEEDED(graph.WriteResource(uPass, backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+		}
+
+		REQUIRE(SUCCEEDED(graph.Compile()));
+
+		RenderGraphStatistics statistics;
+		graph.GetStatistics(statistics);
+		CHECK(statistics.uNumTransitionBarriers == 2);
+		CHECK(statistics.uNumUavBarriers == 0);
+	}
+
+	// Compiling again without changes plans the same graph
+	TEST_CASE(RenderGraphCompileIsRepeatable)
+	{
+		RenderGraph graph;
+		GpuResource backBuffer;
+
+		RenderGraphResourceHandle backBufferHandle = RenderGraph::INVALID_HANDLE;
+		RenderGraphResourceHandle sceneHandle = RenderGraph::INVALID_HANDLE;
+		REQUIRE(SUCCEEDED(graph.ImportResource(backBufferHandle, backBuffer, D3D12_RESOURCE_STATE_PRESENT, L"Back Buffer")));
+		REQUIRE(SUCCEEDED(graph.CreateTransientResource(sceneHandle, makeTextureDesc(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET), L"Scene")));
+
+		uint32_t uScenePass = 0;
+		uint32_t uCompositePass = 0;
+		REQUIRE(SUCCEEDED(graph.AddPass(uScenePass, L"Scene", nullptr, nullptr)));
+		REQUIRE(SUCCEEDED(graph.AddPass(uCompositePass, L"Composite", nullptr, nullptr)));
+		REQUIRE(SUCCEEDED(graph.WriteResource(uScenePass, sceneHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+		REQUIRE(SUCCEEDED(graph.ReadResource(uCompositePass, sceneHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)));
+		REQUIRE(SUCCEEDED(graph.WriteResource(uCompositePass, backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+
+		REQUIRE(SUCCEEDED(graph.Compile()));
+		RenderGraphStatistics firstStatistics;
+		graph.GetStatistics(firstStatistics);
+
+		REQUIRE(SUCCEEDED(graph.Compile()));
+		RenderGraphStatistics secondStatistics;
+		graph.GetStatistics(secondStatistics);
+
+		CHECK(secondStatistics.uNumCulledPasses == firstStatistics.uNumCulledPasses);
+		CHECK(secondStatistics.uNumTransientResources == firstStatistics.uNumTransientResources);
+		CHECK(secondStatistics.uNumTransitionBarriers == firstStatistics.uNumTransitionBarriers);
+		CHECK(secondStatistics.uNumUavBarriers == firstStatistics.uNumUavBarriers);
+		CHECK(secondStatistics.uNumAliasBarriers == firstStatistics.uNumAliasBarriers);
+		CHECK(secondStatistics.uTransientHeapSize == firstStatistics.uTransientHeapSize);
+		CHECK(secondStatistics.uNumTransitionBarriers == 2);
+	}
+
+	// Executes a chain of three transients twice on the headless device.  The first frame activates every new
+	// placed resource, the second only the two sharing memory, and neither pays a fix-up for them: their state
+	// is dropped with their contents.  The transient nobody took memory from is fixed up like any other resource.
+	TEST_CASE(RenderGraphExecuteActivatesTransientsWithoutFixups)
+	{
+		constexpr const uint32_t NUM_FRAMES = 2u;
+
+		ID3D12Device* pDevice = GetHeadlessDevice();
+		REQUIRE(pDevice != nullptr);
+
+		std::shared_ptr<CommandListManager> pCommandListManager = std::make_shared<CommandListManager>();
+		REQUIRE(SUCCEEDED(pCommandListManager->Initialize(pDevice)));
+
+		ContextManager contextManager;
+		REQUIRE(SUCCEEDED(contextManager.Initialize(pCommandListManager)));
+
+		// Rendered to and left as a render target, so the back buffer needs no barrier of its own
+		const D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+		const D3D12_RESOURCE_DESC backBufferDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+		ComPtr<ID3D12Resource> pBackBufferResource;
+		REQUIRE(SUCCEEDED(pDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &backBufferDesc, D3D12_RESOURCE_STATE_RENDER_TARGET, nullptr,
+			IID_PPV_ARGS(&pBackBufferResource))));
+		GpuResource backBuffer(pBackBufferResource.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+		RenderGraphTextureDesc desc = {};
+		desc.Desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+		desc.AllocationInfo = pDevice->GetResourceAllocationInfo(0, 1, &desc.Desc);
+
+		RenderGraph graph;
+		RenderGraphStatistics aStatistics[NUM_FRAMES] = {};
+		for (uint32_t uFrame = 0; uFrame < NUM_FRAMES; ++uFrame)
+		{
+			graph.Reset();
+
+			RenderGraphResourceHandle backBufferHandle = RenderGraph::INVALID_HANDLE;
+			REQUIRE(SUCCEEDED(graph.ImportResource(backBufferHandle, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, L"Back Buffer")));
+
+			RenderGraphResourceHandle aHandles[3] = {};
+			for (RenderGraphResourceHandle& handle : aHandles)
+			{
+				REQUIRE(SUCCEEDED(graph.CreateTransientResource(handle, desc, L"Chain")));
+			}
+
+			for (uint32_t i = 0; i <= ARRAYSIZE(aHandles); ++i)
+			{
+				uint32_t uPass = 0;
+				REQUIRE(SUCCEEDED(graph.AddPass(uPass, L"Chain", nullptr, nullptr)));
+
+				if (i > 0)
+				{
+					REQUIRE(SUCCEEDED(graph.ReadResource(uPass, aHandles[i - 1], D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)));
+				}
+
+				REQUIRE(SUCCEEDED(graph.WriteResource(uPass, i < ARRAYSIZE(aHandles) ? aHandles[i] : backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET)));
+			}
+
+			UINT64 uFenceValue = 0;
+			REQUIRE(SUCCEEDED(graph.Execute(pDevice, contextManager, *pCommandListManager, uFenceValue)));
+			graph.GetStatistics(aStatistics[uFrame]);
+		}
+
+		pCommandListManager->IdleGpu();
+
+		ResourceBarrierStatistics barrierStatistics;
+		contextManager.GetResourceBarrierStatistics(barrierStatistics);
+
+		// Compile still counts the overlap inside the frame, Execute counts what it activated
+		CHECK(aStatistics[0].uNumAliasBarriers == 1);
+		CHECK(aStatistics[1].uNumAliasBarriers == 1);
+		CHECK(aStatistics[0].uNumActivations == 3);
+		CHECK(aStatistics[1].uNumActivations == 2);
+
+		CHECK(barrierStatistics.uNumAliasBarriers == 5);
+		CHECK(barrierStatistics.uNumFixupBarriers == 1);
+		CHECK(barrierStatistics.uNumTransitionBarriers == 3 * NUM_FRAMES);
+		CHECK(pDevice->GetDeviceRemovedReason() == S_OK);
+
+		graph.Destroy();
+		contextManager.Destroy();
+		pCommandListManager->Destroy();
+	}
+}
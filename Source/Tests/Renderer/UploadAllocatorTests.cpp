@@ -0,0 +1,147 @@
+#include "Test.h"
+
+#include "Renderer/UploadAllocator.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		constexpr const UINT64 PAGE_SIZE = 64u * 1024u;
+	}
+
+	// Allocations follow each other in one page at their own alignment, and both addresses of an allocation
+	// point at the same bytes of the page
+	TEST_CASE(LinearUploadAllocatorSubAllocatesAtTheRequestedAlignment)
+	{
+		CpuUploadPageProvider pageProvider;
+		LinearUploadAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+
+		UploadAllocation first = {};
+		UploadAllocation second = {};
+		UploadAllocation third = {};
+		REQUIRE(SUCCEEDED(allocator.Allocate(first, 100, 16)));
+		REQUIRE(SUCCEEDED(allocator.Allocate(second, 100, 256)));
+		REQUIRE(SUCCEEDED(allocator.Allocate(third, 1, 0)));
+
+		CHECK(first.uOffset == 0);
+		CHECK(second.uOffset == 256);
+		CHECK(third.uOffset == 356);
+		CHECK(second.pCpuAddress == first.pCpuAddress + 256);
+		CHECK(second.GpuVirtualAddress == first.GpuVirtualAddress + 256);
+		CHECK(pageProvider.GetNumCreatedPages() == 1);
+
+		UploadAllocation invalid = {};
+		CHECK(allocator.Allocate(invalid, 16, 3) == E_INVALIDARG);
+		CHECK(allocator.Allocate(invalid, 0, 16) == E_INVALIDARG);
+
+		// Writing a whole allocation must not touch its neighbours
+		std::memset(first.pCpuAddress, 0x11, static_cast<size_t>(first.uSize));
+		std::memset(second.pCpuAddress, 0x22, static_cast<size_t>(second.uSize));
+		std::memset(third.pCpuAddress, 0x33, static_cast<size_t>(third.uSize));
+		CHECK(first.pCpuAddress[first.uSize - 1] == 0x11);
+		CHECK(second.pCpuAddress[second.uSize - 1] == 0x22);
+
+		UploadAllocatorStatistics statistics;
+		allocator.GetStatistics(statistics);
+		CHECK(statistics.uNumPages == 1);
+		CHECK(statistics.uBytesAllocated == 201);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+
+	// An allocation that does not fit the rest of the page opens a new one instead of straddling both
+	TEST_CASE(LinearUploadAllocatorOpensANewPageWhenFull)
+	{
+		CpuUploadPageProvider pageProvider;
+		LinearUploadAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+
+		UploadAllocation first = {};
+		UploadAllocation second = {};
+		REQUIRE(SUCCEEDED(allocator.Allocate(first, PAGE_SIZE - 64, 256)));
+		REQUIRE(SUCCEEDED(allocator.Allocate(second, 128, 256)));
+
+		CHECK(second.uOffset == 0);
+		CHECK(pageProvider.GetNumCreatedPages() == 2);
+		CHECK(second.pCpuAddress < first.pCpuAddress || second.pCpuAddress >= first.pCpuAddress + PAGE_SIZE);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+
+	// Retired pages come back only once their fence completes, and in the meantime new pages are created
+	TEST_CASE(LinearUploadAllocatorRecyclesPagesAfterTheirFence)
+	{
+		constexpr const uint32_t NUM_FRAMES = 8u;
+		constexpr const uint32_t NUM_FRAMES_IN_FLIGHT = 2u;
+
+		CpuUploadPageProvider pageProvider;
+		LinearUploadAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+
+		for (uint32_t uFrame = 1; uFrame <= NUM_FRAMES; ++uFrame)
+		{
+			// The GPU runs NUM_FRAMES_IN_FLIGHT frames behind the CPU
+			if (uFrame > NUM_FRAMES_IN_FLIGHT)
+			{
+				pageProvider.SetCompletedFenceValue(uFrame - NUM_FRAMES_IN_FLIGHT);
+			}
+
+			UploadAllocation allocation = {};
+			REQUIRE(SUCCEEDED(allocator.Allocate(allocation, PAGE_SIZE / 2, 256)));
+
+			allocator.RetirePages(uFrame);
+		}
+
+		// One page per frame in flight, every later frame reuses the page of the frame the GPU just finished
+		UploadAllocatorStatistics statistics;
+		allocator.GetStatistics(statistics);
+		CHECK(pageProvider.GetNumCreatedPages() == NUM_FRAMES_IN_FLIGHT);
+		CHECK(statistics.uNumPages == NUM_FRAMES_IN_FLIGHT);
+		CHECK(statistics.uNumRecycledPages == NUM_FRAMES - NUM_FRAMES_IN_FLIGHT);
+		CHECK(statistics.uNumRetiredPages == NUM_FRAMES_IN_FLIGHT);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+
+	// Requests bigger than a page get a page of their own, which is destroyed after its fence instead of
+	// being recycled, and its slot is taken by the next large page
+	TEST_CASE(LinearUploadAllocatorDestroysLargePagesAfterTheirFence)
+	{
+		CpuUploadPageProvider pageProvider;
+		LinearUploadAllocator allocator;
+		REQUIRE(SUCCEEDED(allocator.Initialize(pageProvider, PAGE_SIZE)));
+
+		UploadAllocation small = {};
+		UploadAllocation large = {};
+		REQUIRE(SUCCEEDED(allocator.Allocate(small, 256, 256)));
+		REQUIRE(SUCCEEDED(allocator.Allocate(large, PAGE_SIZE * 3, 256)));
+
+		CHECK(large.uOffset == 0);
+		CHECK(large.uSize == PAGE_SIZE * 3);
+		CHECK(pageProvider.GetNumLivePages() == 2);
+
+		allocator.RetirePages(1);
+		CHECK(pageProvider.GetNumLivePages() == 2);
+
+		// Collected on the next allocation that needs a page
+		pageProvider.SetCompletedFenceValue(1);
+		REQUIRE(SUCCEEDED(allocator.Allocate(small, 256, 256)));
+		CHECK(pageProvider.GetNumLivePages() == 1);
+
+		REQUIRE(SUCCEEDED(allocator.Allocate(large, PAGE_SIZE * 2, 256)));
+		CHECK(pageProvider.GetNumLivePages() == 2);
+
+		UploadAllocatorStatistics statistics;
+		allocator.GetStatistics(statistics);
+		CHECK(statistics.uNumLargePages == 2);
+		CHECK(statistics.uNumRecycledPages == 1);
+		CHECK(statistics.uNumPages == 2);
+
+		allocator.Destroy();
+		CHECK(pageProvider.GetNumLivePages() == 0);
+	}
+}
@@ -0,0 +1,355 @@
+#include "Test.h"
+#include "HeadlessDevice.h"
+
+#include "Renderer/CommandContext.h"
+#include "Renderer/CommandListManager.h"
+#include "Renderer/GpuResource.h"
+#include "Renderer/UploadAllocator.h"
+#include "Renderer/UploadBatcher.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		constexpr const UINT64 BUFFER_SIZE = 64u * 1024u;
+
+		// An upload batcher over its own upload allocator on the headless device, and a way to read back what
+		// its copies wrote
+		struct UploadTestFixture final
+		{
+			explicit UploadTestFixture() noexcept
+				: pDevice(GetHeadlessDevice())
+				, pCommandListManager(std::make_shared<CommandListManager>())
+				, pContextManager(std::make_unique<ContextManager>())
+				, pPageProvider(std::make_unique<D3D12UploadPageProvider>())
+				, pUploadAllocator(std::make_unique<LinearUploadAllocator>())
+				, pUploadBatcher(std::make_unique<UploadBatcher>())
+			{
+			}
+
+			UploadTestFixture(const UploadTestFixture& other) = delete;
+			UploadTestFixture(UploadTestFixture&& other) = delete;
+			UploadTestFixture& operator=(const UploadTestFixture& other) = delete;
+			UploadTestFixture& operator=(UploadTestFixture&& other) = delete;
+
+			~UploadTestFixture() noexcept
+			{
+				if (pCommandListManager->GetGraphicsQueue().IsReady())
+				{
+					pCommandListManager->IdleGpu();
+				}
+
+				pUploadBatcher->Destroy();
+				pUploadAllocator->Destroy();
+				pPageProvider->Destroy();
+				pContextManager->Destroy();
+				pCommandListManager->Destroy();
+			}
+
+			HRESULT Initialize() noexcept
+			{
+				if (!pDevice)
+				{
+					return E_FAIL;
+				}
+
+				HRESULT hr = pCommandListManager->Initialize(pDevice);
+				if (SUCCEEDED(hr))
+				{
+					hr = pContextManager->Initialize(pCommandListManager);
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = pPageProvider->Initialize(pDevice, *pCommandListManager);
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = pUploadAllocator->Initialize(*pPageProvider);
+				}
+				if (SUCCEEDED(hr))
+				{
+					hr = pUploadBatcher->Initialize(pDevice, *pUploadAllocator, *pContextManager, *pCommandListManager);
+				}
+
+				return hr;
+			}
+
+			HRESULT CreateResource(_Out_ std::unique_ptr<GpuResource>& pOutResource, _In_ const D3D12_RESOURCE_DESC& desc) noexcept
+			{
+				const D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+
+				ComPtr<ID3D12Resource> pResource;
+				HRESULT hr = pDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pResource));
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				pOutResource = std::make_unique<GpuResource>(pResource.Get(), D3D12_RESOURCE_STATE_COMMON);
+
+				return hr;
+			}
+
+			// Copies every subresource into a readback buffer laid out as GetCopyableFootprints places them and
+			// waits for the copy, which runs on the copy queue after every batch flushed before
+			HRESULT ReadBack(_Out_ std::vector<BYTE>& outData, _In_ GpuResource& resource) noexcept
+			{
+				outData.clear();
+
+				const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+				const UINT uNumSubresources = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? 1u : static_cast<UINT>(desc.MipLevels) * desc.DepthOrArraySize;
+
+				std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(uNumSubresources);
+				UINT64 uTotalSize = 0;
+				pDevice->GetCopyableFootprints(&desc, 0, uNumSubresources, 0, footprints.data(), nullptr, nullptr, &uTotalSize);
+
+				const D3D12_HEAP_PROPERTIES heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+				const D3D12_RESOURCE_DESC readbackDesc = CD3DX12_RESOURCE_DESC::Buffer(uTotalSize);
+
+				ComPtr<ID3D12Resource> pReadback;
+				HRESULT hr = pDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &readbackDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pReadback));
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				CommandContext* pContext = nullptr;
+				hr = pContextManager->BeginCopyContext(&pContext, L"Read Back");
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				ID3D12GraphicsCommandList* pCommandList = pContext->GetCommandList();
+				if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+				{
+					pCommandList->CopyBufferRegion(pReadback.Get(), 0, resource.GetResource(), 0, desc.Width);
+				}
+				else
+				{
+					for (UINT i = 0; i < uNumSubresources; ++i)
+					{
+						CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(pReadback.Get(), footprints[i]);
+						CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(resource.GetResource(), i);
+						pCommandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+					}
+				}
+
+				UINT64 uFenceValue = 0;
+				hr = pContext->Finish(uFenceValue, TRUE);
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				const D3D12_RANGE readRange = { 0, static_cast<SIZE_T>(uTotalSize) };
+				BYTE* pMappedData = nullptr;
+				hr = pReadback->Map(0, &readRange, reinterpret_cast<void**>(&pMappedData));
+				if (FAILED(hr))
+				{
+					return hr;
+				}
+
+				outData.assign(pMappedData, pMappedData + uTotalSize);
+
+				const D3D12_RANGE writtenRange = { 0, 0 };
+				pReadback->Unmap(0, &writtenRange);
+
+				return hr;
+			}
+
+			UploadBatcherStatistics GetStatistics() noexcept
+			{
+				UploadBatcherStatistics statistics;
+				pUploadBatcher->GetStatistics(statistics);
+
+				return statistics;
+			}
+
+			ID3D12Device* pDevice;
+			std::shared_ptr<CommandListManager> pCommandListManager;
+			std::unique_ptr<ContextManager> pContextManager;
+			std::unique_ptr<D3D12UploadPageProvider> pPageProvider;
+			std::unique_ptr<LinearUploadAllocator> pUploadAllocator;
+			std::unique_ptr<UploadBatcher> pUploadBatcher;
+		};
+
+		BYTE makeByte(_In_ UINT64 uIndex, _In_ UINT uSeed) noexcept
+		{
+			return static_cast<BYTE>((uIndex * 31u + uSeed * 7u) & 0xff);
+		}
+	}
+
+	// Uploads into consecutive ranges of a buffer come out as one CopyBufferRegion, a gap in the destination
+	// starts a new one, and every byte lands where it was uploaded
+	TEST_CASE(UploadBatcherMergesConsecutiveBufferUploads)
+	{
+		UploadTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		std::unique_ptr<GpuResource> pBuffer;
+		REQUIRE(SUCCEEDED(fixture.CreateResource(pBuffer, CD3DX12_RESOURCE_DESC::Buffer(BUFFER_SIZE))));
+
+		// Three uploads back to back, then one after a gap
+		const UINT64 auOffsets[] = { 0u, 1000u, 2000u, 8000u };
+		const UINT64 auSizes[] = { 1000u, 1000u, 3000u, 500u };
+		std::vector<BYTE> expected(BUFFER_SIZE, 0);
+		for (UINT i = 0; i < 4; ++i)
+		{
+			std::vector<BYTE> data(static_cast<size_t>(auSizes[i]));
+			for (UINT64 j = 0; j < auSizes[i]; ++j)
+			{
+				data[static_cast<size_t>(j)] = makeByte(j, i + 1);
+				expected[static_cast<size_t>(auOffsets[i] + j)] = data[static_cast<size_t>(j)];
+			}
+
+			REQUIRE(SUCCEEDED(fixture.pUploadBatcher->UploadBuffer(*pBuffer, auOffsets[i], data.data(), auSizes[i])));
+		}
+
+		UINT64 uFenceValue = 0;
+		REQUIRE(SUCCEEDED(fixture.pUploadBatcher->Flush(uFenceValue)));
+		CHECK(uFenceValue == fixture.pUploadBatcher->GetLastFenceValue());
+
+		const UploadBatcherStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumBufferUploads == 4);
+		CHECK(statistics.uNumBufferCopies == 2);
+		CHECK(statistics.uNumSubmissions == 1);
+		CHECK(statistics.uBytesUploaded == 5500);
+
+		std::vector<BYTE> data;
+		REQUIRE(SUCCEEDED(fixture.ReadBack(data, *pBuffer)));
+		REQUIRE(data.size() >= BUFFER_SIZE);
+		CHECK(std::memcmp(data.data(), expected.data(), static_cast<size_t>(BUFFER_SIZE)) == 0);
+		CHECK(fixture.pDevice->GetDeviceRemovedReason() == S_OK);
+
+		pBuffer->Destroy();
+	}
+
+	// Every mip of a texture whose rows are not a multiple of the pitch alignment is copied with its own
+	// footprint, so the padded rows in the upload page must come back as the tightly packed source rows
+	TEST_CASE(UploadBatcherCopiesEachSubresourceWithItsFootprint)
+	{
+		constexpr const UINT WIDTH = 20u;
+		constexpr const UINT HEIGHT = 7u;
+		constexpr const UINT16 NUM_MIPS = 3u;
+		constexpr const UINT BYTES_PER_TEXEL = 4u;
+
+		UploadTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		std::unique_ptr<GpuResource> pTexture;
+		REQUIRE(SUCCEEDED(fixture.CreateResource(pTexture, CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, WIDTH, HEIGHT, 1, NUM_MIPS))));
+
+		std::vector<std::vector<BYTE>> mips(NUM_MIPS);
+		D3D12_SUBRESOURCE_DATA aSubresources[NUM_MIPS] = {};
+		for (UINT uMip = 0; uMip < NUM_MIPS; ++uMip)
+		{
+			const UINT uRowSize = std::max(WIDTH >> uMip, 1u) * BYTES_PER_TEXEL;
+			const UINT uNumRows = std::max(HEIGHT >> uMip, 1u);
+
+			mips[uMip].resize(static_cast<size_t>(uRowSize) * uNumRows);
+			for (size_t j = 0; j < mips[uMip].size(); ++j)
+			{
+				mips[uMip][j] = makeByte(j, uMip + 1);
+			}
+
+			aSubresources[uMip].pData = mips[uMip].data();
+			aSubresources[uMip].RowPitch = uRowSize;
+			aSubresources[uMip].SlicePitch = static_cast<LONG_PTR>(mips[uMip].size());
+		}
+
+		REQUIRE(SUCCEEDED(fixture.pUploadBatcher->UploadTexture(*pTexture, 0, NUM_MIPS, aSubresources)));
+
+		UINT64 uFenceValue = 0;
+		REQUIRE(SUCCEEDED(fixture.pUploadBatcher->Flush(uFenceValue)));
+
+		const UploadBatcherStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumTextureUploads == 1);
+		CHECK(statistics.uNumTextureCopies == NUM_MIPS);
+		CHECK(statistics.uNumSubmissions == 1);
+
+		std::vector<BYTE> data;
+		REQUIRE(SUCCEEDED(fixture.ReadBack(data, *pTexture)));
+
+		const D3D12_RESOURCE_DESC desc = (*pTexture)->GetDesc();
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT aFootprints[NUM_MIPS] = {};
+		fixture.pDevice->GetCopyableFootprints(&desc, 0, NUM_MIPS, 0, aFootprints, nullptr, nullptr, nullptr);
+
+		for (UINT uMip = 0; uMip < NUM_MIPS; ++uMip)
+		{
+			const size_t uRowSize = static_cast<size_t>(aSubresources[uMip].RowPitch);
+			const size_t uNumRows = mips[uMip].size() / uRowSize;
+			CHECK(aFootprints[uMip].Footprint.RowPitch > uRowSize);
+
+			for (size_t y = 0; y < uNumRows; ++y)
+			{
+				const BYTE* pReadRow = data.data() + aFootprints[uMip].Offset + y * aFootprints[uMip].Footprint.RowPitch;
+				CHECK(std::memcmp(pReadRow, mips[uMip].data() + y * uRowSize, uRowSize) == 0);
+			}
+		}
+
+		CHECK(fixture.pDevice->GetDeviceRemovedReason() == S_OK);
+
+		pTexture->Destroy();
+	}
+
+	// The upload that brings the pending copies to MAX_NUM_PENDING_COPIES submits them on its own, and the
+	// copies staged after it go out with the next Flush
+	TEST_CASE(UploadBatcherFlushesWhenTooManyCopiesArePending)
+	{
+		constexpr const UINT64 UPLOAD_SIZE = 16u;
+		constexpr const UINT64 UPLOAD_STRIDE = 32u;
+		constexpr const UINT NUM_UPLOADS = static_cast<UINT>(UploadBatcher::MAX_NUM_PENDING_COPIES) + 1u;
+
+		UploadTestFixture fixture;
+		REQUIRE(SUCCEEDED(fixture.Initialize()));
+
+		std::unique_ptr<GpuResource> pBuffer;
+		REQUIRE(SUCCEEDED(fixture.CreateResource(pBuffer, CD3DX12_RESOURCE_DESC::Buffer(BUFFER_SIZE))));
+		REQUIRE(NUM_UPLOADS * UPLOAD_STRIDE <= BUFFER_SIZE);
+
+		// Every upload leaves a gap behind it, so none of them merge
+		std::vector<BYTE> expected(BUFFER_SIZE, 0);
+		for (UINT i = 0; i < NUM_UPLOADS; ++i)
+		{
+			BYTE aData[UPLOAD_SIZE];
+			for (UINT64 j = 0; j < UPLOAD_SIZE; ++j)
+			{
+				aData[j] = makeByte(j, i + 1);
+				expected[static_cast<size_t>(i * UPLOAD_STRIDE + j)] = aData[j];
+			}
+
+			REQUIRE(SUCCEEDED(fixture.pUploadBatcher->UploadBuffer(*pBuffer, i * UPLOAD_STRIDE, aData, UPLOAD_SIZE)));
+
+			if (i + 1 == UploadBatcher::MAX_NUM_PENDING_COPIES)
+			{
+				const UploadBatcherStatistics statistics = fixture.GetStatistics();
+				CHECK(statistics.uNumSubmissions == 1);
+				CHECK(statistics.uNumBufferCopies == UploadBatcher::MAX_NUM_PENDING_COPIES);
+				CHECK(fixture.pUploadBatcher->GetLastFenceValue() != 0);
+			}
+		}
+
+		UINT64 uFenceValue = 0;
+		REQUIRE(SUCCEEDED(fixture.pUploadBatcher->Flush(uFenceValue)));
+
+		const UploadBatcherStatistics statistics = fixture.GetStatistics();
+		CHECK(statistics.uNumBufferUploads == NUM_UPLOADS);
+		CHECK(statistics.uNumBufferCopies == NUM_UPLOADS);
+		CHECK(statistics.uNumSubmissions == 2);
+
+		// Nothing left to submit, Flush hands back the fence of the last batch
+		UINT64 uEmptyFenceValue = 0;
+		REQUIRE(SUCCEEDED(fixture.pUploadBatcher->Flush(uEmptyFenceValue)));
+		CHECK(uEmptyFenceValue == uFenceValue);
+		CHECK(fixture.GetStatistics().uNumSubmissions == 2);
+
+		std::vector<BYTE> data;
+		REQUIRE(SUCCEEDED(fixture.ReadBack(data, *pBuffer)));
+		REQUIRE(data.size() >= BUFFER_SIZE);
+		CHECK(std::memcmp(data.data(), expected.data(), static_cast<size_t>(BUFFER_SIZE)) == 0);
+		CHECK(fixture.pDevice->GetDeviceRemovedReason() == S_OK);
+
+		pBuffer->Destroy();
+	}
+}
@@ -0,0 +1,33 @@
+#include "Test.h"
+
+namespace esperanza::tests
+{
+	namespace
+	{
+		std::atomic<size_t> s_uNumFailures = 0;
+	}
+
+	TestRegistrar::TestRegistrar(const char* pszName, PFN_TEST pfnRun) noexcept
+	{
+		GetTests().push_back({ .pszName = pszName, .pfnRun = pfnRun });
+	}
+
+	std::vector<TestCase>& GetTests() noexcept
+	{
+		// Function local so registration from other translation units never sees it uninitialized
+		static std::vector<TestCase> s_Tests;
+
+		return s_Tests;
+	}
+
+	void ReportFailure(const char* pszFileName, INT nLineNumber, const char* pszExpression) noexcept
+	{
+		printf("%s(%d): check failed: %s\n", pszFileName, nLineNumber, pszExpression);
+		s_uNumFailures.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	size_t GetNumFailures() noexcept
+	{
+		return s_uNumFailures.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Pch.h"
+
+#include <cstdio>
+
+namespace esperanza::tests
+{
+	typedef void (*PFN_TEST)();
+
+	struct TestCase
+	{
+		const char* pszName;
+		PFN_TEST pfnRun;
+	};
+
+	class TestRegistrar final
+	{
+	public:
+		explicit TestRegistrar(_In_ const char* pszName, _In_ PFN_TEST pfnRun) noexcept;
+	};
+
+	std::vector<TestCase>& GetTests() noexcept;
+
+	void ReportFailure(_In_ const char* pszFileName, _In_ INT nLineNumber, _In_ const char* pszExpression) noexcept;
+	size_t GetNumFailures() noexcept;
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const esperanza::tests::TestRegistrar s_##name##Registrar(#name, name); \
+	static void name()
+
+// Keeps running the test after a failed check
+#define CHECK(expression) \
+	((expression) ? static_cast<void>(0) : esperanza::tests::ReportFailure(__FILE__, __LINE__, #expression))
+
+// Leaves the test after a failed check, for conditions the rest of the test relies on
+#define REQUIRE(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			esperanza::tests::ReportFailure(__FILE__, __LINE__, #expression); \
+			return; \
+		} \
+	} while (false)